@@ -0,0 +1,166 @@
+#include "CgiCache.hpp"
+#include "utils/StringUtils.hpp"
+#include "utils/Logger.hpp"
+#include <cstdlib>
+
+namespace wsv
+{
+
+CgiCache::CgiCache()
+{ }
+
+CgiCache::~CgiCache()
+{ }
+
+// ========================================
+// Key and Cacheability
+// ========================================
+
+std::string CgiCache::makeKey(const HttpRequest& request,
+                              const LocationConfig& location,
+                              const ServerConfig& server)
+{
+    std::string key = server.host + ":" + StringUtils::toString(server.listen_port)
+                    + request.getPath() + "?" + request.getQuery();
+
+    // Only the headers named in the directive vary the key
+    for (size_t i = 0; i < location.cgi_cache_key_headers.size(); ++i)
+    {
+        const std::string& name = location.cgi_cache_key_headers[i];
+        key += "\n" + StringUtils::toLower(name) + ": " + request.getHeader(name);
+    }
+    return key;
+}
+
+int CgiCache::storableTtl(int status, const HeaderMap& cgi_headers, int default_ttl)
+{
+    if (status != 200)
+        return 0;
+
+    int ttl = default_ttl;
+    for (HeaderMap::const_iterator it = cgi_headers.begin(); it != cgi_headers.end(); ++it)
+    {
+        std::string name = StringUtils::toLower(it->first);
+
+        // Per-user responses never go into a shared cache
+        if (name == "set-cookie")
+            return 0;
+        if (name != "cache-control")
+            continue;
+
+        std::vector<std::string> directives = StringUtils::split(StringUtils::toLower(it->second), ",");
+        for (size_t i = 0; i < directives.size(); ++i)
+        {
+            std::string directive = StringUtils::trim(directives[i]);
+            if (directive == "no-store" || directive == "no-cache" || directive == "private")
+                return 0;
+            if (StringUtils::startsWith(directive, "max-age="))
+                ttl = std::atoi(directive.c_str() + 8);
+        }
+    }
+    return ttl > 0 ? ttl : 0;
+}
+
+// ========================================
+// Entries
+// ========================================
+
+bool CgiCache::lookup(const std::string& key, HttpResponse& response, std::time_t now)
+{
+    std::map<std::string, Entry>::iterator it = _entries.find(key);
+    if (it == _entries.end())
+        return false;
+
+    if (now >= it->second.expires)
+    {
+        _entries.erase(it);
+        return false;
+    }
+
+    response = it->second.response;
+    response.setHeader("Age", StringUtils::toString(static_cast<int>(now - it->second.stored_at)));
+    return true;
+}
+
+void CgiCache::store(const std::string& key, const HttpResponse& response, int ttl, std::time_t now)
+{
+    if (ttl <= 0)
+        return;
+
+    if (_entries.size() >= MAX_ENTRIES && _entries.find(key) == _entries.end())
+    {
+        _purgeExpired(now);
+        if (_entries.size() >= MAX_ENTRIES)
+            _entries.erase(_entries.begin());
+    }
+
+    Entry& entry = _entries[key];
+    entry.response = response;
+    entry.stored_at = now;
+    entry.expires = now + ttl;
+    Logger::debug("CGI cache stored {} for {} seconds", key, ttl);
+}
+
+size_t CgiCache::size() const
+{
+    return _entries.size();
+}
+
+void CgiCache::_purgeExpired(std::time_t now)
+{
+    std::map<std::string, Entry>::iterator it = _entries.begin();
+    while (it != _entries.end())
+    {
+        if (now >= it->second.expires)
+            _entries.erase(it++);
+        else
+            ++it;
+    }
+}
+
+// ========================================
+// Request Coalescing
+// ========================================
+
+bool CgiCache::joinFlight(const std::string& key, int client_fd)
+{
+    std::map<std::string, std::vector<int> >::iterator it = _flights.find(key);
+    if (it == _flights.end())
+    {
+        _flights[key];  // The caller leads this key
+        return false;
+    }
+    it->second.push_back(client_fd);
+    return true;
+}
+
+std::vector<int> CgiCache::finishFlight(const std::string& key)
+{
+    std::vector<int> waiters;
+    std::map<std::string, std::vector<int> >::iterator it = _flights.find(key);
+    if (it != _flights.end())
+    {
+        waiters.swap(it->second);
+        _flights.erase(it);
+    }
+    return waiters;
+}
+
+void CgiCache::leaveFlight(const std::string& key, int client_fd)
+{
+    std::map<std::string, std::vector<int> >::iterator it = _flights.find(key);
+    if (it == _flights.end())
+        return;
+
+    std::vector<int>& waiters = it->second;
+    for (size_t i = 0; i < waiters.size(); ++i)
+    {
+        if (waiters[i] == client_fd)
+        {
+            waiters.erase(waiters.begin() + i);
+            return;
+        }
+    }
+}
+
+} // namespace wsv
@@ -0,0 +1,93 @@
+#ifndef CGI_CACHE_HPP
+#define CGI_CACHE_HPP
+
+#include <string>
+#include <map>
+#include <vector>
+#include <ctime>
+#include "http/HttpRequest.hpp"
+#include "http/HttpResponse.hpp"
+#include "config/ConfigParser.hpp"
+
+namespace wsv
+{
+
+/**
+ * CgiCache - Shared cache of CGI responses for `cgi_cache` locations
+ *
+ * Features:
+ * - Keys are server + path + QUERY_STRING + the headers listed in the directive
+ * - Entries expire after the location TTL, or the script's Cache-Control max-age
+ * - Request coalescing: while one CGI run (the leader) produces a key, identical
+ *   requests wait for its result instead of starting their own process
+ *
+ * Stored responses carry no Connection header; it is set per client on send.
+ */
+class CgiCache
+{
+public:
+	typedef std::map<std::string, std::string> HeaderMap;
+
+	static const size_t MAX_ENTRIES = 1024;
+
+	CgiCache();
+	~CgiCache();
+
+	/**
+	 * Build the cache key of a request
+	 * @return Key string, stable for identical path, query and key headers
+	 */
+	static std::string makeKey(const HttpRequest& request,
+	                           const LocationConfig& location,
+	                           const ServerConfig& server);
+
+	/**
+	 * Decide how long a CGI response may be stored
+	 * @param status HTTP status of the response
+	 * @param cgi_headers Headers emitted by the script
+	 * @param default_ttl TTL from the location's cgi_cache directive
+	 * @return Seconds to keep the response, 0 if it must not be stored
+	 */
+	static int storableTtl(int status, const HeaderMap& cgi_headers, int default_ttl);
+
+	// Copy a fresh entry into response (Age header set); false on miss or expiry
+	bool	lookup(const std::string& key, HttpResponse& response, std::time_t now);
+	void	store(const std::string& key, const HttpResponse& response, int ttl, std::time_t now);
+	size_t	size() const;
+
+	// ===== Request Coalescing =====
+
+	/**
+	 * Register a cache miss
+	 * @return false if the caller becomes the leader and must run the CGI,
+	 *         true if it was queued behind a run already in flight
+	 */
+	bool	joinFlight(const std::string& key, int client_fd);
+
+	// Close the flight of a key and hand back the clients waiting on it
+	std::vector<int>	finishFlight(const std::string& key);
+
+	// Drop a waiting client (disconnect or timeout)
+	void	leaveFlight(const std::string& key, int client_fd);
+
+private:
+	struct Entry
+	{
+		HttpResponse	response;
+		std::time_t		stored_at;
+		std::time_t		expires;
+	};
+
+	std::map<std::string, Entry>				_entries;
+	std::map<std::string, std::vector<int> >	_flights;  // key -> waiting client fds
+
+	void	_purgeExpired(std::time_t now);
+
+	// Forbidden copy
+	CgiCache(const CgiCache&);
+	CgiCache& operator=(const CgiCache&);
+};
+
+} // namespace wsv
+
+#endif
@@ -1,9 +1,15 @@
 #include "CgiHandler.hpp"
+#include "utils/StringUtils.hpp"
+#include "utils/ByteScan.hpp"
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include <cstring>
 #include <cerrno>
 #include <sstream>
@@ -13,6 +19,8 @@
 namespace wsv
 {
 
+std::vector<pid_t> CgiHandler::_orphans;
+
 // ========================================
 // _PipeSet Implementation
 // ========================================
@@ -25,17 +33,24 @@ CgiHandler::_PipeSet::_PipeSet()
     output_pipe[1] = -1;
 }
 
+// Pipes are created close-on-exec so they never leak into other CGI
+// children; the spawn file actions dup2 the child ends onto stdin/stdout,
+// which clears the flag on the duplicates only.
 void CgiHandler::_PipeSet::_createPipes()
 {
-    if (pipe(input_pipe) == -1)
+    if (pipe2(input_pipe, O_CLOEXEC) == -1)
         throw PipeFailed();
 
-    if (pipe(output_pipe) == -1)
+    if (pipe2(output_pipe, O_CLOEXEC) == -1)
     {
         close(input_pipe[0]);
         close(input_pipe[1]);
         throw PipeFailed();
     }
+
+    // Best effort: unprivileged processes are capped by /proc/sys/fs/pipe-max-size.
+    // A large stdout pipe lets splice() relay big bodies in few calls.
+    fcntl(output_pipe[0], F_SETPIPE_SZ, STDOUT_PIPE_SIZE);
 }
 
 void CgiHandler::_PipeSet::_closeAll()
@@ -55,15 +70,6 @@ void CgiHandler::_PipeSet::_closeAll()
     }
 }
 
-void CgiHandler::_PipeSet::_setupForChild()
-{
-    close(input_pipe[1]);
-    close(output_pipe[0]);
-    // Child keeps input_pipe[0] (read from parent) and output_pipe[1] (write to parent)
-    input_pipe[1] = -1;
-    output_pipe[0] = -1;
-}
-
 void CgiHandler::_PipeSet::_setupForParent()
 {
     close(input_pipe[0]);
@@ -98,7 +104,11 @@ char** CgiHandler::_EnvironmentBuilder::_getEnvironmentArray()
 // ========================================
 
 CgiHandler::CgiHandler()
-    : _timeout(DEFAULT_TIMEOUT), _child_pid(-1)
+    : _timeout(DEFAULT_TIMEOUT)
+    , _child_pid(-1)
+    , _pid_fd(-1)
+    , _exited(false)
+    , _exit_status(0)
 {
 }
 
@@ -107,6 +117,9 @@ CgiHandler::CgiHandler(const std::string& cgi_bin, const std::string& script_pat
     , _script_path(script_path)
     , _timeout(DEFAULT_TIMEOUT)
     , _child_pid(-1)
+    , _pid_fd(-1)
+    , _exited(false)
+    , _exit_status(0)
 {
 }
 
@@ -115,14 +128,18 @@ CgiHandler::~CgiHandler()
     // Only close pipes we still own (not externally closed)
     // Note: _pipes.input_pipe[1] and _pipes.output_pipe[0] are the parent's FDs
     _pipes._closeAll();
-    
-    if (_child_pid > 0)
+
+    if (_pid_fd != -1)
+        close(_pid_fd);
+
+    if (_child_pid > 0 && !_exited)
     {
         // Non-blocking cleanup for async I/O architecture
-        // SIGKILL is sent immediately, and we use WNOHANG to avoid blocking
-        // The actual waitpid will be called by the Server's epoll handler
+        // SIGKILL is sent immediately; if the child is not gone yet it is
+        // remembered and reaped later by reapOrphans() from the event loop
         kill(_child_pid, SIGKILL);
-        waitpid(_child_pid, NULL, WNOHANG);
+        if (waitpid(_child_pid, NULL, WNOHANG) == 0)
+            _orphans.push_back(_child_pid);
     }
 }
 
@@ -146,6 +163,11 @@ void CgiHandler::setEnvironmentVariable(const std::string& key, const std::strin
 }
 
 void CgiHandler::setInput(const std::string& input)
+{
+    _input = SharedBuffer(input);
+}
+
+void CgiHandler::setInput(const SharedBuffer& input)
 {
     _input = input;
 }
@@ -155,6 +177,16 @@ void CgiHandler::setTimeout(unsigned int seconds)
     _timeout = seconds;
 }
 
+void CgiHandler::setLimits(const Limits& limits)
+{
+    _limits = limits;
+}
+
+void CgiHandler::setFastCgiPass(const std::string& socket_path)
+{
+    _fastcgi_pass = socket_path;
+}
+
 // ========================================
 // Non-Blocking Execution API
 // ========================================
@@ -166,30 +198,68 @@ pid_t CgiHandler::start()
 
     _pipes._createPipes();
 
-    _child_pid = fork();
+    bool limit_failed = false;
+    if (_limits.empty())
+        _child_pid = _spawnChild(env_builder);
+    else
+        _child_pid = _spawnLimitedChild(env_builder, limit_failed);
 
     if (_child_pid < 0)
     {
         _pipes._closeAll();
-        throw ForkFailed();
+        if (limit_failed)
+            throw LimitFailed();
+        throw SpawnFailed();
     }
 
-    if (_child_pid == 0)
+    _pipes._setupForParent();
+
+    // pidfd lets the event loop observe the child's exit (Linux >= 5.3)
+#ifdef SYS_pidfd_open
+    _pid_fd = static_cast<int>(syscall(SYS_pidfd_open, _child_pid, 0));
+#endif
+
+    // Set parent pipes to non-blocking
+    if (fcntl(_pipes.input_pipe[1], F_SETFL, O_NONBLOCK) == -1)
+         throw PipeFailed();
+    if (fcntl(_pipes.output_pipe[0], F_SETFL, O_NONBLOCK) == -1)
+         throw PipeFailed();
+    
+    return _child_pid;
+}
+
+bool CgiHandler::reap()
+{
+    if (_exited || _child_pid <= 0)
+        return _exited;
+
+    int status = 0;
+    if (waitpid(_child_pid, &status, WNOHANG) == _child_pid)
     {
-        _executeInChild(_pipes, env_builder);
+        _exited = true;
+        _exit_status = status;
     }
-    else
+    return _exited;
+}
+
+void CgiHandler::reapOrphans()
+{
+    for (size_t i = 0; i < _orphans.size(); )
     {
-        _pipes._setupForParent();
-        
-        // Set parent pipes to non-blocking
-        if (fcntl(_pipes.input_pipe[1], F_SETFL, O_NONBLOCK) == -1)
-             throw PipeFailed();
-        if (fcntl(_pipes.output_pipe[0], F_SETFL, O_NONBLOCK) == -1)
-             throw PipeFailed();
+        if (waitpid(_orphans[i], NULL, WNOHANG) == 0)
+            ++i;
+        else
+        {
+            _orphans[i] = _orphans.back();
+            _orphans.pop_back();
+        }
     }
-    
-    return _child_pid;
+}
+
+void CgiHandler::prepareFastCgiRequest()
+{
+    _fastcgi_parser.reset();
+    _fastcgi_request = FastCgi::encodeRequest(1, _environment, _input.str(), true);
 }
 
 void CgiHandler::closeStdin()
@@ -212,85 +282,329 @@ void CgiHandler::closePipes()
 
 void CgiHandler::parseCgiOutput(const std::string& raw_output, HeaderMap& headers, std::string& body)
 {
-    size_t header_end = raw_output.find("\r\n\r\n");
-    size_t sep_len = 4;
+    // Header lines end with \r\n or \n; one pass finds line ends and colons
+    static const size_t LINES_PER_SCAN = 32;
+    ByteScan::Line lines[LINES_PER_SCAN];
+    ByteScan::LineScan scan;
+    HeaderMap found;
+    const char* data = raw_output.data();
+
+    while (true)
+    {
+        size_t count = ByteScan::scanLines(data, raw_output.size(), scan, lines, LINES_PER_SCAN);
+        if (count == 0)
+        {
+            // No headers found, treat entire output as body? Or error?
+            // RFC suggests there should be headers. But if missing, maybe just body.
+            body = raw_output;
+            return;
+        }
 
-    if (header_end == std::string::npos)
+        for (size_t i = 0; i < count; ++i)
+        {
+            const ByteScan::Line& line = lines[i];
+            if (line.end == line.start)
+            {
+                for (HeaderMap::const_iterator it = found.begin(); it != found.end(); ++it)
+                    headers[it->first] = it->second;
+                body = raw_output.substr(line.next);
+                return;
+            }
+            if (line.colon == ByteScan::npos)
+                continue;
+
+            size_t start = line.colon + 1;
+            while (start < line.end && (data[start] == ' ' || data[start] == '\t'))
+                ++start;
+            found[raw_output.substr(line.start, line.colon - line.start)]
+                = raw_output.substr(start, line.end - start);
+        }
+    }
+}
+
+bool CgiHandler::getFileDelegation(const HeaderMap& headers, std::string& target, bool& is_uri)
+{
+    for (HeaderMap::const_iterator it = headers.begin(); it != headers.end(); ++it)
     {
-        header_end = raw_output.find("\n\n");
-        sep_len = 2;
+        std::string name = StringUtils::toLower(it->first);
+        if (name != "x-accel-redirect" && name != "x-sendfile")
+            continue;
+        if (it->second.empty())
+            continue;
+
+        target = it->second;
+        is_uri = (name == "x-accel-redirect");
+        return true;
     }
+    return false;
+}
 
-    if (header_end == std::string::npos)
+int CgiHandler::parseStatus(const std::string& value)
+{
+    std::string status = StringUtils::trim(value);
+    if (status.size() < 3 || (status.size() > 3 && status[3] != ' '))
+        return 0;
+    int code = 0;
+    for (size_t i = 0; i < 3; ++i)
     {
-        // No headers found, treat entire output as body? Or error?
-        // RFC suggests there should be headers. But if missing, maybe just body.
-        body = raw_output;
-        return;
+        if (status[i] < '0' || status[i] > '9')
+            return 0;
+        code = code * 10 + (status[i] - '0');
     }
+    return (code >= 100 && code <= 599) ? code : 0;
+}
 
-    std::string headers_str = raw_output.substr(0, header_end);
-    body = raw_output.substr(header_end + sep_len);
+// ========================================
+// Child Process Spawning
+// ========================================
 
-    std::istringstream stream(headers_str);
-    std::string line;
+/**
+ * posix_spawn shares the parent's address space until execve (glibc uses
+ * clone(CLONE_VM|CLONE_VFORK)), so spawn cost does not grow with the
+ * server's RSS. Every server fd is close-on-exec; closefrom(3) is added
+ * as a second line of defence where the C library supports it.
+ */
+pid_t CgiHandler::_spawnChild(_EnvironmentBuilder& env)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
 
-    while (std::getline(stream, line))
+    if (posix_spawn_file_actions_init(&actions) != 0)
+        return -1;
+    if (posix_spawnattr_init(&attr) != 0)
     {
-        if (!line.empty() && line[line.size() - 1] == '\r')
-            line.erase(line.size() - 1);
+        posix_spawn_file_actions_destroy(&actions);
+        return -1;
+    }
 
-        size_t pos = line.find(':');
-        if (pos == std::string::npos)
-            continue;
+    posix_spawn_file_actions_adddup2(&actions, _pipes.input_pipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, _pipes.output_pipe[1], STDOUT_FILENO);
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+    posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+#endif
+
+    // The server ignores SIGPIPE; scripts expect the default disposition
+    sigset_t default_signals;
+    sigemptyset(&default_signals);
+    sigaddset(&default_signals, SIGPIPE);
+    sigset_t empty_mask;
+    sigemptyset(&empty_mask);
+    posix_spawnattr_setsigdefault(&attr, &default_signals);
+    posix_spawnattr_setsigmask(&attr, &empty_mask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
 
-        std::string key = line.substr(0, pos);
-        std::string value = line.substr(pos + 1);
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(_cgi_bin.c_str()));
+    argv.push_back(const_cast<char*>(_script_path.c_str()));
+    argv.push_back(NULL);
 
-        size_t start = value.find_first_not_of(" \t");
-        value = (start == std::string::npos) ? "" : value.substr(start);
+    pid_t pid = -1;
+    int result = posix_spawn(&pid, _cgi_bin.c_str(), &actions, &attr,
+                             &argv[0], env._getEnvironmentArray());
 
-        headers[key] = value;
-    }
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    return (result == 0) ? pid : -1;
 }
 
 // ========================================
-// Child Process Execution
+// Resource Isolation
 // ========================================
 
-void CgiHandler::_executeInChild(const _PipeSet& pipes, _EnvironmentBuilder& env)
+namespace
 {
-    _redirectChildIO(pipes);
-    _executeCGIScript(env);
-    std::exit(EXIT_CGI_FAILED);
+
+enum SpawnError
+{
+    SPAWN_OK,
+    SPAWN_LIMIT_FAILED,
+    SPAWN_EXEC_FAILED
+};
+
+// Everything the vfork child needs, prepared by the parent
+struct LimitedSpawn
+{
+    __rlimit_resource_t resources[3];
+    struct rlimit       limits[3];
+    size_t              limit_count;
+    const char*         cgroup_procs;   // NULL: no cgroup
+    int                 stdin_fd;
+    int                 stdout_fd;
+    const char*         path;
+    char* const*        argv;
+    char* const*        envp;
+    volatile int        error;          // SpawnError, written by the child before it exits
+};
+
+// Soft limit = value, hard limit = value + hard_extra, both capped by the current hard limit
+bool add_limit(LimitedSpawn& spawn, __rlimit_resource_t resource, unsigned long value, unsigned long hard_extra)
+{
+    struct rlimit current;
+    if (getrlimit(resource, &current) == -1)
+        return false;
+
+    struct rlimit& limit = spawn.limits[spawn.limit_count];
+    limit.rlim_cur = value;
+    limit.rlim_max = value + hard_extra;
+    if (current.rlim_max != RLIM_INFINITY)
+    {
+        if (limit.rlim_max > current.rlim_max)
+            limit.rlim_max = current.rlim_max;
+        if (limit.rlim_cur > limit.rlim_max)
+            limit.rlim_cur = limit.rlim_max;
+    }
+    spawn.resources[spawn.limit_count++] = resource;
+    return true;
 }
 
-void CgiHandler::_redirectChildIO(const _PipeSet& pipes)
+// dup2 that also clears close-on-exec when the pipe end already has the target number
+bool map_fd(int fd, int target)
 {
-    if (dup2(pipes.input_pipe[0], STDIN_FILENO) == -1)
-        std::exit(EXIT_CGI_FAILED);
+    if (fd == target)
+        return fcntl(fd, F_SETFD, 0) == 0;
+    return dup2(fd, target) == target;
+}
 
-    if (dup2(pipes.output_pipe[1], STDOUT_FILENO) == -1)
-        std::exit(EXIT_CGI_FAILED);
+// Runs in the vfork child, on the parent's memory: plain syscalls on the
+// prepared data only, and it never returns
+void exec_limited(LimitedSpawn& spawn)
+{
+    for (size_t i = 0; i < spawn.limit_count; ++i)
+    {
+        if (setrlimit(spawn.resources[i], &spawn.limits[i]) == -1)
+        {
+            spawn.error = SPAWN_LIMIT_FAILED;
+            _exit(127);
+        }
+    }
+    if (spawn.cgroup_procs)
+    {
+        // "0" moves the writing process itself
+        int fd = open(spawn.cgroup_procs, O_WRONLY | O_CLOEXEC);
+        if (fd == -1 || write(fd, "0", 1) != 1)
+        {
+            spawn.error = SPAWN_LIMIT_FAILED;
+            _exit(127);
+        }
+        close(fd);
+    }
 
-    // Close all original pipe FDs as they are now duplicated
-    // Note: We need to close everything to avoid leaks in child
-    // _PipeSet::closeAll won't work easily here because it's const, 
-    
-    close(pipes.input_pipe[0]);
-    close(pipes.input_pipe[1]);
-    close(pipes.output_pipe[0]);
-    close(pipes.output_pipe[1]);
+    if (!map_fd(spawn.stdin_fd, STDIN_FILENO) || !map_fd(spawn.stdout_fd, STDOUT_FILENO))
+    {
+        spawn.error = SPAWN_EXEC_FAILED;
+        _exit(127);
+    }
+#ifdef SYS_close_range
+    syscall(SYS_close_range, STDERR_FILENO + 1, ~0U, 0);
+#endif
+
+    // The server's handlers must not run in the child; scripts also expect
+    // the default SIGPIPE. Signals stay blocked until this is done.
+    for (int sig = 1; sig < NSIG; ++sig)
+    {
+        struct sigaction action;
+        if (sigaction(sig, NULL, &action) == 0
+            && (sig == SIGPIPE || (action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN)))
+            signal(sig, SIG_DFL);
+    }
+    sigset_t empty_mask;
+    sigemptyset(&empty_mask);
+    sigprocmask(SIG_SETMASK, &empty_mask, NULL);
+
+    execve(spawn.path, spawn.argv, spawn.envp);
+    spawn.error = SPAWN_EXEC_FAILED;
+    _exit(127);
 }
 
-void CgiHandler::_executeCGIScript(_EnvironmentBuilder& env)
+} // namespace
+
+/**
+ * posix_spawn has no rlimit or cgroup attributes, and attaching them once it
+ * has returned leaves the interpreter running unlimited for a moment. With
+ * limits set, the child is started with vfork instead and sets its rlimits
+ * and joins the cgroup itself, before execve. Like posix_spawn, the parent
+ * is suspended until the child execs or exits, so a failure is reported
+ * synchronously.
+ */
+pid_t CgiHandler::_spawnLimitedChild(_EnvironmentBuilder& env, bool& limit_failed)
 {
+    LimitedSpawn spawn;
+    spawn.limit_count = 0;
+    if ((_limits.cpu_seconds && !add_limit(spawn, RLIMIT_CPU, _limits.cpu_seconds, 1))
+        || (_limits.address_space && !add_limit(spawn, RLIMIT_AS, _limits.address_space, 0))
+        || (_limits.open_files && !add_limit(spawn, RLIMIT_NOFILE, _limits.open_files, 0)))
+    {
+        limit_failed = true;
+        return -1;
+    }
+
+    std::string cgroup_procs = _limits.cgroup + "/cgroup.procs";
+    spawn.cgroup_procs = _limits.cgroup.empty() ? NULL : cgroup_procs.c_str();
+
     std::vector<char*> argv;
     argv.push_back(const_cast<char*>(_cgi_bin.c_str()));
     argv.push_back(const_cast<char*>(_script_path.c_str()));
     argv.push_back(NULL);
 
-    execve(_cgi_bin.c_str(), &argv[0], env._getEnvironmentArray());
+    spawn.stdin_fd = _pipes.input_pipe[0];
+    spawn.stdout_fd = _pipes.output_pipe[1];
+    spawn.path = _cgi_bin.c_str();
+    spawn.argv = &argv[0];
+    spawn.envp = env._getEnvironmentArray();
+    spawn.error = SPAWN_OK;
+
+    // No handler may run in the child while it shares the parent's stack
+    sigset_t all_signals;
+    sigset_t saved_mask;
+    sigfillset(&all_signals);
+    sigprocmask(SIG_SETMASK, &all_signals, &saved_mask);
+
+    pid_t pid = vfork();
+    if (pid == 0)
+        exec_limited(spawn);
+
+    sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+
+    if (pid > 0 && spawn.error != SPAWN_OK)
+    {
+        waitpid(pid, NULL, 0);
+        limit_failed = (spawn.error == SPAWN_LIMIT_FAILED);
+        return -1;
+    }
+    return pid;
+}
+
+bool CgiHandler::_writeControl(const std::string& path, const std::string& value)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    ssize_t written = write(fd, value.c_str(), value.size());
+    close(fd);
+    return written == static_cast<ssize_t>(value.size());
+}
+
+bool CgiHandler::prepareCgroup(const std::string& dir, const std::string& cpu_max, size_t memory_max)
+{
+    if (mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST)
+        return false;
+
+    // The controllers must be enabled in the parent for cpu.max / memory.max to exist.
+    // Best effort: they may already be on, or delegated by the service manager.
+    std::string parent = dir.substr(0, dir.find_last_of('/'));
+    if (!cpu_max.empty())
+        _writeControl(parent + "/cgroup.subtree_control", "+cpu");
+    if (memory_max > 0)
+        _writeControl(parent + "/cgroup.subtree_control", "+memory");
+
+    if (!cpu_max.empty() && !_writeControl(dir + "/cpu.max", cpu_max))
+        return false;
+    std::ostringstream memory;
+    memory << memory_max;
+    if (memory_max > 0 && !_writeControl(dir + "/memory.max", memory.str()))
+        return false;
+    return true;
 }
 
-} // namespace wsv
\ No newline at end of file
+} // namespace wsv
@@ -6,6 +6,9 @@
 #include <vector>
 #include <stdexcept>
 #include <sys/types.h>
+#include <sys/resource.h>
+#include "FastCgi.hpp"
+#include "utils/SharedBuffer.hpp"
 
 namespace wsv
 {
@@ -24,7 +27,7 @@ public:
 
     // Constants
     static const unsigned int DEFAULT_TIMEOUT = 30;
-    static const int EXIT_CGI_FAILED = 42;
+    static const int STDOUT_PIPE_SIZE = 1024 * 1024;  // Requested with F_SETPIPE_SZ
 
 
     // Exception Classes
@@ -34,10 +37,10 @@ public:
         PipeFailed() : std::runtime_error("Failed to create pipe") {}
     };
     
-    class ForkFailed : public std::runtime_error 
+    class SpawnFailed : public std::runtime_error 
     {
     public:
-        ForkFailed() : std::runtime_error("Failed to fork process") {}
+        SpawnFailed() : std::runtime_error("Failed to spawn CGI process") {}
     };
     
     class Timeout : public std::runtime_error 
@@ -64,6 +67,25 @@ public:
         OutputTooLarge() : std::runtime_error("CGI output exceeds maximum size") {}
     };
 
+    class LimitFailed : public std::runtime_error 
+    {
+    public:
+        LimitFailed() : std::runtime_error("Failed to apply CGI resource limits") {}
+    };
+
+    // Per-location isolation of the child (0 / empty = inherit from the server)
+    struct Limits
+    {
+        unsigned long cpu_seconds;      // RLIMIT_CPU: SIGXCPU, then SIGKILL one second later
+        unsigned long address_space;    // RLIMIT_AS in bytes
+        unsigned long open_files;       // RLIMIT_NOFILE
+        std::string cgroup;             // cgroup v2 directory the child joins
+
+        Limits() : cpu_seconds(0), address_space(0), open_files(0) {}
+
+        bool empty() const { return !cpu_seconds && !address_space && !open_files && cgroup.empty(); }
+    };
+
 
     // Constructors & Destructor
     CgiHandler();
@@ -76,30 +98,85 @@ public:
     void setScriptPath(const std::string& path);
     void setEnvironmentVariable(const std::string& key, const std::string& value);
     void setInput(const std::string& input);
+    void setInput(const SharedBuffer& input);   // Shares the bytes (request body), no copy
     void setTimeout(unsigned int seconds);
+    void setLimits(const Limits& limits);
+    void setFastCgiPass(const std::string& socket_path);
 
     // Getters
     std::string getCGIBin() const { return _cgi_bin; }
     std::string getScriptPath() const { return _script_path; }
     HeaderMap getEnvironment() const { return _environment; }
-    std::string getInput() const { return _input; }
+    const std::string& getInput() const { return _input.str(); }
+    unsigned int getTimeout() const { return _timeout; }
 
     int getStdinWriteFd() const { return _pipes.input_pipe[1]; }
     int getStdoutReadFd() const { return _pipes.output_pipe[0]; }
     pid_t getChildPid() const { return _child_pid; }
+    int getPidFd() const { return _pid_fd; }   // -1 if pidfd_open is unsupported
+    bool hasExited() const { return _exited; }
+    int getExitStatus() const { return _exit_status; }
+
+    // FastCGI mode: the request goes to a persistent worker instead of a child
+    bool isFastCgi() const { return !_fastcgi_pass.empty(); }
+    std::string getFastCgiPass() const { return _fastcgi_pass; }
+    const std::string& getFastCgiRequest() const { return _fastcgi_request; }
+    FastCgi::ResponseParser& getFastCgiParser() { return _fastcgi_parser; }
 
 
     // Helpers for parsing output after read is done
     static void parseCgiOutput(const std::string& raw_output, HeaderMap& headers, std::string& body);
 
+    /**
+     * Detect a file the script hands back to the server instead of sending it
+     * @param headers Parsed CGI headers
+     * @param target Internal URI (X-Accel-Redirect) or filesystem path (X-Sendfile)
+     * @param is_uri true for X-Accel-Redirect, false for X-Sendfile
+     * @return true if one of the headers is present
+     */
+    static bool getFileDelegation(const HeaderMap& headers, std::string& target, bool& is_uri);
+
+    /**
+     * Read the code of a CGI Status header ("404" or "404 Not Found")
+     * @return The code, or 0 if it is not three digits in 100-599
+     */
+    static int parseStatus(const std::string& value);
+
 
     // Non-Blocking Execution API
     /**
      * @brief Start the CGI process
+     * Spawned with posix_spawn (vfork-style, no page table copy); the child
+     * only inherits the two pipe ends mapped to stdin/stdout. With Limits set,
+     * the child applies them itself before it execs the interpreter
      * @return PID of the child process
      */
     pid_t start();
 
+    /**
+     * @brief Encode environment and input as FastCGI records
+     * Used instead of start() when a fastcgi_pass upstream is configured
+     */
+    void prepareFastCgiRequest();
+
+    /**
+     * @brief Collect the child's exit status without blocking (WNOHANG)
+     * @return true once the child has been reaped
+     */
+    bool reap();
+
+    // Reap children killed by ~CgiHandler that had not exited yet
+    static void reapOrphans();
+
+    /**
+     * @brief Create a cgroup v2 directory and write its controller limits
+     * Run once per configured cgi_cgroup at startup; children join it in start()
+     * @param cpu_max Content for cpu.max ("<quota> [period]" or "max"), empty to skip
+     * @param memory_max Bytes for memory.max, 0 to skip
+     * @return false if the directory or a limit file could not be written
+     */
+    static bool prepareCgroup(const std::string& dir, const std::string& cpu_max, size_t memory_max);
+
     void closeStdin();      // Call when finished writing input
     void closePipes();      // Call when finished everything or error
     void markStdinClosed()  { _pipes.input_pipe[1] = -1; }   // Mark as externally closed
@@ -116,7 +193,6 @@ private:
         
         void _createPipes();
         void _closeAll();
-        void _setupForChild();
         void _setupForParent();
     };
     
@@ -134,17 +210,27 @@ private:
     std::string _cgi_bin;
     std::string _script_path;
     HeaderMap _environment;
-    std::string _input;
+    SharedBuffer _input;
     unsigned int _timeout;
+    Limits _limits;
     
     _PipeSet _pipes;
     pid_t _child_pid;
+    int _pid_fd;            // Readable in epoll once the child exits
+    bool _exited;
+    int _exit_status;
+
+    static std::vector<pid_t> _orphans;
+
+    std::string _fastcgi_pass;              // Unix socket path of the worker
+    std::string _fastcgi_request;           // Encoded records to send
+    FastCgi::ResponseParser _fastcgi_parser;
 
 
     // Internal Methods
-    void _executeInChild(const _PipeSet& pipes, _EnvironmentBuilder& env);
-    void _redirectChildIO(const _PipeSet& pipes);
-    void _executeCGIScript(_EnvironmentBuilder& env);
+    pid_t _spawnChild(_EnvironmentBuilder& env);
+    pid_t _spawnLimitedChild(_EnvironmentBuilder& env, bool& limit_failed);
+    static bool _writeControl(const std::string& path, const std::string& value);
 };
 
 } // namespace wsv
@@ -0,0 +1,136 @@
+#include "CgiLimiter.hpp"
+#include "utils/StringUtils.hpp"
+#include "utils/Logger.hpp"
+#include <cstring>
+#include <time.h>
+
+namespace wsv
+{
+
+CgiLimiter::CgiLimiter()
+{
+    _busy.setStatus(503);
+    _busy.setContentType("text/html");
+    _busy.setHeader("Retry-After", StringUtils::toString(RETRY_AFTER));
+    _busy.setBody(HttpResponse::createErrorResponse(503).getBody());
+    _busy.freeze();
+}
+
+CgiLimiter::~CgiLimiter()
+{ }
+
+CgiLimiter::Admission CgiLimiter::admit(const LocationConfig& location, int client_fd)
+{
+    if (location.cgi_max_concurrent <= 0)
+        return ADMIT_RUN;
+
+    Slots& slots = _slotsFor(location);
+    if (slots.running < static_cast<size_t>(location.cgi_max_concurrent))
+    {
+        slots.running++;
+        slots.stats.running = slots.running;
+        return ADMIT_RUN;
+    }
+
+    if (slots.queue.size() >= static_cast<size_t>(location.cgi_queue))
+    {
+        slots.stats.total_rejected++;
+        Logger::info("CGI queue full for {} ({} waiting), rejecting client FD {}",
+                     location.path, slots.queue.size(), client_fd);
+        return ADMIT_REJECTED;
+    }
+
+    Waiter waiter;
+    waiter.client_fd = client_fd;
+    waiter.enqueued_ms = _nowMs();
+    slots.queue.push_back(waiter);
+
+    slots.stats.queued = slots.queue.size();
+    slots.stats.total_queued++;
+    if (slots.queue.size() > slots.stats.max_queued)
+        slots.stats.max_queued = slots.queue.size();
+    Logger::info("CGI limit reached for {}, client FD {} queued (depth {})",
+                 location.path, client_fd, slots.queue.size());
+    return ADMIT_QUEUED;
+}
+
+void CgiLimiter::release(const LocationConfig& location)
+{
+    Slots& slots = _slotsFor(location);
+    if (slots.running > 0)
+        slots.running--;
+    slots.stats.running = slots.running;
+}
+
+int CgiLimiter::nextQueued(const LocationConfig& location)
+{
+    Slots& slots = _slotsFor(location);
+    if (slots.queue.empty() || slots.running >= static_cast<size_t>(location.cgi_max_concurrent))
+        return -1;
+
+    Waiter waiter = slots.queue.front();
+    slots.queue.pop_front();
+    slots.running++;
+
+    long waited = _nowMs() - waiter.enqueued_ms;
+    slots.stats.running = slots.running;
+    slots.stats.queued = slots.queue.size();
+    slots.stats.total_wait_ms += waited;
+    if (waited > slots.stats.max_wait_ms)
+        slots.stats.max_wait_ms = waited;
+    Logger::info("CGI slot for client FD {} after {} ms in queue ({} still waiting)",
+                 waiter.client_fd, waited, slots.queue.size());
+    return waiter.client_fd;
+}
+
+void CgiLimiter::remove(const LocationConfig& location, int client_fd)
+{
+    Slots& slots = _slotsFor(location);
+    for (std::deque<Waiter>::iterator it = slots.queue.begin(); it != slots.queue.end(); ++it)
+    {
+        if (it->client_fd == client_fd)
+        {
+            slots.queue.erase(it);
+            slots.stats.queued = slots.queue.size();
+            return;
+        }
+    }
+}
+
+CgiLimiter::Stats CgiLimiter::getStats(const LocationConfig& location) const
+{
+    std::map<const LocationConfig*, Slots>::const_iterator it = _slots.find(&location);
+    if (it != _slots.end())
+        return it->second.stats;
+
+    Stats empty;
+    std::memset(&empty, 0, sizeof(empty));
+    return empty;
+}
+
+HttpResponse CgiLimiter::busyResponse() const
+{
+    return _busy;
+}
+
+CgiLimiter::Slots& CgiLimiter::_slotsFor(const LocationConfig& location)
+{
+    std::map<const LocationConfig*, Slots>::iterator it = _slots.find(&location);
+    if (it != _slots.end())
+        return it->second;
+
+    Slots& slots = _slots[&location];
+    slots.running = 0;
+    std::memset(&slots.stats, 0, sizeof(slots.stats));
+    return slots;
+}
+
+// Monotonic clock: queue waits must not jump with wall-clock changes
+long CgiLimiter::_nowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+} // namespace wsv
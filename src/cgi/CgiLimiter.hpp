@@ -0,0 +1,96 @@
+#ifndef CGI_LIMITER_HPP
+#define CGI_LIMITER_HPP
+
+#include <string>
+#include <map>
+#include <deque>
+#include "http/HttpResponse.hpp"
+#include "config/ConfigParser.hpp"
+
+namespace wsv
+{
+
+/**
+ * CgiLimiter - Per-location cap on running CGI processes with a FIFO wait queue
+ *
+ * A location with `cgi_max_concurrent N` runs at most N CGI requests at once.
+ * Up to `cgi_queue M` further requests wait (client state CLIENT_CGI_QUEUED)
+ * and are started in arrival order as slots free up; beyond that, requests are
+ * rejected with a pre-built 503 carrying Retry-After.
+ *
+ * Locations are identified by address: LocationConfig objects live in the
+ * server configuration for the whole run.
+ */
+class CgiLimiter
+{
+public:
+	enum Admission
+	{
+		ADMIT_RUN,		// Start now (slot taken if the location is limited)
+		ADMIT_QUEUED,	// Wait for a slot
+		ADMIT_REJECTED	// Queue full: answer with busyResponse()
+	};
+
+	struct Stats
+	{
+		size_t	running;
+		size_t	queued;
+		size_t	max_queued;		// Deepest queue seen
+		size_t	total_queued;	// Requests that had to wait
+		size_t	total_rejected;
+		long	total_wait_ms;	// Summed wait of dequeued requests
+		long	max_wait_ms;
+	};
+
+	static const int RETRY_AFTER = 1;  // Seconds suggested to rejected clients
+
+	CgiLimiter();
+	~CgiLimiter();
+
+	Admission	admit(const LocationConfig& location, int client_fd);
+
+	// Free the slot of a finished run
+	void		release(const LocationConfig& location);
+
+	/**
+	 * Hand the freed slot to the oldest waiting client
+	 * @return Its fd (the slot is now held for it), or -1 if none is waiting
+	 */
+	int			nextQueued(const LocationConfig& location);
+
+	// Drop a waiting client (disconnect or timeout)
+	void		remove(const LocationConfig& location, int client_fd);
+
+	Stats		getStats(const LocationConfig& location) const;
+
+	// 503 Service Unavailable with Retry-After; rendered and frozen once
+	HttpResponse	busyResponse() const;
+
+private:
+	struct Waiter
+	{
+		int		client_fd;
+		long	enqueued_ms;
+	};
+
+	struct Slots
+	{
+		size_t				running;
+		std::deque<Waiter>	queue;
+		Stats				stats;
+	};
+
+	std::map<const LocationConfig*, Slots>	_slots;
+	HttpResponse							_busy;
+
+	Slots&		_slotsFor(const LocationConfig& location);
+	static long	_nowMs();
+
+	// Forbidden copy
+	CgiLimiter(const CgiLimiter&);
+	CgiLimiter& operator=(const CgiLimiter&);
+};
+
+} // namespace wsv
+
+#endif
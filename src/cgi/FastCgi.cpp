@@ -0,0 +1,218 @@
+#include "FastCgi.hpp"
+#include "utils/Logger.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+
+namespace wsv
+{
+
+// ========================================
+// ResponseParser Implementation
+// ========================================
+
+FastCgi::ResponseParser::ResponseParser(unsigned short request_id)
+    : _request_id(request_id)
+    , _offset(0)
+    , _complete(false)
+    , _error(false)
+    , _app_status(0)
+{
+}
+
+void FastCgi::ResponseParser::reset()
+{
+    _buffer.clear();
+    _offset = 0;
+    _complete = false;
+    _error = false;
+    _app_status = 0;
+}
+
+bool FastCgi::ResponseParser::feed(const char* data, size_t len, std::string& stdout_data)
+{
+    _buffer.append(data, len);
+
+    while (!_complete && !_error && _buffer.size() - _offset >= HEADER_SIZE)
+    {
+        const unsigned char* header =
+            reinterpret_cast<const unsigned char*>(_buffer.data() + _offset);
+
+        if (header[0] != VERSION_1)
+        {
+            _error = true;
+            break;
+        }
+
+        unsigned char type = header[1];
+        unsigned short request_id = static_cast<unsigned short>((header[2] << 8) | header[3]);
+        size_t content_length = (static_cast<size_t>(header[4]) << 8) | header[5];
+        size_t padding_length = header[6];
+        size_t record_size = HEADER_SIZE + content_length + padding_length;
+
+        if (_buffer.size() - _offset < record_size)
+            break;  // Need more data
+
+        const char* content = _buffer.data() + _offset + HEADER_SIZE;
+
+        // Management records (id 0) and foreign ids are skipped
+        if (request_id == _request_id)
+        {
+            if (type == STDOUT)
+                stdout_data.append(content, content_length);
+            else if (type == STDERR && content_length > 0)
+                Logger::error("FastCGI stderr: {}", std::string(content, content_length));
+            else if (type == END_REQUEST)
+            {
+                if (content_length < 8)
+                {
+                    _error = true;
+                    break;
+                }
+                const unsigned char* body = reinterpret_cast<const unsigned char*>(content);
+                _app_status = static_cast<int>((static_cast<unsigned int>(body[0]) << 24)
+                                             | (static_cast<unsigned int>(body[1]) << 16)
+                                             | (static_cast<unsigned int>(body[2]) << 8)
+                                             | static_cast<unsigned int>(body[3]));
+                if (body[4] != REQUEST_COMPLETE)
+                    _error = true;
+                _complete = true;
+            }
+        }
+        _offset += record_size;
+    }
+
+    // Drop consumed records once the buffer is fully drained
+    if (_offset == _buffer.size())
+    {
+        _buffer.clear();
+        _offset = 0;
+    }
+
+    return _complete;
+}
+
+// ========================================
+// Request Encoding
+// ========================================
+
+std::string FastCgi::encodeRequest(unsigned short request_id,
+                                   const ParamMap& params,
+                                   const std::string& body,
+                                   bool keep_conn)
+{
+    std::string out;
+
+    // BEGIN_REQUEST: role (2), flags (1), reserved (5)
+    char begin[8];
+    std::memset(begin, 0, sizeof(begin));
+    begin[0] = static_cast<char>((ROLE_RESPONDER >> 8) & 0xFF);
+    begin[1] = static_cast<char>(ROLE_RESPONDER & 0xFF);
+    begin[2] = keep_conn ? static_cast<char>(FLAG_KEEP_CONN) : 0;
+    _appendRecord(out, BEGIN_REQUEST, request_id, begin, sizeof(begin));
+
+    // PARAMS: name-value pairs, terminated by an empty record
+    std::string encoded_params;
+    for (ParamMap::const_iterator it = params.begin(); it != params.end(); ++it)
+    {
+        _appendLength(encoded_params, it->first.size());
+        _appendLength(encoded_params, it->second.size());
+        encoded_params += it->first;
+        encoded_params += it->second;
+    }
+    _appendStream(out, PARAMS, request_id, encoded_params);
+
+    // STDIN: request body, terminated by an empty record
+    _appendStream(out, STDIN, request_id, body);
+
+    return out;
+}
+
+void FastCgi::_appendRecord(std::string& out, unsigned char type,
+                            unsigned short request_id,
+                            const char* data, size_t len)
+{
+    // Pad content to a multiple of 8 bytes as recommended by the spec
+    size_t padding = (8 - (len % 8)) % 8;
+
+    char header[HEADER_SIZE];
+    header[0] = static_cast<char>(VERSION_1);
+    header[1] = static_cast<char>(type);
+    header[2] = static_cast<char>((request_id >> 8) & 0xFF);
+    header[3] = static_cast<char>(request_id & 0xFF);
+    header[4] = static_cast<char>((len >> 8) & 0xFF);
+    header[5] = static_cast<char>(len & 0xFF);
+    header[6] = static_cast<char>(padding);
+    header[7] = 0;
+
+    out.append(header, HEADER_SIZE);
+    out.append(data, len);
+    out.append(padding, '\0');
+}
+
+void FastCgi::_appendStream(std::string& out, unsigned char type,
+                            unsigned short request_id,
+                            const std::string& data)
+{
+    for (size_t pos = 0; pos < data.size(); pos += MAX_CONTENT_LENGTH)
+    {
+        size_t chunk = data.size() - pos;
+        if (chunk > MAX_CONTENT_LENGTH)
+            chunk = MAX_CONTENT_LENGTH;
+        _appendRecord(out, type, request_id, data.data() + pos, chunk);
+    }
+    // Empty record closes the stream
+    _appendRecord(out, type, request_id, "", 0);
+}
+
+// Name/value lengths: 1 byte below 128, otherwise 4 bytes with the high bit set
+void FastCgi::_appendLength(std::string& out, size_t len)
+{
+    if (len < 128)
+    {
+        out += static_cast<char>(len);
+        return;
+    }
+    out += static_cast<char>(((len >> 24) & 0x7F) | 0x80);
+    out += static_cast<char>((len >> 16) & 0xFF);
+    out += static_cast<char>((len >> 8) & 0xFF);
+    out += static_cast<char>(len & 0xFF);
+}
+
+// ========================================
+// Connection Helper
+// ========================================
+
+int FastCgi::connectUnix(const std::string& path)
+{
+    struct sockaddr_un addr;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1 || fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0
+        && errno != EINPROGRESS)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace wsv
@@ -0,0 +1,116 @@
+#ifndef FASTCGI_HPP
+#define FASTCGI_HPP
+
+#include <string>
+#include <map>
+
+namespace wsv
+{
+
+/**
+ * FastCgi - FastCGI/1.0 record encoding and decoding (Responder role)
+ *
+ * Features:
+ * - Encodes BEGIN_REQUEST, PARAMS and STDIN streams into one byte buffer
+ * - Decodes STDOUT/STDERR/END_REQUEST records progressively (partial data)
+ * - Requests FCGI_KEEP_CONN so the connection can go back to the pool
+ *
+ * Only one request is in flight per connection; connections are reused
+ * sequentially through the Server's UpstreamPool.
+ */
+class FastCgi
+{
+public:
+    // ===== Type Definitions =====
+    typedef std::map<std::string, std::string> ParamMap;
+
+    enum RecordType
+    {
+        BEGIN_REQUEST   = 1,
+        ABORT_REQUEST   = 2,
+        END_REQUEST     = 3,
+        PARAMS          = 4,
+        STDIN           = 5,
+        STDOUT          = 6,
+        STDERR          = 7
+    };
+
+    // ===== Constants =====
+    static const unsigned char  VERSION_1 = 1;
+    static const unsigned short ROLE_RESPONDER = 1;
+    static const unsigned char  FLAG_KEEP_CONN = 1;
+    static const unsigned char  REQUEST_COMPLETE = 0;   // END_REQUEST protocolStatus
+    static const size_t         HEADER_SIZE = 8;
+    static const size_t         MAX_CONTENT_LENGTH = 65535;
+
+    /**
+     * Progressive decoder for the records sent back by the application
+     *
+     * Usage:
+     *   parser.feed(buffer, n, stdout_data);
+     *   if (parser.hasError()) -> 502
+     *   if (parser.isComplete()) -> stdout_data holds the CGI-style output
+     */
+    class ResponseParser
+    {
+    public:
+        explicit ResponseParser(unsigned short request_id = 1);
+
+        /**
+         * Consume bytes read from the connection
+         * STDOUT content is appended to stdout_data, STDERR is logged
+         * @return true once END_REQUEST for our request id was received
+         */
+        bool feed(const char* data, size_t len, std::string& stdout_data);
+
+        void reset();
+
+        bool isComplete() const { return _complete; }
+        bool hasError() const { return _error; }
+        int getAppStatus() const { return _app_status; }
+
+        // Bytes received after END_REQUEST (connection must not be reused)
+        size_t getTrailingBytes() const { return _buffer.size() - _offset; }
+
+    private:
+        unsigned short  _request_id;
+        std::string     _buffer;
+        size_t          _offset;
+        bool            _complete;
+        bool            _error;
+        int             _app_status;
+    };
+
+    /**
+     * Encode a full Responder request
+     * @param request_id FastCGI request id (non-zero)
+     * @param params CGI/1.1 environment sent as FCGI_PARAMS
+     * @param body Request body sent as FCGI_STDIN
+     * @param keep_conn Ask the application to keep the connection open
+     * @return Bytes to write to the application socket
+     */
+    static std::string encodeRequest(unsigned short request_id,
+                                     const ParamMap& params,
+                                     const std::string& body,
+                                     bool keep_conn);
+
+    /**
+     * Open a non-blocking stream connection to a Unix domain socket
+     * @param path Filesystem path of the socket (without "unix:")
+     * @return Connected (or connecting) fd, -1 on failure
+     */
+    static int connectUnix(const std::string& path);
+
+private:
+    static void _appendRecord(std::string& out, unsigned char type,
+                              unsigned short request_id,
+                              const char* data, size_t len);
+    static void _appendStream(std::string& out, unsigned char type,
+                              unsigned short request_id,
+                              const std::string& data);
+    static void _appendLength(std::string& out, size_t len);
+};
+
+} // namespace wsv
+
+#endif
@@ -17,6 +17,17 @@ LocationConfig::LocationConfig()
 	, redirect_code(0) 
 	, upload_enable(false) 
 	, client_max_body_size(0)
+	, cgi_cache_ttl(0)
+	, cgi_max_concurrent(0)
+	, cgi_queue(0)
+	, cgi_timeout(0)
+	, cgi_rlimit_cpu(0)
+	, cgi_rlimit_as(0)
+	, cgi_rlimit_nofile(0)
+	, cgi_cgroup_memory_max(0)
+	, proxy_port(0)
+	, proxy_connect_timeout(0)
+	, proxy_read_timeout(0)
 { 
 	allow_methods.push_back("GET"); 
 }
@@ -37,71 +48,54 @@ ServerConfig::ServerConfig()
 	, listen_port(8080) 
 	, root("/var/www/html") 
 	, client_max_body_size(1048576)
+	, ssl(false)
+	, http2(false)
+	, ssl_session_cache(20480)
+	, ssl_session_timeout(300)
+	, ssl_session_tickets(true)
+	, ssl_ktls(true)
+	, ssl_early_data(false)
 { }
 
 const LocationConfig* ServerConfig::findLocation(const std::string& uri) const
 {
-	// Step 1: Normalize the path (ensure consistency)
-	std::string normalized_uri = uri;
-	
-	// If the path ends with '/' and is not the root, remove the trailing slash for matching
-	// e.g., /directory/ -> /directory
-	if (normalized_uri.length() > 1 && 
-		normalized_uri[normalized_uri.length() - 1] == '/')
-	{
-		normalized_uri = normalized_uri.substr(0, normalized_uri.length() - 1);
-	}
-	
-	// Step 2: Exact match (highest priority)
-	for (size_t i = 0; i < locations.size(); ++i)
-	{
-		if (locations[i].path == normalized_uri || 
-			locations[i].path == uri)  // also try the original URI
-		{
-			return &locations[i];
-		}
-	}
-	
-	// Step 3: Prefix match (prefer the longest matching prefix)
-	const LocationConfig* best_match = NULL;
-	size_t best_match_length = 0;
-	
-	for (size_t i = 0; i < locations.size(); ++i)
-	{
-		const std::string& loc_path = locations[i].path;
-		
-		// Check for prefix match
-		if (uri.find(loc_path) == 0)
-		{
-			// Ensure matching a complete path segment
-			// /directory/ should match /directory/nop
-			// but should not match /directoryabc
-			
-			if (loc_path.length() == uri.length() ||
-				uri[loc_path.length()] == '/')
-			{
-				if (loc_path.length() > best_match_length)
-				{
-					best_match = &locations[i];
-					best_match_length = loc_path.length();
-				}
-			}
-		}
-	}
-	
-	if (best_match)
-		return best_match;
-	
-	// Step 4: Return the default location (/)
-	for (size_t i = 0; i < locations.size(); ++i)
-	{
-		if (locations[i].path == "/")
-			return &locations[i];
-	}
-	
-	return NULL;
+	return findLocation(uri.data(), uri.size());
+}
+
+// The URI is compared in place, so a request-scoped buffer can be passed as is.
+// Lookups only go through the trie of the last compileLocations(); the bounds
+// check keeps a config edited without compiling from reading past the vector.
+const LocationConfig* ServerConfig::findLocation(const char* uri, size_t len) const
+{
+	int index = _location_trie.match(uri, len);
+	if (index < 0 || static_cast<size_t>(index) >= locations.size())
+		return NULL;
+	return &locations[index];
+}
+
+void ServerConfig::compileLocations()
+{
+	_location_trie.build(locations);
 }
 
+// ==================== UpstreamConfig ====================
+
+UpstreamConfig::Peer::Peer()
+	: port(80)
+	, weight(1)
+	, max_fails(1)
+	, fail_timeout(10)
+{ }
+
+UpstreamConfig::UpstreamConfig()
+	: policy("round_robin")
+	, health_interval(0)
+	, health_uri("/")
+	, health_timeout(2)
+	, health_fails(1)
+	, health_passes(1)
+{ }
+
 // ==================== ConfigParser ====================
 
 ConfigParser::ConfigParser(const std::string& file_path)
@@ -129,12 +123,18 @@ void ConfigParser::parse()
 		// Find server block
 		if (StringUtils::startsWith(line, "server"))
 			_parseServerBlock(file, line);
+		// upstream backend {
+		else if (StringUtils::startsWith(line, "upstream"))
+			_parseUpstreamBlock(file, line);
 	}
 	
 	file.close();
 	
 	if (_servers.empty())
 		throw std::runtime_error("Error: No server configuration found");
+
+	// Upstream blocks may follow the servers that use them
+	_resolveUpstreams();
 }
 
 void ConfigParser::_parseServerBlock(std::ifstream& file, std::string& line)
@@ -164,16 +164,37 @@ void ConfigParser::_parseServerBlock(std::ifstream& file, std::string& line)
 		// End of server block
 		if (line == "}" || line == "};")
 		{
+			if (server.ssl && (server.ssl_certificate.empty() || server.ssl_certificate_key.empty()))
+				throw std::runtime_error("listen ... ssl needs ssl_certificate and ssl_certificate_key");
+			// OpenSSL's anti-replay check keeps single-use tickets in the cache
+			if (server.ssl_early_data && server.ssl_session_cache == 0)
+				throw std::runtime_error("ssl_early_data needs ssl_session_cache");
+			server.compileLocations();
 			_servers.push_back(server);
 			return;
 		}
 		
-		// listen 127.0.0.1:8080;
+		// listen 127.0.0.1:8080; / listen 8443 ssl [http2];
 		if (StringUtils::startsWith(line, "listen"))
 		{
 			std::string value = line.substr(6);  // Jump "listen"
 			value = StringUtils::trim(value);
 			value = StringUtils::removeSemicolon(value);
+
+			std::vector<std::string> params = StringUtils::split(value, " \t");
+			value = params.empty() ? "" : params[0];
+			for (size_t i = 1; i < params.size(); i++)
+			{
+				if (params[i] == "ssl")
+					server.ssl = true;
+				else if (params[i] == "http2")
+					server.http2 = true;
+				else if (params[i] == "quic")
+					throw std::runtime_error("listen ... quic: HTTP/3 is not available, the TLS library "
+											 "has no QUIC support (use ssl with ssl_early_data)");
+				else if (!params[i].empty())
+					throw std::runtime_error("Unknown listen parameter: " + params[i]);
+			}
 			
 			size_t colon_pos = value.find(':');
 			if (colon_pos != std::string::npos)  // host:port
@@ -217,6 +238,64 @@ void ConfigParser::_parseServerBlock(std::ifstream& file, std::string& line)
 			value = StringUtils::removeSemicolon(value);
 			server.client_max_body_size = StringUtils::parseSize(value);
 		}
+		// ssl_certificate_key certs/server.key; (before ssl_certificate, its prefix)
+		else if (StringUtils::startsWith(line, "ssl_certificate_key"))
+		{
+			std::string value = line.substr(19);
+			value = StringUtils::trim(value);
+			server.ssl_certificate_key = StringUtils::removeSemicolon(value);
+		}
+		// ssl_certificate certs/server.crt;
+		else if (StringUtils::startsWith(line, "ssl_certificate"))
+		{
+			std::string value = line.substr(15);
+			value = StringUtils::trim(value);
+			server.ssl_certificate = StringUtils::removeSemicolon(value);
+		}
+		// ssl_session_cache 20480; / ssl_session_cache off;
+		else if (StringUtils::startsWith(line, "ssl_session_cache"))
+		{
+			std::string value = line.substr(17);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			server.ssl_session_cache = (value == "off") ? 0 : std::atoi(value.c_str());
+			if (server.ssl_session_cache < 0)
+				throw std::runtime_error("Invalid ssl_session_cache: " + value);
+		}
+		// ssl_session_timeout 5m;
+		else if (StringUtils::startsWith(line, "ssl_session_timeout"))
+		{
+			std::string value = line.substr(19);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			server.ssl_session_timeout = StringUtils::parseDuration(value);
+			if (server.ssl_session_timeout <= 0)
+				throw std::runtime_error("Invalid ssl_session_timeout: " + value);
+		}
+		// ssl_session_tickets off;
+		else if (StringUtils::startsWith(line, "ssl_session_tickets"))
+		{
+			std::string value = line.substr(19);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			server.ssl_session_tickets = (value == "on");
+		}
+		// ssl_ktls off;
+		else if (StringUtils::startsWith(line, "ssl_ktls"))
+		{
+			std::string value = line.substr(8);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			server.ssl_ktls = (value == "on");
+		}
+		// ssl_early_data on;
+		else if (StringUtils::startsWith(line, "ssl_early_data"))
+		{
+			std::string value = line.substr(14);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			server.ssl_early_data = (value == "on");
+		}
 		// error_page 404 /404.html;
 		else if (StringUtils::startsWith(line, "error_page"))
 		{
@@ -385,6 +464,181 @@ void ConfigParser::_parseLocationBlock(std::ifstream& file, std::string& line,
 			value = StringUtils::removeSemicolon(value);
 			location.client_max_body_size = StringUtils::parseSize(value);
 		}
+		// fastcgi_pass unix:/tmp/app.sock;
+		else if (StringUtils::startsWith(line, "fastcgi_pass"))
+		{
+			std::string value = line.substr(12);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			if (!StringUtils::startsWith(value, "unix:") || value.size() == 5)
+				throw std::runtime_error("Invalid fastcgi_pass (expected unix:/path): " + value);
+			location.fastcgi_pass = value.substr(5);
+		}
+		// cgi_cache 30s Accept-Language;
+		else if (StringUtils::startsWith(line, "cgi_cache"))
+		{
+			std::string value = line.substr(9);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+
+			std::vector<std::string> parts = StringUtils::split(value, " \t");
+			if (parts.empty())
+				throw std::runtime_error("Invalid cgi_cache (expected TTL): " + value);
+			location.cgi_cache_ttl = StringUtils::parseDuration(parts[0]);
+			if (location.cgi_cache_ttl <= 0)
+				throw std::runtime_error("Invalid cgi_cache TTL: " + parts[0]);
+			for (size_t i = 1; i < parts.size(); i++)
+			{
+				if (!parts[i].empty())
+					location.cgi_cache_key_headers.push_back(parts[i]);
+			}
+		}
+		// cgi_max_concurrent 8;
+		else if (StringUtils::startsWith(line, "cgi_max_concurrent"))
+		{
+			std::string value = line.substr(18);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			location.cgi_max_concurrent = std::atoi(value.c_str());
+			if (location.cgi_max_concurrent <= 0)
+				throw std::runtime_error("Invalid cgi_max_concurrent: " + value);
+		}
+		// cgi_queue 64;
+		else if (StringUtils::startsWith(line, "cgi_queue"))
+		{
+			std::string value = line.substr(9);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			location.cgi_queue = std::atoi(value.c_str());
+			if (location.cgi_queue < 0)
+				throw std::runtime_error("Invalid cgi_queue: " + value);
+		}
+		// proxy_pass http://127.0.0.1:9000;
+		else if (StringUtils::startsWith(line, "proxy_pass"))
+		{
+			std::string value = line.substr(10);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			if (!StringUtils::startsWith(value, "http://"))
+				throw std::runtime_error("Invalid proxy_pass (expected http://host[:port][/uri]): " + value);
+
+			// http://host[:port][/uri]: a URI replaces the matched location prefix
+			std::string rest = value.substr(7);
+			size_t slash = rest.find('/');
+			std::string authority = rest.substr(0, slash);
+			location.proxy_uri = (slash == std::string::npos) ? "" : rest.substr(slash);
+
+			size_t colon = authority.rfind(':');
+			location.proxy_host = authority.substr(0, colon);
+			location.proxy_port = 80;
+			if (colon != std::string::npos)
+			{
+				std::string port = authority.substr(colon + 1);
+				location.proxy_port = std::atoi(port.c_str());
+				if (port.empty() || port.find_first_not_of("0123456789") != std::string::npos)
+					location.proxy_port = 0;
+			}
+			if (location.proxy_host.empty() || location.proxy_port <= 0 || location.proxy_port > 65535)
+				throw std::runtime_error("Invalid proxy_pass (expected http://host[:port][/uri]): " + value);
+			location.proxy_pass = value;
+		}
+		// proxy_connect_timeout 5s;
+		else if (StringUtils::startsWith(line, "proxy_connect_timeout"))
+		{
+			std::string value = line.substr(21);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			location.proxy_connect_timeout = StringUtils::parseDuration(value);
+			if (location.proxy_connect_timeout <= 0)
+				throw std::runtime_error("Invalid proxy_connect_timeout: " + value);
+		}
+		// proxy_read_timeout 60s;
+		else if (StringUtils::startsWith(line, "proxy_read_timeout"))
+		{
+			std::string value = line.substr(18);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			location.proxy_read_timeout = StringUtils::parseDuration(value);
+			if (location.proxy_read_timeout <= 0)
+				throw std::runtime_error("Invalid proxy_read_timeout: " + value);
+		}
+		// cgi_timeout 10s;
+		else if (StringUtils::startsWith(line, "cgi_timeout"))
+		{
+			std::string value = line.substr(11);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			location.cgi_timeout = StringUtils::parseDuration(value);
+			if (location.cgi_timeout <= 0)
+				throw std::runtime_error("Invalid cgi_timeout: " + value);
+		}
+		// cgi_rlimit_cpu 5s;
+		else if (StringUtils::startsWith(line, "cgi_rlimit_cpu"))
+		{
+			std::string value = line.substr(14);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			location.cgi_rlimit_cpu = StringUtils::parseDuration(value);
+			if (location.cgi_rlimit_cpu <= 0)
+				throw std::runtime_error("Invalid cgi_rlimit_cpu: " + value);
+		}
+		// cgi_rlimit_as 256M;
+		else if (StringUtils::startsWith(line, "cgi_rlimit_as"))
+		{
+			std::string value = line.substr(13);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			location.cgi_rlimit_as = StringUtils::parseSize(value);
+			if (location.cgi_rlimit_as == 0)
+				throw std::runtime_error("Invalid cgi_rlimit_as: " + value);
+		}
+		// cgi_rlimit_nofile 64;
+		else if (StringUtils::startsWith(line, "cgi_rlimit_nofile"))
+		{
+			std::string value = line.substr(17);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			location.cgi_rlimit_nofile = std::atoi(value.c_str());
+			if (location.cgi_rlimit_nofile <= 0)
+				throw std::runtime_error("Invalid cgi_rlimit_nofile: " + value);
+		}
+		// cgi_cgroup_cpu_max 50000 100000;
+		else if (StringUtils::startsWith(line, "cgi_cgroup_cpu_max"))
+		{
+			std::string value = line.substr(18);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+
+			std::vector<std::string> parts = StringUtils::split(value, " \t");
+			bool valid = !parts.empty() && parts.size() <= 2
+				&& (parts[0] == "max" || parts[0].find_first_not_of("0123456789") == std::string::npos)
+				&& (parts.size() < 2 || parts[1].find_first_not_of("0123456789") == std::string::npos);
+			if (!valid)
+				throw std::runtime_error("Invalid cgi_cgroup_cpu_max (expected <quota|max> [period]): " + value);
+			location.cgi_cgroup_cpu_max = parts.size() == 2 ? parts[0] + " " + parts[1] : parts[0];
+		}
+		// cgi_cgroup_memory_max 512M;
+		else if (StringUtils::startsWith(line, "cgi_cgroup_memory_max"))
+		{
+			std::string value = line.substr(21);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			location.cgi_cgroup_memory_max = StringUtils::parseSize(value);
+			if (location.cgi_cgroup_memory_max == 0)
+				throw std::runtime_error("Invalid cgi_cgroup_memory_max: " + value);
+		}
+		// cgi_cgroup /sys/fs/cgroup/webserv/cgi;
+		else if (StringUtils::startsWith(line, "cgi_cgroup"))
+		{
+			std::string value = line.substr(10);
+			value = StringUtils::trim(value);
+			value = StringUtils::removeSemicolon(value);
+			if (value.empty() || value[0] != '/')
+				throw std::runtime_error("Invalid cgi_cgroup (expected absolute path): " + value);
+			while (value.size() > 1 && value[value.size() - 1] == '/')
+				value.erase(value.size() - 1);
+			location.cgi_cgroup = value;
+		}
 	}
 	
 	throw std::runtime_error("Error: Unexpected end of file inside location block");
@@ -395,4 +649,156 @@ const std::vector<ServerConfig>& ConfigParser::getServers() const
 	return _servers;
 }
 
+const std::vector<UpstreamConfig>& ConfigParser::getUpstreams() const
+{
+	return _upstreams;
+}
+
+/*
+	upstream backend {
+		least_conn;                         # or: hash $request_uri | $remote_addr
+		server 127.0.0.1:9001 weight=2 max_fails=3 fail_timeout=30s;
+		server 127.0.0.1:9002;
+		health_check interval=5s uri=/health timeout=2s fails=2 passes=1;
+	}
+*/
+void ConfigParser::_parseUpstreamBlock(std::ifstream& file, std::string& line)
+{
+	UpstreamConfig upstream;
+
+	std::string value = StringUtils::trim(line.substr(8));  // Skip "upstream"
+	size_t brace_pos = value.find('{');
+	upstream.name = StringUtils::trim(value.substr(0, brace_pos));
+	if (brace_pos == std::string::npos)
+	{
+		std::getline(file, line);
+		if (StringUtils::trim(line) != "{")
+			throw std::runtime_error("Error: Expected '{' after 'upstream'");
+	}
+	if (upstream.name.empty() || upstream.name.find_first_of(":/") != std::string::npos)
+		throw std::runtime_error("Invalid upstream name: " + upstream.name);
+	for (size_t i = 0; i < _upstreams.size(); ++i)
+	{
+		if (_upstreams[i].name == upstream.name)
+			throw std::runtime_error("Duplicate upstream: " + upstream.name);
+	}
+
+	while (std::getline(file, line))
+	{
+		line = StringUtils::trim(line);
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		if (line == "}" || line == "};")
+		{
+			if (upstream.peers.empty())
+				throw std::runtime_error("Upstream without servers: " + upstream.name);
+			_upstreams.push_back(upstream);
+			return;
+		}
+
+		std::vector<std::string> parts = StringUtils::split(StringUtils::removeSemicolon(line), " \t");
+		if (parts.empty())
+			continue;
+
+		// server host:port [weight=N] [max_fails=N] [fail_timeout=T];
+		if (parts[0] == "server")
+		{
+			if (parts.size() < 2)
+				throw std::runtime_error("Invalid upstream server: " + line);
+
+			UpstreamConfig::Peer peer;
+			size_t colon = parts[1].rfind(':');
+			peer.host = parts[1].substr(0, colon);
+			if (colon != std::string::npos)
+			{
+				std::string port = parts[1].substr(colon + 1);
+				peer.port = (port.empty() || port.find_first_not_of("0123456789") != std::string::npos)
+							? 0 : std::atoi(port.c_str());
+			}
+			if (peer.host.empty() || peer.port <= 0 || peer.port > 65535)
+				throw std::runtime_error("Invalid upstream server address: " + parts[1]);
+
+			for (size_t i = 2; i < parts.size(); ++i)
+			{
+				if (StringUtils::startsWith(parts[i], "weight="))
+					peer.weight = std::atoi(parts[i].c_str() + 7);
+				else if (StringUtils::startsWith(parts[i], "max_fails="))
+					peer.max_fails = std::atoi(parts[i].c_str() + 10);
+				else if (StringUtils::startsWith(parts[i], "fail_timeout="))
+					peer.fail_timeout = StringUtils::parseDuration(parts[i].substr(13));
+				else
+					throw std::runtime_error("Unknown upstream server parameter: " + parts[i]);
+			}
+			if (peer.weight <= 0 || peer.max_fails < 0 || peer.fail_timeout <= 0)
+				throw std::runtime_error("Invalid upstream server parameters: " + line);
+			upstream.peers.push_back(peer);
+		}
+		// least_conn;
+		else if (parts[0] == "least_conn")
+			upstream.policy = "least_conn";
+		// hash $request_uri;
+		else if (parts[0] == "hash")
+		{
+			if (parts.size() != 2 || (parts[1] != "$request_uri" && parts[1] != "$remote_addr"))
+				throw std::runtime_error("Invalid hash key (expected $request_uri or $remote_addr): " + line);
+			upstream.policy = "hash";
+			upstream.hash_key = parts[1];
+		}
+		// health_check interval=5s uri=/health timeout=2s fails=2 passes=1;
+		else if (parts[0] == "health_check")
+		{
+			upstream.health_interval = 5;
+			for (size_t i = 1; i < parts.size(); ++i)
+			{
+				if (StringUtils::startsWith(parts[i], "interval="))
+					upstream.health_interval = StringUtils::parseDuration(parts[i].substr(9));
+				else if (StringUtils::startsWith(parts[i], "uri="))
+					upstream.health_uri = parts[i].substr(4);
+				else if (StringUtils::startsWith(parts[i], "timeout="))
+					upstream.health_timeout = StringUtils::parseDuration(parts[i].substr(8));
+				else if (StringUtils::startsWith(parts[i], "fails="))
+					upstream.health_fails = std::atoi(parts[i].c_str() + 6);
+				else if (StringUtils::startsWith(parts[i], "passes="))
+					upstream.health_passes = std::atoi(parts[i].c_str() + 7);
+				else
+					throw std::runtime_error("Unknown health_check parameter: " + parts[i]);
+			}
+			if (upstream.health_interval <= 0 || upstream.health_timeout <= 0 ||
+				upstream.health_fails <= 0 || upstream.health_passes <= 0 ||
+				upstream.health_uri.empty() || upstream.health_uri[0] != '/')
+				throw std::runtime_error("Invalid health_check: " + line);
+		}
+		else
+			throw std::runtime_error("Unknown upstream directive: " + parts[0]);
+	}
+
+	throw std::runtime_error("Unexpected end of file inside upstream block");
+}
+
+// proxy_pass http://<name>[/uri] targets the upstream block of that name
+void ConfigParser::_resolveUpstreams()
+{
+	for (size_t s = 0; s < _servers.size(); ++s)
+	{
+		for (size_t l = 0; l < _servers[s].locations.size(); ++l)
+		{
+			LocationConfig& location = _servers[s].locations[l];
+			if (location.proxy_pass.empty())
+				continue;
+
+			for (size_t u = 0; u < _upstreams.size(); ++u)
+			{
+				if (_upstreams[u].name != location.proxy_host)
+					continue;
+				std::string authority = location.proxy_pass.substr(7);
+				if (authority.substr(0, authority.find('/')).find(':') != std::string::npos)
+					throw std::runtime_error("proxy_pass to an upstream takes no port: " + location.proxy_pass);
+				location.proxy_upstream = location.proxy_host;
+			}
+		}
+	}
+}
+
 } // namespace wsv
@@ -7,6 +7,8 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include "http/HttpResponse.hpp"
+#include "LocationTrie.hpp"
 
 namespace wsv
 {
@@ -24,6 +26,7 @@ public:
 	// Redirection
 	int			redirect_code;  // 301, 302
 	std::string	redirect_url;   // new-path
+	HttpResponse	canned_redirect;    // Frozen at startup (ErrorHandler::prepare)
 	
 	// Upload
 	bool		upload_enable;
@@ -34,6 +37,35 @@ public:
 	std::string	cgi_path;       // CGI excutable path /usr/bin/python3
 	size_t		client_max_body_size; // Max body size for this location
 
+	// FastCGI
+	std::string	fastcgi_pass;   // Unix socket path of a FastCGI worker
+
+	// CGI response cache (GET only)
+	int			cgi_cache_ttl;  // Seconds, 0 = caching disabled
+	std::vector<std::string>	cgi_cache_key_headers; // Request headers added to the key
+
+	// CGI concurrency limit
+	int			cgi_max_concurrent; // Running CGI requests, 0 = unlimited
+	int			cgi_queue;          // Requests waiting for a slot before 503
+
+	// CGI process isolation
+	int			cgi_timeout;            // Seconds, 0 = server default (CGI_TIMEOUT)
+	int			cgi_rlimit_cpu;         // CPU seconds per child, 0 = unlimited
+	size_t		cgi_rlimit_as;          // Address space bytes per child, 0 = unlimited
+	int			cgi_rlimit_nofile;      // Open files per child, 0 = inherited
+	std::string	cgi_cgroup;             // cgroup v2 directory the children join
+	std::string	cgi_cgroup_cpu_max;     // Written to cpu.max ("<quota> [period]")
+	size_t		cgi_cgroup_memory_max;  // Written to memory.max, 0 = untouched
+
+	// Reverse proxy
+	std::string	proxy_pass;             // Upstream URL as written, empty = not proxied
+	std::string	proxy_host;
+	int			proxy_port;
+	std::string	proxy_upstream;         // Name of an upstream block, empty = single host
+	std::string	proxy_uri;              // Replaces the location prefix, empty = URI unchanged
+	int			proxy_connect_timeout;  // Seconds, 0 = server default
+	int			proxy_read_timeout;     // Seconds between upstream reads, 0 = server default
+
 public:
 	LocationConfig();
 
@@ -51,15 +83,67 @@ public:
 	std::string	root;
 	size_t		client_max_body_size; // Max request body size, default 1MB
 
+	// TLS (`listen ... ssl`)
+	bool		ssl;
+	bool		http2;                  // Offer h2 in ALPN (`listen ... ssl http2`)
+	std::string	ssl_certificate;        // PEM chain, server certificate first
+	std::string	ssl_certificate_key;    // PEM private key
+	int			ssl_session_cache;      // Sessions kept for resumption, 0 = no cache
+	int			ssl_session_timeout;    // Seconds a session (or ticket) can be resumed
+	bool		ssl_session_tickets;    // Stateless resumption with session tickets
+	bool		ssl_ktls;               // Hand records to kernel TLS where supported
+	bool		ssl_early_data;         // Accept TLS 1.3 0-RTT requests from resumed clients
+
 	std::vector<std::string>	server_names; // Server names, can be multiple
 	std::map<int, std::string>	error_pages; // Error page mapping, key=HTTP status code
+	std::map<int, HttpResponse>	canned_errors; // error_pages read and frozen at startup
 	std::vector<LocationConfig>	locations; // All location configurations
 
 public:
 	ServerConfig();
 
-	// Find the best matching location
+	// Find the best matching location (exact, then longest segment prefix, then "/")
 	const LocationConfig* findLocation(const std::string& path) const;
+	const LocationConfig* findLocation(const char* path, size_t len) const;
+
+	// Compile locations into the lookup trie. Done when the server block is
+	// parsed; a config built or edited by hand must call it before lookups
+	void compileLocations();
+
+private:
+	LocationTrie	_location_trie;
+};
+
+
+class UpstreamConfig
+{
+public:
+	// One `server host:port [weight=N] [max_fails=N] [fail_timeout=T];` line
+	struct Peer
+	{
+		std::string	host;
+		int			port;
+		int			weight;         // Share of requests relative to the other peers
+		int			max_fails;      // Failures within fail_timeout before the peer is skipped, 0 = never
+		int			fail_timeout;   // Seconds: failure window, then time the peer is skipped
+
+		Peer();
+	};
+
+	std::string			name;
+	std::string			policy;         // "round_robin", "least_conn" or "hash"
+	std::string			hash_key;       // "$request_uri" or "$remote_addr" (hash policy)
+	std::vector<Peer>	peers;
+
+	// Active health checks (`health_check interval=5s uri=/health ...`)
+	int			health_interval;    // Seconds between probes of a peer, 0 = disabled
+	std::string	health_uri;
+	int			health_timeout;     // Seconds before a probe counts as failed
+	int			health_fails;       // Consecutive failed probes to mark a peer down
+	int			health_passes;      // Consecutive passed probes to mark it up again
+
+public:
+	UpstreamConfig();
 };
 
 
@@ -68,11 +152,14 @@ class ConfigParser
 private:
 	std::string					_filepath;
 	std::vector<ServerConfig>	_servers;
+	std::vector<UpstreamConfig>	_upstreams;
 
 	// Parsing helper methods
 	void _parseServerBlock(std::ifstream& file, std::string& line);
 	void _parseLocationBlock(std::ifstream& file, std::string& line, 
 						   ServerConfig& server);
+	void _parseUpstreamBlock(std::ifstream& file, std::string& line);
+	void _resolveUpstreams();
 
 public:
 	ConfigParser(const std::string& file_path);
@@ -80,6 +167,7 @@ public:
 
 	void parse();
 	const std::vector<ServerConfig>& getServers() const;
+	const std::vector<UpstreamConfig>& getUpstreams() const;
 };
 
 } // namespace wsv
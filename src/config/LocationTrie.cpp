@@ -0,0 +1,152 @@
+#include "LocationTrie.hpp"
+#include "ConfigParser.hpp"
+#include <cstring>
+#include <map>
+
+namespace wsv
+{
+
+// End of the segment that starts at pos: the next '/', or len
+static size_t	segment_end(const char* path, size_t pos, size_t len)
+{
+	const void* slash = std::memchr(path + pos, '/', len - pos);
+	return slash ? static_cast<const char*>(slash) - path : len;
+}
+
+// Node of the trie while it is built
+struct PendingNode
+{
+	std::map<std::string, size_t>	children;	// Segment -> index of the child
+	int								location;
+};
+
+LocationTrie::LocationTrie() : _root_location(-1), _location_count(0)
+{ }
+
+void LocationTrie::build(const std::vector<LocationConfig>& locations)
+{
+	// Insert into a tree of maps first, then lay every node's children out
+	// side by side in _nodes, in the order of the maps (sorted)
+	std::vector<PendingNode> pending(1);
+	pending[0].location = -1;
+	_root_location = -1;
+
+	for (size_t i = 0; i < locations.size(); ++i)
+	{
+		const std::string& path = locations[i].path;
+		if (path == "/" && _root_location < 0)
+			_root_location = static_cast<int>(i);
+
+		size_t node = 0;
+		size_t pos = 0;
+		while (true)
+		{
+			size_t end = segment_end(path.data(), pos, path.size());
+			std::string segment(path, pos, end - pos);
+			std::map<std::string, size_t>::iterator it = pending[node].children.find(segment);
+			if (it == pending[node].children.end())
+			{
+				pending[node].children[segment] = pending.size();
+				node = pending.size();
+				pending.push_back(PendingNode());
+				pending[node].location = -1;
+			}
+			else
+				node = it->second;
+			if (end == path.size())
+				break;
+			pos = end + 1;
+		}
+		if (pending[node].location < 0)
+			pending[node].location = static_cast<int>(i);
+	}
+
+	_nodes.clear();
+	_nodes.reserve(pending.size());
+	std::vector<size_t> source(1, 0);		// Pending node of each entry of _nodes
+	Node root;
+	root.location = pending[0].location;
+	root.first_child = 0;
+	root.child_count = 0;
+	_nodes.push_back(root);
+	for (size_t i = 0; i < _nodes.size(); ++i)
+	{
+		const PendingNode& from = pending[source[i]];
+		_nodes[i].first_child = _nodes.size();
+		_nodes[i].child_count = from.children.size();
+		for (std::map<std::string, size_t>::const_iterator it = from.children.begin(); it != from.children.end(); ++it)
+		{
+			Node child;
+			child.segment = it->first;
+			child.location = pending[it->second].location;
+			child.first_child = 0;
+			child.child_count = 0;
+			_nodes.push_back(child);
+			source.push_back(it->second);
+		}
+	}
+	_location_count = locations.size();
+}
+
+int LocationTrie::match(const char* uri, size_t len) const
+{
+	if (_nodes.empty())
+		return -1;
+
+	// A trailing slash is ignored for the exact match: /directory/ -> /directory
+	size_t normalized_len = len;
+	if (normalized_len > 1 && uri[normalized_len - 1] == '/')
+		normalized_len--;
+
+	int exact = -1;
+	int prefix = -1;
+	size_t node = 0;
+	size_t pos = 0;
+	while (true)
+	{
+		size_t end = segment_end(uri, pos, len);
+		size_t child = _findChild(_nodes[node], uri + pos, end - pos);
+		if (child == 0)
+			break;
+		node = child;
+
+		// Every node ends on a segment boundary, so any location here is a prefix
+		int location = _nodes[node].location;
+		if (location >= 0)
+		{
+			prefix = location;
+			if ((end == len || end == normalized_len) && (exact < 0 || location < exact))
+				exact = location;
+		}
+		if (end == len)
+			break;
+		pos = end + 1;
+	}
+
+	if (exact >= 0)
+		return exact;
+	if (prefix >= 0)
+		return prefix;
+	return _root_location;
+}
+
+// Index of the child of node named segment, 0 (the root) if there is none
+size_t LocationTrie::_findChild(const Node& node, const char* segment, size_t len) const
+{
+	size_t low = node.first_child;
+	size_t high = node.first_child + node.child_count;
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		int cmp = _nodes[mid].segment.compare(0, std::string::npos, segment, len);
+		if (cmp == 0)
+			return mid;
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return 0;
+}
+
+} // namespace wsv
@@ -0,0 +1,58 @@
+#ifndef LOCATION_TRIE_HPP
+#define LOCATION_TRIE_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace wsv
+{
+
+class LocationConfig;
+
+/**
+ * LocationTrie - Compiled location table of one server
+ *
+ * Location paths are split on '/' and stored one segment per node, so a
+ * location only ever matches on a path-segment boundary ("/img" matches
+ * "/img/a.png", not "/imgs"). The children of a node are stored next to
+ * each other, sorted, and found by binary search. A lookup walks the URI
+ * once, in place, and allocates nothing.
+ *
+ * Matching rules, in order:
+ *   1. Exact path, with or without the URI's trailing slash
+ *      (the location declared first wins)
+ *   2. Longest location path that is a segment prefix of the URI
+ *   3. The "/" location
+ */
+class LocationTrie
+{
+public:
+	LocationTrie();
+
+	void	build(const std::vector<LocationConfig>& locations);
+
+	// Index in the locations given to build(), -1 if none matches
+	int		match(const char* uri, size_t len) const;
+
+	size_t	size() const { return _location_count; }	// Locations compiled
+
+private:
+	struct Node
+	{
+		std::string	segment;		// Path segment, without '/'
+		int			location;		// First location with this exact path, -1 if none
+		size_t		first_child;	// Children: _nodes[first_child, first_child + child_count)
+		size_t		child_count;
+	};
+
+	std::vector<Node>	_nodes;				// _nodes[0] is the root, before the first segment
+	int					_root_location;		// First "/" location, -1 if none
+	size_t				_location_count;
+
+	size_t	_findChild(const Node& node, const char* segment, size_t len) const;
+};
+
+} // namespace wsv
+
+#endif
@@ -0,0 +1,613 @@
+#include "Hpack.hpp"
+
+namespace wsv
+{
+
+// ========================================
+// Tables
+// ========================================
+
+namespace
+{
+
+struct StaticEntry
+{
+    const char* name;
+    const char* value;
+};
+
+// RFC 7541 Appendix A
+const StaticEntry STATIC_TABLE[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""}
+};
+
+const size_t STATIC_COUNT = sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]);
+const size_t ENTRY_OVERHEAD = 32;   // Per-entry accounting cost (RFC 7541 4.1)
+
+struct HuffmanCode
+{
+    unsigned int code;
+    int          bits;
+};
+
+// RFC 7541 Appendix B, indexed by symbol; 256 is EOS
+const HuffmanCode HUFFMAN_TABLE[257] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},          //   0-  3
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},      //   4-  7
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},      //   8- 11
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},     //  12- 15
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},      //  16- 19
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},     //  20- 23
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},      //  24- 27
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},      //  28- 31
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},                        //  32- 35
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},                         //  36- 39
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},                        //  40- 43
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},                              //  44- 47
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},                                 //  48- 51
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},                              //  52- 55
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},                              //  56- 59
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},                       //  60- 63
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},                           //  64- 67
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},                              //  68- 71
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},                              //  72- 75
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},                              //  76- 79
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},                              //  80- 83
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},                              //  84- 87
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},                           //  88- 91
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},                    //  92- 95
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},                             //  96- 99
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},                               // 100-103
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},                               // 104-107
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},                               // 108-111
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},                               // 112-115
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},                               // 116-119
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},                           // 120-123
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},                // 124-127
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},             // 128-131
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},          // 132-135
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},          // 136-139
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},          // 140-143
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},          // 144-147
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},          // 148-151
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},          // 152-155
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},          // 156-159
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},           // 160-163
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},          // 164-167
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},          // 168-171
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},          // 172-175
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},          // 176-179
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},          // 180-183
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},           // 184-187
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},          // 188-191
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},          // 192-195
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},         // 196-199
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},      // 200-203
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},       // 204-207
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},         // 208-211
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},       // 212-215
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},        // 216-219
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},      // 220-223
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},            // 224-227
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},          // 228-231
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},        // 232-235
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},         // 236-239
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},      // 240-243
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},      // 244-247
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},      // 248-251
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},      // 252-255
+    {0x3fffffff, 30},                                                        // 256-256
+};
+
+const int HUFFMAN_MAX_BITS = 30;
+
+// Canonical decoding tables: codes of one length are consecutive, and
+// symbols of one length are listed in code order
+struct HuffmanDecoder
+{
+    unsigned int first[HUFFMAN_MAX_BITS + 1];   // First code of each length
+    int          count[HUFFMAN_MAX_BITS + 1];   // Codes of each length
+    int          offset[HUFFMAN_MAX_BITS + 1];  // Index of the first one in symbols
+    int          symbols[257];
+
+    HuffmanDecoder()
+    {
+        int n = 0;
+        for (int len = 0; len <= HUFFMAN_MAX_BITS; ++len)
+        {
+            first[len] = 0;
+            count[len] = 0;
+            offset[len] = n;
+            for (int sym = 0; sym < 257; ++sym)
+            {
+                if (HUFFMAN_TABLE[sym].bits != len)
+                    continue;
+                if (count[len] == 0)
+                    first[len] = HUFFMAN_TABLE[sym].code;
+                count[len]++;
+                symbols[n++] = sym;
+            }
+        }
+    }
+};
+
+const HuffmanDecoder& huffmanDecoder()
+{
+    static const HuffmanDecoder decoder;
+    return decoder;
+}
+
+size_t entrySize(const std::string& name, const std::string& value)
+{
+    return name.size() + value.size() + ENTRY_OVERHEAD;
+}
+
+// Values that change with every response would only churn the table
+bool isIndexable(const std::string& name)
+{
+    static const char* const skip[] = {
+        "content-length", "date", "etag", "last-modified", "location",
+        "content-range", "age", "expires", "set-cookie", "authorization"
+    };
+    for (size_t i = 0; i < sizeof(skip) / sizeof(skip[0]); ++i)
+    {
+        if (name == skip[i])
+            return false;
+    }
+    return true;
+}
+
+// Never-indexed literals also tell intermediaries not to compress them
+bool isSensitive(const std::string& name)
+{
+    return name == "set-cookie" || name == "authorization";
+}
+
+} // namespace
+
+// ========================================
+// Primitive Coding
+// ========================================
+
+void Hpack::encodeInteger(std::string& out, size_t value, int prefix_bits, unsigned char flags)
+{
+    size_t max_prefix = (static_cast<size_t>(1) << prefix_bits) - 1;
+
+    if (value < max_prefix)
+    {
+        out += static_cast<char>(flags | value);
+        return;
+    }
+    out += static_cast<char>(flags | max_prefix);
+    value -= max_prefix;
+    while (value >= 128)
+    {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool Hpack::decodeInteger(const std::string& in, size_t& pos, int prefix_bits, size_t& value)
+{
+    if (pos >= in.size())
+        return false;
+
+    size_t max_prefix = (static_cast<size_t>(1) << prefix_bits) - 1;
+    value = static_cast<unsigned char>(in[pos++]) & max_prefix;
+    if (value < max_prefix)
+        return true;
+
+    for (int shift = 0; pos < in.size(); shift += 7)
+    {
+        if (shift > 28)
+            return false;   // Larger than anything a sane peer sends
+        unsigned char byte = static_cast<unsigned char>(in[pos++]);
+        value += static_cast<size_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+void Hpack::encodeString(std::string& out, const std::string& value)
+{
+    size_t huffman_length = huffmanLength(value);
+
+    if (huffman_length < value.size())
+    {
+        encodeInteger(out, huffman_length, 7, 0x80);
+        out += huffmanEncode(value);
+        return;
+    }
+    encodeInteger(out, value.size(), 7, 0x00);
+    out += value;
+}
+
+bool Hpack::decodeString(const std::string& in, size_t& pos, std::string& value)
+{
+    if (pos >= in.size())
+        return false;
+
+    bool huffman = (static_cast<unsigned char>(in[pos]) & 0x80) != 0;
+    size_t length;
+    if (!decodeInteger(in, pos, 7, length) || length > in.size() - pos)
+        return false;
+
+    std::string raw = in.substr(pos, length);
+    pos += length;
+    if (!huffman)
+    {
+        value = raw;
+        return true;
+    }
+    value.clear();
+    return huffmanDecode(raw, value);
+}
+
+// ========================================
+// Huffman Coding
+// ========================================
+
+size_t Hpack::huffmanLength(const std::string& data)
+{
+    size_t bits = 0;
+    for (size_t i = 0; i < data.size(); ++i)
+        bits += HUFFMAN_TABLE[static_cast<unsigned char>(data[i])].bits;
+    return (bits + 7) / 8;
+}
+
+std::string Hpack::huffmanEncode(const std::string& data)
+{
+    std::string out;
+    unsigned long acc = 0;  // Holds < 8 pending bits plus one code (<= 30 bits)
+    int pending = 0;
+
+    out.reserve(huffmanLength(data));
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        const HuffmanCode& hc = HUFFMAN_TABLE[static_cast<unsigned char>(data[i])];
+        acc = (acc << hc.bits) | hc.code;
+        pending += hc.bits;
+        while (pending >= 8)
+        {
+            pending -= 8;
+            out += static_cast<char>((acc >> pending) & 0xff);
+        }
+        acc &= (1UL << pending) - 1;
+    }
+    // Pad with the most significant bits of EOS (all ones)
+    if (pending > 0)
+        out += static_cast<char>(((acc << (8 - pending)) | (0xff >> pending)) & 0xff);
+    return out;
+}
+
+bool Hpack::huffmanDecode(const std::string& data, std::string& out)
+{
+    const HuffmanDecoder& table = huffmanDecoder();
+    unsigned int code = 0;
+    int length = 0;
+    bool all_ones = true;   // Pending bits could still be EOS padding
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        unsigned char byte = static_cast<unsigned char>(data[i]);
+        for (int bit = 7; bit >= 0; --bit)
+        {
+            unsigned int b = (byte >> bit) & 1;
+            code = (code << 1) | b;
+            length++;
+            all_ones = all_ones && b;
+            if (table.count[length] > 0 && code >= table.first[length] &&
+                code - table.first[length] < static_cast<unsigned int>(table.count[length]))
+            {
+                int sym = table.symbols[table.offset[length] + (code - table.first[length])];
+                if (sym == 256)
+                    return false;   // EOS inside a string is an error
+                out += static_cast<char>(sym);
+                code = 0;
+                length = 0;
+                all_ones = true;
+            }
+            else if (length >= HUFFMAN_MAX_BITS)
+                return false;
+        }
+    }
+    // Padding: fewer than 8 bits, all ones
+    return length < 8 && all_ones;
+}
+
+// ========================================
+// Decoder
+// ========================================
+
+Hpack::Decoder::Decoder()
+    : _size(0)
+    , _max_size(DEFAULT_TABLE_SIZE)
+    , _settings_max(DEFAULT_TABLE_SIZE)
+{
+}
+
+bool Hpack::Decoder::decode(const std::string& block, HeaderList& headers)
+{
+    size_t pos = 0;
+    size_t list_size = 0;
+    bool field_seen = false;
+
+    while (pos < block.size())
+    {
+        unsigned char first = static_cast<unsigned char>(block[pos]);
+        std::string name;
+        std::string value;
+        size_t index;
+
+        if (first & 0x80)
+        {
+            // Indexed field
+            if (!decodeInteger(block, pos, 7, index) || !_lookup(index, name, value))
+                return false;
+        }
+        else if (first & 0x20 && !(first & 0x40))
+        {
+            // Dynamic table size update, only before the first field
+            if (field_seen || !decodeInteger(block, pos, 5, index) || index > _settings_max)
+                return false;
+            _max_size = index;
+            _evict(_max_size);
+            continue;
+        }
+        else
+        {
+            // Literal: with incremental indexing (01), without (0000) or never indexed (0001)
+            bool indexing = (first & 0x40) != 0;
+            if (!decodeInteger(block, pos, indexing ? 6 : 4, index))
+                return false;
+            if (index == 0)
+            {
+                if (!decodeString(block, pos, name))
+                    return false;
+            }
+            else if (!_lookup(index, name, value))
+                return false;
+            if (!decodeString(block, pos, value))
+                return false;
+            if (indexing)
+                _add(name, value);
+        }
+
+        field_seen = true;
+        list_size += entrySize(name, value);
+        if (list_size > MAX_HEADER_LIST_SIZE)
+            return false;
+        headers.push_back(std::make_pair(name, value));
+    }
+    return true;
+}
+
+void Hpack::Decoder::_add(const std::string& name, const std::string& value)
+{
+    size_t size = entrySize(name, value);
+
+    // An entry larger than the table empties it (not an error)
+    if (size > _max_size)
+    {
+        _evict(0);
+        return;
+    }
+    _evict(_max_size - size);
+    _entries.push_front(std::make_pair(name, value));
+    _size += size;
+}
+
+void Hpack::Decoder::_evict(size_t limit)
+{
+    while (_size > limit && !_entries.empty())
+    {
+        _size -= entrySize(_entries.back().first, _entries.back().second);
+        _entries.pop_back();
+    }
+}
+
+bool Hpack::Decoder::_lookup(size_t index, std::string& name, std::string& value) const
+{
+    if (index == 0)
+        return false;
+    if (index <= STATIC_COUNT)
+    {
+        name = STATIC_TABLE[index - 1].name;
+        value = STATIC_TABLE[index - 1].value;
+        return true;
+    }
+    index -= STATIC_COUNT + 1;
+    if (index >= _entries.size())
+        return false;
+    name = _entries[index].first;
+    value = _entries[index].second;
+    return true;
+}
+
+// ========================================
+// Encoder
+// ========================================
+
+Hpack::Encoder::Encoder()
+    : _size(0)
+    , _max_size(DEFAULT_TABLE_SIZE)
+    , _min_pending(DEFAULT_TABLE_SIZE)
+    , _size_update(false)
+{
+}
+
+void Hpack::Encoder::setMaxTableSize(size_t size)
+{
+    // Never grow past the default: a bigger table buys little for responses
+    if (size > DEFAULT_TABLE_SIZE)
+        size = DEFAULT_TABLE_SIZE;
+    if (size == _max_size && !_size_update)
+        return;
+
+    if (!_size_update || size < _min_pending)
+        _min_pending = size;
+    _max_size = size;
+    _size_update = true;
+    _evict(_max_size);
+}
+
+std::string Hpack::Encoder::encode(const HeaderList& headers)
+{
+    std::string out;
+
+    if (_size_update)
+    {
+        // A shrink-then-grow between blocks must announce the minimum first
+        if (_min_pending < _max_size)
+            encodeInteger(out, _min_pending, 5, 0x20);
+        encodeInteger(out, _max_size, 5, 0x20);
+        _size_update = false;
+    }
+
+    for (size_t i = 0; i < headers.size(); ++i)
+    {
+        const std::string& name = headers[i].first;
+        const std::string& value = headers[i].second;
+        bool exact = false;
+        size_t index = _find(name, value, exact);
+
+        if (exact)
+        {
+            encodeInteger(out, index, 7, 0x80);
+            continue;
+        }
+        if (isIndexable(name) && entrySize(name, value) <= _max_size / 2)
+        {
+            encodeInteger(out, index, 6, 0x40);
+            if (index == 0)
+                encodeString(out, name);
+            encodeString(out, value);
+            _add(name, value);
+            continue;
+        }
+        encodeInteger(out, index, 4, isSensitive(name) ? 0x10 : 0x00);
+        if (index == 0)
+            encodeString(out, name);
+        encodeString(out, value);
+    }
+    return out;
+}
+
+void Hpack::Encoder::_add(const std::string& name, const std::string& value)
+{
+    size_t size = entrySize(name, value);
+
+    if (size > _max_size)
+    {
+        _evict(0);
+        return;
+    }
+    _evict(_max_size - size);
+    _entries.push_front(std::make_pair(name, value));
+    _size += size;
+}
+
+void Hpack::Encoder::_evict(size_t limit)
+{
+    while (_size > limit && !_entries.empty())
+    {
+        _size -= entrySize(_entries.back().first, _entries.back().second);
+        _entries.pop_back();
+    }
+}
+
+size_t Hpack::Encoder::_find(const std::string& name, const std::string& value, bool& exact) const
+{
+    size_t name_match = 0;
+
+    exact = false;
+    for (size_t i = 0; i < STATIC_COUNT; ++i)
+    {
+        if (name != STATIC_TABLE[i].name)
+            continue;
+        if (value == STATIC_TABLE[i].value)
+        {
+            exact = true;
+            return i + 1;
+        }
+        if (name_match == 0)
+            name_match = i + 1;
+    }
+    for (size_t i = 0; i < _entries.size(); ++i)
+    {
+        if (name != _entries[i].first)
+            continue;
+        if (value == _entries[i].second)
+        {
+            exact = true;
+            return STATIC_COUNT + 1 + i;
+        }
+        if (name_match == 0)
+            name_match = STATIC_COUNT + 1 + i;
+    }
+    return name_match;
+}
+
+} // namespace wsv
@@ -0,0 +1,95 @@
+#ifndef HPACK_HPP
+#define HPACK_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+
+namespace wsv
+{
+
+/**
+ * Hpack - HTTP/2 header compression (RFC 7541)
+ *
+ * Features:
+ * - Static table, dynamic table with size updates
+ * - Integer and string literals, Huffman coding in both directions
+ * - Decoder rejects malformed blocks (a connection-level COMPRESSION_ERROR)
+ * - Encoder indexes stable response headers (server, content-type, ...)
+ *   and keeps per-response values (content-length, date, ...) out of the table
+ *
+ * Each HTTP/2 connection owns one Decoder (request headers) and one
+ * Encoder (response headers); their tables follow the header blocks in
+ * connection order.
+ */
+class Hpack
+{
+public:
+    // ===== Type Definitions =====
+    typedef std::vector<std::pair<std::string, std::string> > HeaderList;  // Order and duplicates kept
+
+    // ===== Constants =====
+    static const size_t DEFAULT_TABLE_SIZE = 4096;      // SETTINGS_HEADER_TABLE_SIZE initial value
+    static const size_t MAX_HEADER_LIST_SIZE = 65536;   // Decoded name + value bytes per block
+
+    class Decoder
+    {
+    public:
+        Decoder();
+
+        /**
+         * Decode one complete header block (HEADERS + CONTINUATION payloads)
+         * @param headers Decoded fields are appended here
+         * @return false on a compression error; the connection must be closed
+         */
+        bool decode(const std::string& block, HeaderList& headers);
+
+    private:
+        std::deque<std::pair<std::string, std::string> > _entries;
+        size_t _size;
+        size_t _max_size;               // Current size, lowered or raised by size updates
+        size_t _settings_max;           // Upper bound we advertised
+
+        void _add(const std::string& name, const std::string& value);
+        void _evict(size_t limit);
+        bool _lookup(size_t index, std::string& name, std::string& value) const;
+    };
+
+    class Encoder
+    {
+    public:
+        Encoder();
+
+        // Peer's SETTINGS_HEADER_TABLE_SIZE; announced in the next header block
+        void setMaxTableSize(size_t size);
+
+        // Encode one header block (names must be lowercase)
+        std::string encode(const HeaderList& headers);
+
+    private:
+        std::deque<std::pair<std::string, std::string> > _entries;
+        size_t _size;
+        size_t _max_size;
+        size_t _min_pending;            // Smallest size since the last announced update
+        bool   _size_update;            // Table size update owed at the next block start
+
+        void _add(const std::string& name, const std::string& value);
+        void _evict(size_t limit);
+        // 1-based index over static + dynamic table; 0 if absent
+        size_t _find(const std::string& name, const std::string& value, bool& exact) const;
+    };
+
+    // ===== Primitive coding (exposed for tests) =====
+    static void encodeInteger(std::string& out, size_t value, int prefix_bits, unsigned char flags);
+    static bool decodeInteger(const std::string& in, size_t& pos, int prefix_bits, size_t& value);
+    static void encodeString(std::string& out, const std::string& value);
+    static bool decodeString(const std::string& in, size_t& pos, std::string& value);
+
+    static std::string huffmanEncode(const std::string& data);
+    static size_t huffmanLength(const std::string& data);
+    static bool huffmanDecode(const std::string& data, std::string& out);
+};
+
+} // namespace wsv
+
+#endif
@@ -0,0 +1,995 @@
+#include "Http2.hpp"
+#include "utils/StringUtils.hpp"
+
+namespace wsv
+{
+
+const char* const Http2Connection::PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+namespace
+{
+
+// Frame flags
+const int FLAG_END_STREAM = 0x1;
+const int FLAG_ACK = 0x1;
+const int FLAG_END_HEADERS = 0x4;
+const int FLAG_PADDED = 0x8;
+const int FLAG_PRIORITY = 0x20;
+
+// SETTINGS identifiers
+const int SETTINGS_HEADER_TABLE_SIZE = 0x1;
+const int SETTINGS_ENABLE_PUSH = 0x2;
+const int SETTINGS_MAX_CONCURRENT_STREAMS = 0x3;
+const int SETTINGS_INITIAL_WINDOW_SIZE = 0x4;
+const int SETTINGS_MAX_FRAME_SIZE = 0x5;
+const int SETTINGS_NO_RFC7540_PRIORITIES = 0x9;
+
+const size_t MAX_FRAME_SIZE_LIMIT = 16777215;
+const int DEFAULT_URGENCY = 3;
+
+// Hop-by-hop fields have no meaning in HTTP/2 (RFC 9113 8.2.2)
+bool isConnectionHeader(const std::string& name)
+{
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade";
+}
+
+// Strip the Pad Length byte and the padding of a PADDED frame
+bool stripPadding(int flags, const std::string& payload, std::string& data)
+{
+    if (!(flags & FLAG_PADDED))
+    {
+        data = payload;
+        return true;
+    }
+    if (payload.empty())
+        return false;
+    size_t padding = static_cast<unsigned char>(payload[0]);
+    if (padding >= payload.size())
+        return false;
+    data = payload.substr(1, payload.size() - 1 - padding);
+    return true;
+}
+
+void appendSetting(std::string& out, int id, unsigned int value)
+{
+    out += static_cast<char>((id >> 8) & 0xff);
+    out += static_cast<char>(id & 0xff);
+    out += static_cast<char>((value >> 24) & 0xff);
+    out += static_cast<char>((value >> 16) & 0xff);
+    out += static_cast<char>((value >> 8) & 0xff);
+    out += static_cast<char>(value & 0xff);
+}
+
+} // namespace
+
+// ========================================
+// Stream
+// ========================================
+
+Http2Connection::Stream::Stream()
+    : id(0)
+    , remote_closed(false)
+    , dispatched(false)
+    , responded(false)
+    , status(0)
+    , recv_window(LOCAL_WINDOW)
+    , recv_unacked(0)
+    , send_window(DEFAULT_WINDOW)
+    , out_offset(0)
+    , urgency(DEFAULT_URGENCY)
+    , incremental(false)
+{
+}
+
+// ========================================
+// Construction
+// ========================================
+
+Http2Connection::Http2Connection(size_t max_body_size)
+    : _input_state(INPUT_PREFACE)
+    , _max_body_size(max_body_size)
+    , _last_stream_id(0)
+    , _last_sent_id(0)
+    , _continuation_id(0)
+    , _continuation_end_stream(false)
+    , _peer_max_frame(DEFAULT_FRAME_SIZE)
+    , _peer_initial_window(DEFAULT_WINDOW)
+    , _send_window(DEFAULT_WINDOW)
+    , _recv_window(LOCAL_WINDOW)
+    , _recv_unacked(0)
+    , _goaway_sent(false)
+    , _goaway_received(false)
+    , _failed(false)
+{
+    // Server preface: our SETTINGS, then the connection window raised to match streams
+    std::string settings;
+    appendSetting(settings, SETTINGS_MAX_CONCURRENT_STREAMS, MAX_CONCURRENT_STREAMS);
+    appendSetting(settings, SETTINGS_INITIAL_WINDOW_SIZE, LOCAL_WINDOW);
+    appendSetting(settings, SETTINGS_NO_RFC7540_PRIORITIES, 1);
+    _writeFrame(_control, FRAME_SETTINGS, 0, 0, settings);
+    _sendWindowUpdate(0, LOCAL_WINDOW - DEFAULT_WINDOW);
+}
+
+bool Http2Connection::startUpgraded(const HttpRequest& request, const std::string& settings)
+{
+    std::string payload;
+    if (!decodeBase64Url(settings, payload) || payload.size() % 6 != 0)
+        return false;
+    // Implicitly acknowledged by the 101 (RFC 7540 3.2.1)
+    if (!_applySettings(payload))
+        return false;
+
+    Hpack::HeaderList headers;
+    std::string target = request.getPath();
+    if (!request.getQuery().empty())
+        target += "?" + request.getQuery();
+    headers.push_back(std::make_pair(std::string(":method"), request.getMethod()));
+    headers.push_back(std::make_pair(std::string(":scheme"), std::string("http")));
+    headers.push_back(std::make_pair(std::string(":path"), target));
+    headers.push_back(std::make_pair(std::string(":authority"), request.getHeader(HEADER_HOST)));
+
+    for (size_t i = 0; i < request.getHeaderCount(); ++i)
+    {
+        std::string name = request.getHeaderName(i);
+        if (isConnectionHeader(name) || name == "host" || name == "http2-settings" || name == "content-length")
+            continue;
+        headers.push_back(std::make_pair(name, request.getHeaderValue(i)));
+    }
+
+    // Stream 1 is half-closed (remote): the request is already complete
+    Stream& stream = _openStream(1, headers);
+    stream.body = request.getBody();
+    stream.remote_closed = true;
+    _completeRequest(stream);
+    return true;
+}
+
+// ========================================
+// Input
+// ========================================
+
+bool Http2Connection::feed(const char* data, size_t len)
+{
+    if (_failed)
+        return false;
+    _input.append(data, len);
+
+    if (_input_state == INPUT_PREFACE)
+    {
+        size_t n = _input.size() < PREFACE_SIZE ? _input.size() : PREFACE_SIZE;
+        if (_input.compare(0, n, PREFACE, n) != 0)
+            return _connectionError(PROTOCOL_ERROR);
+        if (n < PREFACE_SIZE)
+            return true;
+        _input.erase(0, PREFACE_SIZE);
+        _input_state = INPUT_SETTINGS;
+    }
+
+    size_t pos = 0;
+    while (_input.size() - pos >= FRAME_HEADER_SIZE)
+    {
+        size_t length = (static_cast<unsigned char>(_input[pos]) << 16) |
+                        (static_cast<unsigned char>(_input[pos + 1]) << 8) |
+                        static_cast<unsigned char>(_input[pos + 2]);
+        int type = static_cast<unsigned char>(_input[pos + 3]);
+        int flags = static_cast<unsigned char>(_input[pos + 4]);
+        int stream_id = static_cast<int>(_read32(_input, pos + 5) & 0x7fffffff);
+
+        // We never raise SETTINGS_MAX_FRAME_SIZE above the default
+        if (length > DEFAULT_FRAME_SIZE)
+            return _connectionError(FRAME_SIZE_ERROR);
+        if (_input.size() - pos < FRAME_HEADER_SIZE + length)
+            break;
+
+        std::string payload = _input.substr(pos + FRAME_HEADER_SIZE, length);
+        pos += FRAME_HEADER_SIZE + length;
+
+        if (_input_state == INPUT_SETTINGS)
+        {
+            if (type != FRAME_SETTINGS || (flags & FLAG_ACK))
+                return _connectionError(PROTOCOL_ERROR);
+            _input_state = INPUT_FRAMES;
+        }
+        if (!_processFrame(type, flags, stream_id, payload))
+            return false;
+    }
+    _input.erase(0, pos);
+    return true;
+}
+
+bool Http2Connection::_processFrame(int type, int flags, int stream_id, const std::string& payload)
+{
+    // Nothing may interleave with a header block
+    if (_continuation_id != 0 && type != FRAME_CONTINUATION)
+        return _connectionError(PROTOCOL_ERROR);
+
+    switch (type)
+    {
+        case FRAME_DATA:
+            return _onData(flags, stream_id, payload);
+        case FRAME_HEADERS:
+            return _onHeaders(flags, stream_id, payload);
+        case FRAME_CONTINUATION:
+            return _onContinuation(flags, stream_id, payload);
+        case FRAME_PRIORITY:
+            // RFC 7540 dependency tree: deprecated, priorities come from RFC 9218
+            if (stream_id == 0)
+                return _connectionError(PROTOCOL_ERROR);
+            if (payload.size() != 5)
+                _resetStream(stream_id, FRAME_SIZE_ERROR);
+            return true;
+        case FRAME_RST_STREAM:
+            return _onRstStream(stream_id, payload);
+        case FRAME_SETTINGS:
+            return _onSettings(flags, stream_id, payload);
+        case FRAME_PUSH_PROMISE:
+            return _connectionError(PROTOCOL_ERROR);    // Clients cannot push
+        case FRAME_PING:
+            return _onPing(flags, stream_id, payload);
+        case FRAME_GOAWAY:
+            if (stream_id != 0)
+                return _connectionError(PROTOCOL_ERROR);
+            _goaway_received = true;
+            return true;
+        case FRAME_WINDOW_UPDATE:
+            return _onWindowUpdate(stream_id, payload);
+        case FRAME_PRIORITY_UPDATE:
+            return _onPriorityUpdate(stream_id, payload);
+        default:
+            return true;    // Unknown frame types are ignored
+    }
+}
+
+bool Http2Connection::_onData(int flags, int stream_id, const std::string& payload)
+{
+    if (stream_id == 0)
+        return _connectionError(PROTOCOL_ERROR);
+
+    // The whole payload, padding included, counts against the windows
+    long length = static_cast<long>(payload.size());
+    if (length > _recv_window)
+        return _connectionError(FLOW_CONTROL_ERROR);
+    _recv_window -= length;
+    _recv_unacked += length;
+    if (_recv_unacked >= LOCAL_WINDOW / 2)
+    {
+        _sendWindowUpdate(0, _recv_unacked);
+        _recv_window += _recv_unacked;
+        _recv_unacked = 0;
+    }
+
+    std::string data;
+    if (!stripPadding(flags, payload, data))
+        return _connectionError(PROTOCOL_ERROR);
+
+    std::map<int, Stream>::iterator it = _streams.find(stream_id);
+    if (it == _streams.end())
+    {
+        if (stream_id > _last_stream_id)
+            return _connectionError(PROTOCOL_ERROR);    // Idle stream
+        return true;    // Reset or finished: frames still in flight are dropped
+    }
+
+    Stream& stream = it->second;
+    if (stream.remote_closed)
+    {
+        _resetStream(stream_id, STREAM_CLOSED);
+        return true;
+    }
+    if (length > stream.recv_window)
+    {
+        _resetStream(stream_id, FLOW_CONTROL_ERROR);
+        return true;
+    }
+    stream.recv_window -= length;
+    stream.recv_unacked += length;
+
+    // Too large: answer right away and drop the rest of the body
+    if (stream.status == 0)
+    {
+        if (stream.body.size() + data.size() > _max_body_size)
+        {
+            stream.status = 413;
+            stream.body.clear();
+            _completeRequest(stream);
+        }
+        else
+            stream.body += data;
+    }
+
+    if (flags & FLAG_END_STREAM)
+    {
+        stream.remote_closed = true;
+        if (!stream.dispatched)
+            _completeRequest(stream);
+    }
+    else if (stream.recv_unacked >= LOCAL_WINDOW / 2)
+    {
+        _sendWindowUpdate(stream_id, stream.recv_unacked);
+        stream.recv_window += stream.recv_unacked;
+        stream.recv_unacked = 0;
+    }
+    return true;
+}
+
+bool Http2Connection::_onHeaders(int flags, int stream_id, const std::string& payload)
+{
+    // Client streams are odd
+    if (stream_id == 0 || !(stream_id & 1))
+        return _connectionError(PROTOCOL_ERROR);
+
+    std::string block;
+    if (!stripPadding(flags, payload, block))
+        return _connectionError(PROTOCOL_ERROR);
+    if (flags & FLAG_PRIORITY)
+    {
+        if (block.size() < 5)
+            return _connectionError(FRAME_SIZE_ERROR);
+        block.erase(0, 5);  // Exclusive bit, dependency and weight: unused
+    }
+
+    _continuation_id = stream_id;
+    _continuation_end_stream = (flags & FLAG_END_STREAM) != 0;
+    _header_block = block;
+    if (flags & FLAG_END_HEADERS)
+        return _endHeaderBlock();
+    return true;
+}
+
+bool Http2Connection::_onContinuation(int flags, int stream_id, const std::string& payload)
+{
+    if (_continuation_id == 0 || stream_id != _continuation_id)
+        return _connectionError(PROTOCOL_ERROR);
+
+    _header_block += payload;
+    if (_header_block.size() > MAX_HEADER_BLOCK)
+        return _connectionError(ENHANCE_YOUR_CALM);
+    if (flags & FLAG_END_HEADERS)
+        return _endHeaderBlock();
+    return true;
+}
+
+bool Http2Connection::_endHeaderBlock()
+{
+    int stream_id = _continuation_id;
+    Hpack::HeaderList headers;
+
+    _continuation_id = 0;
+    // Decoded even for streams we refuse: the HPACK tables must stay in sync
+    bool decoded = _decoder.decode(_header_block, headers);
+    _header_block.clear();
+    if (!decoded)
+        return _connectionError(COMPRESSION_ERROR);
+
+    std::map<int, Stream>::iterator it = _streams.find(stream_id);
+    if (it != _streams.end())
+    {
+        // Trailers: must end the stream; their fields are not used
+        Stream& stream = it->second;
+        if (stream.remote_closed)
+            return _connectionError(STREAM_CLOSED);
+        if (!_continuation_end_stream || !_validateHeaders(headers, true))
+        {
+            _resetStream(stream_id, PROTOCOL_ERROR);
+            return true;
+        }
+        stream.remote_closed = true;
+        if (!stream.dispatched)
+            _completeRequest(stream);
+        return true;
+    }
+
+    if (stream_id <= _last_stream_id)
+        return true;    // Stream already reset by us
+    _last_stream_id = stream_id;
+
+    if (_goaway_sent)
+        return true;    // Not processed, as announced by GOAWAY
+    if (_streams.size() >= MAX_CONCURRENT_STREAMS)
+    {
+        _resetStream(stream_id, REFUSED_STREAM);
+        return true;
+    }
+    if (!_validateHeaders(headers, false))
+    {
+        _resetStream(stream_id, PROTOCOL_ERROR);
+        return true;
+    }
+
+    Stream& stream = _openStream(stream_id, headers);
+    if (_continuation_end_stream)
+    {
+        stream.remote_closed = true;
+        _completeRequest(stream);
+    }
+    return true;
+}
+
+bool Http2Connection::_onSettings(int flags, int stream_id, const std::string& payload)
+{
+    if (stream_id != 0)
+        return _connectionError(PROTOCOL_ERROR);
+    if (flags & FLAG_ACK)
+    {
+        if (!payload.empty())
+            return _connectionError(FRAME_SIZE_ERROR);
+        return true;
+    }
+    if (payload.size() % 6 != 0)
+        return _connectionError(FRAME_SIZE_ERROR);
+    if (!_applySettings(payload))
+        return false;
+    _writeFrame(_control, FRAME_SETTINGS, FLAG_ACK, 0, "");
+    return true;
+}
+
+bool Http2Connection::_applySettings(const std::string& payload)
+{
+    for (size_t pos = 0; pos + 6 <= payload.size(); pos += 6)
+    {
+        int id = (static_cast<unsigned char>(payload[pos]) << 8) |
+                 static_cast<unsigned char>(payload[pos + 1]);
+        unsigned int value = _read32(payload, pos + 2);
+
+        if (id == SETTINGS_HEADER_TABLE_SIZE)
+            _encoder.setMaxTableSize(value);
+        else if (id == SETTINGS_ENABLE_PUSH)
+        {
+            if (value > 1)
+                return _connectionError(PROTOCOL_ERROR);
+        }
+        else if (id == SETTINGS_INITIAL_WINDOW_SIZE)
+        {
+            if (value > static_cast<unsigned int>(MAX_WINDOW))
+                return _connectionError(FLOW_CONTROL_ERROR);
+            // Applies to the open streams as a delta (RFC 9113 6.9.2)
+            long delta = static_cast<long>(value) - _peer_initial_window;
+            for (std::map<int, Stream>::iterator it = _streams.begin(); it != _streams.end(); ++it)
+            {
+                it->second.send_window += delta;
+                if (it->second.send_window > MAX_WINDOW)
+                    return _connectionError(FLOW_CONTROL_ERROR);
+            }
+            _peer_initial_window = value;
+        }
+        else if (id == SETTINGS_MAX_FRAME_SIZE)
+        {
+            if (value < DEFAULT_FRAME_SIZE || value > MAX_FRAME_SIZE_LIMIT)
+                return _connectionError(PROTOCOL_ERROR);
+            _peer_max_frame = value;
+        }
+        // Others (MAX_CONCURRENT_STREAMS: we never push; MAX_HEADER_LIST_SIZE) are advisory
+    }
+    return true;
+}
+
+bool Http2Connection::_onWindowUpdate(int stream_id, const std::string& payload)
+{
+    if (payload.size() != 4)
+        return _connectionError(FRAME_SIZE_ERROR);
+    long increment = static_cast<long>(_read32(payload, 0) & 0x7fffffff);
+
+    if (stream_id == 0)
+    {
+        if (increment == 0)
+            return _connectionError(PROTOCOL_ERROR);
+        _send_window += increment;
+        if (_send_window > MAX_WINDOW)
+            return _connectionError(FLOW_CONTROL_ERROR);
+        return true;
+    }
+
+    std::map<int, Stream>::iterator it = _streams.find(stream_id);
+    if (it == _streams.end())
+    {
+        if (stream_id > _last_stream_id)
+            return _connectionError(PROTOCOL_ERROR);
+        return true;
+    }
+    if (increment == 0)
+    {
+        _resetStream(stream_id, PROTOCOL_ERROR);
+        return true;
+    }
+    it->second.send_window += increment;
+    if (it->second.send_window > MAX_WINDOW)
+        _resetStream(stream_id, FLOW_CONTROL_ERROR);
+    return true;
+}
+
+bool Http2Connection::_onRstStream(int stream_id, const std::string& payload)
+{
+    if (payload.size() != 4)
+        return _connectionError(FRAME_SIZE_ERROR);
+    if (stream_id == 0 || stream_id > _last_stream_id)
+        return _connectionError(PROTOCOL_ERROR);
+    _streams.erase(stream_id);
+    return true;
+}
+
+bool Http2Connection::_onPing(int flags, int stream_id, const std::string& payload)
+{
+    if (payload.size() != 8)
+        return _connectionError(FRAME_SIZE_ERROR);
+    if (stream_id != 0)
+        return _connectionError(PROTOCOL_ERROR);
+    if (!(flags & FLAG_ACK))
+        _writeFrame(_control, FRAME_PING, FLAG_ACK, 0, payload);
+    return true;
+}
+
+bool Http2Connection::_onPriorityUpdate(int stream_id, const std::string& payload)
+{
+    if (stream_id != 0)
+        return _connectionError(PROTOCOL_ERROR);
+    if (payload.size() < 4)
+        return _connectionError(FRAME_SIZE_ERROR);
+
+    int target = static_cast<int>(_read32(payload, 0) & 0x7fffffff);
+    std::string value = payload.substr(4);
+
+    std::map<int, Stream>::iterator it = _streams.find(target);
+    if (it != _streams.end())
+        _parsePriority(value, it->second);
+    // May precede the HEADERS of the stream; kept (bounded) until then
+    else if (target > _last_stream_id && _early_priorities.size() < MAX_CONCURRENT_STREAMS)
+        _early_priorities[target] = value;
+    return true;
+}
+
+// ========================================
+// Requests
+// ========================================
+
+Http2Connection::Stream& Http2Connection::_openStream(int stream_id, const Hpack::HeaderList& headers)
+{
+    Stream& stream = _streams[stream_id];
+
+    stream.id = stream_id;
+    stream.headers = headers;
+    stream.send_window = _peer_initial_window;
+    for (size_t i = 0; i < headers.size(); ++i)
+    {
+        if (headers[i].first == "priority")
+            _parsePriority(headers[i].second, stream);
+    }
+    // A PRIORITY_UPDATE overrides the header
+    std::map<int, std::string>::iterator early = _early_priorities.find(stream_id);
+    if (early != _early_priorities.end())
+    {
+        _parsePriority(early->second, stream);
+        _early_priorities.erase(early);
+    }
+    if (stream_id > _last_stream_id)
+        _last_stream_id = stream_id;
+    return stream;
+}
+
+void Http2Connection::_completeRequest(Stream& stream)
+{
+    stream.dispatched = true;
+    _ready.push_back(stream.id);
+}
+
+// Malformed requests are stream errors (RFC 9113 8.1.1)
+bool Http2Connection::_validateHeaders(const Hpack::HeaderList& headers, bool trailers) const
+{
+    bool regular_seen = false;
+    bool has_method = false;
+    bool has_scheme = false;
+    bool has_path = false;
+    bool has_authority = false;
+
+    for (size_t i = 0; i < headers.size(); ++i)
+    {
+        const std::string& name = headers[i].first;
+        const std::string& value = headers[i].second;
+
+        if (name.empty())
+            return false;
+        for (size_t c = (name[0] == ':') ? 1 : 0; c < name.size(); ++c)
+        {
+            unsigned char ch = static_cast<unsigned char>(name[c]);
+            if (ch <= 0x20 || ch >= 0x7f || ch == ':' || (ch >= 'A' && ch <= 'Z'))
+                return false;
+        }
+        // Would split the rebuilt HTTP/1.1 request
+        if (value.find_first_of(std::string("\r\n\0", 3)) != std::string::npos)
+            return false;
+
+        if (name[0] == ':')
+        {
+            if (trailers || regular_seen)
+                return false;
+            bool* seen = NULL;
+            if (name == ":method")
+                seen = &has_method;
+            else if (name == ":scheme")
+                seen = &has_scheme;
+            else if (name == ":path")
+                seen = &has_path;
+            else if (name == ":authority")
+                seen = &has_authority;
+            if (!seen || *seen)
+                return false;
+            *seen = true;
+            if (name == ":path" && (value.empty() || value[0] != '/'))
+                return false;
+            continue;
+        }
+        regular_seen = true;
+        if (isConnectionHeader(name) || (name == "te" && value != "trailers"))
+            return false;
+    }
+    return trailers || (has_method && has_scheme && has_path);
+}
+
+bool Http2Connection::popRequest(int& stream_id, HttpRequest& request, int& status)
+{
+    while (!_ready.empty())
+    {
+        int id = _ready.front();
+        _ready.pop_front();
+
+        std::map<int, Stream>::iterator it = _streams.find(id);
+        if (it == _streams.end())
+            continue;   // Reset by the client meanwhile
+        Stream& stream = it->second;
+
+        // Rebuild the request as HTTP/1.1 so HttpRequest and the handlers apply unchanged
+        std::string method;
+        std::string path;
+        std::string authority;
+        std::string host;
+        std::string cookies;
+        std::string fields;
+        std::string declared_length;
+        for (size_t i = 0; i < stream.headers.size(); ++i)
+        {
+            const std::string& name = stream.headers[i].first;
+            const std::string& value = stream.headers[i].second;
+            if (name == ":method")
+                method = value;
+            else if (name == ":path")
+                path = value;
+            else if (name == ":authority")
+                authority = value;
+            else if (name[0] == ':')
+                continue;
+            else if (name == "host")
+                host = value;
+            else if (name == "content-length")
+                declared_length = value;
+            // Split cookie fields are joined back (RFC 9113 8.2.3)
+            else if (name == "cookie")
+                cookies += (cookies.empty() ? "" : "; ") + value;
+            else
+                fields += name + ": " + value + "\r\n";
+        }
+
+        status = stream.status;
+        if (status == 0 && !declared_length.empty() &&
+            declared_length != StringUtils::toString(static_cast<int>(stream.body.size())))
+            status = 400;
+
+        std::string text = method + " " + path + " HTTP/1.1\r\n";
+        text += "host: " + (authority.empty() ? host : authority) + "\r\n";
+        text += fields;
+        if (!cookies.empty())
+            text += "cookie: " + cookies + "\r\n";
+        if (status == 0 && (!stream.body.empty() || method == "POST"))
+            text += "content-length: " + StringUtils::toString(static_cast<int>(stream.body.size())) + "\r\n";
+        text += "\r\n";
+        if (status == 0)
+            text += stream.body;
+
+        request.reset();
+        request.parse(text.c_str(), text.size());
+        if (!request.isComplete() && status == 0)
+            status = 400;
+
+        stream.headers.clear();
+        stream.body.clear();
+        stream_id = id;
+        return true;
+    }
+    return false;
+}
+
+void Http2Connection::_parsePriority(const std::string& value, Stream& stream)
+{
+    std::vector<std::string> params = StringUtils::split(value, ",");
+
+    for (size_t i = 0; i < params.size(); ++i)
+    {
+        std::string param = StringUtils::trim(params[i]);
+        if (param.size() == 3 && param[0] == 'u' && param[1] == '=' && param[2] >= '0' && param[2] <= '7')
+            stream.urgency = param[2] - '0';
+        else if (param == "i" || param == "i=?1")
+            stream.incremental = true;
+        else if (param == "i=?0")
+            stream.incremental = false;
+    }
+}
+
+// ========================================
+// Responses
+// ========================================
+
+void Http2Connection::submitResponse(int stream_id, const HttpResponse& response, bool head_request)
+{
+    std::map<int, Stream>::iterator it = _streams.find(stream_id);
+    if (it == _streams.end() || _failed)
+        return;
+    Stream& stream = it->second;
+
+    Hpack::HeaderList headers;
+    headers.push_back(std::make_pair(std::string(":status"), StringUtils::toString(response.getStatus())));
+    HttpResponse::HeaderList fields;
+    response.collectHeaders(fields);
+    for (HttpResponse::HeaderList::const_iterator f = fields.begin(); f != fields.end(); ++f)
+    {
+        std::string name = StringUtils::toLower(f->first);
+        if (!isConnectionHeader(name))
+            headers.push_back(std::make_pair(name, f->second));
+    }
+
+    std::string block = _encoder.encode(headers);
+    bool end_stream = head_request || response.getBody().empty();
+
+    // HEADERS, then CONTINUATION for what exceeds the peer's frame size
+    size_t pos = 0;
+    do
+    {
+        size_t n = block.size() - pos;
+        if (n > _peer_max_frame)
+            n = _peer_max_frame;
+        int flags = 0;
+        if (pos + n == block.size())
+            flags |= FLAG_END_HEADERS;
+        if (pos == 0 && end_stream)
+            flags |= FLAG_END_STREAM;
+        _writeFrame(_control, pos == 0 ? FRAME_HEADERS : FRAME_CONTINUATION, flags, stream_id,
+                    block.substr(pos, n));
+        pos += n;
+    } while (pos < block.size());
+
+    stream.responded = true;
+    if (end_stream)
+        _closeIfDone(stream_id);
+    else
+    {
+        stream.out = response.getBody();
+        stream.out_offset = 0;
+    }
+}
+
+// Our side is done; a client still sending (early 413) is told to stop
+void Http2Connection::_closeIfDone(int stream_id)
+{
+    std::map<int, Stream>::iterator it = _streams.find(stream_id);
+    if (it == _streams.end())
+        return;
+    if (!it->second.remote_closed)
+        _resetStream(stream_id, NO_ERROR);
+    else
+        _streams.erase(it);
+}
+
+void Http2Connection::produce(std::string& out, size_t budget)
+{
+    out += _control;
+    _control.clear();
+
+    while (out.size() < budget && _send_window > 0)
+    {
+        Stream* stream = _nextSendable();
+        if (!stream)
+            break;
+
+        size_t remaining = stream->out.size() - stream->out_offset;
+        size_t n = remaining;
+        if (n > _peer_max_frame)
+            n = _peer_max_frame;
+        if (static_cast<long>(n) > stream->send_window)
+            n = stream->send_window;
+        if (static_cast<long>(n) > _send_window)
+            n = _send_window;
+
+        bool last = (n == remaining);
+        _writeFrame(out, FRAME_DATA, last ? FLAG_END_STREAM : 0, stream->id,
+                    stream->out.substr(stream->out_offset, n));
+        stream->out_offset += n;
+        stream->send_window -= n;
+        _send_window -= n;
+        _last_sent_id = stream->id;
+
+        if (last)
+        {
+            _closeIfDone(stream->id);
+            out += _control;
+            _control.clear();
+        }
+    }
+}
+
+// RFC 9218: lowest urgency first; at equal urgency non-incremental
+// responses go one by one in stream order, incremental ones take turns
+Http2Connection::Stream* Http2Connection::_nextSendable()
+{
+    int urgency = 8;
+
+    for (std::map<int, Stream>::iterator it = _streams.begin(); it != _streams.end(); ++it)
+    {
+        const Stream& s = it->second;
+        if (s.responded && s.out_offset < s.out.size() && s.send_window > 0 && s.urgency < urgency)
+            urgency = s.urgency;
+    }
+    if (urgency == 8)
+        return NULL;
+
+    Stream* first_incremental = NULL;
+    Stream* next_incremental = NULL;
+    for (std::map<int, Stream>::iterator it = _streams.begin(); it != _streams.end(); ++it)
+    {
+        Stream& s = it->second;
+        if (!s.responded || s.out_offset >= s.out.size() || s.send_window <= 0 || s.urgency != urgency)
+            continue;
+        if (!s.incremental)
+            return &s;
+        if (!first_incremental)
+            first_incremental = &s;
+        if (!next_incremental && s.id > _last_sent_id)
+            next_incremental = &s;
+    }
+    return next_incremental ? next_incremental : first_incremental;
+}
+
+bool Http2Connection::wantsWrite() const
+{
+    if (!_control.empty())
+        return true;
+    if (_send_window <= 0)
+        return false;
+    for (std::map<int, Stream>::const_iterator it = _streams.begin(); it != _streams.end(); ++it)
+    {
+        const Stream& s = it->second;
+        if (s.responded && s.out_offset < s.out.size() && s.send_window > 0)
+            return true;
+    }
+    return false;
+}
+
+bool Http2Connection::isClosing() const
+{
+    if (!_failed && !_goaway_sent && !_goaway_received)
+        return false;
+    if (!_control.empty())
+        return false;
+    for (std::map<int, Stream>::const_iterator it = _streams.begin(); it != _streams.end(); ++it)
+    {
+        if (it->second.responded && it->second.out_offset < it->second.out.size())
+            return false;
+    }
+    return true;
+}
+
+void Http2Connection::shutdown()
+{
+    if (_goaway_sent)
+        return;
+    std::string payload;
+    _append32(payload, _last_stream_id);
+    _append32(payload, NO_ERROR);
+    _writeFrame(_control, FRAME_GOAWAY, 0, 0, payload);
+    _goaway_sent = true;
+}
+
+// ========================================
+// Frame Output
+// ========================================
+
+void Http2Connection::_writeFrame(std::string& out, int type, int flags, int stream_id,
+                                  const std::string& payload) const
+{
+    size_t length = payload.size();
+
+    out += static_cast<char>((length >> 16) & 0xff);
+    out += static_cast<char>((length >> 8) & 0xff);
+    out += static_cast<char>(length & 0xff);
+    out += static_cast<char>(type);
+    out += static_cast<char>(flags);
+    _append32(out, stream_id & 0x7fffffff);
+    out += payload;
+}
+
+void Http2Connection::_sendWindowUpdate(int stream_id, long increment)
+{
+    std::string payload;
+    _append32(payload, static_cast<unsigned int>(increment));
+    _writeFrame(_control, FRAME_WINDOW_UPDATE, 0, stream_id, payload);
+}
+
+void Http2Connection::_resetStream(int stream_id, ErrorCode code)
+{
+    std::string payload;
+    _append32(payload, code);
+    _writeFrame(_control, FRAME_RST_STREAM, 0, stream_id, payload);
+    _streams.erase(stream_id);
+}
+
+bool Http2Connection::_connectionError(ErrorCode code)
+{
+    if (!_failed)
+    {
+        std::string payload;
+        _append32(payload, _last_stream_id);
+        _append32(payload, code);
+        _writeFrame(_control, FRAME_GOAWAY, 0, 0, payload);
+        _goaway_sent = true;
+        _failed = true;
+    }
+    _streams.clear();
+    _ready.clear();
+    _input.clear();
+    return false;
+}
+
+// ========================================
+// Helpers
+// ========================================
+
+unsigned int Http2Connection::_read32(const std::string& data, size_t pos)
+{
+    return (static_cast<unsigned int>(static_cast<unsigned char>(data[pos])) << 24) |
+           (static_cast<unsigned int>(static_cast<unsigned char>(data[pos + 1])) << 16) |
+           (static_cast<unsigned int>(static_cast<unsigned char>(data[pos + 2])) << 8) |
+           static_cast<unsigned int>(static_cast<unsigned char>(data[pos + 3]));
+}
+
+void Http2Connection::_append32(std::string& out, unsigned int value)
+{
+    out += static_cast<char>((value >> 24) & 0xff);
+    out += static_cast<char>((value >> 16) & 0xff);
+    out += static_cast<char>((value >> 8) & 0xff);
+    out += static_cast<char>(value & 0xff);
+}
+
+bool Http2Connection::decodeBase64Url(const std::string& in, std::string& out)
+{
+    unsigned int acc = 0;
+    int bits = 0;
+
+    out.clear();
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        char c = in[i];
+        int value;
+        if (c >= 'A' && c <= 'Z')
+            value = c - 'A';
+        else if (c >= 'a' && c <= 'z')
+            value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9')
+            value = c - '0' + 52;
+        else if (c == '-' || c == '+')
+            value = 62;
+        else if (c == '_' || c == '/')
+            value = 63;
+        else if (c == '=')
+            break;  // Padding is not required, but tolerated
+        else
+            return false;
+
+        acc = (acc << 6) | value;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out += static_cast<char>((acc >> bits) & 0xff);
+        }
+    }
+    return true;
+}
+
+} // namespace wsv
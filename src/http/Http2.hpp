@@ -0,0 +1,221 @@
+#ifndef HTTP2_HPP
+#define HTTP2_HPP
+
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+
+#include "Hpack.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+
+namespace wsv
+{
+
+/**
+ * Http2Connection - Server side of one HTTP/2 connection (RFC 9113)
+ *
+ * Features:
+ * - Cleartext HTTP/2: prior knowledge (client preface first) or h2c Upgrade
+ * - Stream multiplexing with MAX_CONCURRENT_STREAMS, RST_STREAM, GOAWAY
+ * - HPACK header blocks split over CONTINUATION frames
+ * - Flow control in both directions (connection and stream windows)
+ * - Extensible priorities (RFC 9218): `priority` header and PRIORITY_UPDATE;
+ *   lower urgency first, non-incremental responses one at a time in stream
+ *   order, incremental ones interleaved round-robin
+ *
+ * The class only turns bytes into requests and responses into bytes; the
+ * Server owns the socket. Each complete request is rebuilt as HTTP/1.1 text
+ * and parsed by HttpRequest, so routing is shared with HTTP/1.x.
+ *
+ * Usage:
+ *   conn.feed(data, len);                      // false: connection error, flush and close
+ *   while (conn.popRequest(id, request, status))
+ *       conn.submitResponse(id, handle(request), request.getMethodId() == METHOD_HEAD);
+ *   conn.produce(out, budget);                 // frames to send
+ */
+class Http2Connection
+{
+public:
+    // ===== Constants =====
+    static const char* const PREFACE;               // "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+    static const size_t PREFACE_SIZE = 24;
+    static const size_t FRAME_HEADER_SIZE = 9;
+    static const size_t DEFAULT_FRAME_SIZE = 16384;
+    static const long   DEFAULT_WINDOW = 65535;
+    static const long   MAX_WINDOW = 0x7fffffff;
+    static const size_t MAX_CONCURRENT_STREAMS = 100;
+    static const long   LOCAL_WINDOW = 1 << 20;     // Receive window we advertise per stream and connection
+    static const size_t MAX_HEADER_BLOCK = 65536;   // HEADERS + CONTINUATION payload per request
+
+    enum FrameType
+    {
+        FRAME_DATA = 0x0,
+        FRAME_HEADERS = 0x1,
+        FRAME_PRIORITY = 0x2,
+        FRAME_RST_STREAM = 0x3,
+        FRAME_SETTINGS = 0x4,
+        FRAME_PUSH_PROMISE = 0x5,
+        FRAME_PING = 0x6,
+        FRAME_GOAWAY = 0x7,
+        FRAME_WINDOW_UPDATE = 0x8,
+        FRAME_CONTINUATION = 0x9,
+        FRAME_PRIORITY_UPDATE = 0x10
+    };
+
+    enum ErrorCode
+    {
+        NO_ERROR = 0x0,
+        PROTOCOL_ERROR = 0x1,
+        INTERNAL_ERROR = 0x2,
+        FLOW_CONTROL_ERROR = 0x3,
+        STREAM_CLOSED = 0x5,
+        FRAME_SIZE_ERROR = 0x6,
+        REFUSED_STREAM = 0x7,
+        CANCEL = 0x8,
+        COMPRESSION_ERROR = 0x9,
+        ENHANCE_YOUR_CALM = 0xb
+    };
+
+    /**
+     * @param max_body_size Largest request body buffered per stream; beyond
+     *        it the request is handed over early with status 413
+     */
+    explicit Http2Connection(size_t max_body_size);
+
+    /**
+     * Take over an HTTP/1.1 request that asked for `Upgrade: h2c`
+     * The request becomes stream 1; the client preface is still expected
+     * @param settings Value of the HTTP2-Settings header (base64url SETTINGS payload)
+     * @return false if the settings are malformed (answer over HTTP/1.1 instead)
+     */
+    bool startUpgraded(const HttpRequest& request, const std::string& settings);
+
+    /**
+     * Process received bytes (the client preface included)
+     * @return false on a connection error; GOAWAY is queued, flush then close
+     */
+    bool feed(const char* data, size_t len);
+
+    /**
+     * Next complete request, in arrival order
+     * @param status 0, or the error status to answer with (400 malformed, 413 too large)
+     */
+    bool popRequest(int& stream_id, HttpRequest& request, int& status);
+
+    // Queue the response of a stream (ignored if the client reset it meanwhile)
+    void submitResponse(int stream_id, const HttpResponse& response, bool head_request);
+
+    /**
+     * Append frames to send: control frames and headers first, then DATA as
+     * the flow-control windows and the priorities allow
+     * @param budget Stop adding DATA once `out` holds this many bytes
+     */
+    void produce(std::string& out, size_t budget);
+
+    bool wantsWrite() const;
+    bool hasActiveStreams() const { return !_streams.empty(); }
+
+    // GOAWAY sent or received and nothing left to do: close after flushing
+    bool isClosing() const;
+
+    // Queue a graceful GOAWAY (server shutdown, idle timeout)
+    void shutdown();
+
+    // Decode a base64url string (HTTP2-Settings); false on invalid input
+    static bool decodeBase64Url(const std::string& in, std::string& out);
+
+private:
+    struct Stream
+    {
+        int         id;
+        bool        remote_closed;      // END_STREAM received (or request cut short)
+        bool        dispatched;         // Handed to popRequest
+        bool        responded;          // submitResponse called
+        int         status;             // Error status for popRequest, 0 if none
+        Hpack::HeaderList headers;
+        std::string body;
+        long        recv_window;
+        long        recv_unacked;       // Consumed bytes not yet returned with WINDOW_UPDATE
+        long        send_window;
+        std::string out;                // Response body still to send
+        size_t      out_offset;
+        int         urgency;            // RFC 9218 u=0..7, default 3
+        bool        incremental;        // RFC 9218 i
+
+        Stream();
+    };
+
+    enum InputState
+    {
+        INPUT_PREFACE,
+        INPUT_SETTINGS,     // The first frame must be SETTINGS
+        INPUT_FRAMES
+    };
+
+    InputState      _input_state;
+    std::string     _input;
+    size_t          _max_body_size;
+
+    Hpack::Decoder  _decoder;
+    Hpack::Encoder  _encoder;
+
+    std::map<int, Stream> _streams;
+    std::deque<int> _ready;             // Streams waiting for popRequest
+    std::map<int, std::string> _early_priorities;  // PRIORITY_UPDATE before HEADERS
+    int             _last_stream_id;    // Highest client stream id seen
+    int             _last_sent_id;      // Round-robin position of incremental streams
+
+    // Header block being assembled from HEADERS + CONTINUATION
+    int             _continuation_id;
+    bool            _continuation_end_stream;
+    std::string     _header_block;
+
+    // Peer settings
+    size_t          _peer_max_frame;
+    long            _peer_initial_window;
+
+    long            _send_window;
+    long            _recv_window;
+    long            _recv_unacked;
+
+    std::string     _control;           // Queued non-DATA frames, in order
+    bool            _goaway_sent;
+    bool            _goaway_received;
+    bool            _failed;            // Connection error: only the GOAWAY is left to send
+
+    // ===== Frame handling (false = connection error, GOAWAY queued) =====
+    bool _processFrame(int type, int flags, int stream_id, const std::string& payload);
+    bool _onData(int flags, int stream_id, const std::string& payload);
+    bool _onHeaders(int flags, int stream_id, const std::string& payload);
+    bool _onContinuation(int flags, int stream_id, const std::string& payload);
+    bool _onSettings(int flags, int stream_id, const std::string& payload);
+    bool _onWindowUpdate(int stream_id, const std::string& payload);
+    bool _onRstStream(int stream_id, const std::string& payload);
+    bool _onPing(int flags, int stream_id, const std::string& payload);
+    bool _onPriorityUpdate(int stream_id, const std::string& payload);
+    bool _applySettings(const std::string& payload);
+    bool _endHeaderBlock();
+
+    // Request assembly
+    Stream& _openStream(int stream_id, const Hpack::HeaderList& headers);
+    void _completeRequest(Stream& stream);
+    bool _validateHeaders(const Hpack::HeaderList& headers, bool trailers) const;
+    static void _parsePriority(const std::string& value, Stream& stream);
+
+    // Output
+    void _writeFrame(std::string& out, int type, int flags, int stream_id, const std::string& payload) const;
+    void _sendWindowUpdate(int stream_id, long increment);
+    void _resetStream(int stream_id, ErrorCode code);
+    bool _connectionError(ErrorCode code);
+    Stream* _nextSendable();
+    void _closeIfDone(int stream_id);
+
+    static unsigned int _read32(const std::string& data, size_t pos);
+    static void _append32(std::string& out, unsigned int value);
+};
+
+} // namespace wsv
+
+#endif
@@ -0,0 +1,455 @@
+#include "HttpProxy.hpp"
+#include "utils/StringUtils.hpp"
+#include <sys/socket.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <sstream>
+
+namespace wsv
+{
+
+std::map<std::string, HttpProxy::Resolved> HttpProxy::_resolved;
+
+// The strings and hints must outlive the asynchronous lookup
+struct HttpProxy::Lookup
+{
+    std::string     host;
+    std::string     service;
+    struct addrinfo hints;
+    struct gaicb    request;
+};
+
+// ========================================
+// Response Parser
+// ========================================
+
+HttpProxy::ResponseParser::ResponseParser()
+{
+    reset(false);
+}
+
+void HttpProxy::ResponseParser::reset(bool head_request)
+{
+    _state = STATE_HEAD;
+    _head_request = head_request;
+    _buffer.clear();
+    _status = 0;
+    _reason.clear();
+    _headers.clear();
+    _framing = FRAMING_NONE;
+    _content_length = 0;
+    _remaining = 0;
+    _keep_alive = true;
+}
+
+bool HttpProxy::ResponseParser::feed(const char* data, size_t len, std::string& body)
+{
+    if (_state == STATE_ERROR)
+        return false;
+    _buffer.append(data, len);
+
+    bool progress = true;
+    while (progress && _state != STATE_COMPLETE && _state != STATE_ERROR)
+    {
+        switch (_state)
+        {
+            case STATE_HEAD:
+                progress = _parseHead();
+                break;
+            case STATE_BODY:
+                _takeBody(body);
+                if (_framing == FRAMING_LENGTH && _remaining == 0)
+                    _state = STATE_COMPLETE;
+                progress = false;
+                break;
+            case STATE_CHUNK_DATA:
+                _takeBody(body);
+                progress = (_remaining == 0);
+                if (progress)
+                    _state = STATE_CHUNK_CRLF;
+                break;
+            case STATE_CHUNK_CRLF:
+                if (_buffer.size() < 2)
+                    progress = false;
+                else if (_buffer.compare(0, 2, "\r\n") != 0)
+                    _state = STATE_ERROR;
+                else
+                {
+                    _buffer.erase(0, 2);
+                    _state = STATE_CHUNK_SIZE;
+                }
+                break;
+            case STATE_CHUNK_SIZE:
+                progress = _parseChunkSize();
+                break;
+            case STATE_TRAILERS:
+                progress = _parseTrailers();
+                break;
+            default:
+                progress = false;
+                break;
+        }
+    }
+    return _state != STATE_ERROR;
+}
+
+void HttpProxy::ResponseParser::feedEof()
+{
+    if (_state == STATE_BODY && _framing == FRAMING_CLOSE)
+        _state = STATE_COMPLETE;
+    else if (_state != STATE_COMPLETE)
+        _state = STATE_ERROR;
+}
+
+bool HttpProxy::ResponseParser::_parseHead()
+{
+    size_t end = _buffer.find("\r\n\r\n");
+    if (end == std::string::npos)
+    {
+        if (_buffer.size() > MAX_HEAD_SIZE)
+            _state = STATE_ERROR;
+        return false;
+    }
+
+    std::vector<std::string> lines = StringUtils::split(_buffer.substr(0, end), "\r\n");
+    _buffer.erase(0, end + 4);
+
+    // Status line: HTTP/1.x SP code SP reason
+    if (lines.empty() || !StringUtils::startsWith(lines[0], "HTTP/1."))
+    {
+        _state = STATE_ERROR;
+        return false;
+    }
+    const std::string& status_line = lines[0];
+    size_t sp = status_line.find(' ');
+    if (sp == std::string::npos || status_line.size() < sp + 4)
+    {
+        _state = STATE_ERROR;
+        return false;
+    }
+    std::string code = status_line.substr(sp + 1, 3);
+    if (code.find_first_not_of("0123456789") != std::string::npos)
+    {
+        _state = STATE_ERROR;
+        return false;
+    }
+    _status = std::atoi(code.c_str());
+    _reason = (status_line.size() > sp + 5) ? status_line.substr(sp + 5) : "";
+    _keep_alive = (status_line.compare(0, 8, "HTTP/1.1") == 0);
+
+    _headers.clear();
+    bool chunked = false;
+    bool has_length = false;
+    for (size_t i = 1; i < lines.size(); ++i)
+    {
+        size_t colon = lines[i].find(':');
+        if (colon == std::string::npos || colon == 0)
+            continue;
+        std::string name = StringUtils::trim(lines[i].substr(0, colon));
+        std::string value = StringUtils::trim(lines[i].substr(colon + 1));
+        std::string lower = StringUtils::toLower(name);
+
+        if (lower == "transfer-encoding")
+            chunked = StringUtils::toLower(value).find("chunked") != std::string::npos;
+        else if (lower == "content-length")
+        {
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+            {
+                _state = STATE_ERROR;
+                return false;
+            }
+            has_length = true;
+            _content_length = std::strtoul(value.c_str(), NULL, 10);
+        }
+        else if (lower == "connection")
+        {
+            std::string tokens = StringUtils::toLower(value);
+            if (tokens.find("close") != std::string::npos)
+                _keep_alive = false;
+            else if (tokens.find("keep-alive") != std::string::npos)
+                _keep_alive = true;
+        }
+        _headers.push_back(std::make_pair(name, value));
+    }
+
+    // Interim response (100 Continue, 103 Early Hints): skip, the real one follows
+    if (_status >= 100 && _status < 200)
+    {
+        _headers.clear();
+        _content_length = 0;
+        return !_buffer.empty();
+    }
+
+    if (_head_request || _status == 204 || _status == 304)
+    {
+        _framing = FRAMING_NONE;
+        _state = STATE_COMPLETE;
+    }
+    else if (chunked)
+    {
+        _framing = FRAMING_CHUNKED;
+        _state = STATE_CHUNK_SIZE;
+    }
+    else if (has_length)
+    {
+        _framing = FRAMING_LENGTH;
+        _remaining = _content_length;
+        _state = (_remaining == 0) ? STATE_COMPLETE : STATE_BODY;
+    }
+    else
+    {
+        _framing = FRAMING_CLOSE;
+        _state = STATE_BODY;
+    }
+    return true;
+}
+
+bool HttpProxy::ResponseParser::_parseChunkSize()
+{
+    size_t end = _buffer.find("\r\n");
+    if (end == std::string::npos)
+    {
+        if (_buffer.size() > HttpRequest::MAX_CHUNK_SIZE_LINE)
+            _state = STATE_ERROR;
+        return false;
+    }
+
+    // Chunk extensions after ';' are ignored
+    std::string line = _buffer.substr(0, end);
+    line = StringUtils::trim(line.substr(0, line.find(';')));
+    _buffer.erase(0, end + 2);
+
+    if (line.empty() || line.size() > 16 || line.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+    {
+        _state = STATE_ERROR;
+        return false;
+    }
+    _remaining = std::strtoul(line.c_str(), NULL, 16);
+    _state = (_remaining == 0) ? STATE_TRAILERS : STATE_CHUNK_DATA;
+    return true;
+}
+
+// Trailer fields are dropped; the message ends at the empty line
+bool HttpProxy::ResponseParser::_parseTrailers()
+{
+    size_t end = _buffer.find("\r\n");
+    if (end == std::string::npos)
+    {
+        if (_buffer.size() > MAX_HEAD_SIZE)
+            _state = STATE_ERROR;
+        return false;
+    }
+    _buffer.erase(0, end + 2);
+    if (end == 0)
+        _state = STATE_COMPLETE;
+    return true;
+}
+
+void HttpProxy::ResponseParser::_takeBody(std::string& body)
+{
+    if (_framing == FRAMING_CLOSE)
+    {
+        body.append(_buffer);
+        _buffer.clear();
+        return;
+    }
+    size_t take = (_buffer.size() < _remaining) ? _buffer.size() : _remaining;
+    body.append(_buffer, 0, take);
+    _buffer.erase(0, take);
+    _remaining -= take;
+}
+
+// ========================================
+// Request Side
+// ========================================
+
+bool HttpProxy::isHopByHop(const std::string& lower_name)
+{
+    return lower_name == "connection" || lower_name == "keep-alive" ||
+           lower_name == "proxy-connection" || lower_name == "transfer-encoding" ||
+           lower_name == "te" || lower_name == "trailer" || lower_name == "upgrade" ||
+           lower_name == "proxy-authorization" || lower_name == "proxy-authenticate";
+}
+
+std::string HttpProxy::encodeRequest(const HttpRequest& request,
+                                     const std::string& upstream_path,
+                                     const std::string& client_ip,
+                                     const std::string& scheme)
+{
+    std::string out = request.getMethod() + " " + upstream_path + " HTTP/1.1\r\n";
+
+    // Headers listed in Connection are hop-by-hop too
+    std::string connection_tokens = ",";
+    std::vector<std::string> tokens = StringUtils::split(StringUtils::toLower(request.getHeader(HEADER_CONNECTION)), ", \t");
+    for (size_t i = 0; i < tokens.size(); ++i)
+        connection_tokens += tokens[i] + ",";
+
+    // Arrival order, repeated fields included
+    for (size_t i = 0; i < request.getHeaderCount(); ++i)
+    {
+        const std::string name = request.getHeaderName(i);  // Lowercase
+        if (isHopByHop(name) || name == "content-length" || name == "expect" || name == "x-forwarded-for")
+            continue;
+        if (connection_tokens.find("," + name + ",") != std::string::npos)
+            continue;
+        out += name + ": " + request.getHeaderValue(i) + "\r\n";
+    }
+
+    std::string forwarded = request.getHeader(HEADER_X_FORWARDED_FOR);
+    out += "x-forwarded-for: " + (forwarded.empty() ? client_ip : forwarded + ", " + client_ip) + "\r\n";
+    out += "x-forwarded-proto: " + scheme + "\r\n";
+    out += "connection: keep-alive\r\n";
+
+    // The body arrives de-chunked from the request parser: always sent with a length
+    const std::string& body = request.getBody();
+    if (!body.empty() || request.getMethodId() == METHOD_POST)
+    {
+        std::ostringstream length;
+        length << body.size();
+        out += "content-length: " + length.str() + "\r\n";
+    }
+    out += "\r\n";
+    out += body;
+    return out;
+}
+
+std::string HttpProxy::buildClientHead(const ResponseParser& parser, bool chunked, bool keep_alive)
+{
+    std::ostringstream head;
+    head << "HTTP/1.1 " << parser.getStatus() << " " << parser.getReason() << "\r\n";
+
+    const HeaderList& headers = parser.getHeaders();
+    for (size_t i = 0; i < headers.size(); ++i)
+    {
+        std::string lower = StringUtils::toLower(headers[i].first);
+        if (isHopByHop(lower))
+            continue;
+        // The length only survives when the body is relayed unchanged
+        if (lower == "content-length" && parser.getFraming() != ResponseParser::FRAMING_LENGTH
+            && parser.getFraming() != ResponseParser::FRAMING_NONE)
+            continue;
+        head << headers[i].first << ": " << headers[i].second << "\r\n";
+    }
+
+    if (chunked)
+        head << "Transfer-Encoding: chunked\r\n";
+    head << "Connection: " << (keep_alive ? "keep-alive" : "close") << "\r\n\r\n";
+    return head.str();
+}
+
+int HttpProxy::connectTcp(const std::string& host, int port)
+{
+    const struct sockaddr_in* address = _address(host, port);
+    if (!address)
+        return -1;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1 || fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+
+    if (connect(fd, reinterpret_cast<const struct sockaddr*>(address), sizeof(*address)) < 0
+        && errno != EINPROGRESS)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// ========================================
+// Resolver Cache
+// ========================================
+
+bool HttpProxy::resolve(const std::string& host, int port)
+{
+    std::string service = StringUtils::toString(port);
+    Resolved& entry = _resolved[host + ":" + service];
+
+    struct addrinfo hints;
+    struct addrinfo* result = NULL;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &result) != 0 || !result)
+    {
+        entry.expires = std::time(NULL) + RESOLVE_RETRY;
+        return false;
+    }
+    std::memcpy(&entry.addr, result->ai_addr, sizeof(entry.addr));
+    freeaddrinfo(result);
+    entry.valid = true;
+    entry.expires = std::time(NULL) + RESOLVE_TTL;
+    return true;
+}
+
+// Cached address, NULL if the name has not resolved yet; never blocks
+const struct sockaddr_in* HttpProxy::_address(const std::string& host, int port)
+{
+    std::string service = StringUtils::toString(port);
+    Resolved& entry = _resolved[host + ":" + service];
+    std::time_t now = std::time(NULL);
+
+    // A finished refresh replaces the address; a failed one keeps the old address
+    if (entry.lookup && gai_error(&entry.lookup->request) != EAI_INPROGRESS)
+    {
+        struct addrinfo* result = entry.lookup->request.ar_result;
+        if (gai_error(&entry.lookup->request) == 0 && result)
+        {
+            std::memcpy(&entry.addr, result->ai_addr, sizeof(entry.addr));
+            entry.valid = true;
+            entry.expires = now + RESOLVE_TTL;
+        }
+        else
+            entry.expires = now + RESOLVE_RETRY;
+        if (result)
+            freeaddrinfo(result);
+        delete entry.lookup;
+        entry.lookup = NULL;
+    }
+
+    if (!entry.lookup && now >= entry.expires)
+        _startLookup(entry, host, service, now);
+
+    return entry.valid ? &entry.addr : NULL;
+}
+
+// Start a getaddrinfo_a lookup; its result is picked up by the next _address()
+void HttpProxy::_startLookup(Resolved& entry, const std::string& host, const std::string& service,
+                             std::time_t now)
+{
+    Lookup* lookup = new Lookup;
+    lookup->host = host;
+    lookup->service = service;
+    std::memset(&lookup->hints, 0, sizeof(lookup->hints));
+    lookup->hints.ai_family = AF_INET;
+    lookup->hints.ai_socktype = SOCK_STREAM;
+    std::memset(&lookup->request, 0, sizeof(lookup->request));
+    lookup->request.ar_name = lookup->host.c_str();
+    lookup->request.ar_service = lookup->service.c_str();
+    lookup->request.ar_request = &lookup->hints;
+
+    struct gaicb* requests[1] = { &lookup->request };
+    struct sigevent notify;
+    std::memset(&notify, 0, sizeof(notify));
+    notify.sigev_notify = SIGEV_NONE;   // Polled with gai_error()
+    if (getaddrinfo_a(GAI_NOWAIT, requests, 1, &notify) != 0)
+    {
+        delete lookup;
+        entry.expires = now + RESOLVE_RETRY;
+        return;
+    }
+    entry.lookup = lookup;
+}
+
+} // namespace wsv
@@ -0,0 +1,180 @@
+#ifndef HTTPPROXY_HPP
+#define HTTPPROXY_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+#include <netinet/in.h>
+#include "http/HttpRequest.hpp"
+
+namespace wsv
+{
+
+/**
+ * HttpProxy - HTTP/1.1 client side of the `proxy_pass` reverse proxy
+ *
+ * Features:
+ * - Encodes the client request for the upstream (hop-by-hop headers dropped,
+ *   X-Forwarded-For / X-Forwarded-Proto added, keep-alive requested)
+ * - Decodes the upstream response progressively: head, then a body framed by
+ *   Content-Length, chunked encoding or connection close
+ * - Rebuilds the head sent to the client with the framing chosen by the server
+ *
+ * The Server drives the connection in its epoll loop; idle upstream
+ * connections are kept in its UpstreamPool.
+ */
+class HttpProxy
+{
+public:
+    // ===== Type Definitions =====
+    typedef std::vector<std::pair<std::string, std::string> > HeaderList;  // Order and duplicates kept
+
+    // ===== Constants =====
+    static const size_t MAX_HEAD_SIZE = 16384;      // Status line + headers from the upstream
+
+    /**
+     * Progressive decoder for one upstream response
+     *
+     * Usage:
+     *   parser.reset(is_head_request);
+     *   parser.feed(buffer, n, body);     // decoded body bytes appended
+     *   if (parser.hasHead()) -> status, headers, framing are known
+     *   if (parser.isComplete()) -> response finished
+     *   on EOF: parser.feedEof();         // ends close-delimited bodies
+     */
+    class ResponseParser
+    {
+    public:
+        enum Framing
+        {
+            FRAMING_NONE,       // No body (HEAD, 1xx, 204, 304)
+            FRAMING_LENGTH,     // Content-Length
+            FRAMING_CHUNKED,    // Transfer-Encoding: chunked
+            FRAMING_CLOSE       // Body ends when the upstream closes
+        };
+
+        ResponseParser();
+
+        void reset(bool head_request);
+
+        /**
+         * Consume bytes read from the upstream connection
+         * @param body Decoded body bytes are appended here
+         * @return false on a protocol error
+         */
+        bool feed(const char* data, size_t len, std::string& body);
+
+        // Upstream closed the connection: completes a close-delimited body
+        void feedEof();
+
+        bool hasHead() const { return _state > STATE_HEAD; }
+        bool isComplete() const { return _state == STATE_COMPLETE; }
+        bool hasError() const { return _state == STATE_ERROR; }
+
+        int getStatus() const { return _status; }
+        const std::string& getReason() const { return _reason; }
+        const HeaderList& getHeaders() const { return _headers; }
+        Framing getFraming() const { return _framing; }
+        size_t getContentLength() const { return _content_length; }
+
+        // The connection may carry another request once the response is complete
+        bool isReusable() const { return _keep_alive && _framing != FRAMING_CLOSE && _buffer.empty(); }
+
+    private:
+        enum State
+        {
+            STATE_HEAD,
+            STATE_BODY,
+            STATE_CHUNK_SIZE,
+            STATE_CHUNK_DATA,
+            STATE_CHUNK_CRLF,
+            STATE_TRAILERS,
+            STATE_COMPLETE,
+            STATE_ERROR
+        };
+
+        State       _state;
+        bool        _head_request;
+        std::string _buffer;        // Unconsumed bytes
+        int         _status;
+        std::string _reason;
+        HeaderList  _headers;
+        Framing     _framing;
+        size_t      _content_length;
+        size_t      _remaining;     // Body or chunk bytes still expected
+        bool        _keep_alive;
+
+        bool _parseHead();
+        bool _parseChunkSize();
+        bool _parseTrailers();
+        void _takeBody(std::string& body);
+    };
+
+    /**
+     * Encode the client request for the upstream
+     * @param request Parsed client request
+     * @param upstream_path Path (and query) to request from the upstream
+     * @param client_ip Address appended to X-Forwarded-For
+     * @param scheme Scheme the client used ("http" or "https"), sent as X-Forwarded-Proto
+     * @return Request bytes, body included
+     */
+    static std::string encodeRequest(const HttpRequest& request,
+                                     const std::string& upstream_path,
+                                     const std::string& client_ip,
+                                     const std::string& scheme);
+
+    /**
+     * Build the response head sent to the client
+     * @param chunked Re-encode the body with chunked transfer encoding
+     * @param keep_alive Value of the Connection header
+     */
+    static std::string buildClientHead(const ResponseParser& parser, bool chunked, bool keep_alive);
+
+    /**
+     * Open a non-blocking TCP connection to the upstream
+     * The address comes from the resolver cache and never blocks: an entry
+     * older than RESOLVE_TTL is refreshed in the background (getaddrinfo_a)
+     * while the previous address stays in use.
+     * @return Connecting fd (completion reported by EPOLLOUT), -1 on failure
+     *         or while a name has never resolved
+     */
+    static int connectTcp(const std::string& host, int port);
+
+    /**
+     * Resolve host:port into the cache, blocking
+     * Done at startup for every upstream, so the event loop never waits on DNS
+     * @return false if the name does not resolve (retried in the background)
+     */
+    static bool resolve(const std::string& host, int port);
+
+    static const int RESOLVE_TTL = 60;      // Seconds an address is used before a refresh
+    static const int RESOLVE_RETRY = 5;     // Seconds before a failed lookup is retried
+
+    // Hop-by-hop headers are never forwarded (RFC 9110 7.6.1)
+    static bool isHopByHop(const std::string& lower_name);
+
+private:
+    struct Lookup;      // getaddrinfo_a request in progress
+
+    // Cached address of one host:port
+    struct Resolved
+    {
+        struct sockaddr_in  addr;
+        bool                valid;      // addr holds a result, possibly stale
+        std::time_t         expires;    // Refreshed from then on
+        Lookup*             lookup;     // Background refresh, NULL if none
+
+        Resolved() : valid(false), expires(0), lookup(NULL) {}
+    };
+
+    static std::map<std::string, Resolved> _resolved;
+
+    static const struct sockaddr_in* _address(const std::string& host, int port);
+    static void _startLookup(Resolved& entry, const std::string& host, const std::string& service,
+                             std::time_t now);
+};
+
+} // namespace wsv
+
+#endif
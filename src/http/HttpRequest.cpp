@@ -1,33 +1,105 @@
 #include "HttpRequest.hpp"
+#include <algorithm>
 #include <cctype>
-#include <cstdlib>
-#include <sstream>
-#include <iostream>
+#include <cstring>
+#include <stdexcept>
 
 namespace wsv
 {
 
+static bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// Lines taken from one scan of the header block
+static const size_t HEADER_LINES_PER_SCAN = 32;
+
+static char lowerChar(char c)
+{
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+
+// ===== Well-known Headers =====
+
+// Same order as HeaderId
+static const char* const KNOWN_HEADERS[HEADER_COUNT] = {
+    "host", "content-length", "content-type", "transfer-encoding", "connection",
+    "upgrade", "http2-settings", "expect", "cookie", "x-forwarded-for",
+    "accept", "accept-encoding", "accept-language", "user-agent", "referer",
+    "authorization", "if-none-match", "if-modified-since", "range", "origin",
+    "keep-alive", "te"
+};
+
+// Perfect hash over KNOWN_HEADERS: length, first and last byte (lowercase)
+// give every name its own slot. Adding a name may need a new multiplier;
+// the unit tests check that all names still map to themselves.
+static const size_t HEADER_SLOTS = 64;
+
+static size_t headerHash(const char* name, size_t len)
+{
+    return (len + static_cast<unsigned char>(lowerChar(name[0]))
+            + 26 * static_cast<unsigned char>(lowerChar(name[len - 1]))) & (HEADER_SLOTS - 1);
+}
+
+// Slot -> HeaderId, HEADER_OTHER for unused slots
+struct HeaderSlots
+{
+    HeaderId ids[HEADER_SLOTS];
+
+    HeaderSlots()
+    {
+        std::fill(ids, ids + HEADER_SLOTS, HEADER_OTHER);
+        for (int id = 0; id < HEADER_COUNT; ++id)
+        {
+            const char* name = KNOWN_HEADERS[id];
+            ids[headerHash(name, std::strlen(name))] = static_cast<HeaderId>(id);
+        }
+    }
+};
+
+static const HeaderSlots& headerTable()
+{
+    static const HeaderSlots table;
+    return table;
+}
+
 // Constructors & Destructor
 HttpRequest::HttpRequest()
     : _state(PARSING_REQUEST_LINE)
+    , _method_id(METHOD_UNKNOWN)
+    , _version_id(HTTP_VERSION_UNKNOWN)
     , _content_length(0)
     , _body_received(0)
     , _total_headers_size(0)
+    , _chunked(false)
+    , _pos(0)
+    , _head_end(0)
     , _chunk_size(0)
     , _chunk_finished(true)
-{ }
+{
+    std::fill(_known, _known + HEADER_COUNT, -1);
+}
 
-HttpRequest::HttpRequest(const std::string& raw_request) 
+HttpRequest::HttpRequest(const std::string& raw_request)
     : _state(PARSING_REQUEST_LINE)
+    , _method_id(METHOD_UNKNOWN)
+    , _version_id(HTTP_VERSION_UNKNOWN)
     , _content_length(0)
     , _body_received(0)
     , _total_headers_size(0)
+    , _chunked(false)
+    , _pos(0)
+    , _head_end(0)
     , _chunk_size(0)
     , _chunk_finished(true)
 {
+    std::fill(_known, _known + HEADER_COUNT, -1);
+
     // Parse entire request at once
     ParseState result = parse(raw_request.c_str(), raw_request.length());
-    
+
     // Throw exception if parsing incomplete or failed
     if (result != PARSE_COMPLETE)
         throw std::runtime_error("Incomplete or malformed HTTP request");
@@ -43,26 +115,50 @@ void HttpRequest::reset()
 {
     _total_headers_size = 0;
     _state = PARSING_REQUEST_LINE;
-    _method.clear();
-    _path.clear();
-    _query.clear();
-    _version.clear();
-    _headers.clear();
+    _method = Slice();
+    _path = Slice();
+    _query = Slice();
+    _version = Slice();
+    _method_id = METHOD_UNKNOWN;
+    _version_id = HTTP_VERSION_UNKNOWN;
+    _fields.clear();
+    std::fill(_known, _known + HEADER_COUNT, -1);
     _body.clear();
-    _buffer.clear();
+    _buffer.release();
+    _pos = 0;
+    _line_scan.reset(0);
+    _head_end = 0;
     _content_length = 0;
     _body_received = 0;
+    _chunked = false;
     _chunk_size = 0;
     _chunk_finished = true;
 }
 
 ParseState HttpRequest::parse(const char* data, size_t len)
 {
+    // Content-Length body with nothing buffered in front: straight into the body
+    if (_state == PARSING_BODY && !_chunked && _pos == _buffer.size())
+    {
+        size_t bytes_needed = _content_length - _body_received;
+        size_t bytes_to_read = (len < bytes_needed) ? len : bytes_needed;
+        _body.append(data, bytes_to_read);
+        _body_received += bytes_to_read;
+        if (_body_received >= _content_length)
+            _state = PARSE_COMPLETE;
+        data += bytes_to_read;
+        len -= bytes_to_read;
+    }
+
     // Append new data to buffer
     _buffer.append(data, len);
+    return parseBuffered();
+}
 
+ParseState HttpRequest::parseBuffered()
+{
     // Process buffer based on current state
-    while (!_buffer.empty())
+    while (_pos < _buffer.size())
     {
         if (_state == PARSING_REQUEST_LINE)
         {
@@ -86,21 +182,29 @@ ParseState HttpRequest::parse(const char* data, size_t len)
         }
     }
 
+    // Body bytes already moved to _body are dropped once per call: one move of
+    // the unparsed tail instead of one per line. The head stays for the slices.
+    if (_head_end != 0 && _pos > _head_end)
+    {
+        _buffer.erase(_head_end, _pos - _head_end);
+        _pos = _head_end;
+        _line_scan.reset(_pos);
+    }
+
     return _state;
 }
 
-
 // ===== Request Line Parsing =====
 
 bool HttpRequest::_tryParseRequestLine()
 {
     // Look for line ending
-    size_t line_end = _buffer.find("\r\n");
-    
-    if (line_end == std::string::npos)
+    ByteScan::Line line;
+
+    if (ByteScan::scanLines(_buffer.data(), _buffer.size(), _line_scan, &line, 1) == 0)
     {
         // Check if buffer exceeds maximum allowed size
-        if (_buffer.size() > MAX_REQUEST_LINE_SIZE)
+        if (_buffer.size() - _pos > MAX_REQUEST_LINE_SIZE)
         {
             _state = PARSE_ERROR;
         }
@@ -108,48 +212,62 @@ bool HttpRequest::_tryParseRequestLine()
     }
 
     // Check if request line exceeds limit
-    if (line_end > MAX_REQUEST_LINE_SIZE)
+    if (line.end - line.start > MAX_REQUEST_LINE_SIZE)
     {
         _state = PARSE_ERROR;
         return false;
     }
 
-    // Extract and parse request line
-    std::string request_line = _buffer.substr(0, line_end);
-    _buffer.erase(0, line_end + 2);  // Remove line and \r\n
-    
-    _parseRequestLine(request_line);
-    
+    _pos = line.next;  // Skip line and \r\n
+
+    _parseRequestLine(line.start, line.end);
+
     if (_state != PARSE_ERROR)
         _state = PARSING_HEADERS;
-    
+
     return true;
 }
 
 // Parse request line: "GET /path HTTP/1.1"
-void HttpRequest::_parseRequestLine(const std::string& line)
+void HttpRequest::_parseRequestLine(size_t start, size_t end)
 {
-    std::istringstream stream(line);
-    std::string method, url, version;
+    const char* line = _buffer.data();
+    Slice parts[3];
+    size_t i = start;
 
     // Parse: METHOD URL VERSION
-    if (!(stream >> method >> url >> version))
+    for (int n = 0; n < 3; ++n)
     {
-        _state = PARSE_ERROR;
-        return;
+        while (i < end && isBlank(line[i]))
+            ++i;
+        size_t token = i;
+        while (i < end && !isBlank(line[i]))
+            ++i;
+        if (i == token)
+        {
+            _state = PARSE_ERROR;
+            return;
+        }
+        parts[n] = Slice(token, i - token);
     }
+    while (i < end && isBlank(line[i]))
+        ++i;
 
-    // Validate method and version
-    if (!_validateMethod(method) || !_validateVersion(version))
+    // Validate method and version, nothing may follow the version
+    HttpMethod method = _parseMethod(parts[0]);
+    HttpVersion version = _parseVersion(parts[2]);
+    if (i != end || method == METHOD_UNKNOWN || version == HTTP_VERSION_UNKNOWN)
     {
         _state = PARSE_ERROR;
         return;
     }
 
     // Store parsed values
-    _method = method;
-    _version = version;
-    _parseUrl(url);
+    _method_id = method;
+    _version_id = version;
+    _method = parts[0];
+    _version = parts[2];
+    _parseUrl(parts[1]);
 }
 
 
@@ -157,19 +275,21 @@ void HttpRequest::_parseRequestLine(const std::string& line)
 
 // Split URL into path and query string
 // Example: "/api/users?id=123" -> path="/api/users", query="id=123"
-void HttpRequest::_parseUrl(const std::string& url)
+void HttpRequest::_parseUrl(const Slice& url)
 {
-    size_t query_start = url.find('?');
-    
-    if (query_start != std::string::npos)
+    const char* begin = _buffer.data() + url.offset;
+    const char* query_start = static_cast<const char*>(std::memchr(begin, '?', url.length));
+
+    if (query_start)
     {
-        _path = url.substr(0, query_start);
-        _query = url.substr(query_start + 1);
+        size_t path_length = query_start - begin;
+        _path = Slice(url.offset, path_length);
+        _query = Slice(url.offset + path_length + 1, url.length - path_length - 1);
     }
     else
     {
         _path = url;
-        _query.clear();
+        _query = Slice();
     }
 }
 
@@ -178,86 +298,112 @@ void HttpRequest::_parseUrl(const std::string& url)
 
 bool HttpRequest::_tryParseHeaders()
 {
+    ByteScan::Line lines[HEADER_LINES_PER_SCAN];
+
     while (true)
     {
-        // Look for line ending
-        size_t line_end = _buffer.find("\r\n");
-        
-        if (line_end == std::string::npos)
+        // Line ends and colons of the buffered header lines, in one pass
+        size_t count = ByteScan::scanLines(_buffer.data(), _buffer.size(), _line_scan,
+                                           lines, HEADER_LINES_PER_SCAN);
+
+        if (count == 0)
         {
             // Check if buffer exceeds maximum size
-            if (_buffer.size() > MAX_HEADER_SIZE)
+            if (_buffer.size() - _pos > MAX_HEADER_SIZE)
             {
                 _state = PARSE_ERROR;
             }
             return false;  // Need more data
         }
 
-        size_t line_size = line_end + 2;  // Include \r\n
-
-        // Check if header line exceeds limit
-        // Note: This is a simple check per line. For total header size limit, 
-        // we would need to track total bytes consumed by headers.
-        if (line_end > MAX_HEADER_SIZE)
+        for (size_t i = 0; i < count; ++i)
         {
-            _state = PARSE_ERROR;
-            return false;
-        }
+            const ByteScan::Line& line = lines[i];
+            size_t line_size = line.next - line.start;  // Include \r\n
 
-        // Update total headers size
-        if (_total_headers_size + line_size > MAX_HEADER_SIZE)
-        {
-            _state = PARSE_ERROR;
-            return false;
-        }
-        _total_headers_size += line_size; 
+            // Update total headers size
+            if (_total_headers_size + line_size > MAX_HEADER_SIZE)
+            {
+                _state = PARSE_ERROR;
+                return false;
+            }
+            _total_headers_size += line_size;
+            _pos = line.next;
 
-        // Extract line
-        std::string line = _buffer.substr(0, line_end);
-        _buffer.erase(0, line_end + 2);
+            // Empty line indicates end of headers
+            if (line.end == line.start)
+            {
+                _head_end = _pos;
+                _transitionToBodyOrComplete();
+                return true;
+            }
 
-        // Empty line indicates end of headers
-        if (line.empty())
-        {
-            _transitionToBodyOrComplete();
-            return true;
+            // Parse header line
+            _parseHeaderLine(line);
+            if (_state == PARSE_ERROR)
+                return false;
         }
-
-        // Parse header line
-        _parseHeaderLine(line);
     }
 }
 
 //Parse a single header line: "Key: Value"
-void HttpRequest::_parseHeaderLine(const std::string& line)
+void HttpRequest::_parseHeaderLine(const ByteScan::Line& line)
 {
-    // Find colon separator
-    size_t colon_pos = line.find(':');
-    
-    if (colon_pos == std::string::npos)
+    if (line.colon == ByteScan::npos)
         return;  // Malformed header, skip it
 
-    // Extract and normalize key to lowercase
-    std::string key = StringUtils::toLower(StringUtils::trim(line.substr(0, colon_pos)));
-    
-    // Extract and trim value
-    std::string value = StringUtils::trim(line.substr(colon_pos + 1));
+    const char* data = _buffer.data();
+    Slice key = _trim(line.start, line.colon);
+    Slice value = _trim(line.colon + 1, line.end);
 
-    // Store header
-    _headers[key] = value;
+    // Store header, well-known ones also in their slot
+    HeaderId id = key.length ? lookupHeader(data + key.offset, key.length) : HEADER_OTHER;
+    if (id != HEADER_OTHER)
+        _known[id] = static_cast<int>(_fields.size());
+    _fields.push_back(HeaderField(key, value, id));
 
     // Handle special headers
-    if (key == "content-length")
+    if (id == HEADER_CONTENT_LENGTH)
+    {
+        // 1*DIGIT (RFC 9110 8.6): anything else could desync the framing
+        if (value.length == 0 || value.length > 18)
+        {
+            _state = PARSE_ERROR;
+            return;
+        }
+        size_t length = 0;
+        for (size_t i = value.offset; i < value.offset + value.length; ++i)
+        {
+            if (!std::isdigit(static_cast<unsigned char>(data[i])))
+            {
+                _state = PARSE_ERROR;
+                return;
+            }
+            length = length * 10 + (data[i] - '0');
+        }
+        _content_length = length;
+    }
+    else if (id == HEADER_TRANSFER_ENCODING)
     {
-        _content_length = static_cast<size_t>(std::atoi(value.c_str()));
+        _chunked = _equalsIgnoreCase(value, "chunked");
     }
 }
 
 void HttpRequest::_transitionToBodyOrComplete()
 {
     // Check if request has a body
-    if (isChunked() || _content_length > 0)
+    if (_chunked || _content_length > 0)
+    {
+        // One allocation for the whole body instead of a copy at every growth
+        if (!_chunked)
+        {
+            size_t reserve = _content_length;
+            if (reserve > MAX_BODY_RESERVE)
+                reserve = MAX_BODY_RESERVE;
+            _body.reserve(reserve);
+        }
         _state = PARSING_BODY;
+    }
     else
         // No body, request is complete
         _state = PARSE_COMPLETE;
@@ -268,7 +414,7 @@ void HttpRequest::_transitionToBodyOrComplete()
 
 bool HttpRequest::_tryParseBody()
 {
-    if (isChunked())
+    if (_chunked)
         return _parseChunkedBody();
     else
         return _parseContentLengthBody();
@@ -278,14 +424,14 @@ bool HttpRequest::_parseContentLengthBody()
 {
     // Calculate how much to read
     size_t bytes_needed = _content_length - _body_received;
-    size_t bytes_available = _buffer.size();
-    size_t bytes_to_read = (bytes_available < bytes_needed) 
-                          ? bytes_available 
+    size_t bytes_available = _buffer.size() - _pos;
+    size_t bytes_to_read = (bytes_available < bytes_needed)
+                          ? bytes_available
                           : bytes_needed;
 
     // Append to body
-    _body.append(_buffer.substr(0, bytes_to_read));
-    _buffer.erase(0, bytes_to_read);
+    _body.append(_buffer.data() + _pos, bytes_to_read);
+    _pos += bytes_to_read;
     _body_received += bytes_to_read;
 
     // Check if body is complete
@@ -307,7 +453,7 @@ bool HttpRequest::_parseChunkedBody()
         {
             if (!_tryReadChunkSize())
                 return false;  // Need more data
-            
+
             // Check for last chunk (size 0)
             if (_chunk_size == 0)
             {
@@ -325,90 +471,195 @@ bool HttpRequest::_parseChunkedBody()
 bool HttpRequest::_tryReadChunkSize()
 {
     // Look for chunk size line ending
-    size_t line_end = _buffer.find("\r\n");
-    
-    if (line_end == std::string::npos)
+    ByteScan::Line line;
+
+    if (ByteScan::scanLines(_buffer.data(), _buffer.size(), _line_scan, &line, 1) == 0)
+    {
+        if (_buffer.size() - _pos > MAX_CHUNK_SIZE_LINE)
+            _state = PARSE_ERROR;
         return false;  // Need more data
+    }
 
-    // Extract and parse chunk size
-    std::string size_line = _buffer.substr(0, line_end);
-    _buffer.erase(0, line_end + 2);
+    // Parse chunk size
+    _pos = line.next;
+
+    _chunk_size = _parseChunkSize(line.start, line.end);
 
-    _chunk_size = _parseChunkSize(size_line);
-    
     if (_state == PARSE_ERROR)
         return false;
 
     _chunk_finished = false;
-    
+
     return true;
 }
 
 bool HttpRequest::_tryReadChunkData()
 {
-    // Check if we have enough data for chunk + trailing \r\n
-    if (_buffer.size() < _chunk_size + 2)
+    // Chunk data goes to the body as it arrives, the chunk is never buffered whole
+    size_t bytes_available = _buffer.size() - _pos;
+    size_t bytes_to_read = (bytes_available < _chunk_size) ? bytes_available : _chunk_size;
+    _body.append(_buffer.data() + _pos, bytes_to_read);
+    _pos += bytes_to_read;
+    _chunk_size -= bytes_to_read;
+    _body_received += bytes_to_read;
+
+    // Trailing \r\n of the chunk; a bare \n is accepted, as on every other line
+    if (_chunk_size > 0 || _buffer.size() == _pos)
         return false;  // Need more data
+    const char* end = _buffer.data() + _pos;
+    size_t terminator = 1;
+    if (end[0] == '\r')
+    {
+        if (_buffer.size() - _pos < 2)
+            return false;  // Need more data
+        terminator = 2;
+    }
+    if (end[terminator - 1] != '\n')
+    {
+        _state = PARSE_ERROR;
+        return false;
+    }
+    _pos += terminator;
+    _line_scan.reset(_pos);
 
-    // Append chunk data to body
-    _body.append(_buffer.substr(0, _chunk_size));
-    
-    // Remove chunk data and trailing \r\n
-    _buffer.erase(0, _chunk_size + 2);
-    
     // Mark chunk as finished
     _chunk_finished = true;
-    
+
     return true;
 }
 
-size_t HttpRequest::_parseChunkSize(const std::string& line)
+size_t HttpRequest::_parseChunkSize(size_t start, size_t end)
 {
     // Chunk size is in hexadecimal
     // May be followed by chunk extensions after ';'
     // Example: "1a3" or "1a3;name=value"
-    
-    if (line.empty())
-    {
-        _state = PARSE_ERROR;
-        return 0;
-    }
 
     // RFC 7230: chunk-size = 1*HEXDIG
     // Must start with a hex digit
-    if (!std::isxdigit(static_cast<unsigned char>(line[0])))
+    const char* line = _buffer.data();
+    if (start == end || !std::isxdigit(static_cast<unsigned char>(line[start])))
     {
         _state = PARSE_ERROR;
         return 0;
     }
 
     size_t size = 0;
-    std::istringstream stream(line);
-    
-    // Parse hex number
-    if (!(stream >> std::hex >> size))
+    for (size_t i = start; i < end && std::isxdigit(static_cast<unsigned char>(line[i])); ++i)
     {
-        _state = PARSE_ERROR;
-        return 0;
+        // Larger than any body we could hold
+        if (size > (static_cast<size_t>(-1) >> 4))
+        {
+            _state = PARSE_ERROR;
+            return 0;
+        }
+        char c = lowerChar(line[i]);
+        size = (size << 4) | static_cast<size_t>(c <= '9' ? c - '0' : c - 'a' + 10);
     }
-    
+
     return size;
 }
 
 
 // ===== Validation Methods =====
 
-bool HttpRequest::_validateMethod(const std::string& method) const
+HttpMethod HttpRequest::_parseMethod(const Slice& method) const
+{
+    if (_equals(method, "GET"))
+        return METHOD_GET;
+    if (_equals(method, "POST"))
+        return METHOD_POST;
+    if (_equals(method, "DELETE"))
+        return METHOD_DELETE;
+    if (_equals(method, "HEAD"))
+        return METHOD_HEAD;
+    return METHOD_UNKNOWN;
+}
+
+HttpVersion HttpRequest::_parseVersion(const Slice& version) const
+{
+    if (_equals(version, "HTTP/1.1"))
+        return HTTP_1_1;
+    if (_equals(version, "HTTP/1.0"))
+        return HTTP_1_0;
+    return HTTP_VERSION_UNKNOWN;
+}
+
+
+// ===== Slice Helpers =====
+
+bool HttpRequest::_equals(const Slice& slice, const char* text) const
+{
+    return slice.length == std::strlen(text) && std::memcmp(_buffer.data() + slice.offset, text, slice.length) == 0;
+}
+
+bool HttpRequest::_equalsIgnoreCase(const Slice& slice, const char* text) const
+{
+    return _equalsIgnoreCase(slice, text, std::strlen(text));
+}
+
+bool HttpRequest::_equalsIgnoreCase(const Slice& slice, const char* text, size_t len) const
+{
+    if (slice.length != len)
+        return false;
+    const char* data = _buffer.data() + slice.offset;
+    for (size_t i = 0; i < slice.length; ++i)
+    {
+        if (lowerChar(data[i]) != lowerChar(text[i]))
+            return false;
+    }
+    return true;
+}
+
+HttpRequest::Slice HttpRequest::_trim(size_t start, size_t end) const
+{
+    const char* data = _buffer.data();
+    while (start < end && std::isspace(static_cast<unsigned char>(data[start])))
+        start++;
+    while (end > start && std::isspace(static_cast<unsigned char>(data[end - 1])))
+        end--;
+    return Slice(start, end - start);
+}
+
+
+int HttpRequest::_findHeader(const char* name, size_t len) const
+{
+    HeaderId id = lookupHeader(name, len);
+    if (id != HEADER_OTHER)
+        return _known[id];
+
+    // Other names: linear scan, the last occurrence wins
+    for (size_t i = _fields.size(); i > 0; --i)
+    {
+        if (_fields[i - 1].id == HEADER_OTHER && _equalsIgnoreCase(_fields[i - 1].name, name, len))
+            return static_cast<int>(i - 1);
+    }
+    return -1;
+}
+
+
+// ===== Header Names =====
+
+HeaderId HttpRequest::lookupHeader(const char* name, size_t len)
 {
-    return method == "GET" || 
-           method == "POST" || 
-           method == "DELETE" ||
-           method == "HEAD";
+    if (len == 0)
+        return HEADER_OTHER;
+    HeaderId id = headerTable().ids[headerHash(name, len)];
+    if (id == HEADER_OTHER)
+        return HEADER_OTHER;
+
+    // Same slot is not enough: the name itself must match
+    const char* known = KNOWN_HEADERS[id];
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (known[i] == '\0' || known[i] != lowerChar(name[i]))
+            return HEADER_OTHER;
+    }
+    return known[len] == '\0' ? id : HEADER_OTHER;
 }
 
-bool HttpRequest::_validateVersion(const std::string& version) const
+const char* HttpRequest::headerName(HeaderId id)
 {
-    return version == "HTTP/1.0" || version == "HTTP/1.1";
+    return (id < HEADER_COUNT) ? KNOWN_HEADERS[id] : "";
 }
 
 
@@ -417,27 +668,63 @@ bool HttpRequest::_validateVersion(const std::string& version) const
 std::string HttpRequest::getHeader(const std::string& key) const
 {
     // Case-insensitive lookup
-    HeaderMap::const_iterator it = _headers.find(StringUtils::toLower(key));
-    
-    if (it != _headers.end())
-        return it->second;
-    
-    return "";
+    int index = _findHeader(key.data(), key.size());
+    return (index >= 0) ? _str(_fields[index].value) : "";
 }
 
 bool HttpRequest::hasHeader(const std::string& key) const
 {
-    return _headers.find(StringUtils::toLower(key)) != _headers.end();
+    return _findHeader(key.data(), key.size()) >= 0;
+}
+
+std::string HttpRequest::getHeader(HeaderId id) const
+{
+    return hasHeader(id) ? _str(_fields[_known[id]].value) : "";
 }
 
-bool HttpRequest::isChunked() const
+bool HttpRequest::headerEquals(HeaderId id, const char* value) const
 {
-    HeaderMap::const_iterator it = _headers.find("transfer-encoding");
-    
-    if (it != _headers.end())
-        return StringUtils::toLower(it->second) == "chunked";
-    
+    return hasHeader(id) && _equalsIgnoreCase(_fields[_known[id]].value, value);
+}
+
+bool HttpRequest::headerHasToken(HeaderId id, const char* token) const
+{
+    if (!hasHeader(id))
+        return false;
+    const Slice& value = _fields[_known[id]].value;
+    const char* data = _buffer.data();
+    size_t token_len = std::strlen(token);
+    size_t end = value.offset + value.length;
+
+    for (size_t pos = value.offset; pos < end; )
+    {
+        size_t comma = pos;
+        while (comma < end && data[comma] != ',')
+            ++comma;
+        if (_equalsIgnoreCase(_trim(pos, comma), token, token_len))
+            return true;
+        pos = comma + 1;
+    }
     return false;
 }
 
+std::string HttpRequest::getHeaderName(size_t index) const
+{
+    const HeaderField& field = _fields[index];
+    if (field.id != HEADER_OTHER)
+        return KNOWN_HEADERS[field.id];
+    std::string name = _str(field.name);
+    for (size_t i = 0; i < name.size(); ++i)
+        name[i] = lowerChar(name[i]);
+    return name;
+}
+
+HttpRequest::HeaderMap HttpRequest::getHeaders() const
+{
+    HeaderMap headers;
+    for (size_t i = 0; i < _fields.size(); ++i)
+        headers[getHeaderName(i)] = getHeaderValue(i);
+    return headers;
+}
+
 } // namespace wsv
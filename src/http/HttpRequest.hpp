@@ -3,8 +3,12 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include "utils/StringUtils.hpp"
+#include "utils/ByteScan.hpp"
+#include "utils/SharedBuffer.hpp"
+#include "utils/RecvBuffer.hpp"
 
 namespace wsv
 {
@@ -18,6 +22,51 @@ enum ParseState
     PARSE_ERROR             // Parse error occurred
 };
 
+enum HttpMethod
+{
+    METHOD_GET,
+    METHOD_HEAD,
+    METHOD_POST,
+    METHOD_DELETE,
+    METHOD_UNKNOWN
+};
+
+enum HttpVersion
+{
+    HTTP_1_0,
+    HTTP_1_1,
+    HTTP_VERSION_UNKNOWN
+};
+
+// Well-known request headers: each has a fixed slot in HttpRequest
+enum HeaderId
+{
+    HEADER_HOST,
+    HEADER_CONTENT_LENGTH,
+    HEADER_CONTENT_TYPE,
+    HEADER_TRANSFER_ENCODING,
+    HEADER_CONNECTION,
+    HEADER_UPGRADE,
+    HEADER_HTTP2_SETTINGS,
+    HEADER_EXPECT,
+    HEADER_COOKIE,
+    HEADER_X_FORWARDED_FOR,
+    HEADER_ACCEPT,
+    HEADER_ACCEPT_ENCODING,
+    HEADER_ACCEPT_LANGUAGE,
+    HEADER_USER_AGENT,
+    HEADER_REFERER,
+    HEADER_AUTHORIZATION,
+    HEADER_IF_NONE_MATCH,
+    HEADER_IF_MODIFIED_SINCE,
+    HEADER_RANGE,
+    HEADER_ORIGIN,
+    HEADER_KEEP_ALIVE,
+    HEADER_TE,
+    HEADER_COUNT,                   // Number of well-known headers
+    HEADER_OTHER = HEADER_COUNT     // Any other name
+};
+
 /**
  * HttpRequest - Progressive HTTP/1.1 request parser
  * 
@@ -27,6 +76,12 @@ enum ParseState
  * - Request line and header size limits
  * - Content-Length based body parsing
  * - Case-insensitive header lookups
+ * - Zero-copy head parsing: the request line and headers stay in one buffer
+ *   and are kept as offsets (slices) into it; strings are only built when a
+ *   getter is called. Line ends and colons are found by ByteScan (SIMD).
+ *   Body bytes are copied into the body once and dropped from the buffer.
+ * - Typed model: method and version enums, well-known headers in O(1) slots
+ *   (HeaderId, perfect hash on the name); lookups by id allocate nothing
  * 
  * Usage:
  *   HttpRequest request;
@@ -36,7 +91,10 @@ enum ParseState
  *       if (request.isComplete()) break;
  *       if (request.hasError()) handle_error();
  *   }
- *   std::string body = request.getBody();
+ *   const std::string& body = request.getBody();
+ *
+ * The body is a SharedBuffer: getBodyBuffer() hands it to the upload, CGI
+ * or proxy stage by reference count, its bytes are never copied again.
  */
 class HttpRequest
 {
@@ -48,30 +106,57 @@ public:
     static const size_t MAX_REQUEST_LINE_SIZE = 8192;   // 8KB max for request line
     static const size_t MAX_HEADER_SIZE = 8192;         // 8KB max for all headers
     static const size_t MAX_CHUNK_SIZE_LINE = 256;      // Max length for chunk size line
+    static const size_t MAX_BODY_RESERVE = 8 << 20;     // Content-Length body allocated up front up to 8MB
 
 private:
+    // Field of the request head as an offset into _buffer (no copy)
+    struct Slice
+    {
+        size_t offset;
+        size_t length;
+
+        Slice() : offset(0), length(0) {}
+        Slice(size_t o, size_t l) : offset(o), length(l) {}
+    };
+
+    struct HeaderField
+    {
+        Slice name;
+        Slice value;
+        HeaderId id;
+
+        HeaderField(const Slice& n, const Slice& v, HeaderId i) : name(n), value(v), id(i) {}
+    };
+
     ParseState _state;
     
     // Request line components
-    std::string _method;        // GET, POST, DELETE
-    std::string _path;          // /api/users
-    std::string _query;         // id=123&name=test
-    std::string _version;       // HTTP/1.1
+    Slice _method;              // GET, POST, DELETE
+    Slice _path;                // /api/users
+    Slice _query;               // id=123&name=test
+    Slice _version;             // HTTP/1.1
+    HttpMethod _method_id;
+    HttpVersion _version_id;
     
-    // Headers (keys are lowercase)
-    HeaderMap _headers;
+    // Headers in arrival order (lookups are case-insensitive, last one wins)
+    std::vector<HeaderField> _fields;
+    int _known[HEADER_COUNT];   // Index in _fields of the last well-known header, -1 if absent
     
     // Body
-    std::string _body;
+    SharedBuffer _body;
     size_t _content_length;
     size_t _body_received;
     size_t _total_headers_size; // Total size of headers parsed so far
+    bool _chunked;              // Transfer-Encoding: chunked
 
-    // Parsing buffer (holds incomplete data)
-    std::string _buffer;
+    // Connection buffer: the head stays for the slices, parsed body bytes are dropped
+    RecvBuffer _buffer;
+    size_t _pos;                // First byte not parsed yet
+    ByteScan::LineScan _line_scan;  // Line search over _buffer, resumes where it stopped
+    size_t _head_end;           // End of the empty line after the headers, 0 until then
     
     // Chunked encoding state
-    size_t _chunk_size;         // Current chunk size being processed
+    size_t _chunk_size;         // Bytes left in the current chunk
     bool _chunk_finished;       // Whether current chunk is fully read
 
 public:
@@ -95,17 +180,31 @@ public:
      *   if (state == PARSE_COMPLETE) { ... }
      */
     ParseState parse(const char* data, size_t len);
+
+    /**
+     * Receive in place: the server reads the socket straight into input(),
+     * then parseBuffered() parses the new bytes without copying them
+     *
+     * Example:
+     *   if (request.input().readFrom(fd) > 0)
+     *       request.parseBuffered();
+     */
+    RecvBuffer& input() { return _buffer; }
+    ParseState parseBuffered();
     
     // Reset request to initial state
     // Allows reusing the same object for multiple requests
+    // The receive slab goes back to the pool until the next request arrives
     void reset();
 
 
     // ===== Getters - Request Line =====
-    std::string getMethod() const { return _method; }
-    std::string getPath() const { return _path; }
-    std::string getQuery() const { return _query; }
-    std::string getVersion() const { return _version; }
+    std::string getMethod() const { return _str(_method); }
+    std::string getPath() const { return _str(_path); }
+    std::string getQuery() const { return _str(_query); }
+    std::string getVersion() const { return _str(_version); }
+    HttpMethod getMethodId() const { return _method_id; }
+    HttpVersion getVersionId() const { return _version_id; }
 
 
     // ===== Getters - Headers =====
@@ -117,11 +216,36 @@ public:
     bool hasHeader(const std::string& key) const;
 
     // Get all headers (keys are lowercase)
-    HeaderMap getHeaders() const { return _headers; }
+    // Copies everything: prefer the indexed accessors below
+    HeaderMap getHeaders() const;
+
+    // Well-known headers by slot, without building a key (HEADER_OTHER has no slot: false)
+    bool hasHeader(HeaderId id) const { return id < HEADER_COUNT && _known[id] >= 0; }
+    std::string getHeader(HeaderId id) const;
+
+    // Case-insensitive comparison of the whole value, no allocation
+    bool headerEquals(HeaderId id, const char* value) const;
+
+    // Case-insensitive search in a comma-separated list ("Connection: keep-alive, Upgrade")
+    bool headerHasToken(HeaderId id, const char* token) const;
+
+    // Headers in arrival order, duplicates included (names are lowercase)
+    size_t getHeaderCount() const { return _fields.size(); }
+    std::string getHeaderName(size_t index) const;
+    std::string getHeaderValue(size_t index) const { return _str(_fields[index].value); }
+    HeaderId getHeaderId(size_t index) const { return _fields[index].id; }
+
+
+    // ===== Header Names =====
+
+    // Slot of a header name (any case), HEADER_OTHER if it is not well-known
+    static HeaderId lookupHeader(const char* name, size_t len);
+    static const char* headerName(HeaderId id);    // Lowercase
 
 
     // ===== Getters - Body =====
-    std::string getBody() const { return _body; }
+    const std::string& getBody() const { return _body.str(); }
+    const SharedBuffer& getBodyBuffer() const { return _body; }    // Copy to share, not duplicate
     size_t getContentLength() const { return _content_length; }
     size_t getBodyReceived() const { return _body_received; }
 
@@ -132,7 +256,7 @@ public:
     ParseState getState() const { return _state; }
     
     // true if "Transfer-Encoding: chunked" is present
-    bool isChunked() const;
+    bool isChunked() const { return _chunked; }
 
 private:
     // ===== Parsing State Machine Methods =====
@@ -150,12 +274,13 @@ private:
 
 
     // ===== Request Line Parsing =====
-    void _parseRequestLine(const std::string& line);
-    void _parseUrl(const std::string& url);
+    // [start, end) is the line in _buffer, without its CRLF
+    void _parseRequestLine(size_t start, size_t end);
+    void _parseUrl(const Slice& url);
     
 
     // ===== Header Parsing =====
-    void _parseHeaderLine(const std::string& line);
+    void _parseHeaderLine(const ByteScan::Line& line);
 
 
     // ===== Body Parsing =====
@@ -180,7 +305,7 @@ private:
     bool _tryReadChunkSize();
     
     /**
-     * Try to read chunk data
+     * Try to read chunk data (moved to the body as it arrives)
      * @return true if chunk read, false if need more data
      */
     bool _tryReadChunkData();
@@ -188,19 +313,28 @@ private:
     /**
      * Parse chunk size from hex string
      * Example: "1a3" -> 419, "0" -> 0 (last chunk)
-     * @param line Chunk size line (may contain extensions after ';')
+     * @param start, end Chunk size line (may contain extensions after ';')
      * @return Chunk size in bytes
      */
-    size_t _parseChunkSize(const std::string& line);
+    size_t _parseChunkSize(size_t start, size_t end);
 
 
     // ===== Validation Methods =====
     
-    // true if method is GET, POST, DELETE, HEAD
-    bool _validateMethod(const std::string& method) const;
+    // METHOD_UNKNOWN unless method is GET, POST, DELETE, HEAD
+    HttpMethod _parseMethod(const Slice& method) const;
     
-    // true if version is HTTP/1.0 or HTTP/1.1
-    bool _validateVersion(const std::string& version) const;
+    // HTTP_VERSION_UNKNOWN unless version is HTTP/1.0 or HTTP/1.1
+    HttpVersion _parseVersion(const Slice& version) const;
+
+
+    // ===== Slice Helpers =====
+    std::string _str(const Slice& slice) const { return std::string(_buffer.data() + slice.offset, slice.length); }
+    bool _equals(const Slice& slice, const char* text) const;
+    bool _equalsIgnoreCase(const Slice& slice, const char* text) const;
+    bool _equalsIgnoreCase(const Slice& slice, const char* text, size_t len) const;
+    int _findHeader(const char* name, size_t len) const;
+    Slice _trim(size_t start, size_t end) const;
 
 };
 
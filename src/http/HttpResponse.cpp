@@ -1,23 +1,202 @@
 #include "HttpResponse.hpp"
 #include <sstream>
+#include <map>
 #include <ctime>
+#include <cstring>
+#include <strings.h>
 
 namespace wsv
 {
 
+// ========== Status Lines ==========
+
+struct StatusEntry
+{
+    int code;
+    const char* message;
+    const char* line;       // "HTTP/1.1 <code> <message>\r\n"
+    size_t line_length;
+};
+
+#define STATUS_ENTRY(code, message) \
+    { code, message, "HTTP/1.1 " #code " " message "\r\n", sizeof("HTTP/1.1 " #code " " message "\r\n") - 1 }
+
+static const StatusEntry STATUS_TABLE[] = {
+    // 2xx Success
+    STATUS_ENTRY(200, "OK"),
+    STATUS_ENTRY(201, "Created"),
+    STATUS_ENTRY(204, "No Content"),
+
+    // 3xx Redirection
+    STATUS_ENTRY(301, "Moved Permanently"),
+    STATUS_ENTRY(302, "Found"),
+
+    // 4xx Client Error
+    STATUS_ENTRY(400, "Bad Request"),
+    STATUS_ENTRY(403, "Forbidden"),
+    STATUS_ENTRY(404, "Not Found"),
+    STATUS_ENTRY(405, "Method Not Allowed"),
+    STATUS_ENTRY(408, "Request Timeout"),
+    STATUS_ENTRY(413, "Payload Too Large"),
+    STATUS_ENTRY(414, "URI Too Long"),
+    STATUS_ENTRY(415, "Unsupported Media Type"),
+    STATUS_ENTRY(421, "Misdirected Request"),
+    STATUS_ENTRY(425, "Too Early"),
+
+    // 5xx Server Error
+    STATUS_ENTRY(500, "Internal Server Error"),
+    STATUS_ENTRY(501, "Not Implemented"),
+    STATUS_ENTRY(502, "Bad Gateway"),
+    STATUS_ENTRY(503, "Service Unavailable"),
+    STATUS_ENTRY(504, "Gateway Timeout"),
+    STATUS_ENTRY(505, "HTTP Version Not Supported"),
+    STATUS_ENTRY(507, "Insufficient Storage")
+};
+
+#undef STATUS_ENTRY
+
+static const int STATUS_MIN = 100;
+static const int STATUS_MAX = 599;
+
+// Entry of each code from STATUS_MIN to STATUS_MAX, NULL if not in the table
+static const StatusEntry* find_status(int code)
+{
+    static const StatusEntry* index[STATUS_MAX - STATUS_MIN + 1];
+    static bool built = false;
+
+    if (!built)
+    {
+        for (size_t i = 0; i < sizeof(STATUS_TABLE) / sizeof(STATUS_TABLE[0]); ++i)
+            index[STATUS_TABLE[i].code - STATUS_MIN] = &STATUS_TABLE[i];
+        built = true;
+    }
+    if (code < STATUS_MIN || code > STATUS_MAX)
+        return NULL;
+    return index[code - STATUS_MIN];
+}
+
+// Decimal digits of value, written backwards from end; returns the first digit
+static char* format_decimal(size_t value, char* end)
+{
+    do
+    {
+        *--end = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value);
+    return end;
+}
+
+// ========== Default Headers ==========
+
+static const char SERVER_NAME[] = "Webserv/1.0";
+
+// Shared Date value and the second it was generated for
+static std::string g_date;
+static std::time_t g_date_time = -1;
+
+static bool same_name(const std::string& a, const char* b, size_t b_length)
+{
+    return a.size() == b_length && strcasecmp(a.c_str(), b) == 0;
+}
+
+static const std::string* find_header(const HttpResponse::HeaderList& headers, const std::string& key)
+{
+    for (HttpResponse::HeaderList::const_iterator it = headers.begin(); it != headers.end(); ++it)
+    {
+        if (it->first.size() == key.size() && strcasecmp(it->first.c_str(), key.c_str()) == 0)
+            return &it->second;
+    }
+    return NULL;
+}
+
+// Headers written at send time, never part of a frozen head
+static bool is_send_time_header(const std::string& key)
+{
+    return same_name(key, "Date", 4) || same_name(key, "Connection", 10);
+}
+
+// Status line of code: from the table, or built in fallback (48 bytes)
+static const char* status_line(int code, char* fallback, size_t& length)
+{
+    const char* line = HttpResponse::getStatusLine(code, length);
+    if (line)
+        return line;
+
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* start = format_decimal(code < 0 ? 0 : code, end);
+    std::memcpy(fallback, "HTTP/1.1 ", 9);
+    std::memcpy(fallback + 9, start, end - start);
+    length = 9 + (end - start);
+    std::memcpy(fallback + length, " Unknown\r\n", 10);
+    length += 10;
+    return fallback;
+}
+
+static size_t headers_size(const HttpResponse::HeaderList& headers)
+{
+    size_t size = 0;
+    for (HttpResponse::HeaderList::const_iterator it = headers.begin(); it != headers.end(); ++it)
+        size += it->first.size() + 2 + it->second.size() + 2;
+    return size;
+}
+
+// Headers: "Header-Name: header-value\r\n"
+static void append_headers(std::string& out, const HttpResponse::HeaderList& headers)
+{
+    for (HttpResponse::HeaderList::const_iterator it = headers.begin(); it != headers.end(); ++it)
+    {
+        out.append(it->first);
+        out.append(": ", 2);
+        out.append(it->second);
+        out.append("\r\n", 2);
+    }
+}
+
+// Pre-rendered part of a frozen response, shared by its copies
+struct HttpResponse::Frozen
+{
+    HeaderList  headers;    // All but Date and Connection
+    std::string body;
+    std::string head;       // Status line, Server and headers, ready to send
+    size_t      refs;
+};
+
 // HttpResponse Constructor
 // ============================================================================
-// Initializes the response with a 200 status code, HTTP/1.1 version,
-// and sets default headers (Server, Date, Connection).
+// Initializes the response with a 200 status code. Server, Date and
+// Connection are not stored: serializeTo() writes them unless set explicitly.
 HttpResponse::HttpResponse()
-    : _status_code(200),
-      _version("HTTP/1.1")
+    : _status_code(200), _frozen(NULL)
+{ }
+
+HttpResponse::HttpResponse(const HttpResponse& other)
+    : _status_code(other._status_code), _headers(other._headers), _body(other._body),
+      _frozen(other._frozen)
+{
+    if (_frozen)
+        _frozen->refs++;
+}
+
+HttpResponse& HttpResponse::operator=(const HttpResponse& other)
 {
-    this->_setDefaultHeaders();
+    if (this != &other)
+    {
+        if (other._frozen)
+            other._frozen->refs++;
+        this->_release();
+        _status_code = other._status_code;
+        _headers = other._headers;
+        _body = other._body;
+        _frozen = other._frozen;
+    }
+    return *this;
 }
 
 HttpResponse::~HttpResponse()
-{ }
+{
+    this->_release();
+}
 
 
 // Get the HTTP status code
@@ -29,39 +208,69 @@ int HttpResponse::getStatus() const
 // Get a specific header value (returns empty string if not found)
 std::string HttpResponse::getHeader(const std::string& key) const
 {
-    std::map<std::string, std::string>::const_iterator it = _headers.find(key);
-    if (it != _headers.end())
-    {
-        return it->second;
-    }
-    return "";  // Header not found
+    const std::string* value = this->_findHeader(key);
+    if (value)
+        return *value;
+    const char* fallback = this->_defaultHeader(key);
+    return fallback ? fallback : "";  // Header not found
+}
+
+// ## collectHeaders - Every header in the order serializeTo() writes them
+void HttpResponse::collectHeaders(HeaderList& out) const
+{
+    static const std::string server("Server"), date("Date"), connection("Connection");
+
+    if (this->_defaultHeader(server))
+        out.push_back(std::make_pair(server, std::string(SERVER_NAME)));
+    if (_frozen)
+        out.insert(out.end(), _frozen->headers.begin(), _frozen->headers.end());
+    out.insert(out.end(), _headers.begin(), _headers.end());
+    if (this->_defaultHeader(date))
+        out.push_back(std::make_pair(date, getDate()));
+    if (this->_defaultHeader(connection))
+        out.push_back(std::make_pair(connection, std::string("close")));
 }
 
 // Get the response body
 const std::string& HttpResponse::getBody() const
 {
-    return _body;
+    return _frozen ? _frozen->body : _body;
 }
 
 
 // setStatus - Sets the HTTP status code
 void HttpResponse::setStatus(int code)
 {
+    if (code != this->_status_code)
+        this->_thaw();
     this->_status_code = code;
 }
 
 
 // ## setHeader - Adds or updates an HTTP header
-// If the header key already exists, it will be overwritten.
+// If the header key already exists (in any case), its value is overwritten
+// and it keeps its place. A frozen response stays frozen unless the header
+// is part of its pre-rendered head.
 void HttpResponse::setHeader(const std::string& key, const std::string& value)
 {
-    this->_headers[key] = value;
+    if (_frozen && (same_name(key, "Server", 6) || find_header(_frozen->headers, key)))
+        this->_thaw();
+    for (HeaderList::iterator it = _headers.begin(); it != _headers.end(); ++it)
+    {
+        if (it->first.size() == key.size() && strcasecmp(it->first.c_str(), key.c_str()) == 0)
+        {
+            it->second = value;
+            return;
+        }
+    }
+    _headers.push_back(std::make_pair(key, value));
 }
 
 // ## setBody - Sets the response body and updates Content-Length
 // Automatically sets the Content-Length header based on the body size.
 void HttpResponse::setBody(const std::string& body)
 {
+    this->_thaw();
     this->_body = body;
     this->setContentLength(this->_body.size());
 }
@@ -70,6 +279,7 @@ void HttpResponse::setBody(const std::string& body)
 // Updates Content-Length header after appending.
 void HttpResponse::appendBody(const std::string& data)
 {
+    this->_thaw();
     this->_body += data;
     this->setContentLength(this->_body.size());
 }
@@ -84,30 +294,101 @@ void HttpResponse::setContentType(const std::string& type)
 // Converts the size_t length to string format for HTTP header.
 void HttpResponse::setContentLength(size_t length)
 {
-    std::ostringstream oss;
-    oss << length;
-    this->setHeader("Content-Length", oss.str());
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* start = format_decimal(length, end);
+    this->setHeader("Content-Length", std::string(start, end));
 }
 
-// ## _setDefaultHeaders - Initializes default HTTP response headers
-// Sets Server, Date, and Connection headers.
-// Date is formatted according to RFC 2822 HTTP date format.
-void HttpResponse::_setDefaultHeaders()
+// Header set on this response (frozen head included), or NULL
+const std::string* HttpResponse::_findHeader(const std::string& key) const
 {
-    // Set Server identification header
-    this->setHeader("Server", "Webserv/1.0");
+    const std::string* value = find_header(_headers, key);
+    if (!value && _frozen)
+        value = find_header(_frozen->headers, key);
+    return value;
+}
+
+// ## _defaultHeader - Value of a default header that was not set explicitly
+// Server, Date and "Connection: close"; NULL for any other name or when the
+// header has been set.
+const char* HttpResponse::_defaultHeader(const std::string& key) const
+{
+    const char* value;
+    if (same_name(key, "Server", 6))
+        value = SERVER_NAME;
+    else if (same_name(key, "Date", 4))
+        value = getDate().c_str();
+    else if (same_name(key, "Connection", 10))
+        value = "close";
+    else
+        return NULL;
+    return this->_findHeader(key) ? NULL : value;
+}
+
 
-    // Generate current date in HTTP format: "Day, DD Mon YYYY HH:MM:SS GMT"
-    time_t now = std::time(NULL);
-    char date_buf[100];
-    std::strftime(date_buf, sizeof(date_buf),
-             "%a, %d %b %Y %H:%M:%S GMT",
-             std::gmtime(&now));
+// ========== Frozen Responses ==========
 
-    this->setHeader("Date", date_buf);
+// ## freeze - Pre-renders the response into a block its copies share
+// Status line, Server and every header but Date and Connection are
+// serialized once; copying the response then only takes a reference.
+void HttpResponse::freeze()
+{
+    if (_frozen)
+        return;
 
-    // Indicate that the connection will be closed after this response
-    this->setHeader("Connection", "close");
+    Frozen* frozen = new Frozen;
+    frozen->refs = 1;
+    HeaderList send_time;
+    for (HeaderList::const_iterator it = _headers.begin(); it != _headers.end(); ++it)
+    {
+        if (is_send_time_header(it->first))
+            send_time.push_back(*it);
+        else
+            frozen->headers.push_back(*it);
+    }
+    frozen->body.swap(_body);
+
+    char fallback[48];
+    size_t line_length;
+    const char* line = status_line(_status_code, fallback, line_length);
+    bool has_server = find_header(frozen->headers, "Server") != NULL;
+    frozen->head.reserve(line_length + sizeof("Server: \r\n") + sizeof(SERVER_NAME) + headers_size(frozen->headers));
+    frozen->head.append(line, line_length);
+    if (!has_server)
+    {
+        frozen->head.append("Server: ", 8);
+        frozen->head.append(SERVER_NAME, sizeof(SERVER_NAME) - 1);
+        frozen->head.append("\r\n", 2);
+    }
+    append_headers(frozen->head, frozen->headers);
+
+    _headers.swap(send_time);
+    _frozen = frozen;
+}
+
+bool HttpResponse::isFrozen() const
+{
+    return _frozen != NULL;
+}
+
+// Copy the shared block back into this response before it changes
+void HttpResponse::_thaw()
+{
+    if (!_frozen)
+        return;
+    HeaderList headers(_frozen->headers);
+    headers.insert(headers.end(), _headers.begin(), _headers.end());
+    _headers.swap(headers);
+    _body = _frozen->body;
+    this->_release();
+}
+
+void HttpResponse::_release()
+{
+    if (_frozen && --_frozen->refs == 0)
+        delete _frozen;
+    _frozen = NULL;
 }
 
 
@@ -116,28 +397,71 @@ void HttpResponse::_setDefaultHeaders()
 // Returns the raw HTTP response ready to be sent to the client.
 std::string HttpResponse::serialize() const
 {
-    std::ostringstream oss;
-
-    // Build status line: "HTTP/1.1 200 OK\r\n"
-    oss << this->_version << " "
-        << this->_status_code << " "
-        << getStatusMessage(this->_status_code) << "\r\n";
+    std::string out;
+    this->serializeTo(out);
+    return out;
+}
 
-    // Build headers: "Header-Name: header-value\r\n"
-    for (std::map<std::string, std::string>::const_iterator it =
-             this->_headers.begin();
-         it != this->_headers.end(); ++it)
+// ## serializeTo - Appends the response to out with a single allocation
+// The exact size is computed first, then every part is copied in once.
+// Wire order: status line, Server, headers in the order set, Date, Connection.
+// A frozen response starts from its pre-rendered head.
+void HttpResponse::serializeTo(std::string& out) const
+{
+    const std::string& body = this->getBody();
+    const std::string& date = getDate();
+    bool has_date = this->_findHeader("Date") != NULL;
+    bool has_connection = this->_findHeader("Connection") != NULL;
+    bool has_server = true;
+
+    // Status line: "HTTP/1.1 200 OK\r\n", built only for codes outside the table
+    char fallback[48];
+    size_t line_length = 0;
+    const char* line = NULL;
+    size_t size = headers_size(this->_headers) + 2 + body.size();
+    if (_frozen)
+        size += _frozen->head.size();
+    else
+    {
+        line = status_line(this->_status_code, fallback, line_length);
+        has_server = find_header(this->_headers, "Server") != NULL;
+        size += line_length;
+        if (!has_server)
+            size += sizeof("Server: \r\n") - 1 + sizeof(SERVER_NAME) - 1;
+    }
+    if (!has_date)
+        size += sizeof("Date: \r\n") - 1 + date.size();
+    if (!has_connection)
+        size += sizeof("Connection: close\r\n") - 1;
+    out.reserve(out.size() + size);
+
+    if (_frozen)
+        out.append(_frozen->head);
+    else
+    {
+        out.append(line, line_length);
+        if (!has_server)
+        {
+            out.append("Server: ", 8);
+            out.append(SERVER_NAME, sizeof(SERVER_NAME) - 1);
+            out.append("\r\n", 2);
+        }
+    }
+    append_headers(out, this->_headers);
+    if (!has_date)
     {
-        oss << it->first << ": " << it->second << "\r\n";
+        out.append("Date: ", 6);
+        out.append(date);
+        out.append("\r\n", 2);
     }
+    if (!has_connection)
+        out.append("Connection: close\r\n", 19);
 
     // Empty line separates headers from body: "\r\n"
-    oss << "\r\n";
+    out.append("\r\n", 2);
 
     // Append body content (if any)
-    oss << this->_body;
-
-    return oss.str();
+    out.append(body);
 }
 
 
@@ -150,6 +474,15 @@ std::string HttpResponse::serialize() const
 HttpResponse HttpResponse::createErrorResponse(int code,
                                                const std::string& message)
 {
+    // Standard pages are rendered once per code, then shared
+    static std::map<int, HttpResponse> rendered;
+    if (message.empty())
+    {
+        std::map<int, HttpResponse>::const_iterator it = rendered.find(code);
+        if (it != rendered.end())
+            return it->second;
+    }
+
     HttpResponse response;
     response.setStatus(code);
 
@@ -173,6 +506,11 @@ HttpResponse HttpResponse::createErrorResponse(int code,
     response.setBody(body.str());
     response.setContentType("text/html");
 
+    if (message.empty())
+    {
+        response.freeze();
+        rendered[code] = response;
+    }
     return response;
 }
 
@@ -224,39 +562,43 @@ HttpResponse HttpResponse::createOkResponse(
 // getStatusMessage - Returns standard HTTP status message for a code
 std::string HttpResponse::getStatusMessage(int code)
 {
-    switch (code)
+    const StatusEntry* entry = find_status(code);
+    return entry ? entry->message : "Unknown";
+}
+
+// getStatusLine - Returns the precomputed status line for a code
+const char* HttpResponse::getStatusLine(int code, size_t& length)
+{
+    const StatusEntry* entry = find_status(code);
+    if (!entry)
     {
-        // 2xx Success
-        case 200: return "OK";
-        case 201: return "Created";
-        case 204: return "No Content";
-        
-        // 3xx Redirection
-        case 301: return "Moved Permanently";
-        case 302: return "Found";
-        
-        // 4xx Client Error
-        case 400: return "Bad Request";
-        case 403: return "Forbidden";
-        case 404: return "Not Found";
-        case 405: return "Method Not Allowed";
-        case 408: return "Request Timeout";
-        case 413: return "Payload Too Large";
-        case 414: return "URI Too Long";
-        case 415: return "Unsupported Media Type";
-        
-        // 5xx Server Error
-        case 500: return "Internal Server Error";
-        case 501: return "Not Implemented";
-        case 502: return "Bad Gateway";
-        case 503: return "Service Unavailable";
-        case 504: return "Gateway Timeout";
-        case 505: return "HTTP Version Not Supported";
-        case 507: return "Insufficient Storage";
-        
-        // Unknown code
-        default:  return "Unknown";
+        length = 0;
+        return NULL;
     }
+    length = entry->line_length;
+    return entry->line;
+}
+
+// ## updateDate - Regenerates the shared Date value once per second
+// Format (RFC 9110 IMF-fixdate): "Day, DD Mon YYYY HH:MM:SS GMT"
+void HttpResponse::updateDate(std::time_t now)
+{
+    if (now == g_date_time)
+        return;
+    char date_buf[64];
+    size_t length = std::strftime(date_buf, sizeof(date_buf),
+                                  "%a, %d %b %Y %H:%M:%S GMT",
+                                  std::gmtime(&now));
+    g_date.assign(date_buf, length);
+    g_date_time = now;
+}
+
+// getDate - Current shared Date value
+const std::string& HttpResponse::getDate()
+{
+    if (g_date_time == -1)
+        updateDate(std::time(NULL));
+    return g_date;
 }
 
 } // namespace wsv
@@ -2,8 +2,8 @@
 #define HTTP_RESPONSE_HPP
 
 #include <string>
-#include <map>
 #include <vector>
+#include <ctime>
 
 namespace wsv
 {
@@ -17,24 +17,35 @@ namespace wsv
  */
 class HttpResponse
 {
+public:
+    typedef std::vector<std::pair<std::string, std::string> > HeaderList;  // In the order first set
+
 private:
     int _status_code;                                    // HTTP status code
-    std::string _version;                                // HTTP version (e.g., "HTTP/1.1")
-    std::map<std::string, std::string> _headers;         // Response headers
+    HeaderList _headers;                                 // Response headers, names case-insensitive
     std::string _body;                                   // Response body
 
-    /**
-     * Initialize default headers
-     * Sets Server, Date, and Connection headers
-     */
-    void _setDefaultHeaders();
+    struct Frozen;
+    Frozen* _frozen;                                     // Shared pre-rendered copy, see freeze()
+
+    const std::string* _findHeader(const std::string& key) const;
+
+    // Value of a default header (Server, Date, Connection) not set explicitly, or NULL
+    const char* _defaultHeader(const std::string& key) const;
+
+    void _thaw();
+    void _release();
 
 public:
     /**
      * Constructor
-     * Initializes response with HTTP 200 status and default headers
+     * Initializes response with HTTP 200 status. Server, Date and
+     * "Connection: close" are defaults: they are written at serialization
+     * unless set explicitly, so constructing a response costs no header work.
      */
     HttpResponse();
+    HttpResponse(const HttpResponse& other);
+    HttpResponse& operator=(const HttpResponse& other);
     ~HttpResponse();
 
     // ========================================
@@ -54,6 +65,12 @@ public:
     std::string getHeader(const std::string& key) const;
     const std::string& getBody() const;
 
+    /**
+     * Append every header in the order serializeTo() writes them,
+     * defaults (Server, Date, Connection) included
+     */
+    void collectHeaders(HeaderList& out) const;
+
     // ========================================
     // Serialization
     // ========================================
@@ -65,6 +82,27 @@ public:
      */
     std::string serialize() const;
 
+    /**
+     * Append the serialized response to out, reserving its exact size first
+     * The status line comes from a precomputed table, headers are written
+     * in the order they were set
+     */
+    void serializeTo(std::string& out) const;
+
+    // ========================================
+    // Frozen Responses
+    // ========================================
+
+    /**
+     * Pre-render the status line and every header but Date and Connection
+     * into an immutable block. Copies share the block, so a canned error page
+     * or redirect costs a reference count per request; serializeTo() adds
+     * Date and Connection to it. Setting the status, the body or a header of
+     * the block gives the response its own copy again.
+     */
+    void freeze();
+    bool isFrozen() const;
+
     // ========================================
     // Convenience Methods
     // ========================================
@@ -87,6 +125,7 @@ public:
 
     /**
      * Create a complete error response with HTML body
+     * Without a message, the page of each code is rendered once and frozen
      * @param code HTTP error code
      * @param message Optional custom error message
      * @return Fully formed HttpResponse object
@@ -119,6 +158,29 @@ public:
      * @return Status string (e.g., "Not Found" for 404)
      */
     static std::string getStatusMessage(int code);
+
+    /**
+     * Precomputed status line, e.g. "HTTP/1.1 404 Not Found\r\n"
+     * @param length Receives its length
+     * @return The line, or NULL for a code outside the table
+     */
+    static const char* getStatusLine(int code, size_t& length);
+
+    // ========================================
+    // Date Header
+    // ========================================
+
+    /**
+     * Regenerate the shared Date value if now is a different second
+     * Called once per event loop iteration; every response reuses the string
+     */
+    static void updateDate(std::time_t now);
+
+    /**
+     * Current Date value, e.g. "Sun, 18 Oct 2026 18:06:36 GMT"
+     * Generated on first use when updateDate() has never been called
+     */
+    static const std::string& getDate();
 };
 } // namespace wsv
 
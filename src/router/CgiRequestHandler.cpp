@@ -25,10 +25,12 @@ void CgiRequestHandler::startCgi(Client& client,
     {
         CgiHandler* handler = new CgiHandler(location_config.cgi_path, script_path);
         client.cgi_handler = handler;
+        if (location_config.cgi_timeout > 0)
+            handler->setTimeout(location_config.cgi_timeout);
 
         // 1. Build CGI environment variables
         std::map<std::string, std::string> env_vars =
-            _build_cgi_environment(client.request, script_path, location_config, server_config);
+            _build_cgi_environment(client.request(), script_path, location_config, server_config);
 
         for (std::map<std::string, std::string>::const_iterator it = env_vars.begin();
             it != env_vars.end(); ++it)
@@ -38,15 +40,36 @@ void CgiRequestHandler::startCgi(Client& client,
         }
 
         // 2. Provide request body as CGI stdin if POST
-        if (client.request.getMethod() == "POST")
-            handler->setInput(client.request.getBody());
+        if (client.request().getMethodId() == METHOD_POST)
+            handler->setInput(client.request().getBodyBuffer());
+
+        // 3a. FastCGI: encode the request; Server attaches a pooled worker connection
+        if (!location_config.fastcgi_pass.empty())
+        {
+            handler->setFastCgiPass(location_config.fastcgi_pass);
+            handler->prepareFastCgiRequest();
+            client.cgi_input_fd = -1;
+            client.cgi_output_fd = -1;
+            client.cgi_write_offset = 0;
+            client.state = CLIENT_CGI_PROCESSING;
+            Logger::info("Prepared FastCGI request for client FD {} to {}",
+                         client.client_fd, location_config.fastcgi_pass);
+            return;
+        }
+
+        // 3b. Start the CGI process, confined to the location's limits
+        CgiHandler::Limits limits;
+        limits.cpu_seconds = location_config.cgi_rlimit_cpu;
+        limits.address_space = location_config.cgi_rlimit_as;
+        limits.open_files = location_config.cgi_rlimit_nofile;
+        limits.cgroup = location_config.cgi_cgroup;
+        handler->setLimits(limits);
 
-        // 3. Start the CGI process
         pid_t pid = handler->start();
         
         // 4. For non-POST requests, immediately close stdin (no body to send)
         //    This signals EOF to the CGI process so it doesn't wait for input
-        if (client.request.getMethod() != "POST")
+        if (client.request().getMethodId() != METHOD_POST)
         {
             handler->closeStdin();
             client.cgi_input_fd = -1;  // Mark as already closed
@@ -57,6 +80,8 @@ void CgiRequestHandler::startCgi(Client& client,
             client.cgi_write_offset = 0;  // Reset write offset for new CGI request
         }
         client.cgi_output_fd = handler->getStdoutReadFd();
+        client.cgi_pid_fd = handler->getPidFd();
+        client.cgi_output_done = false;
         client.state = CLIENT_CGI_PROCESSING;
         
         Logger::info("Started CGI process {} for client FD {}", pid, client.client_fd);
@@ -107,11 +132,15 @@ std::map<std::string, std::string> CgiRequestHandler::_build_cgi_environment(
     env_vars["SERVER_NAME"] = server_config.host;
     env_vars["SERVER_PORT"] = StringUtils::toString(server_config.listen_port);
 
+    // HTTPS: set for requests that arrived over TLS
+    if (server_config.ssl)
+        env_vars["HTTPS"] = "on";
+
     // CONTENT_LENGTH and CONTENT_TYPE for POST/PUT
-    if (request.hasHeader("Content-Length"))
-        env_vars["CONTENT_LENGTH"] = request.getHeader("Content-Length");
-    if (request.hasHeader("Content-Type"))
-        env_vars["CONTENT_TYPE"] = request.getHeader("Content-Type");
+    if (request.hasHeader(HEADER_CONTENT_LENGTH))
+        env_vars["CONTENT_LENGTH"] = request.getHeader(HEADER_CONTENT_LENGTH);
+    if (request.hasHeader(HEADER_CONTENT_TYPE))
+        env_vars["CONTENT_TYPE"] = request.getHeader(HEADER_CONTENT_TYPE);
 
     // PATH_INFO: The cgi_tester expects this to be the full request path
     env_vars["PATH_INFO"] = request.getPath();
@@ -119,28 +148,28 @@ std::map<std::string, std::string> CgiRequestHandler::_build_cgi_environment(
     // HTTP_* headers: Convert all HTTP headers to CGI environment variables
     // According to RFC 3875, HTTP headers are passed as HTTP_<HEADER_NAME>
     // where header name is converted to uppercase and dashes become underscores
-    HttpRequest::HeaderMap headers = request.getHeaders();
-    for (HttpRequest::HeaderMap::const_iterator it = headers.begin();
-         it != headers.end(); ++it)
+    // Read in place, in arrival order: a repeated field keeps its last value
+    for (size_t i = 0; i < request.getHeaderCount(); ++i)
     {
-        std::string header_name = it->first;
-        
         // Skip Content-Type and Content-Length (already handled above without HTTP_ prefix)
-        if (header_name == "content-type" || header_name == "content-length")
+        HeaderId id = request.getHeaderId(i);
+        if (id == HEADER_CONTENT_TYPE || id == HEADER_CONTENT_LENGTH)
             continue;
+
+        std::string header_name = request.getHeaderName(i);
         
         // Convert header name: lowercase to uppercase, dash to underscore
         std::string env_name = "HTTP_";
-        for (size_t i = 0; i < header_name.size(); ++i)
+        for (size_t j = 0; j < header_name.size(); ++j)
         {
-            char c = header_name[i];
+            char c = header_name[j];
             if (c == '-')
                 env_name += '_';
             else
                 env_name += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
         }
         
-        env_vars[env_name] = it->second;
+        env_vars[env_name] = request.getHeaderValue(i);
     }
 
     // GATEWAY_INTERFACE: CGI version
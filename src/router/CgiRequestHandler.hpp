@@ -24,6 +24,8 @@ class CgiRequestHandler
 public:
     /**
      * Start async CGI execution
+     * With fastcgi_pass set, only the FastCGI request is prepared; the Server
+     * sends it over a pooled worker connection instead of forking
      * @param client Client object 
      * @param script_path Filesystem path to CGI script
      * @param location_config Location configuration
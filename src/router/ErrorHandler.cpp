@@ -13,6 +13,11 @@ namespace wsv {
 */
 HttpResponse ErrorHandler::get_error_page(int status_code, const ServerConfig& config)
 {
+    // Pages rendered by prepare() are shared as they are
+    std::map<int, HttpResponse>::const_iterator canned = config.canned_errors.find(status_code);
+    if (canned != config.canned_errors.end())
+        return canned->second;
+
     // Create response with appropriate HTTP status code
     HttpResponse response;
     response.setStatus(status_code);
@@ -44,4 +49,35 @@ HttpResponse ErrorHandler::get_error_page(int status_code, const ServerConfig& c
     return HttpResponse::createErrorResponse(status_code, "");
 }
 
+/**
+ * Pre-render the error pages and redirects of a server
+ * A page that cannot be read is left out, so it falls back to the standard
+ * page like it would per request.
+ * @param config Server configuration, as used by the connections
+*/
+void ErrorHandler::prepare(ServerConfig& config)
+{
+    config.canned_errors.clear();
+    for (std::map<int, std::string>::const_iterator it = config.error_pages.begin();
+         it != config.error_pages.end(); ++it)
+    {
+        HttpResponse response = get_error_page(it->first, config);
+        // Only the standard page comes back frozen: the custom one was not read
+        if (response.isFrozen())
+            continue;
+        response.freeze();
+        config.canned_errors[it->first] = response;
+    }
+
+    for (size_t i = 0; i < config.locations.size(); ++i)
+    {
+        LocationConfig& location = config.locations[i];
+        if (!location.hasRedirect())
+            continue;
+        location.canned_redirect = HttpResponse::createRedirectResponse(location.redirect_code,
+                                                                        location.redirect_url);
+        location.canned_redirect.freeze();
+    }
+}
+
 } // namespace wsv
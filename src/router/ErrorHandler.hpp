@@ -10,12 +10,20 @@ namespace wsv {
 /**
  * ErrorHandler - Generates HTTP error responses
  * Supports custom error pages from server config, otherwise generates default HTML pages.
+ * prepare() renders them once at startup; each request then shares the frozen copy.
  */
 class ErrorHandler
 {
 public:
     static HttpResponse get_error_page(int status_code, const ServerConfig& config);
 
+    /**
+     * Read every custom error page of config and freeze it into
+     * config.canned_errors, and freeze the `return` response of each location.
+     * Pages that cannot be read are left out and looked up per request
+     */
+    static void prepare(ServerConfig& config);
+
 };
 
 } // namespace wsv
@@ -2,8 +2,10 @@
 #include "ErrorHandler.hpp"
 #include <sys/stat.h>
 #include <dirent.h>
-#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sstream>
+#include <cstring>
 
 namespace wsv
 {
@@ -11,34 +13,36 @@ namespace wsv
 // ============================================================================
 // Serve a static file with appropriate MIME type
 // ============================================================================
-HttpResponse FileHandler::serve_file(const std::string& file_path)
+HttpResponse FileHandler::serve_file(const char* file_path)
 {
     // 1. Check if the file exists
-    if (!file_exists(file_path))
+    struct stat file_status;
+    if (stat(file_path, &file_status) != 0)
         return HttpResponse::createErrorResponse(404);
+    return serve_file(file_path, file_status);
+}
 
-    // 2. Attempt to read the file
-    std::string file_content = read_file(file_path);
-    
-    // 3. We do not return 500 directly!
-    // If read_file returns empty, determine whether the file is actually zero bytes or couldn't be opened.
-    
-    std::ifstream file(file_path.c_str(), std::ios::binary);
-    if (!file.is_open())
+HttpResponse FileHandler::serve_file(const char* file_path, const struct stat& file_stat)
+{
+    // 2. A file that exists but cannot be opened is forbidden
+    int fd = open(file_path, O_RDONLY);
+    if (fd == -1)
     {
         HttpResponse response;
         response.setStatus(403); 
         return response;
     }
+    std::string content = _read_fd(fd, file_stat);
+    close(fd);
 
-    // 4. Return 200 OK; it's fine if file_content is empty
-    return HttpResponse::createOkResponse(file_content, get_mime_type(file_path));
+    // 3. Return 200 OK; it's fine if the file is empty
+    return HttpResponse::createOkResponse(content, get_mime_type(file_path));
 }
 
 // ============================================================================
 // Handle directory requests (try index file, then listing if enabled)
 // ============================================================================
-HttpResponse FileHandler::serve_directory(const std::string& dir_path,
+HttpResponse FileHandler::serve_directory(const char* dir_path,
                                           const LocationConfig& location_config)
 {
     // Build path to index file (e.g., /var/www/html/index.html)
@@ -50,9 +54,10 @@ HttpResponse FileHandler::serve_directory(const std::string& dir_path,
     index_path += location_config.index;
     
     // If index file exists and is readable, serve it
-    if (file_exists(index_path) && !is_directory(index_path))
+    struct stat index_status;
+    if (stat(index_path.c_str(), &index_status) == 0 && !S_ISDIR(index_status.st_mode))
     {
-        return serve_file(index_path);
+        return serve_file(index_path.c_str(), index_status);
     }
     
     // If autoindex is enabled, generate HTML directory listing
@@ -123,39 +128,61 @@ HttpResponse FileHandler::_generate_directory_listing(const std::string& dir_pat
 // ============================================================================
 // Read entire file content into memory
 // ============================================================================
-std::string FileHandler::read_file(const std::string& path)
+std::string FileHandler::read_file(const char* path)
 {
-    std::ifstream file(path.c_str(), std::ios::binary);
-    if (!file.is_open())
-        return "";
-    
-    std::ostringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return std::string();
+
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0)
+        std::memset(&file_status, 0, sizeof(file_status));
+    std::string content = _read_fd(fd, file_status);
+    close(fd);
+    return content;
+}
+
+std::string FileHandler::_read_fd(int fd, const struct stat& file_stat)
+{
+    std::string content;
+
+    // Regular file: one allocation of the right size, no stream buffers
+    char buffer[4096];
+    ssize_t bytes;
+    if (S_ISREG(file_stat.st_mode) && file_stat.st_size > 0)
+    {
+        content.resize(static_cast<size_t>(file_stat.st_size));
+        size_t filled = 0;
+        while (filled < content.size() &&
+               (bytes = read(fd, &content[filled], content.size() - filled)) > 0)
+            filled += bytes;
+        content.resize(filled);
+    }
+    while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
+        content.append(buffer, bytes);
+    return content;
 }
 
 // ============================================================================
 // Determine MIME type based on file extension
 // ============================================================================
-std::string FileHandler::get_mime_type(const std::string& file_path)
+const char* FileHandler::get_mime_type(const char* file_path)
 {
-    size_t pos = file_path.find_last_of('.');
-    if (pos == std::string::npos)
+    const char* ext = std::strrchr(file_path, '.');
+    if (!ext)
         return "application/octet-stream";
     
-    std::string ext = file_path.substr(pos);
-    
-    if (ext == ".html" || ext == ".htm") return "text/html";
-    if (ext == ".css") return "text/css";
-    if (ext == ".js") return "application/javascript";
-    if (ext == ".jpg" || ext == ".jpeg") return "image/jpeg";
-    if (ext == ".png") return "image/png";
-    if (ext == ".gif") return "image/gif";
-    if (ext == ".ico") return "image/x-icon";
-    if (ext == ".txt") return "text/plain";
-    if (ext == ".json") return "application/json";
-    if (ext == ".xml") return "application/xml";
-    if (ext == ".pdf") return "application/pdf";
+    if (!std::strcmp(ext, ".html") || !std::strcmp(ext, ".htm")) return "text/html";
+    if (!std::strcmp(ext, ".css")) return "text/css";
+    if (!std::strcmp(ext, ".js")) return "application/javascript";
+    if (!std::strcmp(ext, ".jpg") || !std::strcmp(ext, ".jpeg")) return "image/jpeg";
+    if (!std::strcmp(ext, ".png")) return "image/png";
+    if (!std::strcmp(ext, ".gif")) return "image/gif";
+    if (!std::strcmp(ext, ".ico")) return "image/x-icon";
+    if (!std::strcmp(ext, ".txt")) return "text/plain";
+    if (!std::strcmp(ext, ".json")) return "application/json";
+    if (!std::strcmp(ext, ".xml")) return "application/xml";
+    if (!std::strcmp(ext, ".pdf")) return "application/pdf";
     
     return "application/octet-stream";
 }
@@ -163,19 +190,19 @@ std::string FileHandler::get_mime_type(const std::string& file_path)
 // ============================================================================
 // Check if file or directory exists
 // ============================================================================
-bool FileHandler::file_exists(const std::string& path)
+bool FileHandler::file_exists(const char* path)
 {
     struct stat file_status;
-    return (stat(path.c_str(), &file_status) == 0);
+    return (stat(path, &file_status) == 0);
 }
 
 // ============================================================================
 // Check if path is a directory
 // ============================================================================
-bool FileHandler::is_directory(const std::string& path)
+bool FileHandler::is_directory(const char* path)
 {
     struct stat file_status;
-    if (stat(path.c_str(), &file_status) != 0)
+    if (stat(path, &file_status) != 0)
         return false;
     return S_ISDIR(file_status.st_mode);
 }
@@ -2,6 +2,7 @@
 #define FILE_HANDLER_HPP
 
 #include <string>
+#include <sys/stat.h>
 #include "HttpResponse.hpp"
 #include "ConfigParser.hpp"
 
@@ -16,6 +17,9 @@ namespace wsv
  * - Handle directory requests (index file or autoindex)
  * - Check file existence and directory status
  * - Read files into memory
+ *
+ * Paths are taken as C strings, so request-scoped (arena) paths are passed
+ * without building a std::string.
  */
 class FileHandler
 {
@@ -25,7 +29,16 @@ public:
      * @param file_path Filesystem path to the file
      * @return HttpResponse containing file contents or error
      */
-    static HttpResponse serve_file(const std::string& file_path);
+    static HttpResponse serve_file(const char* file_path);
+    static HttpResponse serve_file(const std::string& file_path) { return serve_file(file_path.c_str()); }
+
+    /**
+     * Serve a file already stat()ed by the caller: opened and read once
+     * @param file_path Filesystem path to the file
+     * @param file_stat Its stat() result
+     * @return HttpResponse containing file contents, or 403 if it cannot be opened
+     */
+    static HttpResponse serve_file(const char* file_path, const struct stat& file_stat);
 
     /**
      * Handle directory requests
@@ -34,40 +47,50 @@ public:
      * @param location_config Location-specific configuration
      * @return HttpResponse containing directory listing or index file
      */
-    static HttpResponse serve_directory(const std::string& dir_path,
+    static HttpResponse serve_directory(const char* dir_path,
                                         const LocationConfig& location_config);
+    static HttpResponse serve_directory(const std::string& dir_path,
+                                        const LocationConfig& location_config)
+    { return serve_directory(dir_path.c_str(), location_config); }
 
     /**
      * Read entire file content into memory
      * @param path Filesystem path to the file
      * @return File content as string, empty if cannot read
      */
-    static std::string read_file(const std::string& path);
+    static std::string read_file(const char* path);
+    static std::string read_file(const std::string& path) { return read_file(path.c_str()); }
 
     /**
      * Determine MIME type based on file extension
      * @param file_path Filesystem path or filename
-     * @return MIME type as string (default: application/octet-stream)
+     * @return MIME type (default: application/octet-stream)
      */
-    static std::string get_mime_type(const std::string& file_path);
+    static const char* get_mime_type(const char* file_path);
+    static const char* get_mime_type(const std::string& file_path) { return get_mime_type(file_path.c_str()); }
 
     /**
      * Check if a file or directory exists
      * @param path Filesystem path
      * @return true if exists, false otherwise
      */
-    static bool file_exists(const std::string& path);
+    static bool file_exists(const char* path);
+    static bool file_exists(const std::string& path) { return file_exists(path.c_str()); }
 
     /**
      * Check if a path is a directory
      * @param path Filesystem path
      * @return true if path is a directory, false otherwise
      */
-    static bool is_directory(const std::string& path);
+    static bool is_directory(const char* path);
+    static bool is_directory(const std::string& path) { return is_directory(path.c_str()); }
 
 private:
     // Private Helper Method
 
+    // Content of an open file, sized from its stat() when it is a regular file
+    static std::string _read_fd(int fd, const struct stat& file_stat);
+
     /**
      * Generate HTML directory listing (for autoindex)
      * @param dir_path Filesystem path to directory
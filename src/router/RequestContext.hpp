@@ -0,0 +1,57 @@
+#ifndef REQUEST_CONTEXT_HPP
+#define REQUEST_CONTEXT_HPP
+
+#include "config/ConfigParser.hpp"
+#include "utils/Arena.hpp"
+#include <sys/stat.h>
+
+namespace wsv
+{
+
+/**
+ * RequestContext - Routing result of one request
+ *
+ * RequestHandler fills it once: the URL-decoded path, the matched location
+ * and the filesystem path built from its root or alias. Every handler reads
+ * from it instead of decoding and matching again. The target is stat()ed on
+ * first use, and the result is kept for the rest of the request.
+ *
+ * The strings live in the request's arena, so a context must not outlive
+ * the arena's next reset.
+ */
+class RequestContext
+{
+public:
+    ArenaString decoded_path;
+    const LocationConfig* location;     // NULL until routed
+    ArenaString file_path;              // Empty for proxy_pass locations
+
+    explicit RequestContext(Arena& arena)
+        : decoded_path(ArenaAllocator<char>(arena))
+        , location(NULL)
+        , file_path(ArenaAllocator<char>(arena))
+        , _stat_result(STAT_PENDING)
+    { }
+
+    // stat() of file_path, run once
+    bool exists() { return _stat() == 0; }
+    bool isDirectory() { return _stat() == 0 && S_ISDIR(_file_stat.st_mode); }
+    const struct stat& fileStat() { _stat(); return _file_stat; }
+
+private:
+    static const int STAT_PENDING = 1;
+
+    struct stat _file_stat;
+    int _stat_result;                   // stat()'s return value, STAT_PENDING before the call
+
+    int _stat()
+    {
+        if (_stat_result == STAT_PENDING)
+            _stat_result = stat(file_path.c_str(), &_file_stat);
+        return _stat_result;
+    }
+};
+
+} // namespace wsv
+
+#endif // REQUEST_CONTEXT_HPP
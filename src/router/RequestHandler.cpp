@@ -1,12 +1,18 @@
 #include "RequestHandler.hpp"
 #include <algorithm>
 #include <iostream>
+#include <ctime>
+#include <arpa/inet.h>
 
 namespace wsv
 {
 
-RequestHandler::RequestHandler(const ServerConfig& config)
+RequestHandler::RequestHandler(const ServerConfig& config, CgiCache* cgi_cache,
+                               CgiLimiter* cgi_limiter)
     : _config(config)
+    , _cgi_cache(cgi_cache)
+    , _cgi_limiter(cgi_limiter)
+    , _arena(&_local_arena)
 { }
 
 RequestHandler::~RequestHandler()
@@ -22,42 +28,258 @@ RequestHandler::~RequestHandler()
  */
 HttpResponse RequestHandler::handleRequest(Client& client)
 {
-    const HttpRequest& request = client.request;
-    std::string method = request.getMethod();
-    std::string decoded_path = StringUtils::urlDecode(request.getPath());
-
-    // Basic validation for CGI check
-    // Note: We duplicate some checks here to find the LocationConfig and FilePath
-    // This is necessary to determine if it is a CGI request safely.
-    
-    if (decoded_path.find("..") != std::string::npos)
-        return ErrorHandler::get_error_page(403, _config);
-
-    const LocationConfig* location_config = _config.findLocation(decoded_path);
-    if (!location_config)
-        return ErrorHandler::get_error_page(404, _config);
+    // Request-scoped strings live in the connection's arena until it turns over
+    _arena = &client.arena();
+
+    const HttpRequest& request = client.request();
+    RequestContext context(*_arena);
+    int status = _route(request, context);
+    if (status)
+        return ErrorHandler::get_error_page(status, _config);
+    const LocationConfig& location_config = *context.location;
+
+    // Redirect and body size apply to every handler below, proxy included
+    HttpResponse early;
+    if (_checkLocation(request, location_config, early))
+        return early;
+
+    // Reverse proxy: the upstream owns the whole location
+    if (!location_config.proxy_pass.empty())
+        return _startProxy(client, context);
+
+    // FastCGI: the worker owns the whole location (or only the CGI extension if set)
+    if (!location_config.fastcgi_pass.empty() &&
+        (location_config.cgi_extension.empty() || _isCgiRequest(context.file_path, location_config)))
+    {
+        if (_checkCgiCache(client, location_config, early) ||
+            !_admitCgi(client, context.file_path, location_config, early))
+            return early;
 
-    if (!location_config->isMethodAllowed(method))
-        return ErrorHandler::get_error_page(405, _config);
+        return _startCgi(client, context.file_path, location_config);
+    }
 
-    // Check CGI
-    std::string file_path = _buildFilePath(decoded_path, *location_config);
-    if (_isCgiRequest(file_path, *location_config))
+    if (_isCgiRequest(context.file_path, location_config))
     {
         // For GET/HEAD requests, the CGI script file must exist
         // For POST requests, the target file doesn't need to exist (upload/creation scenario)
-        if ((method == "GET" || method == "HEAD") && !FileHandler::file_exists(file_path))
+        if ((request.getMethodId() == METHOD_GET || request.getMethodId() == METHOD_HEAD) &&
+            !context.exists())
             return ErrorHandler::get_error_page(404, _config);
 
+        if (_checkCgiCache(client, location_config, early) ||
+            !_admitCgi(client, context.file_path, location_config, early))
+            return early;
+
         // Start Async CGI
-        CgiRequestHandler::startCgi(client, file_path, *location_config, _config);
-        
-        // Return placeholder. Server will check client.state
-        return HttpResponse(); 
+        return _startCgi(client, context.file_path, location_config);
+    }
+
+    // Fallback to standard processing, on the same routing result
+    return _dispatchMethod(request, context);
+}
+
+// ============================================================================
+// HTTP/2 streams
+// ============================================================================
+
+bool RequestHandler::canHandleInStream(const HttpRequest& request) const
+{
+    // Errors and redirects are synchronous anyway
+    RequestContext context(*_arena);
+    return _route(request, context) != 0 || _isStreamable(context);
+}
+
+HttpResponse RequestHandler::handleStreamRequest(const HttpRequest& request)
+{
+    RequestContext context(*_arena);
+    int status = _route(request, context);
+    if (status)
+        return ErrorHandler::get_error_page(status, _config);
+    if (!_isStreamable(context))
+        return ErrorHandler::get_error_page(421, _config);
+    return _handleRouted(request, context);
+}
+
+// true unless the routed location needs CGI, FastCGI or proxy_pass
+bool RequestHandler::_isStreamable(const RequestContext& context) const
+{
+    const LocationConfig& location_config = *context.location;
+    if (!location_config.proxy_pass.empty())
+        return false;
+    if (!location_config.fastcgi_pass.empty() &&
+        (location_config.cgi_extension.empty() || _isCgiRequest(context.file_path, location_config)))
+        return false;
+    return !_isCgiRequest(context.file_path, location_config);
+}
+
+// ============================================================================
+// CGI file delegation (X-Accel-Redirect / X-Sendfile)
+// ============================================================================
+
+HttpResponse RequestHandler::serveInternalRedirect(const std::string& uri)
+{
+    RequestContext context(*_arena);
+    int status = _resolve(uri.data(), std::min(uri.find('?'), uri.size()), context);
+    if (context.decoded_path.empty() || context.decoded_path[0] != '/')
+        status = 403;
+    if (status)
+        return ErrorHandler::get_error_page(status, _config);
+
+    // A script, FastCGI or proxied target would be sent as its source
+    if (!_isStreamable(context))
+    {
+        Logger::error("X-Accel-Redirect into a CGI, FastCGI or proxy location: {}", uri);
+        return ErrorHandler::get_error_page(403, _config);
+    }
+
+    if (!context.exists() || context.isDirectory())
+        return ErrorHandler::get_error_page(404, _config);
+
+    Logger::debug("X-Accel-Redirect {} -> {}", uri, context.file_path);
+    return _serve_file(context);
+}
+
+HttpResponse RequestHandler::serveSendfile(const std::string& path)
+{
+    if (path.find("..") != std::string::npos)
+        return ErrorHandler::get_error_page(403, _config);
+
+    // Only files the configuration already exposes may be sent
+    std::vector<std::string> roots;
+    roots.push_back(_config.root);
+    for (size_t i = 0; i < _config.locations.size(); ++i)
+    {
+        roots.push_back(_config.locations[i].root);
+        roots.push_back(_config.locations[i].alias);
+    }
+
+    bool allowed = false;
+    for (size_t i = 0; i < roots.size() && !allowed; ++i)
+    {
+        const std::string& root = roots[i];
+        if (root.empty() || path.compare(0, root.size(), root) != 0)
+            continue;
+        allowed = (path.size() > root.size() &&
+                   (path[root.size()] == '/' || root[root.size() - 1] == '/'));
+    }
+    if (!allowed)
+    {
+        Logger::error("X-Sendfile outside configured roots: {}", path);
+        return ErrorHandler::get_error_page(403, _config);
     }
 
-    // Fallback to standard processing
-    return handleRequest(request);
+    if (!FileHandler::file_exists(path) || FileHandler::is_directory(path))
+        return ErrorHandler::get_error_page(404, _config);
+
+    Logger::debug("X-Sendfile {}", path);
+    return _serve_file(path.c_str());
+}
+
+// cgi_cache: a hit is answered directly; a miss either leads a new CGI run
+// (the Server stores its result) or waits for the identical run in flight
+bool RequestHandler::_checkCgiCache(Client& client, const LocationConfig& location_config,
+                                    HttpResponse& response)
+{
+    if (!_cgi_cache || location_config.cgi_cache_ttl <= 0 || client.request().getMethodId() != METHOD_GET)
+        return false;
+
+    std::string key = CgiCache::makeKey(client.request(), location_config, _config);
+    if (_cgi_cache->lookup(key, response, std::time(NULL)))
+    {
+        Logger::debug("CGI cache hit for client FD {}", client.client_fd);
+        return true;
+    }
+
+    client.cgi_cache_key = key;
+    if (_cgi_cache->joinFlight(key, client.client_fd))
+    {
+        Logger::info("CGI cache miss for client FD {} joined a run in flight", client.client_fd);
+        client.cgi_cache_waiting = true;
+        client.state = CLIENT_CGI_PROCESSING;
+        return true;
+    }
+
+    client.cgi_cache_ttl = location_config.cgi_cache_ttl;
+    return false;
+}
+
+// cgi_max_concurrent: run now, wait in the location's FIFO, or get a 503
+bool RequestHandler::_admitCgi(Client& client, const ArenaString& file_path,
+                               const LocationConfig& location_config, HttpResponse& response)
+{
+    if (!_cgi_limiter || location_config.cgi_max_concurrent <= 0)
+        return true;
+
+    switch (_cgi_limiter->admit(location_config, client.client_fd))
+    {
+        case CgiLimiter::ADMIT_RUN:
+            client.cgi_location = &location_config;
+            client.cgi_slot_held = true;
+            return true;
+        case CgiLimiter::ADMIT_QUEUED:
+            client.cgi_location = &location_config;
+            client.cgi_script_path.assign(file_path.data(), file_path.size());
+            client.state = CLIENT_CGI_QUEUED;
+            return false;
+        default:
+            response = _cgi_limiter->busyResponse();
+            return false;
+    }
+}
+
+HttpResponse RequestHandler::_startProxy(Client& client, const RequestContext& context)
+{
+    const HttpRequest& request = client.request();
+    const LocationConfig& location_config = *context.location;
+
+    // nginx semantics: with a URI in proxy_pass it replaces the matched prefix.
+    // The location matched the decoded path, so the prefix is cut there and
+    // the rest re-encoded: /%61pi/x under /api must not lose the wrong bytes
+    std::string path = request.getPath();
+    if (!location_config.proxy_uri.empty())
+    {
+        size_t prefix = std::min(location_config.path.size(), context.decoded_path.size());
+        const char* rest = context.decoded_path.data() + prefix;
+        size_t rest_len = context.decoded_path.size() - prefix;
+        if (rest_len && rest[0] == '/' &&
+            location_config.proxy_uri[location_config.proxy_uri.size() - 1] == '/')
+        {
+            ++rest;
+            --rest_len;
+        }
+        path = location_config.proxy_uri + StringUtils::urlEncodePath(rest, rest_len);
+    }
+    if (!request.getQuery().empty())
+        path += "?" + request.getQuery();
+
+    char client_ip[INET_ADDRSTRLEN];
+    if (!inet_ntop(AF_INET, &client.address.sin_addr, client_ip, sizeof(client_ip)))
+        client_ip[0] = '\0';
+
+    client.proxy_request = HttpProxy::encodeRequest(request, path, client_ip,
+                                                       _config.ssl ? "https" : "http");
+    client.proxy_location = &location_config;
+    client.proxy_tries = 0;
+    client.proxy_tried.clear();
+    client.proxyParser().reset(request.getMethodId() == METHOD_HEAD);
+    client.state = CLIENT_PROXYING;
+    Logger::info("Proxying {} {} to {}", request.getMethod(), path, location_config.proxy_pass);
+
+    // Return placeholder. Server will check client.state
+    return HttpResponse();
+}
+
+HttpResponse RequestHandler::_startCgi(Client& client, const ArenaString& file_path,
+                                       const LocationConfig& location_config)
+{
+    CgiRequestHandler::startCgi(client, std::string(file_path.data(), file_path.size()),
+                                location_config, _config);
+
+    if (client.state != CLIENT_CGI_PROCESSING)
+        return ErrorHandler::get_error_page(500, _config);
+
+    // Return placeholder. Server will check client.state
+    return HttpResponse();
 }
 
 // standard processing
@@ -66,60 +288,113 @@ HttpResponse RequestHandler::handleRequest(const HttpRequest& request)
     Logger::debug("============================================");
     Logger::debug("START handleRequest");
     Logger::debug("============================================");
-    
-    std::string method = request.getMethod();
-    std::string raw_uri = request.getPath();
-    
-    Logger::debug("Raw URI: {}", raw_uri);
-    Logger::debug("Method: {}", method);
-    
+
+    RequestContext context(*_arena);
+    int status = _route(request, context);
+    if (status)
+        return ErrorHandler::get_error_page(status, _config);
+    return _handleRouted(request, context);
+}
+
+// ============================================================================
+// Routing: runs once per request, every handler reads its RequestContext
+// ============================================================================
+
+/**
+ * Decode a path, match its location and build the file path
+ * @return 0, or the error status: 403 (path traversal), 404 (no location)
+ */
+int RequestHandler::_resolve(const char* path, size_t len, RequestContext& context) const
+{
     // STEP 1: URL Decode (SECURITY)
     // Decode URL BEFORE path traversal check
     // This prevents bypass via encoded sequences like %2e%2e%2f (../)
-    std::string decoded_path = StringUtils::urlDecode(raw_uri);
-    Logger::debug("Decoded path: {}", decoded_path);
-    
+    StringUtils::urlDecode(path, len, context.decoded_path);
+    Logger::debug("Decoded path: {}", context.decoded_path);
+
     // STEP 2: Path Traversal Check (SECURITY)
     // Check for path traversal attacks BEFORE other validations
     // This ensures 403 is returned for traversal attempts, not 405
-    if (decoded_path.find("..") != std::string::npos)
+    if (context.decoded_path.find("..") != ArenaString::npos)
     {
         Logger::debug("SECURITY: Path traversal detected, returning 403");
-        return ErrorHandler::get_error_page(403, _config);
+        return 403;
     }
-  
+
     // STEP 3: Find Matching Location
-    const LocationConfig* location_config = _config.findLocation(decoded_path);
-    
-    if (!location_config)
+    context.location = _config.findLocation(context.decoded_path.data(), context.decoded_path.size());
+    if (!context.location)
     {
-        Logger::debug("ERROR: No location matched for path: {}", decoded_path);
-        return ErrorHandler::get_error_page(404, _config);
+        Logger::debug("ERROR: No location matched for path: {}", context.decoded_path);
+        return 404;
     }
-    
-    Logger::debug("Matched location: {}", location_config->path);
-    Logger::debug("Location root: {}", location_config->root);
-    Logger::debug("Allowed methods: [{}]", _formatMethodList(location_config->allow_methods));
-    
+
+    Logger::debug("Matched location: {}", context.location->path);
+    Logger::debug("Location root: {}", context.location->root);
+
+    // The upstream maps the URI itself
+    if (context.location->proxy_pass.empty())
+        _buildFilePath(context.decoded_path, *context.location, context.file_path);
+    return 0;
+}
+
+/**
+ * _resolve() for a request, plus the location's method check
+ * @return 0, or the error status: 403, 404, 405
+ */
+int RequestHandler::_route(const HttpRequest& request, RequestContext& context) const
+{
+    // The getters return copies: take each once
+    const std::string& path = request.getPath();
+    const std::string& method = request.getMethod();
+    Logger::debug("Raw URI: {}", path);
+    Logger::debug("Method: {}", method);
+
+    int status = _resolve(path.data(), path.size(), context);
+    if (status)
+        return status;
+
+    Logger::debug("Allowed methods: [{}]", _formatMethodList(context.location->allow_methods));
+
     // STEP 4: Method Permission Check
-    if (!location_config->isMethodAllowed(method))
+    if (!context.location->isMethodAllowed(method))
     {
-        Logger::debug("ERROR: Method {} not allowed for location {}", 
-                     method, location_config->path);
-        return ErrorHandler::get_error_page(405, _config);
+        Logger::debug("ERROR: Method {} not allowed for location {}",
+                     method, context.location->path);
+        return 405;
     }
-    
+    return 0;
+}
+
+// Synchronous handling of a routed request: redirect, body size, then the method
+HttpResponse RequestHandler::_handleRouted(const HttpRequest& request, RequestContext& context)
+{
+    HttpResponse early;
+    if (_checkLocation(request, *context.location, early))
+        return early;
+    return _dispatchMethod(request, context);
+}
+
+// Location rules that apply before any handler, proxy and CGI included
+bool RequestHandler::_checkLocation(const HttpRequest& request,
+                                    const LocationConfig& location_config,
+                                    HttpResponse& response) const
+{
     // STEP 5: Redirect Rule Check
-    if (location_config->hasRedirect())
+    if (location_config.hasRedirect())
     {
         Logger::debug("REDIRECT: Location has redirect rule");
-        Logger::debug("  Code: {}", location_config->redirect_code);
-        Logger::debug("  URL: {}", location_config->redirect_url);
+        Logger::debug("  Code: {}", location_config.redirect_code);
+        Logger::debug("  URL: {}", location_config.redirect_url);
         
-        return HttpResponse::createRedirectResponse(
-            location_config->redirect_code,
-            location_config->redirect_url
-        );
+        if (location_config.canned_redirect.isFrozen())
+            response = location_config.canned_redirect;
+        else
+            response = HttpResponse::createRedirectResponse(
+                location_config.redirect_code,
+                location_config.redirect_url
+            );
+        return true;
     }
     
     // STEP 6: Request Body Size Check
@@ -130,33 +405,46 @@ HttpResponse RequestHandler::handleRequest(const HttpRequest& request)
     if (request.isChunked())
         content_length = request.getBody().length();
 
-    if (content_length > location_config->client_max_body_size)
+    if (content_length > location_config.client_max_body_size)
     {
         Logger::debug("ERROR: Request body too large");
         Logger::debug("  Size: {} bytes", content_length);
-        Logger::debug("  Limit: {} bytes", location_config->client_max_body_size);
-        return ErrorHandler::get_error_page(413, _config);
+        Logger::debug("  Limit: {} bytes", location_config.client_max_body_size);
+        response = ErrorHandler::get_error_page(413, _config);
+        return true;
     }
-    
+    return false;
+}
+
+HttpResponse RequestHandler::_dispatchMethod(const HttpRequest& request, RequestContext& context)
+{
+    const LocationConfig* location_config = context.location;
+
     // STEP 7: Route to Method Handler
-    Logger::debug("Routing to method handler: {}", method);
+    Logger::debug("Routing to method handler: {}", request.getMethod());
     
-    if (method == "GET" || method == "HEAD")
-        return _handleGet(request, *location_config, decoded_path);
-    else if (method == "POST")
-        return _handlePost(request, *location_config, decoded_path);
-    else if (method == "DELETE")
-        return _handleDelete(request, *location_config, decoded_path);
+    switch (request.getMethodId())
+    {
+        case METHOD_GET:
+        case METHOD_HEAD:
+            return _handleGet(request, context);
+        case METHOD_POST:
+            return _handlePost(request, *location_config);
+        case METHOD_DELETE:
+            return _handleDelete(context);
+        default:
+            break;
+    }
     
     // Method not implemented
-    Logger::debug("ERROR: Method not implemented: {}", method);
+    Logger::debug("ERROR: Method not implemented: {}", request.getMethod());
     return ErrorHandler::get_error_page(501, _config);
 }
 
 // ============================================================================
 // Helper: Format method list for logging
 // ============================================================================
-std::string RequestHandler::_formatMethodList(const std::vector<std::string>& methods)
+std::string RequestHandler::_formatMethodList(const std::vector<std::string>& methods) const
 {
     if (methods.empty())
         return "NONE";
@@ -179,17 +467,14 @@ std::string RequestHandler::_formatMethodList(const std::vector<std::string>& me
  * Handle GET and HEAD requests
  * Checks file/directory, CGI, and serves static content
  */
-HttpResponse RequestHandler::_handleGet(const HttpRequest& request,
-                                        const LocationConfig& location_config,
-                                        const std::string& decoded_path)
+HttpResponse RequestHandler::_handleGet(const HttpRequest& request, RequestContext& context)
 {
-    std::string file_path = _buildFilePath(decoded_path, location_config);
-
-    if (!FileHandler::file_exists(file_path))
+    // One stat() answers both questions
+    if (!context.exists())
         return ErrorHandler::get_error_page(404, _config);
 
     // Directory Auto-Redirect
-    if (FileHandler::is_directory(file_path))
+    if (context.isDirectory())
     {
         // Check if request path ends with /
         std::string uri = request.getPath();
@@ -206,14 +491,14 @@ HttpResponse RequestHandler::_handleGet(const HttpRequest& request,
         }
         
         // With trailing slash, handle directory normally
-        HttpResponse response = _serve_directory(file_path, location_config);
-        if (request.getMethod() == "HEAD")
+        HttpResponse response = _serve_directory(context.file_path.c_str(), *context.location);
+        if (request.getMethodId() == METHOD_HEAD)
             response.setBody("");
         return response;
     }
 
-    HttpResponse response = _serve_file(file_path);
-    if (request.getMethod() == "HEAD")
+    HttpResponse response = _serve_file(context);
+    if (request.getMethodId() == METHOD_HEAD)
         response.setBody("");
 
     return response;
@@ -225,8 +510,7 @@ HttpResponse RequestHandler::_handleGet(const HttpRequest& request,
  * Process: Check for upload -> check file exists -> handle CGI scripts -> or return 405
  */
 HttpResponse RequestHandler::_handlePost(const HttpRequest& request,
-                                         const LocationConfig& location_config,
-                                         const std::string& decoded_path)
+                                         const LocationConfig& location_config)
 {
     Logger::debug("Routing to _handlePost");
     Logger::debug("Method = {}, Path = {}", request.getMethod(), request.getPath());
@@ -239,9 +523,6 @@ HttpResponse RequestHandler::_handlePost(const HttpRequest& request,
         return UploadHandler::handle_upload(request, location_config);
     }
 
-    // Build file path
-    std::string file_path = _buildFilePath(decoded_path, location_config);
-
     // Non-upload, non-CGI POST: Return 200 OK (accepting the POST data)
     // This handles cases like /post_body which just needs to accept POST requests
     HttpResponse response;
@@ -255,23 +536,20 @@ HttpResponse RequestHandler::_handlePost(const HttpRequest& request,
  * Handle DELETE requests
  * Validates file existence, prevents directory deletion, and deletes file
  */
-HttpResponse RequestHandler::_handleDelete(const HttpRequest& request,
-                                           const LocationConfig& location_config,
-                                           const std::string& decoded_path)
+HttpResponse RequestHandler::_handleDelete(RequestContext& context)
 {
-    (void)request;  // Unused but kept for the same interface
-    // Path traversal check is now done in handleRequest() before method validation
-    std::string file_path = _buildFilePath(decoded_path, location_config);
+    // Path traversal check is done by _route() before method validation
+    const ArenaString& file_path = context.file_path;
 
     Logger::debug("Full file path: {}", file_path);
 
-    if (!FileHandler::file_exists(file_path))
+    if (!context.exists())
     {
         Logger::debug("File does not exist, returning 404");
         return ErrorHandler::get_error_page(404, _config);
     }
 
-    if (FileHandler::is_directory(file_path))
+    if (context.isDirectory())
     {
         Logger::debug("Path is a directory, returning 403");
         return ErrorHandler::get_error_page(403, _config);
@@ -311,10 +589,10 @@ HttpResponse RequestHandler::_handleDelete(const HttpRequest& request,
  * 
  * Note: uri_path is expected to already be URL-decoded by handleRequest()
  */
-std::string RequestHandler::_buildFilePath(const std::string& uri_path,
-                                           const LocationConfig& location_config)
+void RequestHandler::_buildFilePath(const ArenaString& uri_path,
+                                    const LocationConfig& location_config,
+                                    ArenaString& final_path) const
 {
-    std::string final_path;
 
     // Print initial information
     Logger::debug("--- Building File Path ---");
@@ -326,66 +604,74 @@ std::string RequestHandler::_buildFilePath(const std::string& uri_path,
     // Prefer alias over root if both are defined
     if (!location_config.alias.empty())
     {
-        std::string relative_path = uri_path;
         const std::string& location_path = location_config.path;
-        
-        if (uri_path.find(location_path) == 0)
+        final_path.assign(location_config.alias.data(), location_config.alias.size());
+
+        if (uri_path.compare(0, location_path.length(), location_path.data(), location_path.length()) == 0)
         {
-            relative_path = uri_path.substr(location_path.length());
-            
-            if (relative_path.empty())
-                relative_path = "/";
-            else if (relative_path[0] != '/')
-                relative_path = "/" + relative_path;
+            // The part after the location replaces it, always starting with '/'
+            size_t rest = location_path.length();
+            if (rest == uri_path.length() || uri_path[rest] != '/')
+                final_path += '/';
+            final_path.append(uri_path, rest, ArenaString::npos);
         }
-        
-        final_path = location_config.alias + relative_path;
-        Logger::debug("Using ALIAS logic. Relative: '{}' -> Final: '{}'", relative_path, final_path);
+        else
+            final_path.append(uri_path);
+        Logger::debug("Using ALIAS logic. Final: '{}'", final_path);
     }
     else
     {
         // Root semantics: append full URI to root
-        final_path = location_config.root + uri_path;
+        final_path.reserve(location_config.root.size() + uri_path.size());
+        final_path.assign(location_config.root.data(), location_config.root.size());
+        final_path.append(uri_path);
         Logger::debug("Using ROOT logic. Final: '{}'", final_path);
     }
 
     Logger::debug("Resulting Path: '{}'", final_path);
     Logger::debug("--------------------------");
-
-    return final_path;
 }
 
 // Check if file is a CGI script based on configured extension
-bool RequestHandler::_isCgiRequest(const std::string& file_path,
+bool RequestHandler::_isCgiRequest(const ArenaString& file_path,
                                    const LocationConfig& location_config) const
 {
-    if (location_config.cgi_extension.empty())
+    const std::string& ext = location_config.cgi_extension;
+    if (ext.empty())
         return false;
 
     size_t ext_pos = file_path.find_last_of('.');
-    if (ext_pos == std::string::npos)
+    if (ext_pos == ArenaString::npos)
         return false;
 
-    std::string ext = file_path.substr(ext_pos);
-    return (ext == location_config.cgi_extension);
+    return file_path.compare(ext_pos, ArenaString::npos, ext.data(), ext.size()) == 0;
+}
+
+// Serve the routed file with the stat() the context already has
+HttpResponse RequestHandler::_serve_file(RequestContext& context)
+{
+    HttpResponse response = FileHandler::serve_file(context.file_path.c_str(), context.fileStat());
+    if (response.getStatus() >= 400)
+        response = ErrorHandler::get_error_page(response.getStatus(), _config);
+    return response;
 }
 
 // Serve static file
-HttpResponse RequestHandler::_serve_file(const std::string& file_path)
+HttpResponse RequestHandler::_serve_file(const char* file_path)
 {
     HttpResponse response = FileHandler::serve_file(file_path);
     if (response.getStatus() >= 400)
-        return ErrorHandler::get_error_page(response.getStatus(), _config);
-    return response;
+        response = ErrorHandler::get_error_page(response.getStatus(), _config);
+    return response;    // Single return: the response is built in place, not copied
 }
 
 // Serve directory (index file or autoindex)
-HttpResponse RequestHandler::_serve_directory(const std::string& dir_path,
+HttpResponse RequestHandler::_serve_directory(const char* dir_path,
                                               const LocationConfig& location_config)
 {
     HttpResponse response = FileHandler::serve_directory(dir_path, location_config);
     if (response.getStatus() >= 400)
-        return ErrorHandler::get_error_page(response.getStatus(), _config);
+        response = ErrorHandler::get_error_page(response.getStatus(), _config);
     return response;
 }
 
@@ -5,12 +5,16 @@
 #include "UploadHandler.hpp"
 #include "CgiRequestHandler.hpp"
 #include "ErrorHandler.hpp"
+#include "RequestContext.hpp"
+#include "cgi/CgiCache.hpp"
+#include "cgi/CgiLimiter.hpp"
 #include "server/Client.hpp"
 #include "http/HttpRequest.hpp"
 #include "http/HttpResponse.hpp"
 #include "config/ConfigParser.hpp"
 #include "utils/Logger.hpp"
 #include "utils/StringUtils.hpp"
+#include "utils/Arena.hpp"
 
 #include <string>
 
@@ -33,8 +37,18 @@ private:
     // Server configuration reference
     const ServerConfig& _config;
 
+    // Shared CGI response cache and concurrency limiter (owned by Server, may be NULL)
+    CgiCache* _cgi_cache;
+    CgiLimiter* _cgi_limiter;
+
+    // Memory of request-scoped strings: the client's arena when there is a
+    // client, else one of our own
+    Arena _local_arena;
+    Arena* _arena;
+
 public:
-    explicit RequestHandler(const ServerConfig& config);
+    explicit RequestHandler(const ServerConfig& config, CgiCache* cgi_cache = NULL,
+                            CgiLimiter* cgi_limiter = NULL);
     ~RequestHandler();
 
     /**
@@ -51,7 +65,75 @@ public:
      */
     HttpResponse handleRequest(Client& client);
 
+    /**
+     * Entry point for HTTP/2 streams, which are answered synchronously
+     * Locations needing an async handler (CGI, FastCGI, proxy_pass) get
+     * 421 Misdirected Request, so clients retry them over HTTP/1.1
+     * @param request Parsed HTTP request
+     * @return HttpResponse generated for the request
+     */
+    HttpResponse handleStreamRequest(const HttpRequest& request);
+
+    // true if the request can be answered without CGI, FastCGI or proxy_pass
+    bool canHandleInStream(const HttpRequest& request) const;
+
+    /**
+     * Serve the file a CGI script delegated with X-Accel-Redirect
+     * The URI is mapped through the locations like a GET, without method checks.
+     * Targets handled by CGI, FastCGI or proxy_pass get 403, never their source
+     * @param uri Internal URI (query string ignored)
+     * @return HttpResponse with the static file, or an error page
+     */
+    HttpResponse serveInternalRedirect(const std::string& uri);
+
+    /**
+     * Serve the file a CGI script delegated with X-Sendfile
+     * @param path Filesystem path; must lie under the server or a location root/alias
+     * @return HttpResponse with the static file, or an error page
+     */
+    HttpResponse serveSendfile(const std::string& path);
+
 private:
+    // ========================================
+    // Routing
+    // ========================================
+
+    /**
+     * Decode a path, match its location and build its file path
+     * @param path Raw URI path (no query string)
+     * @param len Length of path
+     * @param context Filled with the routing result
+     * @return 0, or the error status: 403 (path traversal), 404 (no location)
+     */
+    int _resolve(const char* path, size_t len, RequestContext& context) const;
+
+    /**
+     * Route a request once: _resolve() plus the location's method check
+     * @return 0, or the error status: 403, 404, 405
+     */
+    int _route(const HttpRequest& request, RequestContext& context) const;
+
+    // true unless the routed location needs CGI, FastCGI or proxy_pass
+    bool _isStreamable(const RequestContext& context) const;
+
+    /**
+     * Synchronous handling of a routed request
+     * Redirect, body size limit, then the method handler
+     */
+    HttpResponse _handleRouted(const HttpRequest& request, RequestContext& context);
+
+    /**
+     * Apply the location's return redirect and client_max_body_size
+     * Runs before every handler, proxy_pass and CGI included
+     * @param response Filled with the redirect or 413 response
+     * @return true if the request is already answered
+     */
+    bool _checkLocation(const HttpRequest& request, const LocationConfig& location_config,
+                        HttpResponse& response) const;
+
+    // Hand a checked request to its method handler
+    HttpResponse _dispatchMethod(const HttpRequest& request, RequestContext& context);
+
     // ========================================
     // HTTP Method Handlers
     // ========================================
@@ -59,35 +141,26 @@ private:
     /**
      * Handle GET requests
      * @param request HTTP request
-     * @param location_config Location-specific configuration
-     * @param decoded_path URL-decoded path from request
+     * @param context Routing result of the request
      * @return HttpResponse for GET request
      */
-    HttpResponse _handleGet(const HttpRequest& request,
-                            const LocationConfig& location_config,
-                            const std::string& decoded_path);
+    HttpResponse _handleGet(const HttpRequest& request, RequestContext& context);
 
     /**
      * Handle POST requests
      * @param request HTTP request
      * @param location_config Location-specific configuration
-     * @param decoded_path URL-decoded path from request
      * @return HttpResponse for POST request
      */
     HttpResponse _handlePost(const HttpRequest& request,
-                             const LocationConfig& location_config,
-                             const std::string& decoded_path);
+                             const LocationConfig& location_config);
 
     /**
      * Handle DELETE requests
-     * @param request HTTP request
-     * @param location_config Location-specific configuration
-     * @param decoded_path URL-decoded path from request
+     * @param context Routing result of the request
      * @return HttpResponse for DELETE request
      */
-    HttpResponse _handleDelete(const HttpRequest& request,
-                               const LocationConfig& location_config,
-                               const std::string& decoded_path);
+    HttpResponse _handleDelete(RequestContext& context);
 
 
     // ===== Helper Functions =====
@@ -97,13 +170,14 @@ private:
      * Note: uri_path should already be URL-decoded before calling this function
      * @param uri_path Decoded URI from HTTP request
      * @param location_config Location configuration
-     * @return Full filesystem path
+     * @param final_path Receives the full filesystem path
      */
-    std::string _buildFilePath(const std::string& uri_path,
-                               const LocationConfig& location_config);
+    void _buildFilePath(const ArenaString& uri_path,
+                        const LocationConfig& location_config,
+                        ArenaString& final_path) const;
 
     // Format method list for logging
-    std::string _formatMethodList(const std::vector<std::string>& methods);
+    std::string _formatMethodList(const std::vector<std::string>& methods) const;
     
     /**
      * Check if the given path corresponds to a CGI script
@@ -111,14 +185,50 @@ private:
      * @param location_config Location configuration
      * @return true if the file should be handled via CGI
      */
-    bool _isCgiRequest(const std::string& file_path, const LocationConfig& location_config) const;
+    bool _isCgiRequest(const ArenaString& file_path, const LocationConfig& location_config) const;
+
+    /**
+     * Answer a cacheable CGI GET from the cache, or queue it behind an identical run
+     * @param client The client object (state set to CLIENT_CGI_PROCESSING when queued)
+     * @param location_config Location configuration with cgi_cache settings
+     * @param response Filled with the cached response on a hit
+     * @return true if no CGI run must be started for this request
+     */
+    bool _checkCgiCache(Client& client, const LocationConfig& location_config,
+                        HttpResponse& response);
+
+    /**
+     * Apply the location's cgi_max_concurrent / cgi_queue limits
+     * @param client The client object (state set to CLIENT_CGI_QUEUED when queued)
+     * @param file_path Script to run once the client gets a slot
+     * @param location_config Location configuration
+     * @param response Filled with the 503 response when the queue is full
+     * @return true if the CGI may start now
+     */
+    bool _admitCgi(Client& client, const ArenaString& file_path,
+                   const LocationConfig& location_config, HttpResponse& response);
+
+    // Start the CGI; a start failure is answered with 500
+    HttpResponse _startCgi(Client& client, const ArenaString& file_path,
+                           const LocationConfig& location_config);
+
+    /**
+     * Encode the request for a proxy_pass upstream
+     * The client enters CLIENT_PROXYING; the Server connects and relays
+     * @param context Routing result; its decoded path is what the location matched
+     * @return Placeholder response
+     */
+    HttpResponse _startProxy(Client& client, const RequestContext& context);
 
     /**
      * Serve a static file
      * @param file_path Filesystem path to file
      * @return HttpResponse with file content or error
      */
-    HttpResponse _serve_file(const std::string& file_path);
+    HttpResponse _serve_file(const char* file_path);
+
+    // Serve the routed file, reusing the context's stat()
+    HttpResponse _serve_file(RequestContext& context);
 
     /**
      * Serve directory content
@@ -126,7 +236,7 @@ private:
      * @param location_config Location configuration
      * @return HttpResponse with directory listing or index file
      */
-    HttpResponse _serve_directory(const std::string& dir_path,
+    HttpResponse _serve_directory(const char* dir_path,
                                    const LocationConfig& location_config);
 };
 
@@ -1,6 +1,7 @@
 #include "UploadHandler.hpp"
 #include "FileHandler.hpp"
 #include "utils/StringUtils.hpp"
+#include "utils/ByteScan.hpp"
 #include "utils/Logger.hpp"
 #include <sys/stat.h>
 #include <fstream>
@@ -8,6 +9,12 @@
 
 namespace wsv {
 
+// Multipart markers are searched a vector block at a time (the body can be large)
+static size_t find_marker(const std::string& body, const std::string& marker, size_t from = 0)
+{
+    return ByteScan::find(body.data(), body.size(), marker.data(), marker.size(), from);
+}
+
 /**
  * Main upload handler - orchestrates the upload process
  */
@@ -42,11 +49,12 @@ HttpResponse UploadHandler::handle_upload(const HttpRequest& request,
         save_path += "/";
     save_path += filename;
     
-    // Step 6: Extract file content
-    std::string file_content = _extract_file_content(request);
+    // Step 6: Locate file content (a range of the body, not a copy)
+    size_t content_length = 0;
+    const char* file_content = _extract_file_content(request, content_length);
     
     // Step 7: Save file to disk
-    HttpResponse save_result = _save_file(save_path, file_content);
+    HttpResponse save_result = _save_file(save_path, file_content, content_length);
     if (save_result.getStatus() != 200) {
         return save_result;
     }
@@ -104,8 +112,8 @@ HttpResponse UploadHandler::_validate_filename(const std::string& filename)
  */
 std::string UploadHandler::_extract_filename(const HttpRequest& request)
 {
-    std::string body = request.getBody();
-    std::string content_type = request.hasHeader("Content-Type") ? request.getHeader("Content-Type") : "";
+    const std::string& body = request.getBody();
+    std::string content_type = request.getHeader(HEADER_CONTENT_TYPE);
     std::string boundary = _extract_boundary(content_type);
 
     if (boundary.empty())
@@ -128,22 +136,24 @@ std::string UploadHandler::_extract_filename(const HttpRequest& request)
     }
 
     std::string part_boundary = "--" + boundary;
-    size_t pos = body.find(part_boundary);
+    static const std::string disposition = "Content-Disposition:";
+    size_t pos = find_marker(body, part_boundary);
 
     while (pos != std::string::npos)
     {
-        size_t next_pos = body.find(part_boundary, pos + part_boundary.length());
-        std::string part = body.substr(pos, next_pos - pos);
+        size_t next_pos = find_marker(body, part_boundary, pos + part_boundary.length());
+        size_t part_end = (next_pos == std::string::npos) ? body.size() : next_pos;
 
-        size_t disp_pos = part.find("Content-Disposition:");
+        // Looked up in place: the part holds the whole file
+        size_t disp_pos = ByteScan::find(body.data(), part_end, disposition.data(), disposition.size(), pos);
         if (disp_pos != std::string::npos)
         {
-            size_t end = part.find("\r\n", disp_pos);
-            if (end == std::string::npos)
-                end = part.find("\n", disp_pos);
-            if (end != std::string::npos)
+            size_t end = body.find('\n', disp_pos);
+            if (end != std::string::npos && end < part_end)
             {
-                std::string filename = _extract_multipart_filename(part.substr(disp_pos, end - disp_pos));
+                if (body[end - 1] == '\r')
+                    --end;
+                std::string filename = _extract_multipart_filename(body.substr(disp_pos, end - disp_pos));
                 if (!filename.empty())
                 {
                     Logger::debug("Successfully extracted filename from part: '" + filename + "'");
@@ -153,7 +163,7 @@ std::string UploadHandler::_extract_filename(const HttpRequest& request)
         }
         pos = next_pos;
         if (pos != std::string::npos && pos + part_boundary.length() + 2 <= body.length() && 
-            body.substr(pos + part_boundary.length(), 2) == "--")
+            body.compare(pos + part_boundary.length(), 2, "--") == 0)
             break; // End boundary
     }
 
@@ -239,22 +249,23 @@ std::string UploadHandler::_sanitize_filename(const std::string& filename)
 /**
  * Extract file content from request body
  */
-std::string UploadHandler::_extract_file_content(const HttpRequest& request)
+const char* UploadHandler::_extract_file_content(const HttpRequest& request, size_t& length)
 {
-    std::string content = request.getBody();
+    const std::string& content = request.getBody();
+    length = content.size();
     
-    if (!request.hasHeader("Content-Type"))
-        return content;  // Handles raw binary uploads
+    if (!request.hasHeader(HEADER_CONTENT_TYPE))
+        return content.data();  // Handles raw binary uploads
     
-    std::string content_type = request.getHeader("Content-Type");
+    std::string content_type = request.getHeader(HEADER_CONTENT_TYPE);
     if (content_type.find("multipart/form-data") == std::string::npos)
-        return content;  // Handles other content types (octet-streaming, etc.)
+        return content.data();  // Handles other content types (octet-streaming, etc.)
     
     std::string boundary = _extract_boundary(content_type);
     if (boundary.empty())
-        return content;
+        return content.data();
     
-    return _extract_multipart_content(content, boundary);  // Only for multipart
+    return _extract_multipart_content(content, boundary, length);  // Only for multipart
 }
 
 /**
@@ -278,22 +289,23 @@ std::string UploadHandler::_extract_boundary(const std::string& content_type)
 /**
  * Extract multipart content using boundary
  */
-std::string UploadHandler::_extract_multipart_content(const std::string& body,
-                                                      const std::string& boundary)
+const char* UploadHandler::_extract_multipart_content(const std::string& body,
+                                                      const std::string& boundary,
+                                                      size_t& length)
 {
     Logger::debug("=== extractMultipartContent ===");
     Logger::debug("Boundary: " + boundary);
     Logger::debug("Body size: " + StringUtils::toString(body.size()) + " bytes");
     
     std::string part_boundary = "--" + boundary;
-    size_t pos = body.find(part_boundary);
+    size_t pos = find_marker(body, part_boundary);
 
     while (pos != std::string::npos)
     {
-        size_t next_pos = body.find(part_boundary, pos + part_boundary.length());
+        size_t next_pos = find_marker(body, part_boundary, pos + part_boundary.length());
         
         // Headers of this part end at \r\n\r\n
-        size_t header_end = body.find("\r\n\r\n", pos);
+        size_t header_end = find_marker(body, "\r\n\r\n", pos);
         if (header_end != std::string::npos && (next_pos == std::string::npos || header_end < next_pos))
         {
             // Check if this part has a filename
@@ -316,7 +328,8 @@ std::string UploadHandler::_extract_multipart_content(const std::string& body,
 
                 Logger::debug("Found file part. Content starts at " + StringUtils::toString(content_start) +
                              ", ends at " + StringUtils::toString(content_end));
-                return body.substr(content_start, content_end - content_start);
+                length = content_end - content_start;
+                return body.data() + content_start;
             }
         }
 
@@ -327,14 +340,15 @@ std::string UploadHandler::_extract_multipart_content(const std::string& body,
     }
 
     Logger::warning("Could not find a part with filename in multipart body");
-    return "";
+    length = 0;
+    return body.data();
 }
 
 /**
  * Save file content to disk
  */
 HttpResponse UploadHandler::_save_file(const std::string& file_path,
-                                       const std::string& content)
+                                       const char* content, size_t length)
 {
     std::ofstream output(file_path.c_str(), std::ios::binary);
     if (!output.is_open())
@@ -346,7 +360,7 @@ HttpResponse UploadHandler::_save_file(const std::string& file_path,
         return response;
     }
     
-    output.write(content.c_str(), content.size());
+    output.write(content, length);
 
     // Check if write operation succeeded
     if (output.fail())
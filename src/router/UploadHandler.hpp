@@ -68,20 +68,23 @@ private:
     static std::string _sanitize_filename(const std::string& filename);
 
     /**
-     * Extract raw file content from HTTP request body
+     * Locate raw file content inside the HTTP request body
      * @param request HTTP request
-     * @return File content as string
+     * @param length Set to the content size
+     * @return Start of the content in the request body (not a copy)
      */
-    static std::string _extract_file_content(const HttpRequest& request);
+    static const char* _extract_file_content(const HttpRequest& request, size_t& length);
 
     /**
-     * Extract file content from multipart body using boundary
+     * Locate file content in a multipart body using boundary
      * @param body Full request body
      * @param boundary Multipart boundary string
-     * @return File content as string
+     * @param length Set to the content size, 0 if no file part
+     * @return Start of the content in body (not a copy)
      */
-    static std::string _extract_multipart_content(const std::string& body,
-                                                  const std::string& boundary);
+    static const char* _extract_multipart_content(const std::string& body,
+                                                  const std::string& boundary,
+                                                  size_t& length);
 
     /**
      * Extract multipart boundary from Content-Type header
@@ -94,10 +97,11 @@ private:
      * Save file content to server filesystem
      * @param file_path Full filesystem path
      * @param content File content to save
+     * @param length Content size in bytes
      * @return HttpResponse indicating success or failure
      */
     static HttpResponse _save_file(const std::string& file_path,
-                                   const std::string& content);
+                                   const char* content, size_t length);
 
     /**
      * Create HttpResponse indicating successful upload
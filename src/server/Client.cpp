@@ -1,7 +1,20 @@
 #include "Client.hpp"
+#include <utility>
 
 namespace wsv {
 
+// Exchanges of compacted connections, kept for the next active one
+static const size_t EXCHANGE_POOL_MAX = 128;
+
+struct ExchangePool
+{
+	std::vector<Client::Exchange*>	free;
+
+	~ExchangePool();
+};
+
+static ExchangePool	g_exchange_pool;
+
 Client::Client()
 	: client_fd(-1),
 	state(CLIENT_READING_REQUEST),
@@ -12,7 +25,29 @@ Client::Client()
 	cgi_handler(NULL),
 	cgi_input_fd(-1),
 	cgi_output_fd(-1),
-	cgi_write_offset(0)
+	cgi_write_offset(0),
+	cgi_pid_fd(-1),
+	cgi_output_done(false),
+	cgi_cache_ttl(0),
+	cgi_cache_waiting(false),
+	cgi_location(NULL),
+	cgi_slot_held(false),
+	cgi_stream_checked(false),
+	cgi_streaming(false),
+	cgi_stream_remaining(0),
+	proxy_location(NULL),
+	proxy_fd(-1),
+	proxy_write_offset(0),
+	proxy_connected(false),
+	proxy_reused(false),
+	proxy_received(false),
+	proxy_chunked(false),
+	proxy_paused(false),
+	proxy_peer(-1),
+	proxy_tries(0),
+	h2(NULL),
+	h2_checked(false),
+	tls(NULL)
 { }
 
 Client::Client(int fd, sockaddr_in addr, const ServerConfig* config)
@@ -26,7 +61,29 @@ Client::Client(int fd, sockaddr_in addr, const ServerConfig* config)
 	cgi_handler(NULL),
 	cgi_input_fd(-1),
 	cgi_output_fd(-1),
-	cgi_write_offset(0)
+	cgi_write_offset(0),
+	cgi_pid_fd(-1),
+	cgi_output_done(false),
+	cgi_cache_ttl(0),
+	cgi_cache_waiting(false),
+	cgi_location(NULL),
+	cgi_slot_held(false),
+	cgi_stream_checked(false),
+	cgi_streaming(false),
+	cgi_stream_remaining(0),
+	proxy_location(NULL),
+	proxy_fd(-1),
+	proxy_write_offset(0),
+	proxy_connected(false),
+	proxy_reused(false),
+	proxy_received(false),
+	proxy_chunked(false),
+	proxy_paused(false),
+	proxy_peer(-1),
+	proxy_tries(0),
+	h2(NULL),
+	h2_checked(false),
+	tls(NULL)
 { }
 
 Client::~Client()
@@ -36,6 +93,17 @@ Client::~Client()
 		delete cgi_handler;
 		cgi_handler = NULL;
 	}
+	if (h2)
+	{
+		delete h2;
+		h2 = NULL;
+	}
+	if (tls)
+	{
+		delete tls;
+		tls = NULL;
+	}
+	compact();
 }
 
 void Client::updateActivity()
@@ -49,4 +117,58 @@ long Client::getIdleTime() const
 	return static_cast<long>(std::difftime(now, last_activity));
 }
 
+Client::Exchange& Client::_active()
+{
+	if (!_exchange.ptr)
+	{
+		if (g_exchange_pool.free.empty())
+			_exchange.ptr = new Exchange();
+		else
+		{
+			_exchange.ptr = g_exchange_pool.free.back();
+			g_exchange_pool.free.pop_back();
+		}
+	}
+	return *_exchange.ptr;
+}
+
+const HttpRequest& Client::request() const
+{
+	static const HttpRequest empty;
+	return _exchange.ptr ? _exchange.ptr->request : empty;
+}
+
+void Client::compact()
+{
+	if (_exchange.ptr)
+	{
+		// Pooled exchanges keep no per-request memory: the receive slab goes
+		// back to its own pool, the arena keeps at most one block
+		_exchange.ptr->request.reset();
+		_exchange.ptr->arena.reset();
+		_exchange.ptr->proxy_parser = HttpProxy::ResponseParser();
+		if (g_exchange_pool.free.size() < EXCHANGE_POOL_MAX)
+			g_exchange_pool.free.push_back(_exchange.ptr);
+		else
+			delete _exchange.ptr;
+		_exchange.ptr = NULL;
+	}
+	std::string().swap(response_buffer);
+	std::string().swap(cgi_cache_key);
+	std::string().swap(cgi_script_path);
+	std::string().swap(proxy_request);
+}
+
+size_t Client::idleFootprint()
+{
+	// Red-black tree node of Server::_clients: colour and three links, then the pair
+	return 4 * sizeof(void*) + sizeof(std::pair<const int, Client>);
+}
+
+ExchangePool::~ExchangePool()
+{
+	for (size_t i = 0; i < free.size(); ++i)
+		delete free[i];
+}
+
 } // namespace wsv
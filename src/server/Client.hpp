@@ -8,6 +8,11 @@
 #include "ConfigParser.hpp"
 #include "http/HttpRequest.hpp"
 #include "cgi/CgiHandler.hpp"
+#include "http/HttpProxy.hpp"
+#include "http/Http2.hpp"
+#include "Tls.hpp"
+#include "utils/Arena.hpp"
+#include "utils/ByteScan.hpp"
 
 namespace wsv {
 
@@ -15,20 +20,21 @@ enum ClientState
 {
 	CLIENT_READING_REQUEST,
 	CLIENT_PROCESSING,
+	CLIENT_CGI_QUEUED,
 	CLIENT_CGI_PROCESSING,
+	CLIENT_PROXYING,			// Waiting for the upstream response head
 	CLIENT_WRITING_RESPONSE
 };
 
+struct ExchangePool;
+
 class Client
 {
 public:
 	int			client_fd;
 	sockaddr_in	address;
-	std::string	request_buffer;
 	std::string response_buffer;
 
-	HttpRequest request;
-
 	ClientState	state;
 	const ServerConfig* config; // Associated server config for this connection
 
@@ -42,6 +48,45 @@ public:
 	int cgi_input_fd;			// Pipe to write request body to CGI stdin
 	int cgi_output_fd;			// Pipe to read response from CGI stdout
 	size_t cgi_write_offset;	// Track write progress for large POST bodies
+	int cgi_pid_fd;				// pidfd of the CGI child (owned by cgi_handler)
+	bool cgi_output_done;		// CGI stdout reached EOF
+
+	// CGI cache (cgi_cache locations)
+	std::string cgi_cache_key;	// Key this client leads or waits on; empty if not cached
+	int cgi_cache_ttl;			// TTL granted to the leader's response
+	bool cgi_cache_waiting;		// Waiting on another client's CGI run
+
+	// CGI concurrency limit (cgi_max_concurrent locations)
+	const LocationConfig* cgi_location;	// Location whose slot is held or awaited
+	std::string cgi_script_path;		// Script to start once a queued client gets a slot
+	bool cgi_slot_held;					// Counts against cgi_max_concurrent
+
+	// Zero-copy relay of CGI stdout (responses with Content-Length)
+	bool cgi_stream_checked;		// Header block already examined for streaming
+	ByteScan::LineScan cgi_header_scan;	// Progress of the header block scan
+	bool cgi_streaming;				// Body is spliced from the stdout pipe to the socket
+	size_t cgi_stream_remaining;	// Body bytes still to relay
+
+	// Reverse proxy (proxy_pass locations); the body keeps streaming while writing
+	const LocationConfig* proxy_location;
+	int proxy_fd;					// Upstream connection, -1 if none
+	std::string proxy_request;		// Encoded request for the upstream
+	size_t proxy_write_offset;
+	bool proxy_connected;			// Non-blocking connect completed
+	bool proxy_reused;				// Connection came from the pool
+	bool proxy_received;			// Upstream answered at least one byte
+	bool proxy_chunked;				// Body re-chunked towards the client
+	bool proxy_paused;				// Upstream reads stopped: client buffer full
+	int proxy_peer;					// Peer of the location's upstream block in use, -1 if none
+	int proxy_tries;				// Peers tried for the current request
+	std::vector<bool> proxy_tried;	// Peer index -> already tried for the current request
+
+	// HTTP/2 (prior knowledge or h2c upgrade); requests then arrive as streams
+	Http2Connection* h2;			// Managed pointer, NULL while speaking HTTP/1.x
+	bool h2_checked;				// Connection start examined for the client preface
+
+	// TLS (`listen ... ssl`); all socket reads and writes go through it
+	TlsConnection* tls;				// Managed pointer, NULL on cleartext listeners
 
 public:
 	Client();
@@ -53,6 +98,47 @@ public:
 
 	// Get elapsed time since last activity in seconds
 	long getIdleTime() const;
+
+	// Request-scoped state: taken from a pool when first used, given back by
+	// compact() while the connection waits for its next request
+	HttpRequest& request() { return _active().request; }
+	const HttpRequest& request() const;					// An empty request while compact
+	Arena& arena() { return _active().arena; }			// Reset when the next request starts
+	HttpProxy::ResponseParser& proxyParser() { return _active().proxy_parser; }
+
+	// Idle keep-alive connection: release the request state and the capacity
+	// of the response and CGI/proxy strings, leaving only the connection record
+	void compact();
+	bool isCompact() const { return _exchange.ptr == NULL; }
+
+	// Bytes an idle cleartext connection costs the server (record and map node)
+	static size_t idleFootprint();
+
+private:
+	friend struct ExchangePool;
+
+	struct Exchange
+	{
+		HttpRequest request;
+		Arena arena;
+		HttpProxy::ResponseParser proxy_parser;
+	};
+
+	// Owner of the exchange. Server::_clients copies a Client when it is
+	// inserted: a copy starts compact and an assignment keeps its own
+	// exchange, so two Clients never share (and free) the same one.
+	struct ExchangeSlot
+	{
+		Exchange* ptr;			// NULL while compact
+
+		ExchangeSlot() : ptr(NULL) {}
+		ExchangeSlot(const ExchangeSlot&) : ptr(NULL) {}
+		ExchangeSlot& operator=(const ExchangeSlot&) { return *this; }
+	};
+
+	ExchangeSlot _exchange;
+
+	Exchange& _active();
 };
 
 } // namespace wsv
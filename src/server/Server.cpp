@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <sstream>
+#include <cstring>
 #include <sys/wait.h>
 
 namespace wsv
@@ -53,6 +54,22 @@ void Server::cleanup()
 	}
 	_listen_fds.clear();
 
+	for (std::map<int, TlsContext*>::iterator it = _tls_contexts.begin(); it != _tls_contexts.end(); ++it)
+		delete it->second;
+	_tls_contexts.clear();
+
+	// Close upstream connections still serving a request
+	for (std::map<int, int>::iterator it = _proxy_fd_map.begin(); it != _proxy_fd_map.end(); ++it)
+		close(it->first);
+	_proxy_fd_map.clear();
+	for (std::map<int, std::pair<std::string, int> >::iterator it = _probe_fd_map.begin();
+		 it != _probe_fd_map.end(); ++it)
+		close(it->first);
+	_probe_fd_map.clear();
+
+	// Close idle FastCGI worker and proxy connections
+	_upstream_pool.closeAll();
+
 	// Close epoll file descriptor
 	if (_epoll_fd >= 0)
 	{
@@ -77,15 +94,20 @@ void Server::start()
 {
 	_init_listening_sockets();
 	_init_epoll();
+	_init_cgi_cgroups();
+	_init_upstreams();
 
 	struct epoll_event events[MAX_EVENTS];
 
 	Logger::info("Server started. Press Ctrl+C to stop.");
+	Logger::info("Idle keep-alive connection: {} bytes (TLS adds its session state)", Client::idleFootprint());
 
 	while (!_shutdown_requested)
 	{
 		// Check for client timeouts periodically
 		_check_client_timeouts();
+		_run_health_checks();
+		CgiHandler::reapOrphans();
 
 		int nfds = epoll_wait(_epoll_fd, events, MAX_EVENTS, EPOLL_TIMEOUT);
 		if (nfds < 0)
@@ -99,6 +121,8 @@ void Server::start()
 			Logger::error("epoll_wait error");
 			break;
 		}
+		// One Date string per second, shared by every response of this batch
+		HttpResponse::updateDate(std::time(NULL));
 
 		for (int i = 0; i < nfds; i++)
 		{
@@ -109,8 +133,31 @@ void Server::start()
 				_handle_new_connection(current_fd);
 			else if (_cgi_fd_map.find(current_fd) != _cgi_fd_map.end())
 				_handle_cgi_data(current_fd, events_flag);
-			else
+			else if (_proxy_fd_map.find(current_fd) != _proxy_fd_map.end())
+				_handle_proxy_data(current_fd, events_flag);
+			else if (_probe_fd_map.find(current_fd) != _probe_fd_map.end())
+				_handle_probe_data(current_fd, events_flag);
+			// Events for CGI FDs released earlier in this batch are stale
+			else if (_clients.find(current_fd) != _clients.end())
 			{
+				if (_clients[current_fd].state == CLIENT_CGI_QUEUED)
+				{
+					if (events_flag & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+					{
+						Logger::info("Queued client {} disconnected.", current_fd);
+						_close_client(current_fd);
+					}
+					continue;
+				}
+				// A streaming client may be parked with no events while the script works
+				// (as is a proxied client while the upstream answers)
+				if ((_clients[current_fd].cgi_streaming || _clients[current_fd].proxy_fd != -1)
+					&& (events_flag & (EPOLLHUP | EPOLLERR)))
+				{
+					Logger::info("Client {} disconnected during CGI stream or proxying.", current_fd);
+					_close_client(current_fd);
+					continue;
+				}
 				// Read first, then handle Write
 				if (events_flag & EPOLLIN)
 					_handle_client_data(current_fd);
@@ -136,7 +183,10 @@ void Server::_init_listening_sockets()
 		const ServerConfig& conf = configs[i];
 		int fd = _create_listening_socket(conf.host, conf.listen_port);
 		_listen_fds[fd] = conf;
-		Logger::info("Server is listening on {}:{} ...", conf.host, conf.listen_port);
+		ErrorHandler::prepare(_listen_fds[fd]);
+		if (conf.ssl)
+			_tls_contexts[fd] = new TlsContext(conf);
+		Logger::info("Server is listening on {}:{}{} ...", conf.host, conf.listen_port, conf.ssl ? " (ssl)" : "");
 	}
 }
 
@@ -219,6 +269,61 @@ void Server::_init_epoll()
 	}
 }
 
+/*
+	Create the cgroup v2 directories of cgi_cgroup locations and write their limits
+*/
+void Server::_init_cgi_cgroups()
+{
+	const std::vector<ServerConfig>& servers = _config.getServers();
+	for (size_t i = 0; i < servers.size(); ++i)
+	{
+		for (size_t j = 0; j < servers[i].locations.size(); ++j)
+		{
+			const LocationConfig& location = servers[i].locations[j];
+			if (location.cgi_cgroup.empty())
+				continue;
+			if (!CgiHandler::prepareCgroup(location.cgi_cgroup, location.cgi_cgroup_cpu_max,
+										   location.cgi_cgroup_memory_max))
+				throw std::runtime_error("Cannot set up cgroup " + location.cgi_cgroup);
+			Logger::info("CGI cgroup {} ready for location {}", location.cgi_cgroup, location.path);
+		}
+	}
+}
+
+/*
+	One balancer per `upstream` block; proxy_pass locations refer to them by name.
+	Every upstream name is resolved here, so the event loop only refreshes them in the background.
+*/
+void Server::_init_upstreams()
+{
+	const std::vector<UpstreamConfig>& upstreams = _config.getUpstreams();
+	for (size_t i = 0; i < upstreams.size(); ++i)
+	{
+		_upstream_groups[upstreams[i].name] = UpstreamGroup(upstreams[i]);
+		Logger::info("Upstream {}: {} servers, {}", upstreams[i].name,
+					 upstreams[i].peers.size(), upstreams[i].policy);
+		for (size_t j = 0; j < upstreams[i].peers.size(); ++j)
+			_resolve_upstream(upstreams[i].peers[j].host, upstreams[i].peers[j].port);
+	}
+
+	const std::vector<ServerConfig>& servers = _config.getServers();
+	for (size_t i = 0; i < servers.size(); ++i)
+	{
+		for (size_t j = 0; j < servers[i].locations.size(); ++j)
+		{
+			const LocationConfig& location = servers[i].locations[j];
+			if (!location.proxy_pass.empty() && location.proxy_upstream.empty())
+				_resolve_upstream(location.proxy_host, location.proxy_port);
+		}
+	}
+}
+
+void Server::_resolve_upstream(const std::string& host, int port)
+{
+	if (!HttpProxy::resolve(host, port))
+		Logger::error("Cannot resolve upstream {}:{} yet, retrying in the background", host, port);
+}
+
 void Server::_add_to_epoll(int fd, uint32_t events)
 {
 	struct epoll_event event;
@@ -271,8 +376,18 @@ void Server::_handle_new_connection(int listen_fd)
 
 	// Get the ServerConfig for this listening port
 	const ServerConfig* config = &_listen_fds[listen_fd];
-	Client client = Client(client_fd, client_addr, config);
-	_clients.insert(std::make_pair(client_fd, client));
+	_clients.insert(std::make_pair(client_fd, Client(client_fd, client_addr, config)));
+
+	// TLS listener: the handshake runs on the first readiness events
+	std::map<int, TlsContext*>::iterator tls = _tls_contexts.find(listen_fd);
+	if (tls != _tls_contexts.end())
+	{
+		_clients[client_fd].tls = new TlsConnection(*tls->second, client_fd);
+		// Handshake flights, tickets and 0.5-RTT data are separate small
+		// writes: Nagle would hold each behind the peer's delayed ACK
+		int nodelay = 1;
+		setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+	}
 
 	_add_to_epoll(client_fd, EPOLLIN);
 	Logger::info("New connection accepted on fd {}. Client socket fd: {}", listen_fd, client_fd);
@@ -281,19 +396,49 @@ void Server::_handle_new_connection(int listen_fd)
 // Client - Read
 void Server::_handle_client_data(int client_fd)
 {
-	char buffer[READ_BUFFER_SIZE];
-	ssize_t bytes_read = read(client_fd, buffer, sizeof(buffer));
 	Client& client = _clients[client_fd];
 
+	if (client.tls && !client.tls->isEstablished())
+	{
+		_handle_tls_handshake(client_fd);
+		return;
+	}
+
+	// HTTP/1.x reads straight into the request's receive buffer
+	char buffer[READ_BUFFER_SIZE];
+	ssize_t bytes_read;
+	if (client.h2)
+		bytes_read = _client_recv(client, buffer, sizeof(buffer));
+	else
+		bytes_read = _client_recv(client, client.request().input());
+
 	if (bytes_read > 0)
 	{
 		// Update client activity timestamp
 		client.updateActivity();
 
-		client.request_buffer.append(buffer, bytes_read);
-		client.request.parse(buffer, bytes_read);
+		if (client.h2)
+		{
+			_handle_h2_data(client_fd, buffer, bytes_read);
+			return;
+		}
 
-		if (client.request.hasError())
+		// Prior-knowledge HTTP/2 opens with the client preface instead of a request
+		if (!client.h2_checked)
+		{
+			const RecvBuffer& data = client.request().input();
+			size_t n = data.size() < Http2Connection::PREFACE_SIZE ? data.size() : Http2Connection::PREFACE_SIZE;
+			if (std::memcmp(data.data(), Http2Connection::PREFACE, n) == 0)
+			{
+				if (n == Http2Connection::PREFACE_SIZE)
+					_start_h2(client_fd);
+				return;
+			}
+			client.h2_checked = true;
+		}
+		client.request().parseBuffered();
+
+		if (client.request().hasError())
 		{
 			Logger::error("Bad Request from client FD {}", client_fd);
 			std::string response = HttpResponse::createErrorResponse(400).serialize();
@@ -305,7 +450,7 @@ void Server::_handle_client_data(int client_fd)
 		}
 
 		// HTTP end detection
-		if (client.request.isComplete())
+		if (client.request().isComplete())
 		{
 			Logger::info("----- Full Request from client FD {} -----", client_fd);
 			
@@ -313,12 +458,24 @@ void Server::_handle_client_data(int client_fd)
 			client.requests_count++;
 
 			// Determine if connection should be kept alive
-			client.keep_alive = _should_keep_alive(client.request);
+			client.keep_alive = _should_keep_alive(client.request());
 			if (client.requests_count >= KEEP_ALIVE_MAX_REQUESTS)
 			{
 				Logger::info("Client FD {} reached max requests limit", client_fd);
 				client.keep_alive = false;
 			}
+
+			if (_too_early(client, client.request()))
+			{
+				Logger::info("Unsafe 0-RTT request on FD {}, answering 425", client_fd);
+				HttpResponse response = ErrorHandler::get_error_page(425, *client.config);
+				_queue_response(client_fd, response);
+				return;
+			}
+
+			// `Upgrade: h2c`: the request is answered as HTTP/2 stream 1
+			if (_try_h2_upgrade(client_fd))
+				return;
 			
 			// Handle request
 			_process_request(client_fd);
@@ -336,6 +493,24 @@ void Server::_handle_client_data(int client_fd)
 		Logger::info("Client {} disconnected.", client_fd);
 		_close_client(client_fd);
 	}
+	else if (errno == EAGAIN)
+	{
+		// Only part of a TLS record arrived (or a post-handshake message).
+		// A 0-RTT connection answered without keep-alive closes once its
+		// handshake is complete (see _finish_response).
+		if (client.tls && !client.keep_alive && client.state == CLIENT_READING_REQUEST
+			&& !client.tls->isEarly())
+		{
+			Logger::info("Closing connection to FD {} (no keep-alive)", client_fd);
+			_close_client(client_fd);
+			return;
+		}
+		// Nothing of a next request yet: stay compact
+		if (!client.h2 && client.state == CLIENT_READING_REQUEST && client.request().input().empty()
+			&& client.request().getState() == PARSING_REQUEST_LINE)
+			client.compact();
+		return;
+	}
 	else
 	{
 		Logger::error("Read error on FD {}", client_fd);
@@ -349,6 +524,18 @@ void Server::_handle_client_write(int client_fd)
 	Client& client = _clients[client_fd];
 	std::string& buffer = client.response_buffer;
 
+	if (client.tls && !client.tls->isEstablished())
+	{
+		_handle_tls_handshake(client_fd);
+		return;
+	}
+
+	if (client.h2)
+	{
+		_handle_h2_write(client_fd);
+		return;
+	}
+
 	// Only write to client when explicitly in the WRITING_RESPONSE state
 	// This prevents writing raw CGI stdout (which is temporarily stored in
 	// client.response_buffer while a CGI is running) before the CGI output is
@@ -356,48 +543,97 @@ void Server::_handle_client_write(int client_fd)
 	if (client.state != CLIENT_WRITING_RESPONSE)
 		return;
 
-	if (buffer.empty())
+	if (buffer.empty() && !client.cgi_streaming)
 		return;
 
-	ssize_t bytes_sent = send(client_fd, buffer.c_str(), buffer.length(), 0);
-	if (bytes_sent > 0)
+	if (!buffer.empty())
 	{
-		buffer.erase(0, bytes_sent);
+		ssize_t bytes_sent = _client_send(client, buffer.c_str(), buffer.length());
+		if (bytes_sent > 0)
+		{
+			buffer.erase(0, bytes_sent);
+			if (client.proxy_fd != -1)
+				client.updateActivity();
+		}
+		else if (bytes_sent == 0)
+		{
+			// No data sent, wait for next EPOLLOUT event
+			return;
+		}
+		else if (errno == EAGAIN)
+		{
+			// TLS record not fully flushed yet, wait for next EPOLLOUT event
+			return;
+		}
+		else // bytes_sent == -1
+		{
+			Logger::error("Send error on FD {}", client_fd);
+			_close_client(client_fd);
+			return;
+		}
 	}
-	else if (bytes_sent == 0)
+
+	// The client drained the proxy buffer enough: read from the upstream again
+	if (client.proxy_paused && buffer.size() < PROXY_BUFFER_LIMIT / 2)
 	{
-		// No data sent, wait for next EPOLLOUT event
-		return;
+		client.proxy_paused = false;
+		client.updateActivity();
+		_modify_epoll(client.proxy_fd, EPOLLIN);
 	}
-	else // bytes_sent == -1
+
+	if (!buffer.empty())
+		return;
+
+	// Proxied body still arriving: wait for the upstream to fill the buffer
+	if (client.proxy_fd != -1)
 	{
-		Logger::error("Send error on FD {}", client_fd);
-		_close_client(client_fd);
+		_modify_epoll(client_fd, 0);
 		return;
 	}
 
-	if (buffer.empty())
+	// Head is out: the rest of a streamed CGI body comes straight from the pipe
+	if (client.cgi_streaming)
 	{
-		Logger::info("##### Response sent fully to FD {} #####\n", client_fd);
+		_relay_cgi_body(client_fd);
+		return;
+	}
 
-		// Update activity timestamp
-		client.updateActivity();
+	_finish_response(client_fd);
+}
 
-		// Keep-Alive: reset client state for next request
-		if (client.keep_alive)
-		{
-			Logger::info("Keep-alive: waiting for next request on FD {}", client_fd);
-			_modify_epoll(client_fd, EPOLLIN);
-			client.request.reset();
-			client.request_buffer.clear();
-			client.response_buffer.clear();
-			client.state = CLIENT_READING_REQUEST;
-		}
-		else
-		{
-			Logger::info("Closing connection to FD {} (no keep-alive)", client_fd);
-			_close_client(client_fd);
-		}
+/*
+	Response fully sent: wait for the next request or close
+*/
+void Server::_finish_response(int client_fd)
+{
+	Client& client = _clients[client_fd];
+
+	Logger::info("##### Response sent fully to FD {} #####\n", client_fd);
+
+	// Update activity timestamp
+	client.updateActivity();
+
+	// Keep-Alive: reset client state for next request
+	if (client.keep_alive)
+	{
+		Logger::info("Keep-alive: waiting for next request on FD {}", client_fd);
+		_modify_epoll(client_fd, EPOLLIN);
+		client.compact();	// Request state is taken again when the next request arrives
+		client.state = CLIENT_READING_REQUEST;
+	}
+	else if (client.tls && client.tls->isEarly())
+	{
+		// 0-RTT response: wait for the client's Finished before closing, so the
+		// handshake completes and the client receives its next session ticket
+		Logger::info("Closing FD {} once the TLS handshake completes", client_fd);
+		_modify_epoll(client_fd, EPOLLIN);
+		client.compact();
+		client.state = CLIENT_READING_REQUEST;
+	}
+	else
+	{
+		Logger::info("Closing connection to FD {} (no keep-alive)", client_fd);
+		_close_client(client_fd);
 	}
 }
 
@@ -419,33 +655,38 @@ void Server::_process_request(int client_fd)
 	}
 
 	// Create RequestHandler and process the request
-	RequestHandler handler(*config);
+	RequestHandler handler(*config, &_cgi_cache, &_cgi_limiter);
 	
 	// Handles CGI start internally. Checks client.state for async changes.
 	HttpResponse response = handler.handleRequest(client);
 	
+	if (client.state == CLIENT_CGI_QUEUED)
+	{
+		// Location at cgi_max_concurrent: started by _release_cgi_slot later.
+		// Only a hang-up is watched, so clients that give up leave the queue.
+		_modify_epoll(client_fd, EPOLLRDHUP);
+		return;
+	}
+
 	if (client.state == CLIENT_CGI_PROCESSING)
 	{
-		Logger::info("Async CGI started for client FD {}", client_fd);
-		
-		// Register CGI pipes to epoll
-		if (client.cgi_input_fd != -1)
-		{
-			_add_to_epoll(client.cgi_input_fd, EPOLLOUT);
-			_cgi_fd_map[client.cgi_input_fd] = client_fd;
-		}
-		if (client.cgi_output_fd != -1)
-		{
-			_add_to_epoll(client.cgi_output_fd, EPOLLIN);
-			_cgi_fd_map[client.cgi_output_fd] = client_fd;
-		}
+		_register_cgi(client_fd);
+		return;
+	}
 
-		// Disable client socket events while waiting for CGI
-		// We don't want to read more requests or write anything yet
-		_modify_epoll(client_fd, 0);
+	if (client.state == CLIENT_PROXYING)
+	{
+		_start_proxy(client_fd);
 		return;
 	}
 
+	// A CGI that was rejected or failed to start releases its slot and cache waiters
+	if (client.cgi_slot_held || !client.cgi_cache_key.empty())
+	{
+		_finish_cgi_flight(client, response);
+		_cleanup_cgi(client);
+	}
+
 	// Normal synchronous response
 	// Set Connection header based on keep-alive status
 	if (client.keep_alive)
@@ -454,44 +695,93 @@ void Server::_process_request(int client_fd)
 		response.setHeader("Connection", "close");
 	
 	Logger::info("Response built - Status: {}, Request: {} {}",
-				response.getStatus(), client.request.getMethod(), client.request.getPath());
+				response.getStatus(), client.request().getMethod(), client.request().getPath());
 	
-	client.response_buffer = response.serialize();
+	client.response_buffer.clear();
+	response.serializeTo(client.response_buffer);
 	client.state = CLIENT_WRITING_RESPONSE;
 }
 
 /*
-	Check if connection should be kept alive based on request headers
+	Register a started CGI (pipes + pidfd, or a FastCGI connection) in epoll
 */
-bool Server::_should_keep_alive(const HttpRequest& request) const
+void Server::_register_cgi(int client_fd)
 {
-	std::string connection = StringUtils::toLower(request.getHeader("Connection"));
-	std::string version = request.getVersion();
+	Client& client = _clients[client_fd];
+
+	// Identical cgi_cache run in flight: wait for its result
+	if (client.cgi_cache_waiting)
+	{
+		_modify_epoll(client_fd, 0);
+		return;
+	}
+
+	Logger::info("Async CGI started for client FD {}", client_fd);
+
+	// FastCGI: no child process, the request goes over a worker connection
+	if (client.cgi_handler && client.cgi_handler->isFastCgi())
+	{
+		_start_fastcgi(client_fd);
+		return;
+	}
 	
-	// HTTP/1.1 defaults to keep-alive unless "Connection: close" is specified
-	if (version == "HTTP/1.1")
+	// Register CGI pipes to epoll
+	if (client.cgi_input_fd != -1)
 	{
-		if (connection == "close")
-			return false;
-		return true;
+		_add_to_epoll(client.cgi_input_fd, EPOLLOUT);
+		_cgi_fd_map[client.cgi_input_fd] = client_fd;
 	}
-	// HTTP/1.0 defaults to close unless "Connection: keep-alive" is specified
-	else if (version == "HTTP/1.0")
+	if (client.cgi_output_fd != -1)
 	{
-		if (connection == "keep-alive")
-			return true;
-		return false;
+		_add_to_epoll(client.cgi_output_fd, EPOLLIN);
+		_cgi_fd_map[client.cgi_output_fd] = client_fd;
 	}
+	if (client.cgi_pid_fd != -1)
+	{
+		_add_to_epoll(client.cgi_pid_fd, EPOLLIN);
+		_cgi_fd_map[client.cgi_pid_fd] = client_fd;
+	}
+
+	// Disable client socket events while waiting for CGI
+	// We don't want to read more requests or write anything yet
+	_modify_epoll(client_fd, 0);
+}
+
+/*
+	Check if connection should be kept alive based on request headers
+*/
+bool Server::_should_keep_alive(const HttpRequest& request) const
+{
+	// HTTP/1.1 defaults to keep-alive unless "Connection: close" is specified
+	if (request.getVersionId() == HTTP_1_1)
+		return !request.headerHasToken(HEADER_CONNECTION, "close");
+	// HTTP/1.0 defaults to close unless "Connection: keep-alive" is specified
+	else if (request.getVersionId() == HTTP_1_0)
+		return request.headerHasToken(HEADER_CONNECTION, "keep-alive");
 	
 	return false;
 }
 
+/*
+	Execution limit of the CGI a client runs or waits for
+*/
+long Server::_cgi_timeout(const Client& client) const
+{
+	if (client.cgi_handler)
+		return client.cgi_handler->getTimeout();
+	if (client.cgi_location && client.cgi_location->cgi_timeout > 0)
+		return client.cgi_location->cgi_timeout;
+	return CGI_TIMEOUT;
+}
+
 /*
 	Check for client timeouts and close idle connections
 */
 void Server::_check_client_timeouts()
 {
 	std::vector<int> to_close;
+	std::vector<int> to_finish;
+	std::vector<int> to_fail;
 	
 	for (std::map<int, Client>::iterator it = _clients.begin(); it != _clients.end(); ++it)
 	{
@@ -501,40 +791,13 @@ void Server::_check_client_timeouts()
 		// CGI timeout handling - parent process enforced
 		if (client.state == CLIENT_CGI_PROCESSING)
 		{
-			if (idle_time > CGI_TIMEOUT)
+			if (idle_time > _cgi_timeout(client))
 			{
 				Logger::error("CGI timeout for client FD {} after {} seconds", it->first, idle_time);
 				
-				// Forcibly kill the CGI child process
-				if (client.cgi_handler && client.cgi_handler->getChildPid() > 0)
-				{
-					kill(client.cgi_handler->getChildPid(), SIGKILL);
-					waitpid(client.cgi_handler->getChildPid(), NULL, WNOHANG);
-				}
-				
-				// Clean up CGI pipe FDs
-				if (client.cgi_input_fd != -1)
-				{
-					_remove_from_epoll(client.cgi_input_fd);
-					_cgi_fd_map.erase(client.cgi_input_fd);
-					close(client.cgi_input_fd);
-					client.cgi_input_fd = -1;
-					if (client.cgi_handler)
-						client.cgi_handler->markStdinClosed();  // Prevent double-close in destructor
-				}
-				if (client.cgi_output_fd != -1)
-				{
-					_remove_from_epoll(client.cgi_output_fd);
-					_cgi_fd_map.erase(client.cgi_output_fd);
-					close(client.cgi_output_fd);
-					client.cgi_output_fd = -1;
-					if (client.cgi_handler)
-						client.cgi_handler->markStdoutClosed();  // Prevent double-close in destructor
-				}
-				
-				// Clean up CGI handler
-				delete client.cgi_handler;
-				client.cgi_handler = NULL;
+				// Release CGI FDs; ~CgiHandler kills the child and queues it for reaping
+				_finish_cgi_flight(client, HttpResponse::createErrorResponse(504));
+				_cleanup_cgi(client);
 				
 				// Send 504 Gateway Timeout response
 				client.response_buffer = HttpResponse::createErrorResponse(504).serialize();
@@ -542,12 +805,59 @@ void Server::_check_client_timeouts()
 				client.keep_alive = false; // Close connection after timeout
 				_modify_epoll(it->first, EPOLLIN | EPOLLOUT);
 			}
+			// Without a pidfd, the exit after stdout EOF is polled here
+			else if (client.cgi_output_done && client.cgi_handler && client.cgi_handler->reap())
+				_finish_cgi_if_done(it->first);
 			// Don't check regular idle timeout while CGI is processing [NOTE: that's for test]
 			continue;
 		}
+
+		// Streaming a CGI body: the script may pause, but not beyond the CGI timeout.
+		// The head is already out, so a stalled stream can only be cut off.
+		if (client.cgi_streaming)
+		{
+			if (idle_time > _cgi_timeout(client))
+			{
+				Logger::error("CGI stream to client FD {} stalled for {} seconds", it->first, idle_time);
+				to_close.push_back(it->first);
+			}
+			// Finishing may close the connection: done after the scan
+			else if (client.cgi_output_done && client.cgi_handler && client.cgi_handler->reap())
+				to_finish.push_back(it->first);
+			continue;
+		}
+
+		// Upstream connecting or silent for too long: 504, or a cut-off if the head is out
+		if (client.proxy_fd != -1)
+		{
+			if (idle_time > _proxy_timeout(client))
+			{
+				Logger::error("Upstream timeout for client FD {} after {} seconds", it->first, idle_time);
+				to_fail.push_back(it->first);
+			}
+			continue;
+		}
+
+		// Still waiting for a CGI slot: give up with the same 503 as a full queue
+		if (client.state == CLIENT_CGI_QUEUED)
+		{
+			if (idle_time > _cgi_timeout(client))
+			{
+				Logger::error("CGI queue wait timeout for client FD {}", it->first);
+				HttpResponse response = _cgi_limiter.busyResponse();
+				_finish_cgi_flight(client, response);
+				_cleanup_cgi(client);
+				client.keep_alive = false;
+				_queue_response(it->first, response);
+			}
+			continue;
+		}
 		
 		// Regular client idle timeout
 		long timeout = client.keep_alive ? KEEP_ALIVE_TIMEOUT : CLIENT_IDLE_TIMEOUT;
+		// HTTP/2 streams still open (e.g. waiting for a WINDOW_UPDATE) are not idle
+		if (client.h2 && client.h2->hasActiveStreams())
+			timeout = CLIENT_IDLE_TIMEOUT;
 		
 		if (idle_time > timeout)
 		{
@@ -562,6 +872,30 @@ void Server::_check_client_timeouts()
 	{
 		_close_client(to_close[i]);
 	}
+
+	for (size_t i = 0; i < to_finish.size(); ++i)
+	{
+		if (_clients.find(to_finish[i]) != _clients.end())
+			_finish_cgi_if_done(to_finish[i]);
+	}
+
+	for (size_t i = 0; i < to_fail.size(); ++i)
+	{
+		if (_clients.find(to_fail[i]) == _clients.end())
+			continue;
+		Client& client = _clients[to_fail[i]];
+		// A connect timeout is retried on another peer, like a refused connect
+		if (!client.proxy_connected)
+		{
+			_retry_proxy(to_fail[i], 504);
+			continue;
+		}
+		// A client too slow to drain the buffer is not the upstream's failure
+		if (client.proxy_paused)
+			_release_peer(client, false);
+		client.keep_alive = false;
+		_fail_proxy(to_fail[i], 504);
+	}
 }
 
 /*
@@ -569,29 +903,13 @@ void Server::_check_client_timeouts()
 */
 void Server::_close_client(int client_fd)
 {
-	// Clean up CGI resources if active
+	// Clean up CGI and upstream resources if active
 	if (_clients.find(client_fd) != _clients.end())
 	{
-		Client& client = _clients[client_fd];
-		if (client.cgi_input_fd != -1)
-		{
-			_remove_from_epoll(client.cgi_input_fd);
-			_cgi_fd_map.erase(client.cgi_input_fd);
-			close(client.cgi_input_fd);
-			client.cgi_input_fd = -1;
-			if (client.cgi_handler)
-				client.cgi_handler->markStdinClosed();
-		}
-		if (client.cgi_output_fd != -1)
-		{
-			_remove_from_epoll(client.cgi_output_fd);
-			_cgi_fd_map.erase(client.cgi_output_fd);
-			close(client.cgi_output_fd);
-			client.cgi_output_fd = -1;
-			if (client.cgi_handler)
-				client.cgi_handler->markStdoutClosed();
-		}
-		// CgiHandler is deleted in Client destructor, which is called when erasing from _clients map
+		_cleanup_cgi(_clients[client_fd]);
+		_cleanup_proxy(_clients[client_fd]);
+		if (_clients[client_fd].tls)
+			_clients[client_fd].tls->shutdown();
 	}
 
 	epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
@@ -3,6 +3,7 @@
 
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <sys/epoll.h>
@@ -17,6 +18,11 @@
 #include <vector>
 
 #include "Client.hpp"
+#include "Tls.hpp"
+#include "UpstreamPool.hpp"
+#include "UpstreamGroup.hpp"
+#include "cgi/CgiCache.hpp"
+#include "cgi/CgiLimiter.hpp"
 #include "config/ConfigParser.hpp"
 #include "http/HttpRequest.hpp"
 #include "http/HttpResponse.hpp"
@@ -32,15 +38,25 @@
 #define SOCKET_REUSE_OPT	1
 
 // Buffer sizes
-#define READ_BUFFER_SIZE	4096
+#define READ_BUFFER_SIZE	16384	// One full TLS record, so SSL_read never leaves plaintext behind
 #define WRITE_BUFFER_SIZE	8192
+#define CGI_MAX_HEADER_SIZE	8192	// CGI header block must fit to stream the body
 
 // Timeout values
 #define EPOLL_TIMEOUT			1000   // epoll wait timeout: 1000ms = 1 second
 #define CLIENT_IDLE_TIMEOUT		30     // 30 seconds idle timeout
 #define KEEP_ALIVE_TIMEOUT		5      // 5 seconds for keep-alive connections
 #define KEEP_ALIVE_MAX_REQUESTS	100    // Max requests per connection
-#define CGI_TIMEOUT				30     // 30 seconds CGI execution timeout
+#define CGI_TIMEOUT				30     // CGI execution timeout unless the location sets cgi_timeout
+#define PROXY_CONNECT_TIMEOUT	10     // Upstream connect, unless proxy_connect_timeout is set
+#define PROXY_READ_TIMEOUT		60     // Upstream silence, unless proxy_read_timeout is set
+
+// Reverse proxy buffering
+#define PROXY_READ_SIZE			16384
+#define PROXY_BUFFER_LIMIT		(256 * 1024)	// Client backlog that pauses upstream reads
+
+// HTTP/2
+#define H2_WRITE_BUDGET			(64 * 1024)		// Frames produced per write
 
 namespace wsv
 {
@@ -53,11 +69,30 @@ private:
 
 	// Map of listening socket FDs to their associated server configuration
 	std::map<int, ServerConfig> _listen_fds;
+
+	// Listening socket FD -> TLS context of `listen ... ssl` servers
+	std::map<int, TlsContext*> _tls_contexts;
 	std::map<int, Client> _clients;
 
-	// CGI Pipe FD -> Client FD
+	// CGI Pipe FD (or FastCGI socket FD) -> Client FD
 	std::map<int, int> _cgi_fd_map;
 
+	// proxy_pass upstream connection FD -> Client FD
+	std::map<int, int> _proxy_fd_map;
+
+	// Idle persistent connections to FastCGI workers and proxy_pass upstreams
+	UpstreamPool _upstream_pool;
+
+	// `upstream` blocks by name, and health probe FD -> (upstream name, peer index)
+	std::map<std::string, UpstreamGroup> _upstream_groups;
+	std::map<int, std::pair<std::string, int> > _probe_fd_map;
+
+	// Responses of cgi_cache locations and the runs producing them
+	CgiCache _cgi_cache;
+
+	// Running and queued CGI requests of cgi_max_concurrent locations
+	CgiLimiter _cgi_limiter;
+
 	// Shutdown flag
 	static volatile sig_atomic_t _shutdown_requested;
 
@@ -78,6 +113,9 @@ protected:
 	// helper functions
 	void	_init_listening_sockets();
 	void	_init_epoll();
+	void	_init_cgi_cgroups();
+	void	_init_upstreams();
+	void	_resolve_upstream(const std::string& host, int port);
 	int		_create_listening_socket(const std::string& host, int port);
 
 	void	_add_to_epoll(int fd, uint32_t events);
@@ -87,9 +125,53 @@ protected:
 	void	_handle_new_connection(int listen_fd);
 	void	_handle_client_data(int client_fd);
 	void	_handle_client_write(int client_fd);
+	void	_finish_response(int client_fd);
 	void	_handle_cgi_data(int cgi_fd, uint32_t events);
+	void	_handle_fastcgi_data(int client_fd, int fcgi_fd, uint32_t events);
+	void	_start_fastcgi(int client_fd);
+	HttpResponse	_build_cgi_response(Client& client, const std::string& raw_output);
+	HttpResponse	_build_delegated_response(Client& client, const CgiHandler::HeaderMap& cgi_headers,
+											  const std::string& target, bool is_uri);
+	void	_queue_response(int client_fd, HttpResponse& response);
+	void	_finish_cgi_flight(Client& client, const HttpResponse& response);
+	void	_abort_fastcgi(int client_fd, int status_code);
+	void	_finish_cgi_if_done(int client_fd);
+	void	_cleanup_cgi(Client& client);
+	void	_register_cgi(int client_fd);
+	void	_release_cgi_slot(Client& client);
+	void	_start_queued_cgi(int client_fd);
+	void	_try_start_cgi_stream(int client_fd);
+	void	_relay_cgi_body(int client_fd);
+
+	void	_start_proxy(int client_fd);
+	void	_handle_proxy_data(int upstream_fd, uint32_t events);
+	void	_start_proxy_response(int client_fd);
+	void	_finish_proxy(int client_fd);
+	void	_fail_proxy(int client_fd, int status_code);
+	void	_cleanup_proxy(Client& client);
+	void	_retry_proxy(int client_fd, int status_code);
+	void	_release_peer(Client& client, bool failed);
+	long	_proxy_timeout(const Client& client) const;
+
+	void	_run_health_checks();
+	void	_handle_probe_data(int probe_fd, uint32_t events);
+	void	_finish_probe(int probe_fd, bool passed);
+
+	void	_start_h2(int client_fd);
+	bool	_try_h2_upgrade(int client_fd);
+	void	_handle_h2_data(int client_fd, const char* data, size_t len);
+	void	_process_h2(int client_fd);
+	void	_handle_h2_write(int client_fd);
+	size_t	_h2_max_body(const ServerConfig& config) const;
+
+	void	_handle_tls_handshake(int client_fd);
+	ssize_t	_client_recv(Client& client, char* buffer, size_t len);
+	ssize_t	_client_recv(Client& client, RecvBuffer& input);
+	ssize_t	_client_send(Client& client, const char* data, size_t len);
+	bool	_too_early(const Client& client, const HttpRequest& request) const;
 
 	void	_check_client_timeouts();
+	long	_cgi_timeout(const Client& client) const;
 	void	_close_client(int client_fd);
 
 	void	_process_request(int client_fd);
@@ -4,6 +4,9 @@
 #include <sys/wait.h>
 #include <cstring>
 #include <cerrno>
+#include <ctime>
+#include <cstdlib>
+#include <sys/ioctl.h>
 
 namespace wsv {
 
@@ -15,7 +18,7 @@ void Server::_handle_cgi_data(int cgi_fd, uint32_t events)
     int client_fd = _cgi_fd_map[cgi_fd];
     Client& client = _clients[client_fd];
 
-    if (client.state != CLIENT_CGI_PROCESSING)
+    if (client.state != CLIENT_CGI_PROCESSING && !client.cgi_streaming)
     {
         Logger::error("CGI event for client {} not in CGI state", client_fd);
         _remove_from_epoll(cgi_fd);
@@ -31,6 +34,40 @@ void Server::_handle_cgi_data(int cgi_fd, uint32_t events)
         return;
     }
 
+    if (handler->isFastCgi())
+    {
+        _handle_fastcgi_data(client_fd, cgi_fd, events);
+        return;
+    }
+
+    // Child exit reported by its pidfd
+    if (cgi_fd == client.cgi_pid_fd)
+    {
+        if (handler->reap())
+        {
+            _remove_from_epoll(cgi_fd);
+            _cgi_fd_map.erase(cgi_fd);
+            client.cgi_pid_fd = -1;  // Closed by ~CgiHandler
+        }
+        _finish_cgi_if_done(client_fd);
+        return;
+    }
+
+    // Streaming: the pipe only signals that spliceable data (or EOF) is there
+    if (client.cgi_streaming && cgi_fd == client.cgi_output_fd)
+    {
+        if (events & EPOLLHUP)
+        {
+            // Writer gone: HUP would be reported forever, the relay finds EOF itself
+            _remove_from_epoll(cgi_fd);
+            _cgi_fd_map.erase(cgi_fd);
+        }
+        else
+            _modify_epoll(cgi_fd, 0);
+        _modify_epoll(client_fd, EPOLLOUT);
+        return;
+    }
+
     // 0. Pre-check for error events (Handle broken pipes/errors via epoll flags)
     if (events & EPOLLERR)
     {
@@ -47,17 +84,10 @@ void Server::_handle_cgi_data(int cgi_fd, uint32_t events)
         else if (cgi_fd == client.cgi_output_fd)
         {
             Logger::error("CGI output pipe error (EPOLLERR)");
-            _remove_from_epoll(cgi_fd);
-            close(cgi_fd);
-            _cgi_fd_map.erase(cgi_fd);
-            client.cgi_output_fd = -1;
-            if (client.cgi_handler)
-                client.cgi_handler->markStdoutClosed();
-            delete client.cgi_handler;
-            client.cgi_handler = NULL;
-            client.response_buffer = HttpResponse::createErrorResponse(500).serialize();
-            client.state = CLIENT_WRITING_RESPONSE;
-            _modify_epoll(client_fd, EPOLLIN | EPOLLOUT);
+            HttpResponse response = HttpResponse::createErrorResponse(500);
+            _finish_cgi_flight(client, response);
+            _cleanup_cgi(client);
+            _queue_response(client_fd, response);
             return;
         }
     }
@@ -133,68 +163,24 @@ void Server::_handle_cgi_data(int cgi_fd, uint32_t events)
         {
             client.response_buffer.append(buffer, bytes);
             client.updateActivity();
+            if (!client.cgi_stream_checked)
+                _try_start_cgi_stream(client_fd);
         }
         else if (bytes == 0 || (events & EPOLLHUP))
         {
-            // CGI finished: Either pipe closed or HUP received
-            Logger::info("CGI stdout closed or HUP, processing response");
-            
-            int status;
-            // Use WNOHANG to check if child exited, or wait if it's already done
-            waitpid(handler->getChildPid(), &status, 0); 
-
-            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
-            {
-                Logger::error("CGI process failed or exited with status: {}", WEXITSTATUS(status));
-                client.response_buffer = HttpResponse::createErrorResponse(500).serialize(); // 500 Internal Server Error
-            }
-            else
-            {
-                CgiHandler::HeaderMap cgi_headers;
-                std::string body;
-                CgiHandler::parseCgiOutput(client.response_buffer, cgi_headers, body);
-
-                HttpResponse response;
-                response.setBody(body);
-                
-                if (cgi_headers.count("Status"))
-                {
-                    std::istringstream iss(cgi_headers["Status"]);
-                    int code = 200;
-                    iss >> code;
-                    response.setStatus(code);
-                }
-                else
-                    response.setStatus(200);
-
-                for (std::map<std::string, std::string>::iterator it = cgi_headers.begin(); it != cgi_headers.end(); ++it)
-                {
-                    if (it->first != "Status")
-                        response.setHeader(it->first, it->second);
-                }
+            // CGI output finished: Either pipe closed or HUP received
+            Logger::info("CGI stdout closed or HUP, waiting for child exit status");
 
-                if (client.keep_alive)
-                    response.setHeader("Connection", "keep-alive");
-                else
-                    response.setHeader("Connection", "close");
-
-                client.response_buffer = response.serialize();
-            }
-
-            // Cleanup CGI resources
             _remove_from_epoll(cgi_fd);
             close(cgi_fd);
             _cgi_fd_map.erase(cgi_fd);
             client.cgi_output_fd = -1;
-            if (client.cgi_handler)
-                client.cgi_handler->markStdoutClosed();
+            handler->markStdoutClosed();
+            client.cgi_output_done = true;
 
-            delete client.cgi_handler;
-            client.cgi_handler = NULL;
-
-            // Final state transition
-            client.state = CLIENT_WRITING_RESPONSE;
-            _modify_epoll(client_fd, EPOLLIN | EPOLLOUT);
+            // Never block here: the exit status may arrive later via the pidfd
+            handler->reap();
+            _finish_cgi_if_done(client_fd);
         }
         else // bytes == -1
         {
@@ -204,4 +190,559 @@ void Server::_handle_cgi_data(int cgi_fd, uint32_t events)
     }
 }
 
+/*
+	Build the response once both stdout EOF and the exit status are in
+*/
+void Server::_finish_cgi_if_done(int client_fd)
+{
+    Client& client = _clients[client_fd];
+    CgiHandler* handler = client.cgi_handler;
+
+    if (!handler || !client.cgi_output_done || !handler->hasExited())
+        return;
+
+    // Streamed: the response is already on the wire, a late failure is only logged
+    if (client.cgi_streaming)
+    {
+        int status = handler->getExitStatus();
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            Logger::error("Streamed CGI process exited with status: {}", WEXITSTATUS(status));
+        _cleanup_cgi(client);
+        _finish_response(client_fd);
+        return;
+    }
+
+    HttpResponse response;
+    int status = handler->getExitStatus();
+    if (WIFSIGNALED(status))
+    {
+        // SIGXCPU / SIGKILL here usually means cgi_rlimit_cpu was hit
+        Logger::error("CGI process killed by signal {}", WTERMSIG(status));
+        response = HttpResponse::createErrorResponse(500);
+    }
+    else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        Logger::error("CGI process failed or exited with status: {}", WEXITSTATUS(status));
+        response = HttpResponse::createErrorResponse(500); // 500 Internal Server Error
+    }
+    else
+        response = _build_cgi_response(client, client.response_buffer);
+
+    _finish_cgi_flight(client, response);
+    _cleanup_cgi(client);
+
+    // Final state transition
+    _queue_response(client_fd, response);
+}
+
+/*
+	Unregister and close every CGI descriptor of a client and drop its handler
+*/
+void Server::_cleanup_cgi(Client& client)
+{
+    if (!client.cgi_cache_key.empty())
+    {
+        if (client.cgi_cache_waiting)
+            _cgi_cache.leaveFlight(client.cgi_cache_key, client.client_fd);
+        else
+            _finish_cgi_flight(client, HttpResponse::createErrorResponse(502));  // Run abandoned
+        client.cgi_cache_key.clear();
+        client.cgi_cache_waiting = false;
+    }
+
+    if (client.cgi_input_fd != -1)
+    {
+        _remove_from_epoll(client.cgi_input_fd);
+        _cgi_fd_map.erase(client.cgi_input_fd);
+        close(client.cgi_input_fd);
+        client.cgi_input_fd = -1;
+        if (client.cgi_handler)
+            client.cgi_handler->markStdinClosed();  // Prevent double-close in destructor
+    }
+    if (client.cgi_output_fd != -1)
+    {
+        _remove_from_epoll(client.cgi_output_fd);
+        _cgi_fd_map.erase(client.cgi_output_fd);
+        close(client.cgi_output_fd);
+        client.cgi_output_fd = -1;
+        if (client.cgi_handler)
+            client.cgi_handler->markStdoutClosed();  // Prevent double-close in destructor
+    }
+    if (client.cgi_pid_fd != -1)
+    {
+        // The pidfd itself is closed by ~CgiHandler
+        _remove_from_epoll(client.cgi_pid_fd);
+        _cgi_fd_map.erase(client.cgi_pid_fd);
+        client.cgi_pid_fd = -1;
+    }
+
+    delete client.cgi_handler;
+    client.cgi_handler = NULL;
+    client.cgi_output_done = false;
+    client.cgi_stream_checked = false;
+    client.cgi_header_scan.reset(0);
+    client.cgi_streaming = false;
+    client.cgi_stream_remaining = 0;
+
+    if (client.state == CLIENT_CGI_QUEUED && client.cgi_location)
+        _cgi_limiter.remove(*client.cgi_location, client.client_fd);
+    _release_cgi_slot(client);
+}
+
+/*
+	Give a finished run's slot to the next queued client of its location
+*/
+void Server::_release_cgi_slot(Client& client)
+{
+    if (!client.cgi_slot_held)
+        return;
+
+    const LocationConfig& location = *client.cgi_location;
+    client.cgi_slot_held = false;
+    _cgi_limiter.release(location);
+
+    int next_fd;
+    while ((next_fd = _cgi_limiter.nextQueued(location)) != -1)
+    {
+        std::map<int, Client>::iterator it = _clients.find(next_fd);
+        if (it != _clients.end() && it->second.state == CLIENT_CGI_QUEUED)
+        {
+            _start_queued_cgi(next_fd);
+            return;
+        }
+        _cgi_limiter.release(location);  // Stale entry
+    }
+}
+
+/*
+	Start the CGI of a client that has just been given a slot
+*/
+void Server::_start_queued_cgi(int client_fd)
+{
+    Client& client = _clients[client_fd];
+
+    client.cgi_slot_held = true;
+    client.state = CLIENT_PROCESSING;
+    client.updateActivity();  // The CGI timeout counts from the start, not the queueing
+
+    CgiRequestHandler::startCgi(client, client.cgi_script_path, *client.cgi_location, *client.config);
+    if (client.state == CLIENT_CGI_PROCESSING)
+        _register_cgi(client_fd);
+
+    // Spawn or worker connection failed: the response is already in the buffer
+    if (client.state == CLIENT_WRITING_RESPONSE)
+    {
+        _finish_cgi_flight(client, HttpResponse::createErrorResponse(500));
+        _cleanup_cgi(client);
+        _modify_epoll(client_fd, EPOLLIN | EPOLLOUT);
+    }
+}
+
+/*
+	Switch a CGI run to zero-copy relay once its header block has been read.
+	Only responses with a Content-Length qualify: the length frames the body
+	without rewriting it. cgi_cache leaders, HEAD requests and file delegations
+	need the whole output and stay on the buffered path.
+*/
+void Server::_try_start_cgi_stream(int client_fd)
+{
+    Client& client = _clients[client_fd];
+    const std::string& raw = client.response_buffer;
+
+    // Spliced bytes bypass OpenSSL: on TLS only a kTLS socket encrypts them
+    if (client.tls && !client.tls->kernelSend())
+    {
+        client.cgi_stream_checked = true;
+        return;
+    }
+
+    // Each read only scans the new bytes for the empty line ending the headers
+    ByteScan::Line lines[16];
+    size_t header_len = 0;
+    while (!header_len)
+    {
+        size_t count = ByteScan::scanLines(raw.data(), raw.size(), client.cgi_header_scan, lines, 16);
+        if (count == 0)
+        {
+            if (raw.size() > CGI_MAX_HEADER_SIZE)
+                client.cgi_stream_checked = true;
+            return;
+        }
+        if (lines[count - 1].start == lines[count - 1].end)
+            header_len = lines[count - 1].next;
+    }
+    client.cgi_stream_checked = true;
+
+    if (!client.cgi_cache_key.empty() || client.request().getMethodId() == METHOD_HEAD)
+        return;
+
+    CgiHandler::HeaderMap cgi_headers;
+    std::string unused_body;
+    CgiHandler::parseCgiOutput(raw.substr(0, header_len), cgi_headers, unused_body);
+
+    std::string target;
+    bool is_uri = false;
+    if (CgiHandler::getFileDelegation(cgi_headers, target, is_uri))
+        return;
+
+    HttpResponse head;
+    std::string length;
+    head.setStatus(200);
+    for (CgiHandler::HeaderMap::const_iterator it = cgi_headers.begin(); it != cgi_headers.end(); ++it)
+    {
+        std::string name = StringUtils::toLower(it->first);
+        if (name == "status")
+        {
+            // An invalid Status is answered with 502 by the buffered path
+            int code = CgiHandler::parseStatus(it->second);
+            if (!code)
+                return;
+            head.setStatus(code);
+        }
+        else if (name == "content-length")
+            length = StringUtils::trim(it->second);
+        else
+            head.setHeader(it->first, it->second);
+    }
+
+    if (length.empty() || length.find_first_not_of("0123456789") != std::string::npos)
+        return;
+    size_t content_length = std::strtoul(length.c_str(), NULL, 10);
+    size_t body_read = raw.size() - header_len;
+    if (body_read > content_length)
+        return;
+
+    head.setHeader("Content-Length", length);
+    head.setHeader("Connection", client.keep_alive ? "keep-alive" : "close");
+
+    // Head plus the body bytes that came with it go out through send();
+    // everything after that is spliced pipe -> socket
+    client.response_buffer = head.serialize() + raw.substr(header_len);
+    client.cgi_stream_remaining = content_length - body_read;
+    client.cgi_streaming = true;
+    client.state = CLIENT_WRITING_RESPONSE;
+
+    _modify_epoll(client.cgi_output_fd, 0);
+    _modify_epoll(client_fd, EPOLLOUT);
+    Logger::info("Streaming CGI body of {} bytes to FD {}", content_length, client_fd);
+}
+
+/*
+	Move the next part of a streamed CGI body from the stdout pipe to the socket.
+	Readiness ping-pongs: the socket is watched while the pipe has data, the
+	pipe while it is empty, so neither side spins.
+*/
+void Server::_relay_cgi_body(int client_fd)
+{
+    Client& client = _clients[client_fd];
+    int pipe_fd = client.cgi_output_fd;
+
+    if (client.cgi_stream_remaining > 0)
+    {
+        ssize_t moved = splice(pipe_fd, NULL, client_fd, NULL, client.cgi_stream_remaining,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (moved > 0)
+        {
+            client.cgi_stream_remaining -= moved;
+            client.updateActivity();
+        }
+        else if (moved == 0)
+        {
+            // Script closed stdout short of its Content-Length
+            Logger::error("CGI stdout ended {} bytes early for FD {}", client.cgi_stream_remaining, client_fd);
+            _close_client(client_fd);
+            return;
+        }
+        else if (errno != EAGAIN)
+        {
+            Logger::error("splice error on FD {}", client_fd);
+            _close_client(client_fd);
+            return;
+        }
+        else
+        {
+            // EAGAIN from either end: an empty pipe means waiting for the script
+            int pending = 0;
+            if (ioctl(pipe_fd, FIONREAD, &pending) == 0 && pending == 0
+                && _cgi_fd_map.find(pipe_fd) != _cgi_fd_map.end())
+            {
+                _modify_epoll(client_fd, 0);
+                _modify_epoll(pipe_fd, EPOLLIN);
+            }
+            return;
+        }
+    }
+
+    if (client.cgi_stream_remaining > 0)
+        return;
+
+    // Whole body relayed; anything the script writes past its length is dropped
+    _modify_epoll(client_fd, 0);
+    _remove_from_epoll(pipe_fd);
+    _cgi_fd_map.erase(pipe_fd);
+    close(pipe_fd);
+    client.cgi_output_fd = -1;
+    client.cgi_handler->markStdoutClosed();
+    client.cgi_output_done = true;
+
+    client.cgi_handler->reap();
+    _finish_cgi_if_done(client_fd);
+}
+
+/*
+	Turn raw CGI output (headers + body) into an HTTP response (no Connection header)
+*/
+HttpResponse Server::_build_cgi_response(Client& client, const std::string& raw_output)
+{
+    CgiHandler::HeaderMap cgi_headers;
+    std::string body;
+    CgiHandler::parseCgiOutput(raw_output, cgi_headers, body);
+
+    // The script only authorized the request: the server sends the file itself
+    std::string target;
+    bool is_uri = false;
+    if (CgiHandler::getFileDelegation(cgi_headers, target, is_uri))
+        return _build_delegated_response(client, cgi_headers, target, is_uri);
+
+    HttpResponse response;
+    response.setBody(body);
+
+    if (cgi_headers.count("Status"))
+    {
+        int code = CgiHandler::parseStatus(cgi_headers["Status"]);
+        if (!code)
+        {
+            Logger::error("CGI sent an invalid Status: {}", cgi_headers["Status"]);
+            return HttpResponse::createErrorResponse(502);
+        }
+        response.setStatus(code);
+    }
+    else
+        response.setStatus(200);
+
+    for (std::map<std::string, std::string>::iterator it = cgi_headers.begin(); it != cgi_headers.end(); ++it)
+    {
+        if (it->first != "Status")
+            response.setHeader(it->first, it->second);
+    }
+
+    // The script's own Cache-Control decides whether a cgi_cache run is stored
+    if (!client.cgi_cache_key.empty() && !client.cgi_cache_waiting)
+        client.cgi_cache_ttl = CgiCache::storableTtl(response.getStatus(), cgi_headers, client.cgi_cache_ttl);
+
+    return response;
+}
+
+/*
+	Serve the file named by X-Accel-Redirect / X-Sendfile through the static path.
+	On success the script's other headers (Content-Type, Content-Disposition,
+	Cache-Control...) are kept; the status and length come from the file.
+*/
+HttpResponse Server::_build_delegated_response(Client& client, const CgiHandler::HeaderMap& cgi_headers,
+                                               const std::string& target, bool is_uri)
+{
+    RequestHandler router(*client.config);
+    HttpResponse response = is_uri ? router.serveInternalRedirect(target)
+                                   : router.serveSendfile(target);
+    Logger::info("CGI delegated {} to the server (status {})", target, response.getStatus());
+
+    if (response.getStatus() == 200)
+    {
+        for (CgiHandler::HeaderMap::const_iterator it = cgi_headers.begin(); it != cgi_headers.end(); ++it)
+        {
+            std::string name = StringUtils::toLower(it->first);
+            if (name == "status" || name == "content-length" ||
+                name == "x-accel-redirect" || name == "x-sendfile")
+                continue;
+            response.setHeader(it->first, it->second);
+        }
+    }
+
+    if (!client.cgi_cache_key.empty() && !client.cgi_cache_waiting)
+        client.cgi_cache_ttl = CgiCache::storableTtl(response.getStatus(), cgi_headers, client.cgi_cache_ttl);
+
+    return response;
+}
+
+/*
+	Serialize a response for a client and switch it to writing
+*/
+void Server::_queue_response(int client_fd, HttpResponse& response)
+{
+    Client& client = _clients[client_fd];
+
+    if (client.keep_alive)
+        response.setHeader("Connection", "keep-alive");
+    else
+        response.setHeader("Connection", "close");
+
+    client.response_buffer.clear();
+    response.serializeTo(client.response_buffer);
+    client.state = CLIENT_WRITING_RESPONSE;
+    _modify_epoll(client_fd, EPOLLIN | EPOLLOUT);
+}
+
+/*
+	End the cgi_cache run led by this client: store the result if allowed
+	and give every client queued on the same key its own copy
+*/
+void Server::_finish_cgi_flight(Client& client, const HttpResponse& response)
+{
+    if (client.cgi_cache_key.empty() || client.cgi_cache_waiting)
+        return;
+
+    std::string key = client.cgi_cache_key;
+    client.cgi_cache_key.clear();
+
+    if (response.getStatus() == 200)
+        _cgi_cache.store(key, response, client.cgi_cache_ttl, std::time(NULL));
+
+    std::vector<int> waiters = _cgi_cache.finishFlight(key);
+    for (size_t i = 0; i < waiters.size(); ++i)
+    {
+        std::map<int, Client>::iterator it = _clients.find(waiters[i]);
+        if (it == _clients.end() || !it->second.cgi_cache_waiting)
+            continue;
+
+        it->second.cgi_cache_key.clear();
+        it->second.cgi_cache_waiting = false;
+        HttpResponse copy = response;
+        _queue_response(waiters[i], copy);
+    }
+    if (!waiters.empty())
+        Logger::info("CGI result shared with {} waiting clients", waiters.size());
+}
+
+// ========================================
+// FastCGI upstream
+// ========================================
+
+/*
+	Attach a worker connection (pooled or fresh) to a prepared FastCGI request
+*/
+void Server::_start_fastcgi(int client_fd)
+{
+    Client& client = _clients[client_fd];
+    const std::string socket_path = client.cgi_handler->getFastCgiPass();
+
+    int fd = _upstream_pool.acquire(socket_path);
+    if (fd == -1)
+        fd = FastCgi::connectUnix(socket_path);
+
+    if (fd == -1)
+    {
+        Logger::error("Cannot connect to FastCGI worker at {}", socket_path);
+        HttpResponse response = HttpResponse::createErrorResponse(502);
+        _finish_cgi_flight(client, response);
+        _cleanup_cgi(client);
+        _queue_response(client_fd, response);
+        return;
+    }
+
+    client.cgi_output_fd = fd;
+    client.cgi_write_offset = 0;
+    _add_to_epoll(fd, EPOLLIN | EPOLLOUT);
+    _cgi_fd_map[fd] = client_fd;
+
+    // Wait for the worker before reading or writing on the client again
+    _modify_epoll(client_fd, 0);
+    Logger::info("FastCGI request for client FD {} sent on upstream fd {}", client_fd, fd);
+}
+
+/*
+	Drive one FastCGI exchange: flush request records, then decode the reply
+*/
+void Server::_handle_fastcgi_data(int client_fd, int fcgi_fd, uint32_t events)
+{
+    Client& client = _clients[client_fd];
+    CgiHandler* handler = client.cgi_handler;
+
+    // 1. Send the encoded request (BEGIN_REQUEST + PARAMS + STDIN)
+    const std::string& request = handler->getFastCgiRequest();
+    if ((events & EPOLLOUT) && client.cgi_write_offset < request.size())
+    {
+        ssize_t written = send(fcgi_fd, request.c_str() + client.cgi_write_offset,
+                               request.size() - client.cgi_write_offset, 0);
+        if (written > 0)
+        {
+            client.cgi_write_offset += written;
+            client.updateActivity();
+            if (client.cgi_write_offset >= request.size())
+                _modify_epoll(fcgi_fd, EPOLLIN);
+        }
+        else
+            Logger::debug("FastCGI send returned {}, waiting for next epoll event", written);
+    }
+
+    // 2. Read and decode the reply
+    if (!(events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+        return;
+
+    char buffer[READ_BUFFER_SIZE];
+    ssize_t bytes = recv(fcgi_fd, buffer, sizeof(buffer), 0);
+
+    if (bytes < 0 && !(events & (EPOLLHUP | EPOLLERR)))
+        return;  // Not ready yet
+
+    if (bytes <= 0)
+    {
+        Logger::error("FastCGI worker closed connection before END_REQUEST");
+        _abort_fastcgi(client_fd, 502);
+        return;
+    }
+
+    client.updateActivity();
+    FastCgi::ResponseParser& parser = handler->getFastCgiParser();
+    std::string stdout_data;
+    parser.feed(buffer, bytes, stdout_data);
+    client.response_buffer.append(stdout_data);
+
+    if (parser.hasError())
+    {
+        Logger::error("Malformed FastCGI response for client FD {}", client_fd);
+        _abort_fastcgi(client_fd, 502);
+        return;
+    }
+    if (!parser.isComplete())
+        return;
+
+    HttpResponse response;
+    if (parser.getAppStatus() != 0)
+    {
+        Logger::error("FastCGI application exited with status: {}", parser.getAppStatus());
+        response = HttpResponse::createErrorResponse(500);
+    }
+    else
+        response = _build_cgi_response(client, client.response_buffer);
+
+    // Exchange complete: the connection goes back to the pool
+    _remove_from_epoll(fcgi_fd);
+    _cgi_fd_map.erase(fcgi_fd);
+    client.cgi_output_fd = -1;
+    if (parser.getTrailingBytes() == 0)
+        _upstream_pool.release(handler->getFastCgiPass(), fcgi_fd);
+    else
+        close(fcgi_fd);
+
+    _finish_cgi_flight(client, response);
+    _cleanup_cgi(client);
+
+    _queue_response(client_fd, response);
+}
+
+/*
+	Drop a failed FastCGI exchange; the connection is never reused
+*/
+void Server::_abort_fastcgi(int client_fd, int status_code)
+{
+    Client& client = _clients[client_fd];
+
+    HttpResponse response = HttpResponse::createErrorResponse(status_code);
+    _finish_cgi_flight(client, response);
+    _cleanup_cgi(client);
+
+    client.keep_alive = false;
+    _queue_response(client_fd, response);
+}
+
 } // namespace wsv
@@ -0,0 +1,155 @@
+#include "Server.hpp"
+#include <algorithm>
+
+namespace wsv
+{
+
+/*
+	Client preface seen on a fresh connection: speak HTTP/2 from here on
+*/
+void Server::_start_h2(int client_fd)
+{
+	Client& client = _clients[client_fd];
+
+	client.h2_checked = true;
+	client.h2 = new Http2Connection(_h2_max_body(*client.config));
+	Logger::info("HTTP/2 ({}) on client FD {}", client.tls ? "TLS" : "prior knowledge", client_fd);
+
+	// The buffered bytes start with the preface; the connection consumes it.
+	// They are copied out first: feeding them may close the client.
+	std::string data(client.request().input().data(), client.request().input().size());
+	client.compact();
+	_handle_h2_data(client_fd, data.c_str(), data.size());
+}
+
+/*
+	`Upgrade: h2c` on a complete HTTP/1.1 request: answer 101 and serve the
+	request as stream 1. Requests with a body, or for locations that need an
+	async handler, stay on HTTP/1.1 (the upgrade is optional for the server).
+	h2c is cleartext only: TLS clients negotiate h2 with ALPN instead.
+*/
+bool Server::_try_h2_upgrade(int client_fd)
+{
+	Client& client = _clients[client_fd];
+	const HttpRequest& request = client.request();
+
+	if (client.tls || request.getVersionId() != HTTP_1_1 || request.getBodyReceived() > 0 ||
+		!request.hasHeader(HEADER_HTTP2_SETTINGS))
+		return false;
+
+	if (!request.headerHasToken(HEADER_UPGRADE, "h2c") ||
+		!request.headerHasToken(HEADER_CONNECTION, "upgrade") ||
+		!request.headerHasToken(HEADER_CONNECTION, "http2-settings"))
+		return false;
+
+	// Routes the request a second time when it is served as stream 1: the
+	// upgrade compacts the connection, so its context cannot be kept. Once
+	// per connection, at most.
+	RequestHandler handler(*client.config, &_cgi_cache, &_cgi_limiter);
+	if (!handler.canHandleInStream(request))
+		return false;
+
+	Http2Connection* h2 = new Http2Connection(_h2_max_body(*client.config));
+	if (!h2->startUpgraded(request, request.getHeader(HEADER_HTTP2_SETTINGS)))
+	{
+		delete h2;
+		return false;
+	}
+
+	Logger::info("HTTP/2 (h2c upgrade) on client FD {}", client_fd);
+	client.h2 = h2;
+	client.h2_checked = true;
+	client.keep_alive = true;
+	client.compact();
+	client.response_buffer = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+	_process_h2(client_fd);
+	return true;
+}
+
+// Client - Read (HTTP/2)
+void Server::_handle_h2_data(int client_fd, const char* data, size_t len)
+{
+	Client& client = _clients[client_fd];
+
+	if (!client.h2->feed(data, len))
+		Logger::error("HTTP/2 protocol error on client FD {}, sending GOAWAY", client_fd);
+	_process_h2(client_fd);
+}
+
+/*
+	Answer every complete stream; responses are multiplexed by the connection
+*/
+void Server::_process_h2(int client_fd)
+{
+	Client& client = _clients[client_fd];
+	Http2Connection& h2 = *client.h2;
+	RequestHandler handler(*client.config, &_cgi_cache, &_cgi_limiter);
+
+	int stream_id;
+	int status;
+	HttpRequest request;
+	while (h2.popRequest(stream_id, request, status))
+	{
+		if (!status && _too_early(client, request))
+			status = 425;
+		HttpResponse response = status ? ErrorHandler::get_error_page(status, *client.config)
+									   : handler.handleStreamRequest(request);
+		Logger::info("HTTP/2 stream {} on FD {} - Status: {}", stream_id, client_fd, response.getStatus());
+		h2.submitResponse(stream_id, response, request.getMethodId() == METHOD_HEAD);
+		client.requests_count++;
+	}
+
+	if (h2.wantsWrite() || !client.response_buffer.empty())
+		_modify_epoll(client_fd, EPOLLIN | EPOLLOUT);
+	else if (h2.isClosing())
+		_close_client(client_fd);
+}
+
+// Client - Write (HTTP/2)
+void Server::_handle_h2_write(int client_fd)
+{
+	Client& client = _clients[client_fd];
+	std::string& buffer = client.response_buffer;
+
+	if (buffer.empty())
+		client.h2->produce(buffer, H2_WRITE_BUDGET);
+
+	if (!buffer.empty())
+	{
+		ssize_t bytes_sent = _client_send(client, buffer.c_str(), buffer.length());
+		if (bytes_sent < 0 && errno == EAGAIN)
+			return;
+		if (bytes_sent < 0)
+		{
+			Logger::error("Send error on FD {}", client_fd);
+			_close_client(client_fd);
+			return;
+		}
+		buffer.erase(0, bytes_sent);
+		client.updateActivity();
+	}
+
+	if (!buffer.empty() || client.h2->wantsWrite())
+		return;
+
+	if (client.h2->isClosing())
+	{
+		Logger::info("HTTP/2 connection on FD {} finished (GOAWAY)", client_fd);
+		_close_client(client_fd);
+		return;
+	}
+	// Everything sent, or blocked by flow control until a WINDOW_UPDATE
+	_modify_epoll(client_fd, EPOLLIN);
+}
+
+// Streams are buffered whole: the largest body any location accepts
+size_t Server::_h2_max_body(const ServerConfig& config) const
+{
+	size_t max_body = config.client_max_body_size;
+
+	for (size_t i = 0; i < config.locations.size(); ++i)
+		max_body = std::max(max_body, config.locations[i].client_max_body_size);
+	return max_body;
+}
+
+} // namespace wsv
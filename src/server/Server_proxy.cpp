@@ -0,0 +1,496 @@
+#include "Server.hpp"
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <ctime>
+
+namespace wsv {
+
+/*
+	Methods safe to resend when a pooled connection turns out to be closed
+*/
+static bool is_idempotent(HttpMethod method)
+{
+    return method == METHOD_GET || method == METHOD_HEAD || method == METHOD_DELETE;
+}
+
+/*
+	Key of the hash policy: the client address or the request URI
+*/
+static std::string hash_input(const Client& client, const UpstreamGroup& group)
+{
+    if (group.hashesRemoteAddr())
+    {
+        char ip[INET_ADDRSTRLEN];
+        if (!inet_ntop(AF_INET, &client.address.sin_addr, ip, sizeof(ip)))
+            return "";
+        return ip;
+    }
+    if (client.request().getQuery().empty())
+        return client.request().getPath();
+    return client.request().getPath() + "?" + client.request().getQuery();
+}
+
+/*
+	Attach an upstream connection (pooled or new) to a CLIENT_PROXYING client
+*/
+void Server::_start_proxy(int client_fd)
+{
+    Client& client = _clients[client_fd];
+    const LocationConfig& location = *client.proxy_location;
+    std::string host = location.proxy_host;
+    int port = location.proxy_port;
+
+    // upstream block: pick a live peer; it counts as in flight until released
+    if (!location.proxy_upstream.empty())
+    {
+        UpstreamGroup& group = _upstream_groups[location.proxy_upstream];
+        std::string input = (group.getPolicy() == UpstreamGroup::HASH) ? hash_input(client, group) : "";
+        int peer = group.select(input, std::time(NULL), &client.proxy_tried);
+        if (peer == -1)
+        {
+            Logger::error("No live server left in upstream {}", group.getName());
+            _fail_proxy(client_fd, 502);
+            return;
+        }
+        group.acquire(peer);
+        client.proxy_peer = peer;
+        client.proxy_tried.resize(group.size(), false);
+        client.proxy_tried[peer] = true;
+        host = group.getPeer(peer).host;
+        port = group.getPeer(peer).port;
+    }
+    client.proxy_tries++;
+
+    const std::string key = host + ":" + StringUtils::toString(port);
+    int fd = _upstream_pool.acquire(key);
+    client.proxy_reused = (fd != -1);
+    if (fd == -1)
+        fd = HttpProxy::connectTcp(host, port);
+
+    if (fd == -1)
+    {
+        Logger::error("Cannot connect to upstream {}", key);
+        _retry_proxy(client_fd, 502);
+        return;
+    }
+
+    client.proxy_fd = fd;
+    client.proxy_connected = client.proxy_reused;
+    client.proxy_write_offset = 0;
+    client.proxy_received = false;
+    client.proxy_chunked = false;
+    client.proxy_paused = false;
+    client.updateActivity();
+
+    _add_to_epoll(fd, EPOLLIN | EPOLLOUT);
+    _proxy_fd_map[fd] = client_fd;
+
+    // Nothing to read from the client until the response is relayed; a hang-up is still reported
+    _modify_epoll(client_fd, 0);
+    Logger::info("Upstream fd {} ({}) for client FD {}", fd, client.proxy_reused ? "pooled" : "new", client_fd);
+}
+
+/*
+	Drive one upstream exchange: finish connecting, send the request, relay the response
+*/
+void Server::_handle_proxy_data(int upstream_fd, uint32_t events)
+{
+    int client_fd = _proxy_fd_map[upstream_fd];
+    Client& client = _clients[client_fd];
+
+    // 1. Non-blocking connect completes with EPOLLOUT (or fails with EPOLLERR)
+    if (!client.proxy_connected)
+    {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(upstream_fd, SOL_SOCKET, SO_ERROR, &error, &len) == -1 || error != 0)
+        {
+            Logger::error("Upstream connect failed for client FD {}: {}", client_fd, std::strerror(error));
+            _retry_proxy(client_fd, 502);
+            return;
+        }
+        if (!(events & EPOLLOUT))
+            return;
+        client.proxy_connected = true;
+        client.updateActivity();
+    }
+
+    // 2. Send the request (head and buffered body)
+    const std::string& request = client.proxy_request;
+    if ((events & EPOLLOUT) && client.proxy_write_offset < request.size())
+    {
+        ssize_t sent = send(upstream_fd, request.c_str() + client.proxy_write_offset,
+                            request.size() - client.proxy_write_offset, 0);
+        if (sent > 0)
+        {
+            client.proxy_write_offset += sent;
+            client.updateActivity();
+            if (client.proxy_write_offset >= request.size())
+                _modify_epoll(upstream_fd, EPOLLIN);
+        }
+        else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            events |= EPOLLERR;  // Handled as a failed read below
+    }
+
+    // 3. Read and relay the response
+    if (!(events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+        return;
+
+    char buffer[PROXY_READ_SIZE];
+    ssize_t bytes = recv(upstream_fd, buffer, sizeof(buffer), 0);
+
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && !(events & (EPOLLHUP | EPOLLERR)))
+        return;  // Not ready yet
+
+    if (bytes <= 0)
+    {
+        // A pooled connection the upstream closed while idle: resend on a fresh one
+        if (!client.proxy_received && client.proxy_reused && is_idempotent(client.request().getMethodId()))
+        {
+            Logger::info("Pooled upstream connection was closed, retrying for client FD {}", client_fd);
+            // Not the peer's fault: it may be chosen again
+            if (client.proxy_peer != -1)
+                client.proxy_tried[client.proxy_peer] = false;
+            _cleanup_proxy(client);
+            client.proxy_tries--;
+            _start_proxy(client_fd);
+            return;
+        }
+
+        if (bytes == 0)
+            client.proxyParser().feedEof();
+        if (client.proxyParser().isComplete())
+        {
+            if (!client.proxyParser().hasHead() || client.state != CLIENT_WRITING_RESPONSE)
+                _start_proxy_response(client_fd);
+            _finish_proxy(client_fd);
+        }
+        else
+        {
+            Logger::error("Upstream closed the connection mid-response for client FD {}", client_fd);
+            _fail_proxy(client_fd, 502);
+        }
+        return;
+    }
+
+    client.proxy_received = true;
+    client.updateActivity();
+
+    bool had_head = client.proxyParser().hasHead();
+    std::string body;
+    if (!client.proxyParser().feed(buffer, bytes, body))
+    {
+        Logger::error("Malformed upstream response for client FD {}", client_fd);
+        _fail_proxy(client_fd, 502);
+        return;
+    }
+    if (!client.proxyParser().hasHead())
+        return;
+    if (!had_head)
+        _start_proxy_response(client_fd);
+
+    if (!body.empty())
+    {
+        if (client.proxy_chunked)
+        {
+            std::ostringstream size;
+            size << std::hex << body.size();
+            client.response_buffer += size.str() + "\r\n" + body + "\r\n";
+        }
+        else
+            client.response_buffer += body;
+    }
+
+    if (client.proxyParser().isComplete())
+    {
+        _finish_proxy(client_fd);
+        return;
+    }
+
+    // Backpressure: a slow client stops the upstream reads instead of growing the buffer
+    if (client.response_buffer.size() > PROXY_BUFFER_LIMIT && !client.proxy_paused)
+    {
+        client.proxy_paused = true;
+        _modify_epoll(upstream_fd, 0);
+    }
+    if (!client.response_buffer.empty())
+        _modify_epoll(client_fd, EPOLLOUT);
+}
+
+/*
+	Response head received: choose the framing towards the client and queue the head
+*/
+void Server::_start_proxy_response(int client_fd)
+{
+    Client& client = _clients[client_fd];
+    const HttpProxy::ResponseParser& parser = client.proxyParser();
+
+    // Chunked bodies are decoded and re-chunked for HTTP/1.1 clients;
+    // HTTP/1.0 clients and close-delimited upstreams get a close-delimited body
+    HttpProxy::ResponseParser::Framing framing = parser.getFraming();
+    client.proxy_chunked = (framing == HttpProxy::ResponseParser::FRAMING_CHUNKED
+                            && client.request().getVersionId() == HTTP_1_1);
+    if (framing == HttpProxy::ResponseParser::FRAMING_CLOSE ||
+        (framing == HttpProxy::ResponseParser::FRAMING_CHUNKED && !client.proxy_chunked))
+        client.keep_alive = false;
+
+    client.response_buffer = HttpProxy::buildClientHead(parser, client.proxy_chunked, client.keep_alive);
+    client.state = CLIENT_WRITING_RESPONSE;
+    Logger::info("Upstream answered {} for client FD {}", parser.getStatus(), client_fd);
+}
+
+/*
+	Upstream response complete: pool the connection and let the client drain
+*/
+void Server::_finish_proxy(int client_fd)
+{
+    Client& client = _clients[client_fd];
+    const LocationConfig& location = *client.proxy_location;
+
+    if (client.proxy_chunked)
+        client.response_buffer += "0\r\n\r\n";
+
+    std::string key = location.proxy_host + ":" + StringUtils::toString(location.proxy_port);
+    if (client.proxy_peer != -1)
+        key = _upstream_groups[location.proxy_upstream].getPeer(client.proxy_peer).key;
+    _release_peer(client, false);
+
+    int fd = client.proxy_fd;
+    _remove_from_epoll(fd);
+    _proxy_fd_map.erase(fd);
+    if (client.proxyParser().isReusable())
+        _upstream_pool.release(key, fd);
+    else
+        close(fd);
+    client.proxy_fd = -1;
+    client.proxy_paused = false;
+    client.proxy_request.clear();
+
+    if (client.response_buffer.empty())
+        _finish_response(client_fd);
+    else
+        _modify_epoll(client_fd, EPOLLIN | EPOLLOUT);
+}
+
+/*
+	Upstream failure: an error page if nothing was sent yet, otherwise cut the response
+*/
+void Server::_fail_proxy(int client_fd, int status_code)
+{
+    Client& client = _clients[client_fd];
+    bool head_sent = (client.state == CLIENT_WRITING_RESPONSE);
+
+    _release_peer(client, true);
+    _cleanup_proxy(client);
+    if (head_sent)
+    {
+        Logger::error("Upstream failed after the response started, closing FD {}", client_fd);
+        _close_client(client_fd);
+        return;
+    }
+
+    HttpResponse response = HttpResponse::createErrorResponse(status_code);
+    _queue_response(client_fd, response);
+}
+
+/*
+	Connect failure or timeout: try a peer of the upstream block not tried yet,
+	else answer status_code (502 refused, 504 timed out)
+*/
+void Server::_retry_proxy(int client_fd, int status_code)
+{
+    Client& client = _clients[client_fd];
+    const LocationConfig& location = *client.proxy_location;
+
+    _release_peer(client, true);
+    _cleanup_proxy(client);
+
+    if (!location.proxy_upstream.empty() &&
+        client.proxy_tries < static_cast<int>(_upstream_groups[location.proxy_upstream].size()))
+    {
+        Logger::info("Trying the next server of upstream {} for client FD {}", location.proxy_upstream, client_fd);
+        _start_proxy(client_fd);
+        return;
+    }
+    _fail_proxy(client_fd, status_code);
+}
+
+/*
+	Give the peer back to its upstream block; failures count towards max_fails
+*/
+void Server::_release_peer(Client& client, bool failed)
+{
+    if (client.proxy_peer == -1)
+        return;
+
+    UpstreamGroup& group = _upstream_groups[client.proxy_location->proxy_upstream];
+    group.release(client.proxy_peer, failed, std::time(NULL));
+    if (failed && !group.isAvailable(client.proxy_peer, std::time(NULL)))
+        Logger::error("Upstream {} server {} marked down", group.getName(), group.getPeer(client.proxy_peer).key);
+    client.proxy_peer = -1;
+}
+
+/*
+	Drop the upstream connection of a client; it is never reused
+*/
+void Server::_cleanup_proxy(Client& client)
+{
+    _release_peer(client, false);
+    if (client.proxy_fd == -1)
+        return;
+
+    _remove_from_epoll(client.proxy_fd);
+    _proxy_fd_map.erase(client.proxy_fd);
+    close(client.proxy_fd);
+    client.proxy_fd = -1;
+    client.proxy_paused = false;
+}
+
+/*
+	Connect timeout until connected, then the allowed upstream silence.
+	Reads paused by backpressure wait on the client, not on the upstream.
+*/
+long Server::_proxy_timeout(const Client& client) const
+{
+    const LocationConfig* location = client.proxy_location;
+
+    if (client.proxy_paused)
+        return CLIENT_IDLE_TIMEOUT;
+    if (!client.proxy_connected)
+        return (location && location->proxy_connect_timeout > 0) ? location->proxy_connect_timeout
+                                                                  : PROXY_CONNECT_TIMEOUT;
+    return (location && location->proxy_read_timeout > 0) ? location->proxy_read_timeout
+                                                           : PROXY_READ_TIMEOUT;
+}
+
+// ========================================
+// Active health checks
+// ========================================
+
+/*
+	Timer tick: start due probes and fail the ones that took too long
+*/
+void Server::_run_health_checks()
+{
+    std::time_t now = std::time(NULL);
+    std::vector<int> expired;
+
+    for (std::map<std::string, UpstreamGroup>::iterator it = _upstream_groups.begin();
+         it != _upstream_groups.end(); ++it)
+    {
+        UpstreamGroup& group = it->second;
+        if (!group.hasHealthCheck())
+            continue;
+
+        for (size_t i = 0; i < group.size(); ++i)
+        {
+            UpstreamGroup::Peer& peer = group.getPeer(i);
+            if (peer.probe_fd != -1)
+            {
+                if (now - peer.probe_started >= group.getHealthTimeout())
+                    expired.push_back(peer.probe_fd);
+                continue;
+            }
+            if (now < peer.next_probe)
+                continue;
+
+            int fd = HttpProxy::connectTcp(peer.host, peer.port);
+            if (fd == -1)
+            {
+                peer.next_probe = now + group.getHealthInterval();
+                if (group.reportProbe(i, false))
+                    Logger::error("Upstream {} server {} failed its health check", group.getName(), peer.key);
+                continue;
+            }
+            peer.probe_fd = fd;
+            peer.probe_started = now;
+            peer.probe_buffer.clear();
+            _add_to_epoll(fd, EPOLLOUT);
+            _probe_fd_map[fd] = std::make_pair(group.getName(), static_cast<int>(i));
+        }
+    }
+
+    for (size_t i = 0; i < expired.size(); ++i)
+        _finish_probe(expired[i], false);
+}
+
+/*
+	Probe exchange: `GET <uri>` once connected, then a 2xx/3xx status line passes
+*/
+void Server::_handle_probe_data(int probe_fd, uint32_t events)
+{
+    const std::pair<std::string, int>& ref = _probe_fd_map[probe_fd];
+    UpstreamGroup& group = _upstream_groups[ref.first];
+    UpstreamGroup::Peer& peer = group.getPeer(ref.second);
+
+    if (events & EPOLLOUT)
+    {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(probe_fd, SOL_SOCKET, SO_ERROR, &error, &len) == -1 || error != 0)
+        {
+            _finish_probe(probe_fd, false);
+            return;
+        }
+        std::string request = "GET " + group.getHealthUri() + " HTTP/1.1\r\nHost: " + peer.host +
+                              "\r\nUser-Agent: webserv-health-check\r\nConnection: close\r\n\r\n";
+        // A few dozen bytes always fit in a fresh socket buffer
+        if (send(probe_fd, request.c_str(), request.size(), 0) != static_cast<ssize_t>(request.size()))
+        {
+            _finish_probe(probe_fd, false);
+            return;
+        }
+        _modify_epoll(probe_fd, EPOLLIN);
+        return;
+    }
+
+    char buffer[512];
+    ssize_t bytes = recv(probe_fd, buffer, sizeof(buffer), 0);
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return;
+    if (bytes <= 0)
+    {
+        _finish_probe(probe_fd, false);
+        return;
+    }
+
+    peer.probe_buffer.append(buffer, bytes);
+    size_t end = peer.probe_buffer.find("\r\n");
+    if (end == std::string::npos)
+    {
+        if (peer.probe_buffer.size() > 256)
+            _finish_probe(probe_fd, false);
+        return;
+    }
+
+    // HTTP/1.x NNN ...
+    const std::string& line = peer.probe_buffer;
+    bool passed = end >= 12 && StringUtils::startsWith(line, "HTTP/1.") && line[8] == ' ' &&
+                  (line[9] == '2' || line[9] == '3');
+    _finish_probe(probe_fd, passed);
+}
+
+void Server::_finish_probe(int probe_fd, bool passed)
+{
+    std::pair<std::string, int> ref = _probe_fd_map[probe_fd];
+    UpstreamGroup& group = _upstream_groups[ref.first];
+    UpstreamGroup::Peer& peer = group.getPeer(ref.second);
+
+    _remove_from_epoll(probe_fd);
+    _probe_fd_map.erase(probe_fd);
+    close(probe_fd);
+    peer.probe_fd = -1;
+    peer.probe_buffer.clear();
+    peer.next_probe = std::time(NULL) + group.getHealthInterval();
+
+    if (group.reportProbe(ref.second, passed))
+    {
+        if (passed)
+            Logger::info("Upstream {} server {} is healthy again", group.getName(), peer.key);
+        else
+            Logger::error("Upstream {} server {} failed its health check", group.getName(), peer.key);
+    }
+}
+
+} // namespace wsv
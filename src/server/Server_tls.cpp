@@ -0,0 +1,82 @@
+#include "Server.hpp"
+
+namespace wsv
+{
+
+/*
+	Drive the handshake of a TLS client; readiness follows what OpenSSL waits for
+*/
+void Server::_handle_tls_handshake(int client_fd)
+{
+	Client& client = _clients[client_fd];
+
+	switch (client.tls->handshake())
+	{
+		case TlsConnection::TLS_WANT_READ:
+			_modify_epoll(client_fd, EPOLLIN);
+			return;
+		case TlsConnection::TLS_WANT_WRITE:
+			_modify_epoll(client_fd, EPOLLIN | EPOLLOUT);
+			return;
+		case TlsConnection::TLS_FAILED:
+			Logger::error("TLS handshake failed on client FD {}", client_fd);
+			_close_client(client_fd);
+			return;
+		case TlsConnection::TLS_DONE:
+			break;
+	}
+
+	client.updateActivity();
+	Logger::info("{} handshake on client FD {} ({})", client.tls->version(), client_fd,
+				 client.tls->isEarly() ? "0-RTT" : client.tls->isResumed() ? "resumed" : "full");
+	if (client.tls->kernelSend())
+		Logger::debug("kTLS send offload active on client FD {}", client_fd);
+	_modify_epoll(client_fd, EPOLLIN);
+
+	// The first request came with the ClientHello and is already read
+	if (client.tls->hasPendingData())
+		_handle_client_data(client_fd);
+}
+
+/*
+	0-RTT data can be replayed by an attacker: only safe methods are served
+	from it, the rest get 425 and are retried after the handshake (RFC 8470)
+*/
+bool Server::_too_early(const Client& client, const HttpRequest& request) const
+{
+	if (!client.tls || !client.tls->isEarly())
+		return false;
+	return request.getMethodId() != METHOD_GET && request.getMethodId() != METHOD_HEAD;
+}
+
+// Client socket I/O: plain read()/send(), or through the TLS connection
+ssize_t Server::_client_recv(Client& client, char* buffer, size_t len)
+{
+	if (client.tls)
+		return client.tls->read(buffer, len);
+	return read(client.client_fd, buffer, len);
+}
+
+// Read into the tail of a receive buffer. SSL_read returns at most one record,
+// so TLS gets a record-sized tail; an empty buffer keeps no slab when nothing
+// was read.
+ssize_t Server::_client_recv(Client& client, RecvBuffer& input)
+{
+	if (!client.tls)
+		return input.readFrom(client.client_fd);
+	ssize_t bytes_read = client.tls->read(input.prepare(READ_BUFFER_SIZE), READ_BUFFER_SIZE);
+	if (bytes_read > 0)
+		input.commit(bytes_read);
+	else if (input.empty())
+		input.release();
+	return bytes_read;
+}
+
+ssize_t Server::_client_send(Client& client, const char* data, size_t len)
+{
+	if (client.tls)
+		return client.tls->write(data, len);
+	return send(client.client_fd, data, len, 0);
+}
+
+} // namespace wsv
@@ -0,0 +1,286 @@
+#include "Tls.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+namespace wsv
+{
+
+// ALPN wire format: length-prefixed protocol names, preferred first
+static const char ALPN_H2[] = "\x02h2\x08http/1.1";
+static const char ALPN_HTTP1[] = "\x08http/1.1";
+
+static std::string lastError()
+{
+	unsigned long code = ERR_get_error();
+	if (code == 0)
+		return "unknown error";
+	char buffer[256];
+	ERR_error_string_n(code, buffer, sizeof(buffer));
+	ERR_clear_error();
+	return buffer;
+}
+
+// ==================== TlsContext ====================
+TlsContext::TlsContext(const ServerConfig& config)
+	: _ctx(SSL_CTX_new(TLS_server_method()))
+	, _alpn(config.http2 ? std::string(ALPN_H2, sizeof(ALPN_H2) - 1)
+						 : std::string(ALPN_HTTP1, sizeof(ALPN_HTTP1) - 1))
+{
+	if (!_ctx)
+		throw std::runtime_error("SSL_CTX_new failed: " + lastError());
+
+	SSL_CTX_set_min_proto_version(_ctx, TLS1_2_VERSION);
+
+	unsigned long options = SSL_OP_NO_RENEGOTIATION | SSL_OP_CIPHER_SERVER_PREFERENCE
+				 | SSL_OP_IGNORE_UNEXPECTED_EOF;
+	if (!config.ssl_session_tickets)
+		options |= SSL_OP_NO_TICKET;
+	if (config.ssl_ktls)
+		options |= SSL_OP_ENABLE_KTLS;
+	SSL_CTX_set_options(_ctx, options);
+
+	// Response buffers are retried after EAGAIN as the same (but moved) bytes;
+	// idle keep-alive connections give their record buffers back
+	SSL_CTX_set_mode(_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER
+					 | SSL_MODE_RELEASE_BUFFERS);
+
+	if (SSL_CTX_use_certificate_chain_file(_ctx, config.ssl_certificate.c_str()) != 1 ||
+		SSL_CTX_use_PrivateKey_file(_ctx, config.ssl_certificate_key.c_str(), SSL_FILETYPE_PEM) != 1 ||
+		SSL_CTX_check_private_key(_ctx) != 1)
+	{
+		std::string error = lastError();
+		SSL_CTX_free(_ctx);
+		throw std::runtime_error("Cannot load " + config.ssl_certificate + " / "
+								 + config.ssl_certificate_key + ": " + error);
+	}
+
+	// Resumption: server-side cache (TLS 1.2 session IDs, TLS 1.3 stateful
+	// tickets when tickets are off) and stateless tickets, same lifetime
+	static const unsigned char session_context[] = "webserv";
+	SSL_CTX_set_session_id_context(_ctx, session_context, sizeof(session_context) - 1);
+	if (config.ssl_session_cache > 0)
+	{
+		SSL_CTX_set_session_cache_mode(_ctx, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_sess_set_cache_size(_ctx, config.ssl_session_cache);
+	}
+	else
+		SSL_CTX_set_session_cache_mode(_ctx, SSL_SESS_CACHE_OFF);
+	SSL_CTX_set_timeout(_ctx, config.ssl_session_timeout);
+
+	// 0-RTT: announced in the tickets; OpenSSL accepts each ticket's early data once
+	if (config.ssl_early_data)
+		SSL_CTX_set_max_early_data(_ctx, MAX_EARLY_DATA);
+
+	SSL_CTX_set_alpn_select_cb(_ctx, &TlsContext::_selectAlpn, this);
+}
+
+TlsContext::~TlsContext()
+{
+	SSL_CTX_free(_ctx);
+}
+
+int TlsContext::_selectAlpn(ssl_st*, const unsigned char** out, unsigned char* outlen,
+							const unsigned char* in, unsigned int inlen, void* arg)
+{
+	const std::string& offered = static_cast<TlsContext*>(arg)->_alpn;
+	unsigned char* selected;
+	if (SSL_select_next_proto(&selected, outlen, reinterpret_cast<const unsigned char*>(offered.data()),
+							  offered.size(), in, inlen) != OPENSSL_NPN_NEGOTIATED)
+		return SSL_TLSEXT_ERR_NOACK;
+	*out = selected;
+	return SSL_TLSEXT_ERR_OK;
+}
+
+// ==================== TlsConnection ====================
+TlsConnection::TlsConnection(const TlsContext& context, int fd)
+	: _ssl(SSL_new(context.get()))
+	, _established(false)
+	, _failed(false)
+	, _early_reading(SSL_CTX_get_max_early_data(context.get()) > 0)
+{
+	if (!_ssl || SSL_set_fd(_ssl, fd) != 1)
+	{
+		_failed = true;
+		return;
+	}
+	SSL_set_accept_state(_ssl);
+}
+
+TlsConnection::~TlsConnection()
+{
+	if (_ssl)
+		SSL_free(_ssl);
+}
+
+TlsConnection::Result TlsConnection::handshake()
+{
+	if (_failed)
+		return TLS_FAILED;
+
+	if (_early_reading)
+	{
+		char buffer[TlsContext::MAX_EARLY_DATA];
+		size_t bytes = 0;
+		ERR_clear_error();
+		int ret = SSL_read_early_data(_ssl, buffer, sizeof(buffer), &bytes);
+		if (ret == SSL_READ_EARLY_DATA_ERROR)
+			return _handshakeResult(ret);
+		_early_pending.append(buffer, bytes);
+		if (ret == SSL_READ_EARLY_DATA_SUCCESS)
+		{
+			// Serve the 0-RTT request now; read() finishes the handshake later
+			_established = true;
+			return TLS_DONE;
+		}
+		// No early data, or it was rejected: regular handshake
+		_early_reading = false;
+	}
+
+	ERR_clear_error();
+	int ret = SSL_do_handshake(_ssl);
+	if (ret == 1)
+	{
+		_established = true;
+		return TLS_DONE;
+	}
+	return _handshakeResult(ret);
+}
+
+TlsConnection::Result TlsConnection::_handshakeResult(int ret)
+{
+	switch (SSL_get_error(_ssl, ret))
+	{
+		case SSL_ERROR_WANT_READ:
+			return TLS_WANT_READ;
+		case SSL_ERROR_WANT_WRITE:
+			return TLS_WANT_WRITE;
+		default:
+			_failed = true;
+			ERR_clear_error();
+			return TLS_FAILED;
+	}
+}
+
+ssize_t TlsConnection::read(char* buffer, size_t len)
+{
+	if (_failed)
+		return -1;
+
+	if (!_early_pending.empty())
+	{
+		size_t bytes = _early_pending.size() < len ? _early_pending.size() : len;
+		std::memcpy(buffer, _early_pending.data(), bytes);
+		_early_pending.erase(0, bytes);
+		return bytes;
+	}
+
+	ERR_clear_error();
+	if (_early_reading)
+	{
+		size_t bytes = 0;
+		int ret = SSL_read_early_data(_ssl, buffer, len, &bytes);
+		if (ret == SSL_READ_EARLY_DATA_ERROR)
+			return _result(ret);
+		if (ret == SSL_READ_EARLY_DATA_SUCCESS)
+			return bytes;
+		// EndOfEarlyData: SSL_read completes the handshake from here on
+		_early_reading = false;
+		if (bytes > 0)
+			return bytes;
+	}
+	return _result(SSL_read(_ssl, buffer, static_cast<int>(len)));
+}
+
+ssize_t TlsConnection::write(const char* data, size_t len)
+{
+	if (_failed)
+		return -1;
+	// SSL_write takes an int; the rest goes on the next call
+	int chunk = len > (1U << 30) ? (1 << 30) : static_cast<int>(len);
+	ERR_clear_error();
+	ssize_t sent;
+	if (_early_reading)
+	{
+		// 0.5-RTT data, sent before the client's Finished
+		size_t written = 0;
+		int ret = SSL_write_early_data(_ssl, data, chunk, &written);
+		sent = (ret == 1) ? static_cast<ssize_t>(written) : _result(0);
+	}
+	else
+		sent = _result(SSL_write(_ssl, data, chunk));
+	if (sent == 0)
+	{
+		// close_notify received: nothing more can be sent
+		errno = EPIPE;
+		return -1;
+	}
+	return sent;
+}
+
+ssize_t TlsConnection::_result(int ret)
+{
+	if (ret > 0)
+		return ret;
+
+	switch (SSL_get_error(_ssl, ret))
+	{
+		case SSL_ERROR_WANT_READ:
+		case SSL_ERROR_WANT_WRITE:
+			errno = EAGAIN;
+			return -1;
+		case SSL_ERROR_ZERO_RETURN:
+			return 0;
+		default:
+			_failed = true;
+			ERR_clear_error();
+			if (errno == 0 || errno == EAGAIN)
+				errno = EPROTO;
+			return -1;
+	}
+}
+
+void TlsConnection::shutdown()
+{
+	if (_established && !_failed)
+	{
+		ERR_clear_error();
+		SSL_shutdown(_ssl);
+		ERR_clear_error();
+	}
+}
+
+bool TlsConnection::isEarly() const
+{
+	return _early_reading && SSL_get_early_data_status(_ssl) == SSL_EARLY_DATA_ACCEPTED;
+}
+
+bool TlsConnection::isResumed() const
+{
+	return SSL_session_reused(_ssl) == 1;
+}
+
+bool TlsConnection::kernelSend() const
+{
+	return _established && BIO_get_ktls_send(SSL_get_wbio(_ssl));
+}
+
+std::string TlsConnection::alpn() const
+{
+	const unsigned char* data;
+	unsigned int len;
+	SSL_get0_alpn_selected(_ssl, &data, &len);
+	if (!data)
+		return "";
+	return std::string(reinterpret_cast<const char*>(data), len);
+}
+
+std::string TlsConnection::version() const
+{
+	return SSL_get_version(_ssl);
+}
+
+} // namespace wsv
@@ -0,0 +1,117 @@
+#ifndef TLS_HPP
+#define TLS_HPP
+
+#include <string>
+#include <sys/types.h>
+
+#include "config/ConfigParser.hpp"
+
+// OpenSSL types stay out of the headers that include this one
+struct ssl_st;
+struct ssl_ctx_st;
+
+namespace wsv
+{
+
+/**
+ * TlsContext - OpenSSL server context of one `listen ... ssl` server block
+ *
+ * Features:
+ * - Certificate chain and private key from ssl_certificate / ssl_certificate_key
+ * - TLS 1.2 and 1.3 only, no renegotiation
+ * - Session cache (ssl_session_cache, ssl_session_timeout) and session
+ *   tickets (ssl_session_tickets) so returning clients skip the full handshake
+ * - ALPN: http/1.1, and h2 first when the listener has the http2 flag
+ *   (HTTP/2 answers CGI and proxy_pass locations with 421, so it is opt-in)
+ * - 0-RTT (ssl_early_data): a resumed TLS 1.3 client may send its first
+ *   request with the ClientHello, and the response goes out with the
+ *   server's first flight (0.5-RTT data): one round trip to the first byte
+ * - Kernel TLS (ssl_ktls): once the handshake is done OpenSSL hands the
+ *   record keys to the kernel when it supports the cipher, and spliced or
+ *   sent bytes are then encrypted by the socket itself
+ */
+class TlsContext
+{
+public:
+	static const unsigned int MAX_EARLY_DATA = 16384;  // 0-RTT bytes accepted, one record
+
+	// @throw std::runtime_error if the certificate or key cannot be loaded
+	explicit TlsContext(const ServerConfig& config);
+	~TlsContext();
+
+	ssl_ctx_st*	get() const { return _ctx; }
+
+private:
+	ssl_ctx_st*	_ctx;
+	std::string	_alpn;      // Protocols we accept, ALPN wire format
+
+	static int	_selectAlpn(ssl_st* ssl, const unsigned char** out, unsigned char* outlen,
+							const unsigned char* in, unsigned int inlen, void* arg);
+
+	// Forbidden copy
+	TlsContext(const TlsContext&);
+	TlsContext& operator=(const TlsContext&);
+};
+
+/**
+ * TlsConnection - TLS state of one accepted client socket
+ *
+ * The socket stays non-blocking: handshake() is called again on each
+ * readiness event until it completes, and read()/write() report "try again"
+ * as -1 with errno EAGAIN, like recv()/send() on a plain socket.
+ *
+ * With 0-RTT, handshake() is done as soon as early data arrives: read()
+ * returns it first, write() sends 0.5-RTT data, and the rest of the
+ * handshake completes inside later read() calls.
+ */
+class TlsConnection
+{
+public:
+	enum Result
+	{
+		TLS_DONE,
+		TLS_WANT_READ,
+		TLS_WANT_WRITE,
+		TLS_FAILED
+	};
+
+	TlsConnection(const TlsContext& context, int fd);
+	~TlsConnection();
+
+	Result	handshake();
+	bool	isEstablished() const { return _established; }
+	bool	hasPendingData() const { return !_early_pending.empty(); }
+
+	// Data so far came as 0-RTT early data: it may be a replay (RFC 8470)
+	bool	isEarly() const;
+
+	// Same contract as read()/send(): bytes moved, 0 on close_notify or EOF, -1 on error
+	ssize_t	read(char* buffer, size_t len);
+	ssize_t	write(const char* data, size_t len);
+
+	// Best-effort close_notify before the socket is closed
+	void	shutdown();
+
+	bool		isResumed() const;
+	bool		kernelSend() const;     // Records are encrypted by kTLS on send
+	std::string	alpn() const;           // Negotiated protocol, empty if none
+	std::string	version() const;
+
+private:
+	ssl_st*	_ssl;
+	bool	_established;
+	bool	_failed;    // Fatal error seen: no close_notify may follow
+	bool	_early_reading;             // Early data phase: SSL_read_early_data until it finishes
+	std::string	_early_pending;         // Early data read by handshake(), handed out by read()
+
+	Result	_handshakeResult(int ret);
+	ssize_t	_result(int ret);
+
+	// Forbidden copy
+	TlsConnection(const TlsConnection&);
+	TlsConnection& operator=(const TlsConnection&);
+};
+
+} // namespace wsv
+
+#endif
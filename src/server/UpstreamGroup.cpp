@@ -0,0 +1,225 @@
+#include "UpstreamGroup.hpp"
+#include "utils/StringUtils.hpp"
+#include <algorithm>
+
+namespace wsv
+{
+
+UpstreamGroup::UpstreamGroup()
+	: _policy(ROUND_ROBIN)
+	, _cursor(0)
+	, _health_interval(0)
+	, _health_timeout(0)
+	, _health_fails(1)
+	, _health_passes(1)
+{ }
+
+UpstreamGroup::UpstreamGroup(const UpstreamConfig& config)
+	: _name(config.name)
+	, _policy(ROUND_ROBIN)
+	, _hash_key(config.hash_key)
+	, _cursor(0)
+	, _health_interval(config.health_interval)
+	, _health_timeout(config.health_timeout)
+	, _health_uri(config.health_uri)
+	, _health_fails(config.health_fails)
+	, _health_passes(config.health_passes)
+{
+	if (config.policy == "least_conn")
+		_policy = LEAST_CONN;
+	else if (config.policy == "hash")
+		_policy = HASH;
+
+	for (size_t i = 0; i < config.peers.size(); ++i)
+	{
+		const UpstreamConfig::Peer& source = config.peers[i];
+		Peer peer;
+		peer.host = source.host;
+		peer.port = source.port;
+		peer.key = source.host + ":" + StringUtils::toString(source.port);
+		peer.weight = source.weight;
+		peer.max_fails = source.max_fails;
+		peer.fail_timeout = source.fail_timeout;
+		peer.in_flight = 0;
+		peer.current_weight = 0;
+		peer.fails = 0;
+		peer.window_start = 0;
+		peer.down_until = 0;
+		peer.healthy = true;    // Until a probe says otherwise
+		peer.probe_streak = 0;
+		peer.probe_fd = -1;
+		peer.probe_started = 0;
+		peer.next_probe = 0;
+		_peers.push_back(peer);
+	}
+	if (_policy == HASH)
+		_buildRing();
+}
+
+int UpstreamGroup::select(const std::string& hash_input, std::time_t now, const std::vector<bool>* tried)
+{
+	if (_policy == LEAST_CONN)
+		return _selectLeastConn(now, tried);
+	if (_policy == HASH)
+		return _selectHash(hash_input, now, tried);
+	return _selectRoundRobin(now, tried);
+}
+
+void UpstreamGroup::acquire(int index)
+{
+	_peers[index].in_flight++;
+}
+
+void UpstreamGroup::release(int index, bool failed, std::time_t now)
+{
+	Peer& peer = _peers[index];
+	if (peer.in_flight > 0)
+		peer.in_flight--;
+
+	if (!failed)
+	{
+		peer.fails = 0;
+		return;
+	}
+	if (peer.max_fails == 0)
+		return;
+
+	// Failures only add up within one fail_timeout window
+	if (now - peer.window_start > peer.fail_timeout)
+	{
+		peer.window_start = now;
+		peer.fails = 0;
+	}
+	if (++peer.fails >= peer.max_fails)
+	{
+		peer.down_until = now + peer.fail_timeout;
+		peer.fails = 0;
+	}
+}
+
+bool UpstreamGroup::reportProbe(int index, bool passed)
+{
+	Peer& peer = _peers[index];
+
+	if (passed == peer.healthy)
+	{
+		peer.probe_streak = 0;
+		return false;
+	}
+	peer.probe_streak++;
+	if (peer.probe_streak < (peer.healthy ? _health_fails : _health_passes))
+		return false;
+
+	peer.healthy = passed;
+	peer.probe_streak = 0;
+	if (passed)
+		peer.down_until = 0;    // A passing probe also ends a passive ban
+	return true;
+}
+
+bool UpstreamGroup::isAvailable(int index, std::time_t now) const
+{
+	const Peer& peer = _peers[index];
+	return peer.healthy && now >= peer.down_until;
+}
+
+// Live and not yet tried for the request
+bool UpstreamGroup::_isCandidate(int index, std::time_t now, const std::vector<bool>* tried) const
+{
+	if (tried && static_cast<size_t>(index) < tried->size() && (*tried)[index])
+		return false;
+	return isAvailable(index, now);
+}
+
+// Smooth weighted round-robin: every pick raises each live peer by its
+// weight and lowers the chosen one by the total, spreading heavy peers out
+int UpstreamGroup::_selectRoundRobin(std::time_t now, const std::vector<bool>* tried)
+{
+	int best = -1;
+	int total = 0;
+
+	for (size_t i = 0; i < _peers.size(); ++i)
+	{
+		if (!_isCandidate(i, now, tried))
+			continue;
+		_peers[i].current_weight += _peers[i].weight;
+		total += _peers[i].weight;
+		if (best == -1 || _peers[i].current_weight > _peers[best].current_weight)
+			best = i;
+	}
+	if (best != -1)
+		_peers[best].current_weight -= total;
+	return best;
+}
+
+// Lowest in_flight / weight, compared as cross products; ties rotate
+int UpstreamGroup::_selectLeastConn(std::time_t now, const std::vector<bool>* tried)
+{
+	int best = -1;
+	size_t count = _peers.size();
+
+	for (size_t n = 0; n < count; ++n)
+	{
+		size_t i = (_cursor + n) % count;
+		if (!_isCandidate(i, now, tried))
+			continue;
+		if (best == -1 ||
+			static_cast<long>(_peers[i].in_flight) * _peers[best].weight <
+			static_cast<long>(_peers[best].in_flight) * _peers[i].weight)
+			best = i;
+	}
+	_cursor = (count == 0) ? 0 : (_cursor + 1) % count;
+	return best;
+}
+
+// First live peer clockwise from the key's point on the ring; a retry
+// moves on to the next peer on the ring, as if the tried ones were down
+int UpstreamGroup::_selectHash(const std::string& hash_input, std::time_t now, const std::vector<bool>* tried)
+{
+	if (_ring.empty())
+		return -1;
+
+	std::vector<std::pair<unsigned int, int> >::const_iterator it =
+		std::lower_bound(_ring.begin(), _ring.end(), std::make_pair(hash(hash_input), -1));
+
+	for (size_t n = 0; n < _ring.size(); ++n, ++it)
+	{
+		if (it == _ring.end())
+			it = _ring.begin();
+		if (_isCandidate(it->second, now, tried))
+			return it->second;
+	}
+	return -1;
+}
+
+void UpstreamGroup::_buildRing()
+{
+	_ring.clear();
+	for (size_t i = 0; i < _peers.size(); ++i)
+	{
+		int points = HASH_POINTS * _peers[i].weight;
+		for (int p = 0; p < points; ++p)
+			_ring.push_back(std::make_pair(hash(_peers[i].key + "#" + StringUtils::toString(p)), static_cast<int>(i)));
+	}
+	std::sort(_ring.begin(), _ring.end());
+}
+
+// 32-bit FNV-1a; the murmur3 finalizer spreads near-identical keys
+// ("host:port#1", "host:port#2", ...) evenly around the ring
+unsigned int UpstreamGroup::hash(const std::string& data)
+{
+	unsigned int h = 2166136261u;
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+} // namespace wsv
@@ -0,0 +1,119 @@
+#ifndef UPSTREAM_GROUP_HPP
+#define UPSTREAM_GROUP_HPP
+
+#include <string>
+#include <vector>
+#include <ctime>
+#include "config/ConfigParser.hpp"
+
+namespace wsv
+{
+
+/**
+ * UpstreamGroup - Peer selection for one `upstream` block
+ *
+ * Policies:
+ * - round_robin: smooth weighted round-robin (no bursts on the heavy peer)
+ * - least_conn:  fewest in-flight requests per unit of weight
+ * - hash:        consistent hash ring, so a key keeps its peer while the
+ *                peer set is stable and only its share moves when one drops
+ *
+ * A peer is skipped while it is down, either passively (max_fails failures
+ * within fail_timeout, then fail_timeout seconds off) or actively (failed
+ * health probes). The Server owns the sockets; this class only keeps the
+ * state and makes the choices, so it can be tested without the event loop.
+ */
+class UpstreamGroup
+{
+public:
+	enum Policy
+	{
+		ROUND_ROBIN,
+		LEAST_CONN,
+		HASH
+	};
+
+	struct Peer
+	{
+		std::string	host;
+		int			port;
+		std::string	key;            // "host:port", also the UpstreamPool key
+		int			weight;
+		int			max_fails;
+		int			fail_timeout;
+
+		int			in_flight;      // Requests currently using the peer
+		int			current_weight; // Smooth round-robin state
+		int			fails;          // Failures in the current window
+		std::time_t	window_start;
+		std::time_t	down_until;     // Passive: skipped until then
+
+		bool		healthy;        // Active: result of the health probes
+		int			probe_streak;   // Consecutive probes contradicting `healthy`
+		int			probe_fd;       // Probe in progress, -1 if none
+		std::time_t	probe_started;
+		std::time_t	next_probe;
+		std::string	probe_buffer;   // Start of the probe response
+	};
+
+	// Virtual nodes per unit of weight on the hash ring
+	static const int HASH_POINTS = 160;
+
+	UpstreamGroup();
+	explicit UpstreamGroup(const UpstreamConfig& config);
+
+	/**
+	 * Choose a peer for a request
+	 * @param hash_input Request URI or client address (hash policy only)
+	 * @param tried Peers that already failed this request (index -> true), skipped; may be NULL
+	 * @return Peer index, -1 if every peer is down or tried
+	 */
+	int		select(const std::string& hash_input, std::time_t now, const std::vector<bool>* tried);
+
+	void	acquire(int index);
+	// Request done; failures (connect errors, timeouts, broken responses) count towards max_fails
+	void	release(int index, bool failed, std::time_t now);
+
+	// Record a probe result; returns true if the peer changed state
+	bool	reportProbe(int index, bool passed);
+
+	bool	isAvailable(int index, std::time_t now) const;
+
+	size_t				size() const { return _peers.size(); }
+	Peer&				getPeer(int index) { return _peers[index]; }
+	const Peer&			getPeer(int index) const { return _peers[index]; }
+	const std::string&	getName() const { return _name; }
+	Policy				getPolicy() const { return _policy; }
+	bool				hashesRemoteAddr() const { return _hash_key == "$remote_addr"; }
+
+	bool				hasHealthCheck() const { return _health_interval > 0; }
+	int					getHealthInterval() const { return _health_interval; }
+	int					getHealthTimeout() const { return _health_timeout; }
+	const std::string&	getHealthUri() const { return _health_uri; }
+
+	static unsigned int	hash(const std::string& data);
+
+private:
+	std::string			_name;
+	Policy				_policy;
+	std::string			_hash_key;
+	std::vector<Peer>	_peers;
+	std::vector<std::pair<unsigned int, int> >	_ring;  // (point, peer index), sorted
+	size_t				_cursor;    // Rotates the least_conn tie-break
+
+	int			_health_interval;
+	int			_health_timeout;
+	std::string	_health_uri;
+	int			_health_fails;
+	int			_health_passes;
+
+	bool	_isCandidate(int index, std::time_t now, const std::vector<bool>* tried) const;
+	int		_selectRoundRobin(std::time_t now, const std::vector<bool>* tried);
+	int		_selectLeastConn(std::time_t now, const std::vector<bool>* tried);
+	int		_selectHash(const std::string& hash_input, std::time_t now, const std::vector<bool>* tried);
+	void	_buildRing();
+};
+
+} // namespace wsv
+
+#endif
@@ -0,0 +1,77 @@
+#include "UpstreamPool.hpp"
+#include "utils/Logger.hpp"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+
+namespace wsv
+{
+
+UpstreamPool::UpstreamPool()
+{ }
+
+UpstreamPool::~UpstreamPool()
+{
+	closeAll();
+}
+
+int UpstreamPool::acquire(const std::string& key)
+{
+	std::map<std::string, std::vector<int> >::iterator it = _idle.find(key);
+	if (it == _idle.end())
+		return -1;
+
+	std::vector<int>& fds = it->second;
+	while (!fds.empty())
+	{
+		int fd = fds.back();
+		fds.pop_back();
+
+		if (_isAlive(fd))
+		{
+			Logger::debug("Reusing upstream connection fd {} for {}", fd, key);
+			return fd;
+		}
+		Logger::debug("Dropping stale upstream connection fd {}", fd);
+		close(fd);
+	}
+	return -1;
+}
+
+void UpstreamPool::release(const std::string& key, int fd)
+{
+	std::vector<int>& fds = _idle[key];
+	if (fds.size() >= MAX_IDLE_PER_UPSTREAM)
+	{
+		close(fd);
+		return;
+	}
+	fds.push_back(fd);
+}
+
+void UpstreamPool::closeAll()
+{
+	for (std::map<std::string, std::vector<int> >::iterator it = _idle.begin(); it != _idle.end(); ++it)
+	{
+		for (size_t i = 0; i < it->second.size(); ++i)
+			close(it->second[i]);
+	}
+	_idle.clear();
+}
+
+size_t UpstreamPool::idleCount(const std::string& key) const
+{
+	std::map<std::string, std::vector<int> >::const_iterator it = _idle.find(key);
+	return (it == _idle.end()) ? 0 : it->second.size();
+}
+
+// An idle connection must have nothing to read: EOF or stray bytes mean
+// the peer closed it or is out of sync, so it cannot carry a new request.
+bool UpstreamPool::_isAlive(int fd)
+{
+	char probe;
+	ssize_t n = recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+	return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+} // namespace wsv
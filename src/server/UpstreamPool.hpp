@@ -0,0 +1,51 @@
+#ifndef UPSTREAM_POOL_HPP
+#define UPSTREAM_POOL_HPP
+
+#include <string>
+#include <map>
+#include <vector>
+
+namespace wsv
+{
+
+/**
+ * UpstreamPool - Idle persistent connections to upstream applications
+ *
+ * Connections are keyed by upstream address (e.g. a FastCGI socket path).
+ * A connection is handed out to one request at a time and returned once
+ * the response has been fully read. Idle connections are not registered
+ * in epoll; liveness is checked when they are acquired.
+ */
+class UpstreamPool
+{
+public:
+	static const size_t MAX_IDLE_PER_UPSTREAM = 32;
+
+	UpstreamPool();
+	~UpstreamPool();
+
+	/**
+	 * Take an idle connection for this upstream
+	 * @return Live fd, or -1 if none is available
+	 */
+	int		acquire(const std::string& key);
+
+	// Return a connection after a complete exchange (closed if the pool is full)
+	void	release(const std::string& key, int fd);
+
+	void	closeAll();
+	size_t	idleCount(const std::string& key) const;
+
+private:
+	std::map<std::string, std::vector<int> >	_idle;
+
+	static bool	_isAlive(int fd);
+
+	// Forbidden copy
+	UpstreamPool(const UpstreamPool&);
+	UpstreamPool& operator=(const UpstreamPool&);
+};
+
+} // namespace wsv
+
+#endif
@@ -0,0 +1,110 @@
+#include "Arena.hpp"
+#include <cstdlib>
+
+namespace wsv {
+
+// Allocations are rounded to this so every pointer suits any scalar type
+static const size_t ALIGNMENT = sizeof(double) > sizeof(void*) ? sizeof(double) : sizeof(void*);
+
+static size_t	align_up(size_t size)
+{
+	return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+// Block header rounded up, so the memory after it stays aligned
+static const size_t HEADER_SIZE = (sizeof(void*) + sizeof(size_t) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+Arena::Arena()
+	: _cursor(_inline),
+	_limit(_inline + INLINE_SIZE),
+	_blocks(NULL),
+	_used(0),
+	_heap_blocks(0)
+{ }
+
+Arena::Arena(const Arena& other)
+	: _cursor(_inline),
+	_limit(_inline + INLINE_SIZE),
+	_blocks(NULL),
+	_used(0),
+	_heap_blocks(0)
+{
+	(void) other;
+}
+
+Arena& Arena::operator=(const Arena& other)
+{
+	(void) other;
+	return *this;
+}
+
+Arena::~Arena()
+{
+	_releaseBlocks();
+}
+
+void* Arena::allocate(size_t size)
+{
+	size = align_up(size ? size : 1);
+	if (static_cast<size_t>(_limit - _cursor) < size)
+		_grow(size);
+	void* result = _cursor;
+	_cursor += size;
+	_used += size;
+	return result;
+}
+
+// A request that needed several blocks gets them merged into one for the next
+void Arena::reset()
+{
+	size_t needed = _used;
+	bool merge = (_blocks && _blocks->next) || (_blocks && _blocks->size < needed);
+
+	if (merge || needed > MAX_RETAINED)
+		_releaseBlocks();
+	if (merge && needed <= MAX_RETAINED)
+		_grow(needed);
+
+	if (_blocks)
+	{
+		_cursor = reinterpret_cast<char*>(_blocks) + HEADER_SIZE;
+		_limit = _cursor + _blocks->size;
+	}
+	else
+	{
+		_cursor = _inline;
+		_limit = _inline + INLINE_SIZE;
+	}
+	_used = 0;
+}
+
+void Arena::_grow(size_t size)
+{
+	size_t block_size = BLOCK_SIZE;
+	if (_blocks && _blocks->size * 2 > block_size)
+		block_size = _blocks->size * 2;
+	if (size > block_size)
+		block_size = align_up(size);
+
+	Block* block = static_cast<Block*>(std::malloc(HEADER_SIZE + block_size));
+	if (!block)
+		throw std::bad_alloc();
+	block->next = _blocks;
+	block->size = block_size;
+	_blocks = block;
+	_heap_blocks++;
+	_cursor = reinterpret_cast<char*>(block) + HEADER_SIZE;
+	_limit = _cursor + block_size;
+}
+
+void Arena::_releaseBlocks()
+{
+	while (_blocks)
+	{
+		Block* next = _blocks->next;
+		std::free(_blocks);
+		_blocks = next;
+	}
+}
+
+} // namespace wsv
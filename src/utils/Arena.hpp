@@ -0,0 +1,125 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <string>
+#include <cstddef>
+#include <new>
+
+namespace wsv
+{
+
+/**
+ * Arena - Bump allocator for request-scoped data
+ *
+ * Each Client owns one. Strings and containers built while a request is
+ * handled take their memory from it, and reset() releases everything at
+ * once when the connection turns over to its next request. Freeing a single
+ * allocation does nothing.
+ *
+ * The first 1KB is stored inside the object. After that, memory comes from
+ * heap blocks. reset() merges the blocks a request needed into one, so the
+ * next request of the same size makes no heap allocation. Copying an arena
+ * gives a new empty arena, because the memory of an arena is never shared.
+ */
+class Arena
+{
+public:
+	static const size_t INLINE_SIZE = 1024;
+	static const size_t BLOCK_SIZE = 4096;          // Smallest heap block
+	static const size_t MAX_RETAINED = 64 * 1024;   // Larger blocks are freed on reset
+
+	Arena();
+	Arena(const Arena& other);
+	Arena&	operator=(const Arena& other);
+	~Arena();
+
+	void*	allocate(size_t size);
+	void	reset();
+
+	size_t	bytesUsed() const { return _used; }
+	size_t	heapBlocks() const { return _heap_blocks; }    // Blocks taken from the heap so far
+
+private:
+	struct Block
+	{
+		Block*	next;
+		size_t	size;
+	};
+
+	union
+	{
+		char	_inline[INLINE_SIZE];
+		double	_align;                 // Forces the alignment of _inline
+	};
+	char*	_cursor;
+	char*	_limit;
+	Block*	_blocks;                    // Newest first
+	size_t	_used;                      // Bytes handed out since the last reset
+	size_t	_heap_blocks;
+
+	void	_grow(size_t size);
+	void	_releaseBlocks();
+};
+
+/**
+ * STL allocator over an Arena (C++98 allocator requirements)
+ * A default-constructed allocator has no arena and uses the heap
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T				value_type;
+	typedef T*				pointer;
+	typedef const T*		const_pointer;
+	typedef T&				reference;
+	typedef const T&		const_reference;
+	typedef std::size_t		size_type;
+	typedef std::ptrdiff_t	difference_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef ArenaAllocator<U>	other;
+	};
+
+	ArenaAllocator() : _arena(NULL) {}
+	explicit ArenaAllocator(Arena& arena) : _arena(&arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.arena()) {}
+
+	pointer	allocate(size_type n, const void* = 0)
+	{
+		if (_arena)
+			return static_cast<pointer>(_arena->allocate(n * sizeof(T)));
+		return static_cast<pointer>(::operator new(n * sizeof(T)));
+	}
+	void	deallocate(pointer p, size_type)
+	{
+		if (!_arena)
+			::operator delete(p);
+	}
+
+	void	construct(pointer p, const T& value) { new (static_cast<void*>(p)) T(value); }
+	void	destroy(pointer p) { p->~T(); }
+	pointer	address(reference x) const { return &x; }
+	const_pointer	address(const_reference x) const { return &x; }
+	size_type	max_size() const { return static_cast<size_type>(-1) / sizeof(T); }
+
+	Arena*	arena() const { return _arena; }
+
+private:
+	Arena*	_arena;
+};
+
+template <typename T, typename U>
+bool	operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() == b.arena(); }
+template <typename T, typename U>
+bool	operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() != b.arena(); }
+
+// Request-scoped string: lives in the arena, valid until its reset
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char> >	ArenaString;
+
+} // namespace wsv
+
+#endif
@@ -0,0 +1,307 @@
+#include "ByteScan.hpp"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+# define BYTESCAN_X86 1
+# include <immintrin.h>
+#endif
+
+namespace ByteScan {
+
+enum Kernel
+{
+	KERNEL_UNSET,
+	KERNEL_SCALAR,
+	KERNEL_SSE2,
+	KERNEL_AVX2
+};
+
+static Kernel	g_kernel = KERNEL_UNSET;
+
+static Kernel	detectKernel()
+{
+#ifdef BYTESCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return KERNEL_AVX2;
+	return KERNEL_SSE2;
+#else
+	return KERNEL_SCALAR;
+#endif
+}
+
+static Kernel	kernel()
+{
+	if (g_kernel == KERNEL_UNSET)
+		g_kernel = detectKernel();
+	return g_kernel;
+}
+
+// ==================== Line walker ====================
+
+// Turns delimiter bit masks (bit i = data[base + i]) into lines, in order
+struct Walker
+{
+	LineScan&	scan;
+	Line*		lines;
+	size_t		max_lines;
+	size_t		count;
+	bool		done;
+
+	Walker(LineScan& s, Line* l, size_t max) : scan(s), lines(l), max_lines(max), count(0), done(false) {}
+
+	inline void	feed(const char* data, size_t base, unsigned int nl, unsigned int colon)
+	{
+		unsigned int all = nl | colon;
+		while (all)
+		{
+			unsigned int bit = all & (0U - all);
+			size_t at = base + __builtin_ctz(all);
+			all ^= bit;
+			if (!(nl & bit))
+			{
+				if (scan.colon == npos)
+					scan.colon = at;
+				continue;
+			}
+
+			Line& line = lines[count++];
+			line.start = scan.line_start;
+			line.end = (at > scan.line_start && data[at - 1] == '\r') ? at - 1 : at;
+			line.colon = (scan.colon < line.end) ? scan.colon : npos;
+			line.next = at + 1;
+			scan.reset(at + 1);
+			if (count == max_lines || line.end == line.start)
+			{
+				done = true;
+				return;
+			}
+		}
+	}
+};
+
+static void	scanScalar(const char* data, size_t len, Walker& walker)
+{
+	size_t pos = walker.scan.pos;
+	for (; pos < len && !walker.done; ++pos)
+	{
+		char c = data[pos];
+		if (c == '\n')
+			walker.feed(data, pos, 1, 0);
+		else if (c == ':')
+			walker.feed(data, pos, 0, 1);
+	}
+	if (!walker.done)
+		walker.scan.pos = len;
+}
+
+#ifdef BYTESCAN_X86
+
+static void	scanSse2(const char* data, size_t len, Walker& walker)
+{
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i colon = _mm_set1_epi8(':');
+	size_t pos = walker.scan.pos;
+
+	while (pos + 16 <= len)
+	{
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		unsigned int nl_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+		unsigned int colon_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, colon));
+		if (nl_mask | colon_mask)
+		{
+			walker.feed(data, pos, nl_mask, colon_mask);
+			if (walker.done)
+				return;
+		}
+		pos += 16;
+	}
+	walker.scan.pos = pos;
+	scanScalar(data, len, walker);
+}
+
+__attribute__((target("avx2")))
+static void	scanAvx2(const char* data, size_t len, Walker& walker)
+{
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i colon = _mm256_set1_epi8(':');
+	size_t pos = walker.scan.pos;
+
+	while (pos + 32 <= len)
+	{
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+		unsigned int nl_mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+		unsigned int colon_mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, colon)));
+		if (nl_mask | colon_mask)
+		{
+			walker.feed(data, pos, nl_mask, colon_mask);
+			if (walker.done)
+				return;
+		}
+		pos += 32;
+	}
+	walker.scan.pos = pos;
+	// The tail runs legacy SSE code: clean upper halves avoid the AVX-SSE transition penalty
+	_mm256_zeroupper();
+	scanSse2(data, len, walker);
+}
+
+#endif
+
+size_t	scanLines(const char* data, size_t len, LineScan& scan, Line* lines, size_t max_lines)
+{
+	if (max_lines == 0 || scan.pos >= len)
+		return 0;
+
+	Walker walker(scan, lines, max_lines);
+	switch (kernel())
+	{
+#ifdef BYTESCAN_X86
+		case KERNEL_AVX2:
+			scanAvx2(data, len, walker);
+			break;
+		case KERNEL_SSE2:
+			scanSse2(data, len, walker);
+			break;
+#endif
+		default:
+			scanScalar(data, len, walker);
+			break;
+	}
+	return walker.count;
+}
+
+// ==================== Marker search ====================
+
+static size_t	findScalar(const char* data, size_t len, const char* needle, size_t needle_len, size_t from)
+{
+	const char* end = data + len - needle_len + 1;
+	const char* p = data + from;
+	while (p < end)
+	{
+		p = static_cast<const char*>(std::memchr(p, needle[0], end - p));
+		if (!p)
+			return npos;
+		if (std::memcmp(p, needle, needle_len) == 0)
+			return p - data;
+		++p;
+	}
+	return npos;
+}
+
+#ifdef BYTESCAN_X86
+
+// A block position is a candidate when both the first and the last needle
+// byte match; only candidates are compared in full
+static size_t	findSse2(const char* data, size_t len, const char* needle, size_t needle_len, size_t from)
+{
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+	size_t pos = from;
+
+	while (pos + needle_len - 1 + 16 <= len)
+	{
+		__m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		__m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + needle_len - 1));
+		unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first),
+															_mm_cmpeq_epi8(tail, last)));
+		while (mask)
+		{
+			size_t at = pos + __builtin_ctz(mask);
+			if (std::memcmp(data + at, needle, needle_len) == 0)
+				return at;
+			mask &= mask - 1;
+		}
+		pos += 16;
+	}
+	return findScalar(data, len, needle, needle_len, pos);
+}
+
+__attribute__((target("avx2")))
+static size_t	findAvx2(const char* data, size_t len, const char* needle, size_t needle_len, size_t from)
+{
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+	size_t pos = from;
+
+	while (pos + needle_len - 1 + 32 <= len)
+	{
+		__m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+		__m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + needle_len - 1));
+		unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last))));
+		while (mask)
+		{
+			size_t at = pos + __builtin_ctz(mask);
+			if (std::memcmp(data + at, needle, needle_len) == 0)
+				return at;
+			mask &= mask - 1;
+		}
+		pos += 32;
+	}
+	_mm256_zeroupper();
+	return findSse2(data, len, needle, needle_len, pos);
+}
+
+#endif
+
+size_t	find(const char* data, size_t len, const char* needle, size_t needle_len, size_t from)
+{
+	if (needle_len == 0)
+		return (from <= len) ? from : npos;
+	if (from >= len || len - from < needle_len)
+		return npos;
+	// memchr is already vectorized for a single byte
+	if (needle_len == 1)
+	{
+		const char* p = static_cast<const char*>(std::memchr(data + from, needle[0], len - from));
+		return p ? static_cast<size_t>(p - data) : npos;
+	}
+
+	switch (kernel())
+	{
+#ifdef BYTESCAN_X86
+		case KERNEL_AVX2:
+			return findAvx2(data, len, needle, needle_len, from);
+		case KERNEL_SSE2:
+			return findSse2(data, len, needle, needle_len, from);
+#endif
+		default:
+			return findScalar(data, len, needle, needle_len, from);
+	}
+}
+
+// ==================== Dispatch ====================
+
+const char*	kernelName()
+{
+	switch (kernel())
+	{
+		case KERNEL_AVX2:
+			return "avx2";
+		case KERNEL_SSE2:
+			return "sse2";
+		default:
+			return "scalar";
+	}
+}
+
+bool	useKernel(const std::string& name)
+{
+	Kernel best = detectKernel();
+	Kernel wanted;
+	if (name == "scalar")
+		wanted = KERNEL_SCALAR;
+	else if (name == "sse2")
+		wanted = KERNEL_SSE2;
+	else if (name == "avx2")
+		wanted = KERNEL_AVX2;
+	else
+		return false;
+	if (wanted > best)
+		return false;
+	g_kernel = wanted;
+	return true;
+}
+
+} // namespace ByteScan
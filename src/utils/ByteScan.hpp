@@ -0,0 +1,62 @@
+#ifndef BYTE_SCAN_HPP
+#define BYTE_SCAN_HPP
+
+#include <string>
+
+/**
+ * ByteScan - Vectorized search for HTTP structural delimiters
+ *
+ * scanLines() finds the line ends ('\n') and the first ':' of each line of a
+ * header block in one pass, 16 (SSE2) or 32 (AVX2) bytes per step. find()
+ * looks for a multi-byte marker (multipart boundary, "\r\n\r\n") by testing
+ * its first and last byte a block at a time.
+ *
+ * The kernel is picked once from the CPU (AVX2, else SSE2 on x86, else a
+ * scalar loop); all kernels return the same results.
+ */
+namespace ByteScan
+{
+
+static const size_t npos = std::string::npos;
+
+// One complete line: offsets into the scanned buffer
+struct Line
+{
+	size_t	start;
+	size_t	end;    // End of the content, "\r\n" or "\n" excluded
+	size_t	colon;  // First ':' of the line, npos if none
+	size_t	next;   // Start of the following line
+};
+
+// Progress over a buffer that grows between calls: bytes are scanned once
+struct LineScan
+{
+	size_t	line_start;     // Start of the line being scanned
+	size_t	colon;          // Its first ':' so far, npos if none
+	size_t	pos;            // Next byte to look at
+
+	LineScan() : line_start(0), colon(npos), pos(0) {}
+
+	// Restart at offset (a line start)
+	void	reset(size_t offset) { line_start = offset; colon = npos; pos = offset; }
+};
+
+/**
+ * Scan data[scan.pos, len) for complete lines
+ * Stops after max_lines lines or after an empty line (end of a header block)
+ * @return Number of lines stored in lines
+ */
+size_t	scanLines(const char* data, size_t len, LineScan& scan, Line* lines, size_t max_lines);
+
+// Offset of the first needle in data[from, len), npos if none
+size_t	find(const char* data, size_t len, const char* needle, size_t needle_len, size_t from = 0);
+
+// Kernel in use: "avx2", "sse2" or "scalar"
+const char*	kernelName();
+
+// Force a kernel (tests and benchmarks); false if this CPU cannot run it
+bool	useKernel(const std::string& name);
+
+} // namespace ByteScan
+
+#endif
@@ -1,65 +1,128 @@
 #include "Logger.hpp"
+#include <cstring>
 
 namespace wsv
 {
 
-std::string Logger::_getTimestamp()
+std::string Logger::_line;
+
+void Logger::info(const std::string& message)
 {
-	char buffer[80];
-	std::time_t rawtime;
-	std::tm* timeinfo;
+	_print(LEVEL_INFO, message.data(), message.size());
+}
 
-	std::time(&rawtime);
-	timeinfo = std::localtime(&rawtime);
+void Logger::warning(const std::string& message)
+{
+	_print(LEVEL_WARNING, message.data(), message.size());
+}
 
-	// Format: YYYY-MM-DD HH:MM:SS
-	std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-	return std::string(buffer);
+void Logger::error(const std::string& message)
+{
+	_print(LEVEL_ERROR, message.data(), message.size());
 }
 
-std::string Logger::_formatMessage(const std::string& format, const std::string args[], size_t count)
+void Logger::debug(const std::string& message)
 {
-	std::string result = format;
-	for (size_t i = 0; i < count; ++i)
-	{
-		size_t pos = result.find("{}");
-		if (pos != std::string::npos)
-			result.replace(pos, 2, args[i]);
-	}
-	return result;
+#ifdef DEBUG
+	_print(LEVEL_DEBUG, message.data(), message.size());
+#else
+	(void) message;
+#endif
 }
 
-void Logger::info(const std::string& message)
+void Logger::info(const char* message)
 {
-	std::cout << "[" << _getTimestamp() << "] "
-			  << GREEN << "INFO" << RESET << ": "
-			  << message << std::endl;
+	_print(LEVEL_INFO, message, std::strlen(message));
 }
 
-void Logger::warning(const std::string& message)
+void Logger::warning(const char* message)
 {
-	std::cout << "[" << _getTimestamp() << "] "
-			  << YELLOW << "WARNING: " << RESET << ": "
-			  << message << std::endl;
+	_print(LEVEL_WARNING, message, std::strlen(message));
 }
 
-void Logger::error(const std::string& message)
+void Logger::error(const char* message)
 {
-	std::cerr << "[" << _getTimestamp() << "] "
-			  << RED << "ERROR" << RESET << ": "
-			  << message << std::endl;
+	_print(LEVEL_ERROR, message, std::strlen(message));
 }
 
-void Logger::debug(const std::string& message)
+void Logger::debug(const char* message)
 {
 #ifdef DEBUG
-	std::cout << "[" << _getTimestamp() << "] "
-			  << BLUE << "DEBUG" << RESET << ": "
-			  << message << std::endl;
+	_print(LEVEL_DEBUG, message, std::strlen(message));
 #else
 	(void) message;
-	return;
 #endif
 }
 
+void Logger::_print(Level level, const char* message, size_t len)
+{
+	char timestamp[32];
+	std::time_t rawtime = std::time(NULL);
+
+	// Format: YYYY-MM-DD HH:MM:SS
+	std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", std::localtime(&rawtime));
+
+	std::ostream& out = (level == LEVEL_ERROR) ? std::cerr : std::cout;
+	out << "[" << timestamp << "] ";
+	if (level == LEVEL_INFO)
+		out << GREEN << "INFO" << RESET << ": ";
+	else if (level == LEVEL_WARNING)
+		out << YELLOW << "WARNING: " << RESET << ": ";
+	else if (level == LEVEL_ERROR)
+		out << RED << "ERROR" << RESET << ": ";
+	else
+		out << BLUE << "DEBUG" << RESET << ": ";
+	out.write(message, len);
+	out << std::endl;
+}
+
+// Copies the text up to the next "{}" and steps over it; false at the end
+bool Logger::_placeholder(const char*& format)
+{
+	const char* mark = std::strstr(format, "{}");
+	if (!mark)
+	{
+		format += std::strlen(format);
+		return false;
+	}
+	_line.append(format, mark - format);
+	format = mark + 2;
+	return true;
+}
+
+void Logger::_flush(Level level, const char* rest)
+{
+	_line += rest;
+	_print(level, _line.data(), _line.size());
+}
+
+void Logger::_appendArg(int value)
+{
+	_appendArg(static_cast<long>(value));
+}
+
+void Logger::_appendArg(long value)
+{
+	if (value < 0)
+		_line += '-';
+	_appendArg(value < 0 ? 0UL - static_cast<unsigned long>(value) : static_cast<unsigned long>(value));
+}
+
+void Logger::_appendArg(unsigned int value)
+{
+	_appendArg(static_cast<unsigned long>(value));
+}
+
+void Logger::_appendArg(unsigned long value)
+{
+	char digits[24];
+	size_t pos = sizeof(digits);
+	do
+	{
+		digits[--pos] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value);
+	_line.append(digits + pos, sizeof(digits) - pos);
+}
+
 } // namespace wsv
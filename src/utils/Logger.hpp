@@ -25,99 +25,151 @@ public:
 	static void error(const std::string& message);
 	static void debug(const std::string& message);
 
+	// Literal messages are printed as they are, without building a std::string
+	static void info(const char* message);
+	static void warning(const char* message);
+	static void error(const char* message);
+	static void debug(const char* message);
+
 	template <typename T1>
-	static void info(const std::string &format, T1 a1);
+	static void info(const char* format, const T1& a1);
 
 	template <typename T1, typename T2>
-	static void info(const std::string &format, T1 a1, T2 a2);
+	static void info(const char* format, const T1& a1, const T2& a2);
 
 	template <typename T1, typename T2, typename T3>
-	static void info(const std::string &format, T1 a1, T2 a2, T3 a3);
+	static void info(const char* format, const T1& a1, const T2& a2, const T3& a3);
 
 	template <typename T1>
-	static void error(const std::string &format, T1 a1);
+	static void error(const char* format, const T1& a1);
 
 	template <typename T1, typename T2>
-	static void error(const std::string &format, T1 a1, T2 a2);
+	static void error(const char* format, const T1& a1, const T2& a2);
 
 	template <typename T1>
-	static void debug(const std::string &format, T1 a1);
+	static void debug(const char* format, const T1& a1);
 
 	template <typename T1, typename T2>
-	static void debug(const std::string &format, T1 a1, T2 a2);
+	static void debug(const char* format, const T1& a1, const T2& a2);
 
 private:
-	static std::string _getTimestamp();
-	static std::string _formatMessage(const std::string &format, const std::string args[], size_t count);
+	enum Level
+	{
+		LEVEL_INFO,
+		LEVEL_WARNING,
+		LEVEL_ERROR,
+		LEVEL_DEBUG
+	};
+
+	// Formatted messages are built in one buffer kept across calls: once its
+	// capacity is warm a log line costs no allocation
+	static std::string _line;
+
+	static void _print(Level level, const char* message, size_t len);
+	static bool _placeholder(const char*& format);
+	static void _flush(Level level, const char* rest);
+
+	static void _appendArg(const std::string& value) { _line += value; }
+	static void _appendArg(const char* value) { _line += value; }
+	static void _appendArg(int value);
+	static void _appendArg(long value);
+	static void _appendArg(unsigned int value);
+	static void _appendArg(unsigned long value);
+	template <typename T>
+	static void _appendArg(const T& value);
 };
 
 
-template <typename T1>
-void Logger::info(const std::string &format, T1 a1)
+template <typename T>
+void Logger::_appendArg(const T& value)
 {
 	std::ostringstream oss;
-	oss << a1;
-	std::string args[] = {oss.str()};
-	info(_formatMessage(format, args, 1));
+	oss << value;
+	_line += oss.str();
+}
+
+template <typename T1>
+void Logger::info(const char* format, const T1& a1)
+{
+	_line.clear();
+	if (_placeholder(format))
+		_appendArg(a1);
+	_flush(LEVEL_INFO, format);
 }
 
 template <typename T1, typename T2>
-void Logger::info(const std::string &format, T1 a1, T2 a2)
+void Logger::info(const char* format, const T1& a1, const T2& a2)
 {
-	std::ostringstream oss1, oss2;
-	oss1 << a1;
-	oss2 << a2;
-	std::string args[] = {oss1.str(), oss2.str()};
-	info(_formatMessage(format, args, 2));
+	_line.clear();
+	if (_placeholder(format))
+		_appendArg(a1);
+	if (_placeholder(format))
+		_appendArg(a2);
+	_flush(LEVEL_INFO, format);
 }
 
 template <typename T1, typename T2, typename T3>
-void Logger::info(const std::string &format, T1 a1, T2 a2, T3 a3)
+void Logger::info(const char* format, const T1& a1, const T2& a2, const T3& a3)
 {
-	std::ostringstream oss1, oss2, oss3;
-	oss1 << a1;
-	oss2 << a2;
-	oss3 << a3;
-	std::string args[] = {oss1.str(), oss2.str(), oss3.str()};
-	info(_formatMessage(format, args, 3));
+	_line.clear();
+	if (_placeholder(format))
+		_appendArg(a1);
+	if (_placeholder(format))
+		_appendArg(a2);
+	if (_placeholder(format))
+		_appendArg(a3);
+	_flush(LEVEL_INFO, format);
 }
 
 template <typename T1>
-void Logger::error(const std::string &format, T1 a1)
+void Logger::error(const char* format, const T1& a1)
 {
-	std::ostringstream oss;
-	oss << a1;
-	std::string args[] = {oss.str()};
-	error(_formatMessage(format, args, 1));
+	_line.clear();
+	if (_placeholder(format))
+		_appendArg(a1);
+	_flush(LEVEL_ERROR, format);
 }
 
 template <typename T1, typename T2>
-void Logger::error(const std::string &format, T1 a1, T2 a2)
+void Logger::error(const char* format, const T1& a1, const T2& a2)
 {
-	std::ostringstream oss1, oss2;
-	oss1 << a1;
-	oss2 << a2;
-	std::string args[] = {oss1.str(), oss2.str()};
-	error(_formatMessage(format, args, 2));
+	_line.clear();
+	if (_placeholder(format))
+		_appendArg(a1);
+	if (_placeholder(format))
+		_appendArg(a2);
+	_flush(LEVEL_ERROR, format);
 }
 
 template <typename T1>
-void Logger::debug(const std::string &format, T1 a1)
+void Logger::debug(const char* format, const T1& a1)
 {
-	std::ostringstream oss;
-	oss << a1;
-	std::string args[] = {oss.str()};
-	debug(_formatMessage(format, args, 1));
+#ifdef DEBUG
+	_line.clear();
+	if (_placeholder(format))
+		_appendArg(a1);
+	_flush(LEVEL_DEBUG, format);
+#else
+	(void) format;
+	(void) a1;
+#endif
 }
 
 template <typename T1, typename T2>
-void Logger::debug(const std::string &format, T1 a1, T2 a2)
+void Logger::debug(const char* format, const T1& a1, const T2& a2)
 {
-	std::ostringstream oss1, oss2;
-	oss1 << a1;
-	oss2 << a2;
-	std::string args[] = {oss1.str(), oss2.str()};
-	debug(_formatMessage(format, args, 2));
+#ifdef DEBUG
+	_line.clear();
+	if (_placeholder(format))
+		_appendArg(a1);
+	if (_placeholder(format))
+		_appendArg(a2);
+	_flush(LEVEL_DEBUG, format);
+#else
+	(void) format;
+	(void) a1;
+	(void) a2;
+#endif
 }
 
 
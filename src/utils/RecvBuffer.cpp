@@ -0,0 +1,187 @@
+#include "RecvBuffer.hpp"
+#include <cstring>
+#include <sys/uio.h>
+
+namespace wsv {
+
+// ==================== BufferPool ====================
+
+static const size_t CLASS_COUNT = 5;    // 4KB, 8KB, 16KB, 32KB, 64KB
+
+// A free slab stores the next free slab of its class in its first bytes
+struct FreeSlab
+{
+	FreeSlab*	next;
+};
+
+static FreeSlab*	g_free[CLASS_COUNT] = { NULL, NULL, NULL, NULL, NULL };
+static size_t		g_free_count[CLASS_COUNT] = { 0, 0, 0, 0, 0 };
+static size_t		g_in_use = 0;
+static size_t		g_heap_allocations = 0;
+
+// Class index of a slab size, CLASS_COUNT if it is larger than MAX_SLAB
+static size_t	slab_class(size_t size)
+{
+	size_t index = 0;
+	for (size_t slab = BufferPool::MIN_SLAB; slab < size; slab <<= 1)
+	{
+		if (++index == CLASS_COUNT)
+			break;
+	}
+	return index;
+}
+
+char* BufferPool::acquire(size_t size, size_t& capacity)
+{
+	size_t index = slab_class(size);
+	g_in_use++;
+	if (index == CLASS_COUNT)
+	{
+		capacity = size;
+		g_heap_allocations++;
+		return new char[size];
+	}
+
+	capacity = MIN_SLAB << index;
+	if (g_free[index])
+	{
+		FreeSlab* slab = g_free[index];
+		g_free[index] = slab->next;
+		g_free_count[index]--;
+		return reinterpret_cast<char*>(slab);
+	}
+	g_heap_allocations++;
+	return new char[capacity];
+}
+
+void BufferPool::release(char* slab, size_t capacity)
+{
+	if (!slab)
+		return;
+	g_in_use--;
+	size_t index = slab_class(capacity);
+	if (index == CLASS_COUNT || (g_free_count[index] + 1) * capacity > RETAIN_BYTES)
+	{
+		delete[] slab;
+		return;
+	}
+	FreeSlab* free_slab = reinterpret_cast<FreeSlab*>(slab);
+	free_slab->next = g_free[index];
+	g_free[index] = free_slab;
+	g_free_count[index]++;
+}
+
+size_t BufferPool::slabsInUse()
+{
+	return g_in_use;
+}
+
+size_t BufferPool::freeSlabs()
+{
+	size_t count = 0;
+	for (size_t i = 0; i < CLASS_COUNT; ++i)
+		count += g_free_count[i];
+	return count;
+}
+
+size_t BufferPool::heapAllocations()
+{
+	return g_heap_allocations;
+}
+
+// ==================== RecvBuffer ====================
+
+RecvBuffer::RecvBuffer() : _data(NULL), _size(0), _capacity(0)
+{ }
+
+RecvBuffer::RecvBuffer(const RecvBuffer& other) : _data(NULL), _size(0), _capacity(0)
+{
+	append(other._data, other._size);
+}
+
+RecvBuffer& RecvBuffer::operator=(const RecvBuffer& other)
+{
+	if (this != &other)
+	{
+		clear();
+		append(other._data, other._size);
+	}
+	return *this;
+}
+
+RecvBuffer::~RecvBuffer()
+{
+	release();
+}
+
+void RecvBuffer::append(const char* data, size_t len)
+{
+	if (len == 0)
+		return;
+	_reserve(_size + len);
+	std::memcpy(_data + _size, data, len);
+	_size += len;
+}
+
+void RecvBuffer::erase(size_t pos, size_t len)
+{
+	if (pos >= _size)
+		return;
+	if (len > _size - pos)
+		len = _size - pos;
+	std::memmove(_data + pos, _data + pos + len, _size - pos - len);
+	_size -= len;
+}
+
+void RecvBuffer::release()
+{
+	BufferPool::release(_data, _capacity);
+	_data = NULL;
+	_size = 0;
+	_capacity = 0;
+}
+
+char* RecvBuffer::prepare(size_t len)
+{
+	_reserve(_size + len);
+	return _data + _size;
+}
+
+ssize_t RecvBuffer::readFrom(int fd)
+{
+	char overflow[OVERFLOW_SIZE];
+	struct iovec iov[2];
+
+	iov[0].iov_base = _data + _size;
+	iov[0].iov_len = _capacity - _size;
+	iov[1].iov_base = overflow;
+	iov[1].iov_len = sizeof(overflow);
+
+	ssize_t bytes_read = readv(fd, iov, 2);
+	if (bytes_read <= 0)
+		return bytes_read;
+
+	size_t in_tail = static_cast<size_t>(bytes_read) < iov[0].iov_len ? bytes_read : iov[0].iov_len;
+	_size += in_tail;
+	append(overflow, bytes_read - in_tail);
+	return bytes_read;
+}
+
+// Move to a slab of at least len bytes, keeping the contents. Sizes at least
+// double, so appending past MAX_SLAB stays linear.
+void RecvBuffer::_reserve(size_t len)
+{
+	if (len <= _capacity)
+		return;
+	if (len < _capacity * 2)
+		len = _capacity * 2;
+	size_t capacity;
+	char* slab = BufferPool::acquire(len, capacity);
+	if (_size > 0)
+		std::memcpy(slab, _data, _size);
+	BufferPool::release(_data, _capacity);
+	_data = slab;
+	_capacity = capacity;
+}
+
+} // namespace wsv
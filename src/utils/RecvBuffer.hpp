@@ -0,0 +1,88 @@
+#ifndef RECV_BUFFER_HPP
+#define RECV_BUFFER_HPP
+
+#include <cstddef>
+#include <sys/types.h>
+
+namespace wsv
+{
+
+/**
+ * BufferPool - Process-wide free lists of receive slabs
+ *
+ * Slabs come in power-of-two classes from 4KB to 64KB. A released slab goes
+ * back to the free list of its class, so connections that come and go reuse
+ * the same memory. Each class keeps at most RETAIN_BYTES of free slabs; the
+ * rest, and larger requests, go straight back to the heap.
+ */
+class BufferPool
+{
+public:
+	static const size_t MIN_SLAB = 4096;
+	static const size_t MAX_SLAB = 65536;
+	static const size_t RETAIN_BYTES = 1024 * 1024;     // Free slabs kept per class
+
+	// Smallest slab of at least size bytes; capacity receives its real size
+	static char*	acquire(size_t size, size_t& capacity);
+	static void		release(char* slab, size_t capacity);
+
+	// Statistics (tests and benchmarks)
+	static size_t	slabsInUse();
+	static size_t	freeSlabs();
+	static size_t	heapAllocations();      // Slabs that had to come from the heap
+
+private:
+	BufferPool();
+};
+
+/**
+ * RecvBuffer - Receive buffer of one connection, parsed in place
+ *
+ * Bytes are read straight into a pooled slab; the parser keeps offsets into
+ * it and erase() drops what it has consumed. The slab is sized to what
+ * arrives: readFrom() reads with readv into the free tail plus a stack
+ * overflow area, and only moves to a larger slab when the overflow was used.
+ * release() hands the slab back to the pool, so an idle connection holds no
+ * receive memory.
+ */
+class RecvBuffer
+{
+public:
+	static const size_t OVERFLOW_SIZE = 16384;  // Stack area after the slab tail
+
+	RecvBuffer();
+	RecvBuffer(const RecvBuffer& other);
+	RecvBuffer&	operator=(const RecvBuffer& other);
+	~RecvBuffer();
+
+	const char*	data() const { return _data; }
+	size_t		size() const { return _size; }
+	bool		empty() const { return _size == 0; }
+	size_t		capacity() const { return _capacity; }
+
+	void	append(const char* data, size_t len);
+	void	erase(size_t pos, size_t len);
+	void	clear() { _size = 0; }
+	void	release();
+
+	// Free tail of at least len bytes, filled by the caller then commit()ed
+	char*	prepare(size_t len);
+	void	commit(size_t len) { _size += len; }
+
+	/**
+	 * One readv() from fd into the tail and the overflow area
+	 * @return Bytes read, 0 on EOF, -1 with errno set
+	 */
+	ssize_t	readFrom(int fd);
+
+private:
+	char*	_data;
+	size_t	_size;
+	size_t	_capacity;
+
+	void	_reserve(size_t len);
+};
+
+} // namespace wsv
+
+#endif
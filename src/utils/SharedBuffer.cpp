@@ -0,0 +1,87 @@
+#include "SharedBuffer.hpp"
+
+namespace wsv {
+
+SharedBuffer::SharedBuffer() : _block(NULL)
+{ }
+
+SharedBuffer::SharedBuffer(const std::string& bytes) : _block(NULL)
+{
+	if (!bytes.empty())
+		_mutable() = bytes;
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer& other) : _block(other._block)
+{
+	if (_block)
+		_block->refs++;
+}
+
+SharedBuffer& SharedBuffer::operator=(const SharedBuffer& other)
+{
+	if (_block != other._block)
+	{
+		_release();
+		_block = other._block;
+		if (_block)
+			_block->refs++;
+	}
+	return *this;
+}
+
+SharedBuffer::~SharedBuffer()
+{
+	_release();
+}
+
+const std::string& SharedBuffer::str() const
+{
+	static const std::string empty;
+	return _block ? _block->bytes : empty;
+}
+
+void SharedBuffer::append(const char* data, size_t len)
+{
+	if (len > 0)
+		_mutable().append(data, len);
+}
+
+void SharedBuffer::append(const std::string& bytes, size_t pos, size_t len)
+{
+	if (len > 0)
+		_mutable().append(bytes, pos, len);
+}
+
+void SharedBuffer::reserve(size_t len)
+{
+	_mutable().reserve(len);
+}
+
+void SharedBuffer::clear()
+{
+	_release();
+}
+
+// The bytes of a block nobody else holds: a shared block is copied first
+std::string& SharedBuffer::_mutable()
+{
+	if (!_block)
+		_block = new Block();
+	else if (_block->refs > 1)
+	{
+		Block* copy = new Block();
+		copy->bytes = _block->bytes;
+		_block->refs--;
+		_block = copy;
+	}
+	return _block->bytes;
+}
+
+void SharedBuffer::_release()
+{
+	if (_block && --_block->refs == 0)
+		delete _block;
+	_block = NULL;
+}
+
+} // namespace wsv
@@ -0,0 +1,54 @@
+#ifndef SHARED_BUFFER_HPP
+#define SHARED_BUFFER_HPP
+
+#include <string>
+
+namespace wsv
+{
+
+/**
+ * SharedBuffer - Reference-counted byte buffer
+ *
+ * Copies share one heap block: a request body is filled once by the parser,
+ * then handed to the upload, CGI and proxy stages without copying its bytes.
+ * The block is read-only while shared; append() on a shared buffer detaches
+ * it first (copy-on-write), and clear() only drops this handle's reference.
+ */
+class SharedBuffer
+{
+public:
+	SharedBuffer();
+	explicit SharedBuffer(const std::string& bytes);
+	SharedBuffer(const SharedBuffer& other);
+	SharedBuffer&	operator=(const SharedBuffer& other);
+	~SharedBuffer();
+
+	const std::string&	str() const;
+	const char*		data() const { return str().data(); }
+	size_t			size() const { return _block ? _block->bytes.size() : 0; }
+	bool			empty() const { return size() == 0; }
+	size_t			useCount() const { return _block ? _block->refs : 0; }
+
+	void	append(const char* data, size_t len);
+	void	append(const std::string& bytes, size_t pos, size_t len);
+	void	reserve(size_t len);
+	void	clear();
+
+private:
+	struct Block
+	{
+		std::string	bytes;
+		size_t		refs;
+
+		Block() : refs(1) {}
+	};
+
+	Block*	_block;
+
+	std::string&	_mutable();
+	void			_release();
+};
+
+} // namespace wsv
+
+#endif
@@ -1,5 +1,6 @@
 #include "StringUtils.hpp"
 #include <cctype>
+#include <cstring>
 #include <algorithm>
 #include <sstream>
 
@@ -76,6 +77,40 @@ size_t parseSize(const std::string& str)
 	return value;
 }
 
+// Seconds with an optional s/m/h unit: "30", "30s", "5m", "1h"
+int parseDuration(const std::string& str)
+{
+	int value = 0;
+	size_t i = 0;
+
+	while (i < str.size() && std::isdigit(static_cast<unsigned char>(str[i])))
+	{
+		value = value * 10 + (str[i] - '0');
+		i++;
+	}
+	if (i == 0)
+		return -1;
+
+	if (i < str.size())
+	{
+		if (i + 1 != str.size())
+			return -1;
+		switch (std::tolower(static_cast<unsigned char>(str[i])))
+		{
+			case 's':
+				return value;
+			case 'm':
+				return value * 60;
+			case 'h':
+				return value * 3600;
+			default:
+				return -1;
+		}
+	}
+
+	return value;
+}
+
 bool startsWith(const std::string& str, const std::string& prefix)
 {
 	if (str.size() < prefix.size())
@@ -115,30 +150,40 @@ std::string	toLower(const std::string& str)
 std::string urlDecode(const std::string& str)
 {
 	std::string result;
-	result.reserve(str.size());
-	
-	for (size_t i = 0; i < str.size(); ++i)
+	urlDecode(str.data(), str.size(), result);
+	return result;
+}
+
+std::string urlEncodePath(const char* data, size_t len)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	std::string result;
+	result.reserve(len);
+	for (size_t i = 0; i < len; ++i)
 	{
-		if (str[i] == '%' && i + 2 < str.size())
+		unsigned char c = static_cast<unsigned char>(data[i]);
+		// RFC 3986 pchar and '/'; '+' stays escaped, urlDecode() reads it as a space
+		if (std::isalnum(c) || (c && std::strchr("-._~!$&'()*,;=:@/", c)))
+			result += static_cast<char>(c);
+		else
 		{
-			// Convert hex digits to char
-			int hex_value;
-			std::istringstream hex_stream(str.substr(i + 1, 2));
-			if (hex_stream >> std::hex >> hex_value)
-			{
-				result += static_cast<char>(hex_value);
-				i += 2;  // Skip the two hex digits
-			}
-			else
-				result += str[i];  // Invalid hex, keep the %
+			result += '%';
+			result += hex[c >> 4];
+			result += hex[c & 0x0F];
 		}
-		else if (str[i] == '+')
-			result += ' ';  // + is often used for space in URLs
-		else
-			result += str[i];
 	}
-	
 	return result;
 }
 
+int hexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
 } // namespace StringUtils
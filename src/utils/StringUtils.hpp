@@ -9,12 +9,38 @@ namespace StringUtils
 
 std::string	trim(const std::string& str);
 size_t		parseSize(const std::string& str);
+int			parseDuration(const std::string& str);
 bool		startsWith(const std::string& str, const std::string& prefix);
 std::string	removeSemicolon(const std::string& str);
 std::vector<std::string>	split(const std::string& str, const std::string& delimiters);
 std::string	toString(int value);
 std::string	toLower(const std::string& str);
 std::string	urlDecode(const std::string& str);
+std::string	urlEncodePath(const char* data, size_t len);	// %XX all but pchar and '/'
+
+int			hexValue(char c);	// -1 if c is not a hex digit
+
+// Decode %XX escapes and '+' of data[0, len) into out (any string type)
+template <typename String>
+void		urlDecode(const char* data, size_t len, String& out)
+{
+	out.reserve(out.size() + len);
+	for (size_t i = 0; i < len; ++i)
+	{
+		int high;
+		int low;
+		if (data[i] == '%' && i + 2 < len && (high = hexValue(data[i + 1])) >= 0
+			&& (low = hexValue(data[i + 2])) >= 0)
+		{
+			out += static_cast<char>(high * 16 + low);
+			i += 2;  // Skip the two hex digits
+		}
+		else if (data[i] == '+')
+			out += ' ';  // + is often used for space in URLs
+		else
+			out += data[i];
+	}
+}
 
 } // namespace StringUtils
 
@@ -0,0 +1,174 @@
+#include "router/RequestHandler.hpp"
+#include "server/Client.hpp"
+#include <cstdlib>
+#include <malloc.h>
+#include <map>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <string>
+
+// Heap allocations per request on one keep-alive connection, split by stage:
+// parse, handle (RequestHandler with the client's arena) and serialize.
+// Then the memory each idle keep-alive connection keeps between requests.
+// Usage: ./bench_alloc [requests per row]
+
+static size_t g_allocations = 0;
+static size_t g_live_bytes = 0;
+
+void* operator new(size_t size)
+{
+	g_allocations++;
+	void* p = std::malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	g_live_bytes += malloc_usable_size(p);
+	return p;
+}
+
+void operator delete(void* p) throw()
+{
+	if (p)
+		g_live_bytes -= malloc_usable_size(p);
+	std::free(p);
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete[](void* p) throw()
+{
+	operator delete(p);
+}
+
+using namespace wsv;
+
+static ServerConfig make_config()
+{
+	ServerConfig config;
+	config.root = "test/www_test";
+
+	LocationConfig root;
+	root.path = "/";
+	root.root = "test/www_test";
+	root.index = "index.html";
+	root.allow_methods.push_back("GET");
+	root.client_max_body_size = config.client_max_body_size;
+	config.locations.push_back(root);
+
+	LocationConfig assets;
+	assets.path = "/static/assets";
+	assets.alias = "test/www_test/public";
+	assets.allow_methods.push_back("GET");
+	assets.client_max_body_size = config.client_max_body_size;
+	config.locations.push_back(assets);
+	config.compileLocations();
+	return config;
+}
+
+static void row(const std::string& label, const ServerConfig& config, const std::string& target, int requests)
+{
+	std::string raw = "GET " + target + " HTTP/1.1\r\n"
+					  "Host: localhost\r\n"
+					  "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+					  "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+					  "Accept-Encoding: gzip, deflate, br\r\n"
+					  "Connection: keep-alive\r\n"
+					  "\r\n";
+	Client client;
+	client.config = &config;
+	size_t parse = 0;
+	size_t handle = 0;
+	size_t serialize = 0;
+	int status = 0;
+
+	// The first request warms the buffers a connection keeps
+	for (int i = -1; i < requests; ++i)
+	{
+		client.compact();
+		size_t start = g_allocations;
+		client.request().parse(raw.data(), raw.size());
+		size_t parsed = g_allocations;
+		RequestHandler handler(config);
+		HttpResponse response = handler.handleRequest(client);
+		size_t handled = g_allocations;
+		client.response_buffer = response.serialize();
+		if (i >= 0)
+		{
+			parse += parsed - start;
+			handle += handled - parsed;
+			serialize += g_allocations - handled;
+		}
+		status = response.getStatus();
+	}
+	std::cout << std::left << std::setw(30) << label << std::right << std::fixed << std::setprecision(1)
+			  << std::setw(8) << static_cast<double>(parse) / requests
+			  << std::setw(8) << static_cast<double>(handle) / requests
+			  << std::setw(11) << static_cast<double>(serialize) / requests
+			  << std::setw(8) << status
+			  << std::setw(12) << client.arena().bytesUsed() << std::endl;
+}
+
+// Heap bytes of connections that each served one request, before and after
+// compaction: the connection records and all they hold
+static void idleBytes(const ServerConfig& config, const std::string& raw, size_t connections,
+					  size_t& served, size_t& idle)
+{
+	size_t before = g_live_bytes;
+	std::map<int, Client> clients;
+	for (size_t fd = 0; fd < connections; ++fd)
+	{
+		Client& client = clients[static_cast<int>(fd)];
+		client.config = &config;
+		client.request().parse(raw.data(), raw.size());
+		RequestHandler handler(config);
+		client.response_buffer = handler.handleRequest(client).serialize();
+		client.response_buffer.clear();		// Sent
+	}
+	served = g_live_bytes - before;
+	for (std::map<int, Client>::iterator it = clients.begin(); it != clients.end(); ++it)
+		it->second.compact();
+	idle = g_live_bytes - before;
+}
+
+// The buffer and exchange pools are shared and bounded: once they are full,
+// the difference between two connection counts is what each connection costs
+static void idleRow(const ServerConfig& config, const std::string& target, size_t connections)
+{
+	std::string raw = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+	size_t served[2];
+	size_t idle[2];
+	idleBytes(config, raw, connections, served[0], idle[0]);     // Fills the pools
+	idleBytes(config, raw, connections, served[0], idle[0]);
+	idleBytes(config, raw, 2 * connections, served[1], idle[1]);
+	std::cout << std::left << std::setw(36) << target << std::right
+			  << std::setw(14) << (served[1] - served[0]) / connections
+			  << std::setw(14) << (idle[1] - idle[0]) / connections << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	int requests = (argc > 1) ? std::atoi(argv[1]) : 10000;
+	if (requests <= 0)
+		requests = 1;
+	ServerConfig config = make_config();
+
+	std::cout << "Heap allocations per request (" << requests << " keep-alive requests per row)" << std::endl
+			  << std::endl << std::left << std::setw(30) << "request" << std::right << std::setw(8) << "parse"
+			  << std::setw(8) << "handle" << std::setw(11) << "serialize" << std::setw(8) << "status"
+			  << std::setw(12) << "arena bytes" << std::endl;
+	row("static file", config, "/file.txt", requests);
+	row("directory index", config, "/", requests);
+	row("alias, encoded path", config, "/static/assets/%69ndex%2Ehtml?v=3", requests);
+	row("not found", config, "/missing/page-that-does-not-exist.html", requests);
+
+	std::cout << std::endl << "Bytes per idle keep-alive connection (one request served on each)"
+			  << std::endl << std::endl << std::left << std::setw(36) << "last request" << std::right
+			  << std::setw(14) << "not compacted" << std::setw(14) << "compacted" << std::endl;
+	idleRow(config, "/file.txt", 1000);
+	idleRow(config, "/static/assets/%69ndex%2Ehtml?v=3", 1000);
+	std::cout << "Client::idleFootprint(): " << Client::idleFootprint() << " bytes" << std::endl;
+	return 0;
+}
@@ -0,0 +1,96 @@
+#include "http/HttpResponse.hpp"
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+
+// Response serialization cost: the former ostringstream + std::map serializer
+// against HttpResponse::serialize() and serializeTo() into a reused buffer.
+// Usage: ./bench_response [responses per row]
+
+using namespace wsv;
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Serializer of the previous HttpResponse: headers kept in a std::map
+static std::string legacySerialize(int status, const std::map<std::string, std::string>& headers,
+								   const std::string& body)
+{
+	std::ostringstream oss;
+	oss << "HTTP/1.1" << " " << status << " " << HttpResponse::getStatusMessage(status) << "\r\n";
+	for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it)
+		oss << it->first << ": " << it->second << "\r\n";
+	oss << "\r\n";
+	oss << body;
+	return oss.str();
+}
+
+static void report(const std::string& label, double elapsed, size_t rounds)
+{
+	std::cout << std::left << std::setw(48) << label << std::right << std::fixed << std::setprecision(0)
+			  << std::setw(8) << elapsed * 1e9 / rounds << " ns" << std::endl;
+}
+
+static void rows(const std::string& label, const HttpResponse& response, size_t rounds)
+{
+	HttpResponse::HeaderList list;
+	response.collectHeaders(list);
+	std::map<std::string, std::string> headers(list.begin(), list.end());
+	volatile size_t sink = 0;
+
+	double start = now();
+	for (size_t i = 0; i < rounds; ++i)
+		sink = sink + legacySerialize(response.getStatus(), headers, response.getBody()).size();
+	report(label + ": ostringstream + map", now() - start, rounds);
+
+	start = now();
+	for (size_t i = 0; i < rounds; ++i)
+		sink = sink + response.serialize().size();
+	report(label + ": serialize()", now() - start, rounds);
+
+	std::string out;
+	start = now();
+	for (size_t i = 0; i < rounds; ++i)
+	{
+		out.clear();
+		response.serializeTo(out);
+		sink = sink + out.size();
+	}
+	report(label + ": serializeTo(reused buffer)", now() - start, rounds);
+	std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	size_t rounds = (argc > 1) ? std::strtoul(argv[1], NULL, 10) : 1000000;
+	if (rounds == 0)
+		rounds = 1;
+
+	std::cout << "Serialize cost per response (" << rounds << " responses per row)" << std::endl << std::endl;
+
+	HttpResponse not_found = HttpResponse::createErrorResponse(404);
+	not_found.setHeader("Connection", "keep-alive");
+	rows("404 error page", not_found, rounds);
+
+	HttpResponse page;
+	page.setBody(std::string(1024, 'h'));
+	page.setContentType("text/html");
+	page.setHeader("Last-Modified", "Sat, 17 Oct 2026 09:12:44 GMT");
+	page.setHeader("Connection", "keep-alive");
+	rows("200 text/html, 1KB", page, rounds);
+
+	HttpResponse file;
+	file.setBody(std::string(64 * 1024, 'f'));
+	file.setContentType("application/octet-stream");
+	file.setHeader("Connection", "keep-alive");
+	rows("200 file, 64KB", file, rounds / 10);
+	return 0;
+}
@@ -0,0 +1,154 @@
+#include "config/ConfigParser.hpp"
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Location lookup cost: the former linear scans against the compiled trie,
+// for servers with 10, 100 and 1000 locations.
+// Usage: ./bench_routes [lookups per row]
+
+using namespace wsv;
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Lookup of the previous ServerConfig::findLocation: exact, prefix, then "/" scan
+static const LocationConfig* legacyFind(const ServerConfig& server, const char* uri, size_t len)
+{
+	const std::vector<LocationConfig>& locations = server.locations;
+	size_t normalized_len = len;
+	if (normalized_len > 1 && uri[normalized_len - 1] == '/')
+		normalized_len--;
+
+	for (size_t i = 0; i < locations.size(); ++i)
+	{
+		if (locations[i].path.compare(0, std::string::npos, uri, normalized_len) == 0 ||
+			locations[i].path.compare(0, std::string::npos, uri, len) == 0)
+			return &locations[i];
+	}
+
+	const LocationConfig* best_match = NULL;
+	size_t best_match_length = 0;
+	for (size_t i = 0; i < locations.size(); ++i)
+	{
+		const std::string& loc_path = locations[i].path;
+		if (loc_path.length() <= len && loc_path.compare(0, std::string::npos, uri, loc_path.length()) == 0
+			&& (loc_path.length() == len || uri[loc_path.length()] == '/')
+			&& loc_path.length() > best_match_length)
+		{
+			best_match = &locations[i];
+			best_match_length = loc_path.length();
+		}
+	}
+	if (best_match)
+		return best_match;
+
+	for (size_t i = 0; i < locations.size(); ++i)
+	{
+		if (locations[i].path == "/")
+			return &locations[i];
+	}
+	return NULL;
+}
+
+static std::string str(size_t value)
+{
+	std::ostringstream oss;
+	oss << value;
+	return oss.str();
+}
+
+// "/", then /svc<i> and /svc<i>/api for half of them
+static ServerConfig makeServer(size_t count)
+{
+	ServerConfig server;
+	LocationConfig root;
+	root.path = "/";
+	server.locations.push_back(root);
+	for (size_t i = 1; server.locations.size() < count; ++i)
+	{
+		LocationConfig location;
+		location.path = "/svc" + str(i);
+		server.locations.push_back(location);
+		if (i % 2 == 0 && server.locations.size() < count)
+		{
+			location.path = "/svc" + str(i) + "/api";
+			server.locations.push_back(location);
+		}
+	}
+	server.compileLocations();
+	return server;
+}
+
+// Exact hits, deep prefix hits and misses that fall back to "/"
+static std::vector<std::string> makeUris(size_t count)
+{
+	std::vector<std::string> uris;
+	size_t services = count / 2;
+	for (size_t i = 0; i < 64; ++i)
+	{
+		size_t svc = 1 + (i * 7919) % (services ? services : 1);
+		uris.push_back("/svc" + str(svc));
+		uris.push_back("/svc" + str(svc) + "/api/v1/users/42");
+		uris.push_back("/svc" + str(svc) + "/static/css/site.css");
+		uris.push_back("/unknown/" + str(i) + "/index.html");
+	}
+	return uris;
+}
+
+int main(int argc, char** argv)
+{
+	size_t rounds = (argc > 1) ? std::strtoul(argv[1], NULL, 10) : 1000000;
+	if (rounds == 0)
+		rounds = 1;
+
+	std::cout << "findLocation cost per lookup (" << rounds << " lookups per row)" << std::endl << std::endl;
+	std::cout << std::left << std::setw(12) << "locations" << std::right
+			  << std::setw(14) << "linear scan" << std::setw(14) << "trie" << std::endl;
+
+	static const size_t counts[] = { 10, 100, 1000 };
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+	{
+		ServerConfig server = makeServer(counts[c]);
+		std::vector<std::string> uris = makeUris(counts[c]);
+
+		for (size_t i = 0; i < uris.size(); ++i)
+		{
+			if (legacyFind(server, uris[i].data(), uris[i].size()) != server.findLocation(uris[i]))
+			{
+				std::cerr << "Mismatch for " << uris[i] << std::endl;
+				return 1;
+			}
+		}
+
+		size_t legacy_rounds = counts[c] >= 1000 ? rounds / 10 : rounds;
+		volatile size_t sink = 0;
+		double start = now();
+		for (size_t i = 0; i < legacy_rounds; ++i)
+		{
+			const std::string& uri = uris[i % uris.size()];
+			sink = sink + legacyFind(server, uri.data(), uri.size())->path.size();
+		}
+		double legacy = (now() - start) * 1e9 / legacy_rounds;
+
+		start = now();
+		for (size_t i = 0; i < rounds; ++i)
+		{
+			const std::string& uri = uris[i % uris.size()];
+			sink = sink + server.findLocation(uri.data(), uri.size())->path.size();
+		}
+		double trie = (now() - start) * 1e9 / rounds;
+
+		std::cout << std::left << std::setw(12) << counts[c] << std::right << std::fixed << std::setprecision(0)
+				  << std::setw(11) << legacy << " ns" << std::setw(11) << trie << " ns" << std::endl;
+	}
+	return 0;
+}
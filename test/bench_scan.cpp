@@ -0,0 +1,144 @@
+#include "http/HttpRequest.hpp"
+#include "utils/ByteScan.hpp"
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+// Delimiter scanning throughput: the former std::string find/substr/erase
+// header loop against ByteScan::scanLines() with each kernel this CPU runs.
+// Usage: ./bench_scan [GB of headers per row]
+
+static const char* HEAD =
+	"GET /products/list?category=shoes&page=3&sort=price HTTP/1.1\r\n"
+	"Host: shop.example.com\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+	"Accept-Language: en-US,en;q=0.5\r\n"
+	"Accept-Encoding: gzip, deflate, br, zstd\r\n"
+	"Referer: https://shop.example.com/products/list?category=shoes&page=2\r\n"
+	"Connection: keep-alive\r\n"
+	"Cookie: session=8f3a9c2e71d44b0f9a1e6c3d5b7a2f10; theme=dark; consent=1; cart=3\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"Sec-Fetch-Dest: document\r\n"
+	"Sec-Fetch-Mode: navigate\r\n"
+	"Sec-Fetch-Site: same-origin\r\n"
+	"Priority: u=0, i\r\n"
+	"\r\n";
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Header loop of the previous HttpRequest: one find, substr and erase per line
+static size_t legacyScan(const std::string& head)
+{
+	std::string buffer = head;
+	size_t colons = 0;
+	while (true)
+	{
+		size_t line_end = buffer.find("\r\n");
+		if (line_end == std::string::npos)
+			break;
+		std::string line = buffer.substr(0, line_end);
+		buffer.erase(0, line_end + 2);
+		if (line.empty())
+			break;
+		if (line.find(':') != std::string::npos)
+			colons++;
+	}
+	return colons;
+}
+
+static size_t byteScan(const std::string& head)
+{
+	ByteScan::Line lines[32];
+	ByteScan::LineScan scan;
+	size_t colons = 0;
+	while (true)
+	{
+		size_t count = ByteScan::scanLines(head.data(), head.size(), scan, lines, 32);
+		for (size_t i = 0; i < count; ++i)
+			colons += (lines[i].colon != ByteScan::npos);
+		if (count == 0 || lines[count - 1].end == lines[count - 1].start)
+			break;
+	}
+	return colons;
+}
+
+static size_t parseRequest(const std::string& head)
+{
+	wsv::HttpRequest request;
+	request.parse(head.data(), head.size());
+	return request.isComplete();
+}
+
+static void row(const std::string& label, size_t (*scan)(const std::string&),
+				const std::string& head, double gigabytes)
+{
+	size_t rounds = static_cast<size_t>(gigabytes * 1e9 / head.size());
+	volatile size_t sink = 0;
+	double start = now();
+	for (size_t i = 0; i < rounds; ++i)
+		sink = sink + scan(head);
+	double elapsed = now() - start;
+	double bytes = static_cast<double>(rounds) * head.size();
+	std::cout << std::left << std::setw(34) << label << std::right << std::fixed
+			  << std::setprecision(0) << std::setw(8) << bytes / elapsed / 1e6 << " MB/s"
+			  << std::setprecision(3) << std::setw(10) << elapsed * 1e9 / bytes << " s/GB" << std::endl;
+}
+
+static void findRow(const std::string& label, bool vector, const std::string& body,
+					const std::string& marker, double gigabytes)
+{
+	size_t rounds = static_cast<size_t>(gigabytes * 1e9 / body.size()) + 1;
+	volatile size_t sink = 0;
+	double start = now();
+	for (size_t i = 0; i < rounds; ++i)
+		sink = sink + (vector ? ByteScan::find(body.data(), body.size(), marker.data(), marker.size())
+							  : body.find(marker));
+	double elapsed = now() - start;
+	double bytes = static_cast<double>(rounds) * body.size();
+	std::cout << std::left << std::setw(34) << label << std::right << std::fixed
+			  << std::setprecision(0) << std::setw(8) << bytes / elapsed / 1e6 << " MB/s"
+			  << std::setprecision(3) << std::setw(10) << elapsed * 1e9 / bytes << " s/GB" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	double gigabytes = (argc > 1) ? std::atof(argv[1]) : 1.0;
+	std::string head = HEAD;
+	const char* kernels[] = { "scalar", "sse2", "avx2" };
+
+	std::cout << "Header block: " << head.size() << " bytes, " << gigabytes << " GB per row, dispatch picks "
+			  << ByteScan::kernelName() << std::endl << std::endl;
+
+	row("std::string find/substr/erase", legacyScan, head, gigabytes);
+	for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i)
+	{
+		if (ByteScan::useKernel(kernels[i]))
+			row(std::string("ByteScan::scanLines ") + kernels[i], byteScan, head, gigabytes);
+	}
+	ByteScan::useKernel(ByteScan::kernelName());
+	row("HttpRequest::parse (whole head)", parseRequest, head, gigabytes);
+
+	// Multipart: the closing boundary at the end of a 4 MB upload
+	std::string marker = "--------------------------boundary7MA4YWxkTrZu0gW";
+	std::string body(4 << 20, 'x');
+	for (size_t i = 0; i < body.size(); i += 61)
+		body[i] = '-';
+	body += "\r\n" + marker + "--\r\n";
+	std::cout << std::endl;
+	findRow("std::string::find boundary", false, body, marker, gigabytes);
+	for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i)
+	{
+		if (ByteScan::useKernel(kernels[i]))
+			findRow(std::string("ByteScan::find ") + kernels[i], true, body, marker, gigabytes);
+	}
+	return 0;
+}
@@ -0,0 +1,88 @@
+#!/bin/bash
+# Connection setup latency: HTTP/1.1 vs TLS full, resumed and 0-RTT handshakes
+# Usage: ./bench_tls_latency.sh [host] [http_port] [https_port] [requests] [delay] [loss]
+#   delay/loss are applied to loopback with tc netem (root), e.g. 25ms 1%
+# The https server needs `ssl_early_data on;` for the 0-RTT rows.
+
+HOST="${1:-127.0.0.1}"
+HTTP_PORT="${2:-8080}"
+HTTPS_PORT="${3:-8443}"
+REQUESTS="${4:-20}"
+DELAY="${5:-}"
+LOSS="${6:-}"
+PATH_="/"
+
+RED='\033[0;31m'
+YELLOW='\033[1;33m'
+NC='\033[0m'
+
+SESSION=$(mktemp)
+EARLY=$(mktemp)
+trap 'rm -f "$SESSION" "$EARLY"; [ -n "$NETEM" ] && tc qdisc del dev lo root 2>/dev/null' EXIT
+
+echo "========================================"
+echo "  Webserv TLS Latency Benchmark"
+echo "========================================"
+echo "HTTP :$HTTP_PORT | HTTPS :$HTTPS_PORT | $REQUESTS requests per row"
+
+if [ -n "$DELAY" ]; then
+    if tc qdisc add dev lo root netem delay "$DELAY" ${LOSS:+loss "$LOSS"} 2>/dev/null; then
+        NETEM=1
+        echo "netem on lo: delay $DELAY ${LOSS:+loss $LOSS}"
+    else
+        echo -e "${RED}tc netem unavailable (root and sch_netem needed), running without${NC}"
+    fi
+fi
+echo ""
+
+# Median of the values read on stdin (seconds), printed in ms
+median() {
+    sort -n | awk '{ v[NR] = $1 } END { if (NR) printf "%.1f ms\n", v[int((NR + 1) / 2)] * 1000 }'
+}
+
+# One curl process, one connection per request (the server closes after each
+# response), so later TLS connections resume the session of the first one;
+# the first request is left out
+curl_row() {
+    local label="$1" url="$2"; shift 2
+    printf "%-28s" "$label"
+    curl -s --http1.1 -H "Connection: close" -w "%{time_starttransfer}\n" "$@" \
+        $(for i in $(seq 1 "$REQUESTS"); do echo "-o /dev/null $url"; done) | tail -n +2 | median
+}
+
+curl_row "HTTP/1.1 (TCP only)" "http://$HOST:$HTTP_PORT$PATH_"
+curl_row "TLS full handshake" "https://$HOST:$HTTPS_PORT$PATH_" -k --no-sessionid
+curl_row "TLS resumed (curl)" "https://$HOST:$HTTPS_PORT$PATH_" -k
+
+# openssl s_client rows share the same process overhead: compare them to each other
+printf 'GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n' "$PATH_" "$HOST" > "$EARLY"
+echo -n | openssl s_client -connect "$HOST:$HTTPS_PORT" -tls1_3 -sess_out "$SESSION" -quiet >/dev/null 2>&1
+
+# Time to the first response byte; the rest is drained so s_client stays
+# alive to store the next ticket (tickets are single-use for 0-RTT)
+s_client_row() {
+    local label="$1" early="$2"
+    printf "%-28s" "$label"
+    for i in $(seq 1 "$REQUESTS"); do
+        local start end
+        start=$(date +%s%N)
+        if [ -n "$early" ]; then
+            end=$(openssl s_client -connect "$HOST:$HTTPS_PORT" -tls1_3 -sess_in "$SESSION" \
+                -sess_out "$SESSION" -early_data "$EARLY" -ign_eof -quiet < /dev/null 2>/dev/null \
+                | { head -c 1 > /dev/null; date +%s%N; cat > /dev/null; })
+        else
+            end=$(openssl s_client -connect "$HOST:$HTTPS_PORT" -tls1_3 -sess_in "$SESSION" \
+                -sess_out "$SESSION" -ign_eof -quiet < "$EARLY" 2>/dev/null \
+                | { head -c 1 > /dev/null; date +%s%N; cat > /dev/null; })
+        fi
+        echo "$(( (end - start) / 1000 ))e-6"
+    done | median
+}
+
+s_client_row "TLS 1.3 resumed (s_client)" ""
+s_client_row "TLS 1.3 0-RTT (s_client)" "early"
+
+if ! openssl s_client -connect "$HOST:$HTTPS_PORT" -tls1_3 -sess_in "$SESSION" -early_data "$EARLY" \
+        -ign_eof < /dev/null 2>/dev/null | grep -q "Early data was accepted"; then
+    echo -e "${YELLOW}Early data was not accepted: is ssl_early_data on?${NC}"
+fi
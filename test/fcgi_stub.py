@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+Minimal FastCGI responder used as a stand-in worker for fastcgi_pass tests.
+
+Usage: python3 test/fcgi_stub.py [/tmp/webserv_fcgi.sock]
+
+Each request answers with a text/plain body that echoes the method, the
+query string, the request body size and a per-connection request counter,
+so keep-alive reuse of worker connections can be observed from the client.
+"""
+import os
+import socket
+import struct
+import sys
+import threading
+
+BEGIN_REQUEST, END_REQUEST, PARAMS, STDIN, STDOUT = 1, 3, 4, 5, 6
+FLAG_KEEP_CONN = 1
+
+
+def read_exact(conn, n):
+    data = b""
+    while len(data) < n:
+        chunk = conn.recv(n - len(data))
+        if not chunk:
+            raise EOFError
+        data += chunk
+    return data
+
+
+def read_record(conn):
+    header = read_exact(conn, 8)
+    _, rtype, req_id, length, padding, _ = struct.unpack("!BBHHBB", header)
+    content = read_exact(conn, length)
+    read_exact(conn, padding)
+    return rtype, req_id, content
+
+
+def write_record(conn, rtype, req_id, content):
+    padding = (8 - len(content) % 8) % 8
+    conn.sendall(struct.pack("!BBHHBB", 1, rtype, req_id, len(content), padding, 0)
+                 + content + b"\0" * padding)
+
+
+def decode_params(data):
+    params, pos = {}, 0
+    while pos < len(data):
+        lengths = []
+        for _ in range(2):
+            if data[pos] < 128:
+                lengths.append(data[pos])
+                pos += 1
+            else:
+                lengths.append(struct.unpack("!I", data[pos:pos + 4])[0] & 0x7FFFFFFF)
+                pos += 4
+        name = data[pos:pos + lengths[0]].decode()
+        pos += lengths[0]
+        params[name] = data[pos:pos + lengths[1]].decode()
+        pos += lengths[1]
+    return params
+
+
+def serve_connection(conn):
+    served = 0
+    try:
+        while True:
+            params_data, body, keep_conn, req_id = b"", b"", False, 0
+            params_done = stdin_done = False
+            while not (params_done and stdin_done):
+                rtype, req_id, content = read_record(conn)
+                if rtype == BEGIN_REQUEST:
+                    keep_conn = bool(content[2] & FLAG_KEEP_CONN)
+                elif rtype == PARAMS:
+                    params_done = not content
+                    params_data += content
+                elif rtype == STDIN:
+                    stdin_done = not content
+                    body += content
+            served += 1
+            params = decode_params(params_data)
+            reply = ("method=%s\nquery=%s\nbody=%d\nconn_requests=%d\n" % (
+                params.get("REQUEST_METHOD", ""), params.get("QUERY_STRING", ""),
+                len(body), served)).encode()
+            write_record(conn, STDOUT, req_id,
+                         b"Content-Type: text/plain\r\n\r\n" + reply)
+            write_record(conn, STDOUT, req_id, b"")
+            write_record(conn, END_REQUEST, req_id, struct.pack("!IB3x", 0, 0))
+            if not keep_conn:
+                break
+    except (EOFError, ConnectionError):
+        pass
+    finally:
+        conn.close()
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "/tmp/webserv_fcgi.sock"
+    if os.path.exists(path):
+        os.unlink(path)
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    server.bind(path)
+    server.listen(128)
+    print("FastCGI stub listening on %s" % path)
+    while True:
+        conn, _ = server.accept()
+        threading.Thread(target=serve_connection, args=(conn,), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
@@ -1,9 +1,20 @@
 #include "cgi/CgiHandler.hpp"
+#include "cgi/CgiCache.hpp"
+#include "cgi/CgiLimiter.hpp"
 #include "TestRunner.hpp"
+#include "utils/StringUtils.hpp"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
 #include <vector>
+#include <algorithm>
 #include <cstring>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 namespace wsv
 {
@@ -158,6 +169,350 @@ void test_large_input(TestRunner& runner) {
     }
 }
 
+void test_spawn_failure(TestRunner& runner) {
+    runner.startTest("CgiHandler spawn of missing interpreter throws");
+    try {
+        CgiHandler h("/nonexistent/interpreter", "script.py");
+        CgiHandlerTestable t(h);
+        try {
+            h.start();
+            runner.fail("Expected SpawnFailed");
+            return;
+        } catch (const CgiHandler::SpawnFailed&) {
+        }
+        if (!t.arePipesClosed()) throw std::runtime_error("Pipes leaked after failed spawn");
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+void test_spawn_fd_isolation(TestRunner& runner) {
+    runner.startTest("CgiHandler child inherits only stdio");
+    try {
+        // An inheritable descriptor the child must not see
+        int devnull = open("/dev/null", O_RDONLY);
+        int leaked = fcntl(devnull, F_DUPFD, 40);
+        close(devnull);
+        if (leaked < 0) throw std::runtime_error("open failed");
+
+        CgiHandler h("/bin/ls", "/proc/self/fd");
+        pid_t pid = h.start();
+        h.closeStdin();
+
+        std::string output;
+        char buf[256];
+        struct pollfd pfd;
+        pfd.fd = h.getStdoutReadFd();
+        pfd.events = POLLIN;
+        while (poll(&pfd, 1, 2000) > 0) {
+            ssize_t n = read(pfd.fd, buf, sizeof(buf));
+            if (n <= 0) break;
+            output.append(buf, n);
+        }
+        waitpid(pid, NULL, 0);
+        close(leaked);
+
+        if (output.find("\n" + StringUtils::toString(leaked) + "\n") != std::string::npos)
+            throw std::runtime_error("Child inherited fd: " + output);
+        if (output.find("0\n1\n") != 0) throw std::runtime_error("stdio not mapped: " + output);
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+void test_spawn_rlimits(TestRunner& runner) {
+    runner.startTest("CgiHandler applies per-location rlimits to the child");
+    try {
+        // Reads its limits at once: they must be set before the exec
+        const char* script = "/tmp/wsv_test_limits.sh";
+        std::ofstream out(script);
+        out << "cat /proc/$$/limits\n";
+        out.close();
+
+        CgiHandler h("/bin/sh", script);
+        CgiHandler::Limits limits;
+        limits.cpu_seconds = 3;
+        limits.address_space = 512UL * 1024 * 1024;
+        limits.open_files = 16;
+        h.setLimits(limits);
+        pid_t pid = h.start();
+        h.closeStdin();
+
+        std::string output;
+        char buf[512];
+        struct pollfd pfd;
+        pfd.fd = h.getStdoutReadFd();
+        pfd.events = POLLIN;
+        while (poll(&pfd, 1, 2000) > 0) {
+            ssize_t n = read(pfd.fd, buf, sizeof(buf));
+            if (n <= 0) break;
+            output.append(buf, n);
+        }
+        waitpid(pid, NULL, 0);
+        unlink(script);
+
+        std::istringstream lines(output);
+        std::string line;
+        std::map<std::string, std::string> found;
+        while (std::getline(lines, line)) {
+            std::vector<std::string> cols = StringUtils::split(line.substr(std::min<size_t>(line.size(), 26)), " ");
+            if (cols.size() >= 2)
+                found[StringUtils::trim(line.substr(0, 26))] = cols[0] + " " + cols[1];
+        }
+        if (found["Max cpu time"] != "3 4")
+            throw std::runtime_error("cpu: " + found["Max cpu time"]);
+        if (found["Max open files"] != "16 16")
+            throw std::runtime_error("nofile: " + found["Max open files"]);
+        if (found["Max address space"] != "536870912 536870912")
+            throw std::runtime_error("as: " + found["Max address space"]);
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+void test_fastcgi_encode(TestRunner& runner) {
+    runner.startTest("FastCGI request encoding");
+    try {
+        FastCgi::ParamMap params;
+        params["REQUEST_METHOD"] = "POST";
+        params["LONG_VALUE"] = std::string(200, 'x');
+        std::string out = FastCgi::encodeRequest(1, params, "body", true);
+
+        // BEGIN_REQUEST header: version 1, type 1, id 1, length 8
+        if (out.size() < 16 || out[0] != 1 || out[1] != FastCgi::BEGIN_REQUEST || out[3] != 1 || out[5] != 8)
+            throw std::runtime_error("BEGIN_REQUEST header malformed");
+        if (out[8 + 1] != FastCgi::ROLE_RESPONDER || out[8 + 2] != FastCgi::FLAG_KEEP_CONN)
+            throw std::runtime_error("BEGIN_REQUEST body malformed");
+        // Every record is padded to 8 bytes
+        if (out.size() % 8 != 0)
+            throw std::runtime_error("Records are not 8-byte aligned");
+        if (out.find("REQUEST_METHODPOST") == std::string::npos)
+            throw std::runtime_error("Short name-value pair missing");
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+static std::string make_record(unsigned char type, const std::string& content) {
+    std::string rec;
+    rec += static_cast<char>(1);
+    rec += static_cast<char>(type);
+    rec += static_cast<char>(0);
+    rec += static_cast<char>(1);
+    rec += static_cast<char>((content.size() >> 8) & 0xFF);
+    rec += static_cast<char>(content.size() & 0xFF);
+    rec += static_cast<char>(0);
+    rec += static_cast<char>(0);
+    return rec + content;
+}
+
+void test_fastcgi_decode(TestRunner& runner) {
+    runner.startTest("FastCGI response decoding (split records)");
+    try {
+        std::string end_body(8, '\0');
+        std::string stream = make_record(FastCgi::STDOUT, "Content-Type: text/plain\r\n\r\n")
+                           + make_record(FastCgi::STDOUT, "hello")
+                           + make_record(FastCgi::STDOUT, "")
+                           + make_record(FastCgi::END_REQUEST, end_body);
+
+        FastCgi::ResponseParser parser;
+        std::string output;
+        // Feed one byte at a time to exercise partial records
+        for (size_t i = 0; i < stream.size(); ++i)
+            parser.feed(stream.data() + i, 1, output);
+
+        if (!parser.isComplete()) throw std::runtime_error("END_REQUEST not detected");
+        if (parser.hasError()) throw std::runtime_error("Unexpected protocol error");
+        if (output != "Content-Type: text/plain\r\n\r\nhello") throw std::runtime_error("STDOUT mismatch: " + output);
+        if (parser.getTrailingBytes() != 0) throw std::runtime_error("Unexpected trailing bytes");
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+static HttpRequest make_get(const std::string& raw) {
+    HttpRequest request;
+    request.parse(raw.c_str(), raw.size());
+    if (!request.isComplete())
+        throw std::runtime_error("Test request did not parse");
+    return request;
+}
+
+void test_cgi_cache_key(TestRunner& runner) {
+    runner.startTest("CgiCache key covers path, query and key headers");
+    try {
+        ServerConfig server;
+        LocationConfig location;
+        location.cgi_cache_key_headers.push_back("Accept-Language");
+
+        std::string base = "GET /cgi-bin/a.py?x=1 HTTP/1.1\r\nHost: h\r\nAccept-Language: en\r\n";
+        std::string key = CgiCache::makeKey(make_get(base + "Cookie: a\r\n\r\n"), location, server);
+
+        if (key != CgiCache::makeKey(make_get(base + "Cookie: b\r\n\r\n"), location, server))
+            throw std::runtime_error("Header outside the key changed it");
+        if (key == CgiCache::makeKey(make_get("GET /cgi-bin/a.py?x=2 HTTP/1.1\r\nHost: h\r\nAccept-Language: en\r\n\r\n"), location, server))
+            throw std::runtime_error("Query string not part of the key");
+        if (key == CgiCache::makeKey(make_get("GET /cgi-bin/a.py?x=1 HTTP/1.1\r\nHost: h\r\nAccept-Language: fr\r\n\r\n"), location, server))
+            throw std::runtime_error("Key header not part of the key");
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+void test_cgi_cache_control(TestRunner& runner) {
+    runner.startTest("CgiCache honors status and Cache-Control");
+    try {
+        CgiCache::HeaderMap headers;
+        if (CgiCache::storableTtl(200, headers, 30) != 30) throw std::runtime_error("Default TTL not used");
+        if (CgiCache::storableTtl(404, headers, 30) != 0) throw std::runtime_error("Non-200 stored");
+
+        headers["cache-control"] = "public, max-age=5";
+        if (CgiCache::storableTtl(200, headers, 30) != 5) throw std::runtime_error("max-age ignored");
+        headers["cache-control"] = "max-age=60, No-Store";
+        if (CgiCache::storableTtl(200, headers, 30) != 0) throw std::runtime_error("no-store ignored");
+        headers["cache-control"] = "private";
+        if (CgiCache::storableTtl(200, headers, 30) != 0) throw std::runtime_error("private ignored");
+
+        headers.clear();
+        headers["Set-Cookie"] = "id=1";
+        if (CgiCache::storableTtl(200, headers, 30) != 0) throw std::runtime_error("Set-Cookie response stored");
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+void test_cgi_cache_expiry(TestRunner& runner) {
+    runner.startTest("CgiCache entries expire after their TTL");
+    try {
+        CgiCache cache;
+        HttpResponse stored = HttpResponse::createOkResponse("cached", "text/plain");
+        cache.store("k", stored, 10, 1000);
+
+        HttpResponse hit;
+        if (!cache.lookup("k", hit, 1004)) throw std::runtime_error("Fresh entry missed");
+        if (hit.getBody() != "cached") throw std::runtime_error("Wrong body");
+        if (hit.getHeader("Age") != "4") throw std::runtime_error("Age header wrong: " + hit.getHeader("Age"));
+        if (cache.lookup("k", hit, 1010)) throw std::runtime_error("Expired entry served");
+        if (cache.size() != 0) throw std::runtime_error("Expired entry kept");
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+void test_cgi_cache_coalescing(TestRunner& runner) {
+    runner.startTest("CgiCache coalesces identical misses");
+    try {
+        CgiCache cache;
+        if (cache.joinFlight("k", 5)) throw std::runtime_error("First miss should lead");
+        if (!cache.joinFlight("k", 6) || !cache.joinFlight("k", 7) || !cache.joinFlight("k", 8))
+            throw std::runtime_error("Identical misses should wait");
+        if (cache.joinFlight("other", 9)) throw std::runtime_error("Different key should lead");
+
+        cache.leaveFlight("k", 7);
+        std::vector<int> waiters = cache.finishFlight("k");
+        if (waiters.size() != 2 || waiters[0] != 6 || waiters[1] != 8)
+            throw std::runtime_error("Wrong waiters released");
+        if (cache.joinFlight("k", 10)) throw std::runtime_error("Finished flight still open");
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+void test_cgi_file_delegation(TestRunner& runner) {
+    runner.startTest("CGI X-Accel-Redirect / X-Sendfile detection");
+    try {
+        CgiHandler::HeaderMap headers;
+        std::string body;
+        std::string target;
+        bool is_uri = false;
+
+        CgiHandler::parseCgiOutput("Content-Type: text/plain\r\n\r\nhello", headers, body);
+        if (CgiHandler::getFileDelegation(headers, target, is_uri))
+            throw std::runtime_error("Plain response detected as delegation");
+
+        headers.clear();
+        CgiHandler::parseCgiOutput("x-accel-redirect: /protected/a.bin\r\n\r\n", headers, body);
+        if (!CgiHandler::getFileDelegation(headers, target, is_uri) || !is_uri || target != "/protected/a.bin")
+            throw std::runtime_error("X-Accel-Redirect not detected");
+
+        headers.clear();
+        CgiHandler::parseCgiOutput("X-Sendfile: /srv/files/a.bin\n\n", headers, body);
+        if (!CgiHandler::getFileDelegation(headers, target, is_uri) || is_uri || target != "/srv/files/a.bin")
+            throw std::runtime_error("X-Sendfile not detected");
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+void test_cgi_status(TestRunner& runner) {
+    runner.startTest("CGI Status header must be a code in 100-599");
+    try {
+        if (CgiHandler::parseStatus("404 Not Found") != 404 || CgiHandler::parseStatus(" 201") != 201)
+            throw std::runtime_error("Valid Status rejected");
+        const char* invalid[] = { "", "abc", "20", "2000", "099", "600", "20x OK", "404Not Found" };
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+        {
+            if (CgiHandler::parseStatus(invalid[i]) != 0)
+                throw std::runtime_error(std::string("Invalid Status accepted: ") + invalid[i]);
+        }
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
+void test_cgi_limiter(TestRunner& runner) {
+    runner.startTest("CgiLimiter caps running CGI and queues in FIFO order");
+    try {
+        CgiLimiter limiter;
+        LocationConfig location;
+        location.cgi_max_concurrent = 2;
+        location.cgi_queue = 2;
+
+        if (limiter.admit(location, 10) != CgiLimiter::ADMIT_RUN ||
+            limiter.admit(location, 11) != CgiLimiter::ADMIT_RUN)
+            throw std::runtime_error("Requests under the limit should run");
+        if (limiter.admit(location, 12) != CgiLimiter::ADMIT_QUEUED ||
+            limiter.admit(location, 13) != CgiLimiter::ADMIT_QUEUED)
+            throw std::runtime_error("Requests over the limit should queue");
+        if (limiter.admit(location, 14) != CgiLimiter::ADMIT_REJECTED)
+            throw std::runtime_error("Request beyond the queue should be rejected");
+        if (limiter.nextQueued(location) != -1)
+            throw std::runtime_error("Queued request started without a free slot");
+
+        limiter.release(location);
+        if (limiter.nextQueued(location) != 12)
+            throw std::runtime_error("Queue is not FIFO");
+
+        limiter.remove(location, 13);
+        limiter.release(location);
+        if (limiter.nextQueued(location) != -1)
+            throw std::runtime_error("Removed client was started");
+
+        CgiLimiter::Stats stats = limiter.getStats(location);
+        if (stats.running != 1 || stats.queued != 0 || stats.max_queued != 2 ||
+            stats.total_queued != 2 || stats.total_rejected != 1)
+            throw std::runtime_error("Stats mismatch");
+
+        HttpResponse busy = limiter.busyResponse();
+        if (busy.getStatus() != 503 || busy.getHeader("Retry-After").empty())
+            throw std::runtime_error("Busy response malformed");
+        runner.pass();
+    } catch (const std::exception& e) {
+        runner.fail(e.what());
+    }
+}
+
 } // namespace wsv
 
 int main() {
@@ -173,6 +528,18 @@ int main() {
     wsv::test_empty_input(runner);
     wsv::test_timeout_config(runner);
     wsv::test_large_input(runner);
+    wsv::test_spawn_failure(runner);
+    wsv::test_spawn_fd_isolation(runner);
+    wsv::test_spawn_rlimits(runner);
+    wsv::test_fastcgi_encode(runner);
+    wsv::test_fastcgi_decode(runner);
+    wsv::test_cgi_cache_key(runner);
+    wsv::test_cgi_cache_control(runner);
+    wsv::test_cgi_cache_expiry(runner);
+    wsv::test_cgi_cache_coalescing(runner);
+    wsv::test_cgi_limiter(runner);
+    wsv::test_cgi_file_delegation(runner);
+    wsv::test_cgi_status(runner);
 
     runner.summary();
     return runner.allPassed() ? 0 : 1;
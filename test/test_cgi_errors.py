@@ -37,6 +37,9 @@ def main():
     # Test 3: Large Output (check if server handles it without crashing)
     results.append(run_test("Large Output", "/cgi-bin/large_output.py", 200))
 
+    # Test 4: Script closes stdout but keeps running (response waits for exit, loop does not block)
+    results.append(run_test("Stdout Closed Early", "/cgi-bin/close_stdout.py", 200))
+
     if all(results):
         sys.exit(0)
     else:
@@ -148,6 +148,107 @@ void test_location_matching(TestRunner& runner, const std::string& config_path)
 	}
 }
 
+void test_upstream_block(TestRunner& runner)
+{
+	runner.startTest("Parse upstream block and proxy_pass to it");
+	std::string filename = "temp_upstream.conf";
+	std::ofstream out(filename.c_str());
+	out << "server {\n"
+		<< "    listen 8080;\n"
+		<< "    location /api {\n"
+		<< "        proxy_pass http://backend/v1;\n"
+		<< "    }\n"
+		<< "}\n"
+		<< "upstream backend {\n"
+		<< "    hash $remote_addr;\n"
+		<< "    server 127.0.0.1:9001 weight=3 max_fails=2 fail_timeout=30s;\n"
+		<< "    server localhost:9002;\n"
+		<< "    health_check interval=2s uri=/health fails=3;\n"
+		<< "}\n";
+	out.close();
+
+	try {
+		wsv::ConfigParser parser(filename);
+		parser.parse();
+		if (parser.getUpstreams().size() != 1) throw std::runtime_error("Upstream not parsed");
+
+		const wsv::UpstreamConfig& upstream = parser.getUpstreams()[0];
+		if (upstream.name != "backend" || upstream.policy != "hash" || upstream.hash_key != "$remote_addr")
+			throw std::runtime_error("Name or policy mismatch");
+		if (upstream.peers.size() != 2) throw std::runtime_error("Expected 2 servers");
+		if (upstream.peers[0].port != 9001 || upstream.peers[0].weight != 3 ||
+			upstream.peers[0].max_fails != 2 || upstream.peers[0].fail_timeout != 30)
+			throw std::runtime_error("Server parameters mismatch");
+		if (upstream.peers[1].host != "localhost" || upstream.peers[1].weight != 1)
+			throw std::runtime_error("Server defaults mismatch");
+		if (upstream.health_interval != 2 || upstream.health_uri != "/health" || upstream.health_fails != 3)
+			throw std::runtime_error("health_check mismatch");
+
+		const wsv::LocationConfig* loc = parser.getServers()[0].findLocation("/api/x");
+		if (!loc || loc->proxy_upstream != "backend" || loc->proxy_uri != "/v1")
+			throw std::runtime_error("proxy_pass not resolved to the upstream");
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+	std::remove(filename.c_str());
+}
+
+void test_location_trie(TestRunner& runner)
+{
+	runner.startTest("Location trie matches on segment boundaries");
+	try {
+		wsv::ServerConfig server;
+		const char* paths[] = { "/", "/img", "/img/thumbs", "/docs/", "/img", "/api/v1" };
+		for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i)
+		{
+			wsv::LocationConfig location;
+			location.path = paths[i];
+			location.index = "location" + StringUtils::toString((int)i);
+			server.locations.push_back(location);
+		}
+		server.compileLocations();
+
+		struct {
+			const char* uri;
+			const char* expected;	// index of the location
+		} cases[] = {
+			{"/img", "location1"},				// Exact, the first of the two "/img"
+			{"/img/", "location1"},				// Trailing slash ignored for exact match
+			{"/imgs/a.png", "location0"},			// Not a segment boundary: falls back to "/"
+			{"/img/thumbs/a.png", "location2"},	// Longest segment prefix
+			{"/img/thumbsup", "location1"},
+			{"/docs/", "location3"},
+			{"/docs/guide", "location0"},			// "/docs/" is exact-only, as before
+			{"/api/v1/users", "location5"},
+			{"/api", "location0"}
+		};
+		for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+		{
+			const wsv::LocationConfig* loc = server.findLocation(cases[i].uri);
+			if (!loc || loc->index != cases[i].expected)
+				throw std::runtime_error(std::string("Wrong location for ") + cases[i].uri + ": "
+										 + (loc ? loc->index : "none"));
+		}
+
+		// Edited or added locations are matched once compiled again
+		server.locations[5].path = "/v2";
+		wsv::LocationConfig late;
+		late.path = "/late";
+		server.locations.push_back(late);
+		server.compileLocations();
+		const wsv::LocationConfig* loc = server.findLocation("/late/x");
+		if (!loc || loc->path != "/late") throw std::runtime_error("Trie not rebuilt for a new location");
+		loc = server.findLocation("/v2/users");
+		if (!loc || loc->index != "location5") throw std::runtime_error("Trie not rebuilt for an edited location");
+		loc = server.findLocation("/api/v1/users");
+		if (!loc || loc->index != "location0") throw std::runtime_error("Replaced location still matched");
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
 int main(int argc, char** argv)
 {
 	if (argc != 2)
@@ -163,7 +264,9 @@ int main(int argc, char** argv)
 
 	test_valid_config(runner, config_path);
 	test_location_matching(runner, config_path);
+	test_location_trie(runner);
 	test_invalid_config(runner);
+	test_upstream_block(runner);
 
 	runner.summary();
 	return runner.allPassed() ? 0 : 1;
@@ -0,0 +1,593 @@
+#include "http/Hpack.hpp"
+#include "http/Http2.hpp"
+#include "http/HttpRequest.hpp"
+#include "http/HttpResponse.hpp"
+#include "TestRunner.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdexcept>
+
+using wsv::Hpack;
+using wsv::Http2Connection;
+
+struct Frame
+{
+	int			type;
+	int			flags;
+	int			stream_id;
+	std::string	payload;
+};
+
+static std::string fromHex(const std::string& hex)
+{
+	std::string out;
+	for (size_t i = 0; i + 1 < hex.size(); i += 2)
+	{
+		unsigned int byte;
+		std::sscanf(hex.c_str() + i, "%2x", &byte);
+		out += static_cast<char>(byte);
+	}
+	return out;
+}
+
+static std::string toHex(const std::string& data)
+{
+	std::string out;
+	char buf[3];
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		std::sprintf(buf, "%02x", static_cast<unsigned char>(data[i]));
+		out += buf;
+	}
+	return out;
+}
+
+static std::string frame(int type, int flags, int stream_id, const std::string& payload)
+{
+	std::string out;
+	out += static_cast<char>((payload.size() >> 16) & 0xff);
+	out += static_cast<char>((payload.size() >> 8) & 0xff);
+	out += static_cast<char>(payload.size() & 0xff);
+	out += static_cast<char>(type);
+	out += static_cast<char>(flags);
+	out += static_cast<char>((stream_id >> 24) & 0x7f);
+	out += static_cast<char>((stream_id >> 16) & 0xff);
+	out += static_cast<char>((stream_id >> 8) & 0xff);
+	out += static_cast<char>(stream_id & 0xff);
+	return out + payload;
+}
+
+static std::string setting(int id, unsigned int value)
+{
+	std::string out;
+	out += static_cast<char>(id >> 8);
+	out += static_cast<char>(id & 0xff);
+	out += static_cast<char>(value >> 24);
+	out += static_cast<char>((value >> 16) & 0xff);
+	out += static_cast<char>((value >> 8) & 0xff);
+	out += static_cast<char>(value & 0xff);
+	return out;
+}
+
+static std::vector<Frame> parseFrames(const std::string& data)
+{
+	std::vector<Frame> frames;
+	size_t pos = 0;
+	while (pos + 9 <= data.size())
+	{
+		Frame f;
+		size_t len = (static_cast<unsigned char>(data[pos]) << 16) |
+					 (static_cast<unsigned char>(data[pos + 1]) << 8) |
+					 static_cast<unsigned char>(data[pos + 2]);
+		f.type = static_cast<unsigned char>(data[pos + 3]);
+		f.flags = static_cast<unsigned char>(data[pos + 4]);
+		f.stream_id = ((static_cast<unsigned char>(data[pos + 5]) & 0x7f) << 24) |
+					  (static_cast<unsigned char>(data[pos + 6]) << 16) |
+					  (static_cast<unsigned char>(data[pos + 7]) << 8) |
+					  static_cast<unsigned char>(data[pos + 8]);
+		f.payload = data.substr(pos + 9, len);
+		frames.push_back(f);
+		pos += 9 + len;
+	}
+	return frames;
+}
+
+static std::string requestBlock(Hpack::Encoder& encoder, const std::string& method,
+								const std::string& path, const std::string& extra_name = "",
+								const std::string& extra_value = "")
+{
+	Hpack::HeaderList headers;
+	headers.push_back(std::make_pair(std::string(":method"), method));
+	headers.push_back(std::make_pair(std::string(":scheme"), std::string("http")));
+	headers.push_back(std::make_pair(std::string(":path"), path));
+	headers.push_back(std::make_pair(std::string(":authority"), std::string("localhost")));
+	if (!extra_name.empty())
+		headers.push_back(std::make_pair(extra_name, extra_value));
+	return encoder.encode(headers);
+}
+
+// Preface plus an empty SETTINGS frame (and any extra settings)
+static std::string clientStart(const std::string& settings = "")
+{
+	return std::string(Http2Connection::PREFACE) + frame(Http2Connection::FRAME_SETTINGS, 0, 0, settings);
+}
+
+static std::string produceAll(Http2Connection& conn)
+{
+	std::string out;
+	conn.produce(out, 1 << 20);
+	return out;
+}
+
+static std::string dataOf(const std::vector<Frame>& frames, int stream_id)
+{
+	std::string body;
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		if (frames[i].type == Http2Connection::FRAME_DATA && frames[i].stream_id == stream_id)
+			body += frames[i].payload;
+	}
+	return body;
+}
+
+static const Frame* findFrame(const std::vector<Frame>& frames, int type, int stream_id)
+{
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		if (frames[i].type == type && frames[i].stream_id == stream_id)
+			return &frames[i];
+	}
+	return NULL;
+}
+
+static void feed(Http2Connection& conn, const std::string& data)
+{
+	if (!conn.feed(data.c_str(), data.size()))
+		throw std::runtime_error("Connection error on valid input");
+}
+
+// ========================================
+// HPACK
+// ========================================
+
+void test_hpack_integers(TestRunner& runner)
+{
+	runner.startTest("HPACK integer coding (RFC 7541 C.1)");
+	try {
+		std::string out;
+		Hpack::encodeInteger(out, 10, 5, 0x00);
+		if (toHex(out) != "0a") throw std::runtime_error("10/5 bits: " + toHex(out));
+		out.clear();
+		Hpack::encodeInteger(out, 1337, 5, 0x00);
+		if (toHex(out) != "1f9a0a") throw std::runtime_error("1337/5 bits: " + toHex(out));
+		out.clear();
+		Hpack::encodeInteger(out, 42, 8, 0x00);
+		if (toHex(out) != "2a") throw std::runtime_error("42/8 bits: " + toHex(out));
+
+		size_t pos = 0;
+		size_t value = 0;
+		std::string in = fromHex("1f9a0a");
+		if (!Hpack::decodeInteger(in, pos, 5, value) || value != 1337 || pos != 3)
+			throw std::runtime_error("Decoding 1337 failed");
+		pos = 0;
+		in = fromHex("1f9a");
+		if (Hpack::decodeInteger(in, pos, 5, value)) throw std::runtime_error("Truncated integer accepted");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_hpack_huffman(TestRunner& runner)
+{
+	runner.startTest("HPACK Huffman coding (RFC 7541 C.4) and all-byte round trip");
+	try {
+		if (toHex(Hpack::huffmanEncode("www.example.com")) != "f1e3c2e5f23a6ba0ab90f4ff")
+			throw std::runtime_error("www.example.com encoding");
+		if (toHex(Hpack::huffmanEncode("no-cache")) != "a8eb10649cbf")
+			throw std::runtime_error("no-cache encoding");
+
+		std::string out;
+		if (!Hpack::huffmanDecode(fromHex("25a849e95bb8e8b4bf"), out) || out != "custom-value")
+			throw std::runtime_error("custom-value decoding: " + out);
+
+		std::string all;
+		for (int c = 0; c < 256; ++c)
+			all += static_cast<char>(c);
+		out.clear();
+		if (!Hpack::huffmanDecode(Hpack::huffmanEncode(all), out) || out != all)
+			throw std::runtime_error("All-byte round trip failed");
+
+		// Padding longer than 7 bits, or not made of ones, is an error
+		out.clear();
+		if (Hpack::huffmanDecode(fromHex("f1e3c2e5f23a6ba0ab90f4ffff"), out))
+			throw std::runtime_error("Over-long padding accepted");
+		out.clear();
+		if (Hpack::huffmanDecode(fromHex("a8eb10649cbe"), out))
+			throw std::runtime_error("Zero padding accepted");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_hpack_decoder(TestRunner& runner)
+{
+	runner.startTest("HPACK decoder dynamic table across requests (RFC 7541 C.4)");
+	try {
+		Hpack::Decoder decoder;
+		const char* blocks[] = {
+			"828684418cf1e3c2e5f23a6ba0ab90f4ff",
+			"828684be5886a8eb10649cbf",
+			"828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"
+		};
+		Hpack::HeaderList headers;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			headers.clear();
+			if (!decoder.decode(fromHex(blocks[i]), headers))
+				throw std::runtime_error("Block rejected");
+		}
+		if (headers.size() != 5) throw std::runtime_error("Third block should have 5 fields");
+		if (headers[1].second != "https" || headers[2].second != "/index.html")
+			throw std::runtime_error("Static entries mismatch");
+		if (headers[3].first != ":authority" || headers[3].second != "www.example.com")
+			throw std::runtime_error("Dynamic :authority mismatch");
+		if (headers[4].first != "custom-key" || headers[4].second != "custom-value")
+			throw std::runtime_error("Literal mismatch");
+
+		// Index past the tables, and a size update above the limit
+		Hpack::Decoder fresh;
+		headers.clear();
+		if (fresh.decode(fromHex("be"), headers)) throw std::runtime_error("Unknown index accepted");
+		if (fresh.decode(fromHex("3fe21f"), headers)) throw std::runtime_error("Oversized table accepted");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_hpack_encoder(TestRunner& runner)
+{
+	runner.startTest("HPACK encoder indexes stable headers and announces table size");
+	try {
+		Hpack::Encoder encoder;
+		Hpack::Decoder decoder;
+		Hpack::HeaderList headers;
+		headers.push_back(std::make_pair(std::string(":status"), std::string("200")));
+		headers.push_back(std::make_pair(std::string("server"), std::string("Webserv/1.0")));
+		headers.push_back(std::make_pair(std::string("content-type"), std::string("text/html")));
+		headers.push_back(std::make_pair(std::string("content-length"), std::string("1234")));
+
+		std::string first = encoder.encode(headers);
+		std::string second = encoder.encode(headers);
+		if (second.size() >= first.size()) throw std::runtime_error("Repeat block not smaller");
+
+		Hpack::HeaderList out;
+		if (!decoder.decode(first, out) || !decoder.decode(second, out))
+			throw std::runtime_error("Own blocks rejected");
+		if (out.size() != 8 || out[5].second != "Webserv/1.0" || out[7].second != "1234")
+			throw std::runtime_error("Round trip mismatch");
+
+		// Peer shrinks the table to 0: next block starts with a size update and indexes nothing
+		encoder.setMaxTableSize(0);
+		std::string third = encoder.encode(headers);
+		if ((static_cast<unsigned char>(third[0]) & 0xe0) != 0x20)
+			throw std::runtime_error("Missing table size update");
+		out.clear();
+		if (!decoder.decode(third, out) || out.size() != 4 || out[1].second != "Webserv/1.0")
+			throw std::runtime_error("Block after size update mismatch");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+// ========================================
+// Connection
+// ========================================
+
+void test_h2_request_response(TestRunner& runner)
+{
+	runner.startTest("HTTP/2 GET over one stream, response HEADERS + DATA");
+	try {
+		Http2Connection conn(1024);
+		Hpack::Encoder encoder;
+
+		feed(conn, clientStart() + frame(Http2Connection::FRAME_HEADERS, 0x5, 1,
+			 requestBlock(encoder, "GET", "/index.html?x=1", "cookie", "a=1")));
+		// Split cookies are joined back: second field in a later request
+		int id = 0;
+		int status = -1;
+		wsv::HttpRequest request;
+		if (!conn.popRequest(id, request, status)) throw std::runtime_error("No request");
+		if (id != 1 || status != 0) throw std::runtime_error("Wrong stream or status");
+		if (request.getMethod() != "GET" || request.getPath() != "/index.html" || request.getQuery() != "x=1")
+			throw std::runtime_error("Request line mismatch");
+		if (request.getHeader("Host") != "localhost" || request.getHeader("Cookie") != "a=1")
+			throw std::runtime_error("Headers mismatch");
+
+		wsv::HttpResponse response = wsv::HttpResponse::createOkResponse("hello h2", "text/plain");
+		conn.submitResponse(1, response, false);
+		std::vector<Frame> frames = parseFrames(produceAll(conn));
+
+		if (frames.size() < 5 || frames[0].type != Http2Connection::FRAME_SETTINGS)
+			throw std::runtime_error("Server SETTINGS must come first");
+		const Frame* ack = NULL;
+		for (size_t i = 1; i < frames.size(); ++i)
+		{
+			if (frames[i].type == Http2Connection::FRAME_SETTINGS && frames[i].flags == 0x1)
+				ack = &frames[i];
+		}
+		if (!ack) throw std::runtime_error("Client SETTINGS not acknowledged");
+
+		const Frame* headers = findFrame(frames, Http2Connection::FRAME_HEADERS, 1);
+		if (!headers || !(headers->flags & 0x4)) throw std::runtime_error("Missing HEADERS");
+		Hpack::Decoder decoder;
+		Hpack::HeaderList fields;
+		if (!decoder.decode(headers->payload, fields)) throw std::runtime_error("Response block rejected");
+		if (fields[0].first != ":status" || fields[0].second != "200")
+			throw std::runtime_error("Missing :status");
+		for (size_t i = 0; i < fields.size(); ++i)
+		{
+			if (fields[i].first == "connection") throw std::runtime_error("Connection header sent");
+		}
+		if (dataOf(frames, 1) != "hello h2") throw std::runtime_error("Body mismatch");
+		if (!(frames.back().type == Http2Connection::FRAME_DATA && (frames.back().flags & 0x1)))
+			throw std::runtime_error("Last DATA should end the stream");
+		if (conn.hasActiveStreams() || conn.wantsWrite()) throw std::runtime_error("Stream not closed");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_h2_body_and_continuation(TestRunner& runner)
+{
+	runner.startTest("HTTP/2 POST body over DATA frames, headers over CONTINUATION");
+	try {
+		Http2Connection conn(1024);
+		Hpack::Encoder encoder;
+		std::string block = requestBlock(encoder, "POST", "/upload", "content-type", "text/plain");
+
+		feed(conn, clientStart());
+		feed(conn, frame(Http2Connection::FRAME_HEADERS, 0x0, 3, block.substr(0, 4)));
+		feed(conn, frame(Http2Connection::FRAME_CONTINUATION, 0x4, 3, block.substr(4)));
+		feed(conn, frame(Http2Connection::FRAME_DATA, 0x0, 3, "hello "));
+		// PADDED: pad length 2, then 2 bytes of padding
+		feed(conn, frame(Http2Connection::FRAME_DATA, 0x9, 3, std::string("\x02", 1) + "world" + std::string(2, '\0')));
+
+		int id = 0;
+		int status = -1;
+		wsv::HttpRequest request;
+		if (!conn.popRequest(id, request, status) || id != 3 || status != 0)
+			throw std::runtime_error("No request on stream 3");
+		if (request.getMethod() != "POST" || request.getBody() != "hello world")
+			throw std::runtime_error("Body mismatch: " + request.getBody());
+		if (request.getHeader("Content-Length") != "11")
+			throw std::runtime_error("Content-Length not synthesized");
+
+		// Another frame type between HEADERS and CONTINUATION is a connection error
+		Http2Connection broken(1024);
+		feed(broken, clientStart());
+		feed(broken, frame(Http2Connection::FRAME_HEADERS, 0x0, 1, block.substr(0, 4)));
+		std::string ping = frame(Http2Connection::FRAME_PING, 0, 0, std::string(8, 'p'));
+		if (broken.feed(ping.c_str(), ping.size())) throw std::runtime_error("Interleaved frame accepted");
+		std::vector<Frame> frames = parseFrames(produceAll(broken));
+		if (!findFrame(frames, Http2Connection::FRAME_GOAWAY, 0)) throw std::runtime_error("No GOAWAY");
+		if (!broken.isClosing()) throw std::runtime_error("Should be closing");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_h2_flow_control(TestRunner& runner)
+{
+	runner.startTest("HTTP/2 send window limits DATA until WINDOW_UPDATE");
+	try {
+		Http2Connection conn(1024);
+		Hpack::Encoder encoder;
+
+		// INITIAL_WINDOW_SIZE = 10 and MAX_FRAME_SIZE left at default
+		feed(conn, clientStart(setting(0x4, 10)) +
+			 frame(Http2Connection::FRAME_HEADERS, 0x5, 1, requestBlock(encoder, "GET", "/")));
+		int id;
+		int status;
+		wsv::HttpRequest request;
+		conn.popRequest(id, request, status);
+		conn.submitResponse(1, wsv::HttpResponse::createOkResponse(std::string(25, 'x'), "text/plain"), false);
+
+		std::vector<Frame> frames = parseFrames(produceAll(conn));
+		if (dataOf(frames, 1).size() != 10) throw std::runtime_error("First window should allow 10 bytes");
+		if (conn.wantsWrite()) throw std::runtime_error("Blocked stream reports data to write");
+
+		std::string increment = fromHex("00000014");
+		feed(conn, frame(Http2Connection::FRAME_WINDOW_UPDATE, 0, 1, increment));
+		frames = parseFrames(produceAll(conn));
+		if (dataOf(frames, 1).size() != 15) throw std::runtime_error("Rest not sent after WINDOW_UPDATE");
+		if (!(frames.back().flags & 0x1)) throw std::runtime_error("END_STREAM missing");
+
+		// Window overflow on the connection is a FLOW_CONTROL_ERROR
+		std::string huge = frame(Http2Connection::FRAME_WINDOW_UPDATE, 0, 0, fromHex("7fffffff"));
+		if (conn.feed(huge.c_str(), huge.size())) throw std::runtime_error("Overflow accepted");
+		frames = parseFrames(produceAll(conn));
+		const Frame* goaway = findFrame(frames, Http2Connection::FRAME_GOAWAY, 0);
+		if (!goaway || goaway->payload[7] != Http2Connection::FLOW_CONTROL_ERROR)
+			throw std::runtime_error("Expected GOAWAY(FLOW_CONTROL_ERROR)");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_h2_priorities(TestRunner& runner)
+{
+	runner.startTest("HTTP/2 RFC 9218 priorities: urgency order, incremental round-robin");
+	try {
+		Http2Connection conn(1024);
+		Hpack::Encoder encoder;
+
+		feed(conn, clientStart());
+		feed(conn, frame(Http2Connection::FRAME_HEADERS, 0x5, 1, requestBlock(encoder, "GET", "/a", "priority", "u=5")));
+		feed(conn, frame(Http2Connection::FRAME_HEADERS, 0x5, 3, requestBlock(encoder, "GET", "/b", "priority", "u=1")));
+		feed(conn, frame(Http2Connection::FRAME_HEADERS, 0x5, 5, requestBlock(encoder, "GET", "/c", "priority", "u=5, i")));
+		feed(conn, frame(Http2Connection::FRAME_HEADERS, 0x5, 7, requestBlock(encoder, "GET", "/d", "priority", "u=5, i")));
+
+		int id;
+		int status;
+		wsv::HttpRequest request;
+		std::string big(40000, 'z');
+		while (conn.popRequest(id, request, status))
+			conn.submitResponse(id, wsv::HttpResponse::createOkResponse(big, "text/plain"), false);
+		// Raise the connection window so only the priorities decide
+		feed(conn, frame(Http2Connection::FRAME_WINDOW_UPDATE, 0, 0, fromHex("00100000")));
+		for (int s = 1; s <= 7; s += 2)
+			feed(conn, frame(Http2Connection::FRAME_WINDOW_UPDATE, 0, s, fromHex("00100000")));
+
+		std::vector<Frame> frames = parseFrames(produceAll(conn));
+		std::vector<int> order;
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			if (frames[i].type == Http2Connection::FRAME_DATA)
+				order.push_back(frames[i].stream_id);
+		}
+		// u=1 first, then the non-incremental u=5, then 5 and 7 alternating
+		if (order.size() != 12) throw std::runtime_error("Expected 12 DATA frames");
+		for (int i = 0; i < 3; ++i)
+		{
+			if (order[i] != 3) throw std::runtime_error("Urgent stream not first");
+			if (order[3 + i] != 1) throw std::runtime_error("Non-incremental stream not next");
+		}
+		for (size_t i = 6; i < order.size(); ++i)
+		{
+			if (order[i] != ((i % 2 == 0) ? 5 : 7)) throw std::runtime_error("Incremental streams not interleaved");
+		}
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_h2_stream_errors(TestRunner& runner)
+{
+	runner.startTest("HTTP/2 oversized body answered early, malformed stream reset");
+	try {
+		Http2Connection conn(8);
+		Hpack::Encoder encoder;
+
+		feed(conn, clientStart());
+		feed(conn, frame(Http2Connection::FRAME_HEADERS, 0x4, 1, requestBlock(encoder, "POST", "/up")));
+		feed(conn, frame(Http2Connection::FRAME_DATA, 0x0, 1, "0123456789"));
+
+		int id;
+		int status;
+		wsv::HttpRequest request;
+		if (!conn.popRequest(id, request, status) || status != 413)
+			throw std::runtime_error("Oversized body should give 413 before END_STREAM");
+		conn.submitResponse(id, wsv::HttpResponse::createErrorResponse(413), false);
+		std::vector<Frame> frames = parseFrames(produceAll(conn));
+		const Frame* rst = findFrame(frames, Http2Connection::FRAME_RST_STREAM, 1);
+		if (!rst || rst->payload[3] != Http2Connection::NO_ERROR)
+			throw std::runtime_error("Expected RST_STREAM(NO_ERROR) after the early response");
+
+		// Uppercase header name: malformed, stream reset, connection survives
+		Hpack::HeaderList bad;
+		bad.push_back(std::make_pair(std::string(":method"), std::string("GET")));
+		bad.push_back(std::make_pair(std::string(":scheme"), std::string("http")));
+		bad.push_back(std::make_pair(std::string(":path"), std::string("/")));
+		bad.push_back(std::make_pair(std::string("X-Upper"), std::string("1")));
+		feed(conn, frame(Http2Connection::FRAME_HEADERS, 0x5, 3, encoder.encode(bad)));
+		frames = parseFrames(produceAll(conn));
+		rst = findFrame(frames, Http2Connection::FRAME_RST_STREAM, 3);
+		if (!rst || rst->payload[3] != Http2Connection::PROTOCOL_ERROR)
+			throw std::runtime_error("Expected RST_STREAM(PROTOCOL_ERROR)");
+		if (conn.popRequest(id, request, status)) throw std::runtime_error("Malformed request dispatched");
+
+		// Even stream ids belong to the server
+		std::string even = frame(Http2Connection::FRAME_HEADERS, 0x5, 4, requestBlock(encoder, "GET", "/"));
+		if (conn.feed(even.c_str(), even.size())) throw std::runtime_error("Even stream id accepted");
+
+		// A wrong preface is rejected outright
+		Http2Connection other(8);
+		std::string junk = "GET / HTTP/1.1\r\n\r\n";
+		if (other.feed(junk.c_str(), junk.size())) throw std::runtime_error("Bad preface accepted");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_h2_upgrade(TestRunner& runner)
+{
+	runner.startTest("HTTP/2 h2c upgrade: HTTP2-Settings applied, request on stream 1");
+	try {
+		std::string settings_b64;
+		if (!Http2Connection::decodeBase64Url("AAMAAABkAAQAoAAAAAIAAAAA", settings_b64) || settings_b64.size() != 18)
+			throw std::runtime_error("base64url decoding");
+
+		wsv::HttpRequest upgrade("GET /page?q=1 HTTP/1.1\r\nHost: example\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+								 "Upgrade: h2c\r\nHTTP2-Settings: AAMAAABkAAQAoAAAAAIAAAAA\r\nAccept: */*\r\n\r\n");
+		Http2Connection conn(1024);
+		if (!conn.startUpgraded(upgrade, "AAMAAABkAAQAoAAAAAIAAAAA"))
+			throw std::runtime_error("Upgrade rejected");
+
+		int id;
+		int status;
+		wsv::HttpRequest request;
+		if (!conn.popRequest(id, request, status) || id != 1)
+			throw std::runtime_error("Upgraded request not on stream 1");
+		if (request.getPath() != "/page" || request.getQuery() != "q=1" || request.getHeader("Host") != "example" ||
+			request.getHeader("Accept") != "*/*" || request.hasHeader("Upgrade"))
+			throw std::runtime_error("Upgraded request mismatch");
+
+		// The client preface still follows the 101
+		feed(conn, clientStart());
+		conn.submitResponse(1, wsv::HttpResponse::createOkResponse("up", "text/plain"), false);
+		std::vector<Frame> frames = parseFrames(produceAll(conn));
+		if (dataOf(frames, 1) != "up") throw std::runtime_error("Stream 1 response missing");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+int main()
+{
+	std::cout << BOLD << "========================================" << RESET << std::endl;
+	std::cout << BOLD << "  HPACK / HTTP/2 Test Suite" << RESET << std::endl;
+	std::cout << BOLD << "========================================" << RESET << std::endl << std::endl;
+
+	TestRunner runner;
+
+	// Header compression
+	test_hpack_integers(runner);
+	test_hpack_huffman(runner);
+	test_hpack_decoder(runner);
+	test_hpack_encoder(runner);
+
+	// Connection and streams
+	test_h2_request_response(runner);
+	test_h2_body_and_continuation(runner);
+	test_h2_flow_control(runner);
+	test_h2_priorities(runner);
+	test_h2_stream_errors(runner);
+	test_h2_upgrade(runner);
+
+	runner.summary();
+
+	return runner.allPassed() ? 0 : 1;
+}
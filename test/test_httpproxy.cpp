@@ -0,0 +1,480 @@
+#include "http/HttpProxy.hpp"
+#include "http/HttpRequest.hpp"
+#include "server/UpstreamGroup.hpp"
+#include "TestRunner.hpp"
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+
+typedef wsv::HttpProxy::ResponseParser Parser;
+
+static bool feed(Parser& parser, const std::string& data, std::string& body)
+{
+	return parser.feed(data.c_str(), data.size(), body);
+}
+
+void test_parser_content_length(TestRunner& runner)
+{
+	runner.startTest("ResponseParser Content-Length body split across reads");
+	try {
+		Parser parser;
+		std::string body;
+
+		parser.reset(false);
+		if (!feed(parser, "HTTP/1.1 200 OK\r\nContent-Len", body)) throw std::runtime_error("Partial head rejected");
+		if (parser.hasHead()) throw std::runtime_error("Head reported too early");
+		if (!feed(parser, "gth: 10\r\nX-App: a\r\n\r\nhello", body)) throw std::runtime_error("Head rejected");
+		if (!parser.hasHead() || parser.isComplete()) throw std::runtime_error("Wrong state after head");
+		if (parser.getStatus() != 200 || parser.getReason() != "OK") throw std::runtime_error("Status mismatch");
+		if (parser.getFraming() != Parser::FRAMING_LENGTH) throw std::runtime_error("Framing should be LENGTH");
+		if (!feed(parser, "world", body)) throw std::runtime_error("Body rejected");
+		if (!parser.isComplete()) throw std::runtime_error("Should be complete");
+		if (body != "helloworld") throw std::runtime_error("Body mismatch: " + body);
+		if (!parser.isReusable()) throw std::runtime_error("HTTP/1.1 response should be reusable");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_parser_chunked(TestRunner& runner)
+{
+	runner.startTest("ResponseParser chunked body decoded byte by byte");
+	try {
+		Parser parser;
+		std::string body;
+		std::string raw = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+						  "5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\nX-Trailer: t\r\n\r\n";
+
+		parser.reset(false);
+		for (size_t i = 0; i < raw.size(); ++i)
+		{
+			if (!parser.feed(raw.c_str() + i, 1, body))
+				throw std::runtime_error("Rejected at byte " + raw.substr(i, 1));
+		}
+		if (!parser.isComplete()) throw std::runtime_error("Should be complete");
+		if (parser.getFraming() != Parser::FRAMING_CHUNKED) throw std::runtime_error("Framing should be CHUNKED");
+		if (body != "hello world") throw std::runtime_error("Body mismatch: " + body);
+		if (!parser.isReusable()) throw std::runtime_error("Should be reusable");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_parser_close_delimited(TestRunner& runner)
+{
+	runner.startTest("ResponseParser close-delimited body ends at EOF");
+	try {
+		Parser parser;
+		std::string body;
+
+		parser.reset(false);
+		feed(parser, "HTTP/1.0 200 OK\r\n\r\nsome", body);
+		feed(parser, " data", body);
+		if (parser.isComplete()) throw std::runtime_error("Complete before EOF");
+		parser.feedEof();
+		if (!parser.isComplete()) throw std::runtime_error("Should be complete after EOF");
+		if (body != "some data") throw std::runtime_error("Body mismatch: " + body);
+		if (parser.isReusable()) throw std::runtime_error("Close-delimited connection must not be reused");
+
+		// EOF in the middle of a sized body is an error
+		parser.reset(false);
+		body.clear();
+		feed(parser, "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nabc", body);
+		parser.feedEof();
+		if (!parser.hasError()) throw std::runtime_error("Truncated body should be an error");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_parser_no_body(TestRunner& runner)
+{
+	runner.startTest("ResponseParser HEAD, 204, 304 and 1xx");
+	try {
+		Parser parser;
+		std::string body;
+
+		parser.reset(true);
+		feed(parser, "HTTP/1.1 200 OK\r\nContent-Length: 1234\r\n\r\n", body);
+		if (!parser.isComplete()) throw std::runtime_error("HEAD response should be complete");
+		if (parser.getContentLength() != 1234) throw std::runtime_error("Content-Length should be kept for HEAD");
+
+		parser.reset(false);
+		feed(parser, "HTTP/1.1 204 No Content\r\n\r\n", body);
+		if (!parser.isComplete() || parser.getFraming() != Parser::FRAMING_NONE)
+			throw std::runtime_error("204 should have no body");
+
+		parser.reset(false);
+		feed(parser, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 201 Created\r\nContent-Length: 2\r\n\r\nok", body);
+		if (parser.getStatus() != 201) throw std::runtime_error("1xx response should be skipped");
+		if (!parser.isComplete() || body != "ok") throw std::runtime_error("Final response not decoded");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_parser_errors(TestRunner& runner)
+{
+	runner.startTest("ResponseParser rejects malformed responses");
+	try {
+		Parser parser;
+		std::string body;
+
+		parser.reset(false);
+		if (feed(parser, "SMTP ready\r\n\r\n", body)) throw std::runtime_error("Bad status line accepted");
+
+		parser.reset(false);
+		if (feed(parser, "HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\n", body))
+			throw std::runtime_error("Negative Content-Length accepted");
+
+		parser.reset(false);
+		if (feed(parser, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", body))
+			throw std::runtime_error("Bad chunk size accepted");
+
+		parser.reset(false);
+		std::string huge = "HTTP/1.1 200 OK\r\nX: " + std::string(wsv::HttpProxy::MAX_HEAD_SIZE, 'a');
+		if (feed(parser, huge, body)) throw std::runtime_error("Oversized head accepted");
+
+		// Upstream asking to close
+		parser.reset(false);
+		feed(parser, "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 0\r\n\r\n", body);
+		if (!parser.isComplete() || parser.isReusable()) throw std::runtime_error("Connection: close ignored");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_encode_request(TestRunner& runner)
+{
+	runner.startTest("encodeRequest drops hop-by-hop headers and adds X-Forwarded-*");
+	try {
+		wsv::HttpRequest request;
+		std::string raw = "POST /api/items?x=1 HTTP/1.1\r\n"
+						  "Host: example.com\r\n"
+						  "Connection: keep-alive, X-Private\r\n"
+						  "X-Private: secret\r\n"
+						  "Keep-Alive: timeout=5\r\n"
+						  "X-Forwarded-For: 10.0.0.1\r\n"
+						  "Transfer-Encoding: chunked\r\n"
+						  "\r\n"
+						  "4\r\nbody\r\n0\r\n\r\n";
+		request.parse(raw.c_str(), raw.size());
+		if (!request.isComplete()) throw std::runtime_error("Request not parsed");
+
+		std::string out = wsv::HttpProxy::encodeRequest(request, "/items?x=1", "192.168.1.2", "https");
+
+		if (out.compare(0, 28, "POST /items?x=1 HTTP/1.1\r\nho") != 0)
+			throw std::runtime_error("Request line mismatch: " + out.substr(0, 30));
+		if (out.find("host: example.com\r\n") == std::string::npos) throw std::runtime_error("Host not forwarded");
+		if (out.find("x-private") != std::string::npos) throw std::runtime_error("Connection-listed header forwarded");
+		if (out.find("keep-alive: ") != std::string::npos) throw std::runtime_error("Keep-Alive forwarded");
+		if (out.find("transfer-encoding") != std::string::npos) throw std::runtime_error("Transfer-Encoding forwarded");
+		if (out.find("x-forwarded-for: 10.0.0.1, 192.168.1.2\r\n") == std::string::npos)
+			throw std::runtime_error("X-Forwarded-For not appended");
+		if (out.find("x-forwarded-proto: https\r\n") == std::string::npos)
+			throw std::runtime_error("X-Forwarded-Proto does not carry the client scheme");
+		if (out.find("connection: keep-alive\r\n") == std::string::npos) throw std::runtime_error("Keep-alive not requested");
+		if (out.find("content-length: 4\r\n\r\nbody") == std::string::npos)
+			throw std::runtime_error("De-chunked body not sent with a length");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_build_client_head(TestRunner& runner)
+{
+	runner.startTest("buildClientHead re-frames the upstream head");
+	try {
+		Parser parser;
+		std::string body;
+
+		parser.reset(false);
+		feed(parser, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nKeep-Alive: timeout=5\r\n"
+					 "Content-Type: text/plain\r\n\r\n", body);
+		std::string head = wsv::HttpProxy::buildClientHead(parser, true, true);
+		if (head.compare(0, 17, "HTTP/1.1 200 OK\r\n") != 0) throw std::runtime_error("Status line mismatch");
+		if (head.find("Content-Type: text/plain\r\n") == std::string::npos) throw std::runtime_error("Header dropped");
+		if (head.find("Keep-Alive") != std::string::npos) throw std::runtime_error("Hop-by-hop header kept");
+		if (head.find("Transfer-Encoding: chunked\r\n") == std::string::npos) throw std::runtime_error("Chunked missing");
+		if (head.find("Connection: keep-alive\r\n\r\n") == std::string::npos) throw std::runtime_error("Connection missing");
+
+		// Close-delimited towards the client: no framing header at all
+		head = wsv::HttpProxy::buildClientHead(parser, false, false);
+		if (head.find("Transfer-Encoding") != std::string::npos) throw std::runtime_error("Chunked not removed");
+		if (head.find("Connection: close\r\n") == std::string::npos) throw std::runtime_error("Connection: close missing");
+
+		parser.reset(false);
+		feed(parser, "HTTP/1.1 404 Not Found\r\nContent-Length: 3\r\n\r\n", body);
+		head = wsv::HttpProxy::buildClientHead(parser, false, true);
+		if (head.find("HTTP/1.1 404 Not Found\r\n") == std::string::npos) throw std::runtime_error("Reason lost");
+		if (head.find("Content-Length: 3\r\n") == std::string::npos) throw std::runtime_error("Content-Length dropped");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+static wsv::UpstreamConfig make_upstream(const std::string& policy, int peers)
+{
+	wsv::UpstreamConfig config;
+	config.name = "backend";
+	config.policy = policy;
+	config.hash_key = "$request_uri";
+	for (int i = 0; i < peers; ++i)
+	{
+		wsv::UpstreamConfig::Peer peer;
+		peer.host = "127.0.0.1";
+		peer.port = 9001 + i;
+		config.peers.push_back(peer);
+	}
+	return config;
+}
+
+void test_balancer_round_robin(TestRunner& runner)
+{
+	runner.startTest("UpstreamGroup smooth weighted round-robin");
+	try {
+		wsv::UpstreamConfig config = make_upstream("round_robin", 3);
+		config.peers[0].weight = 5;
+		wsv::UpstreamGroup group(config);
+
+		// 5:1:1 over 7 picks, and never the heavy peer three times in a row
+		std::string sequence;
+		int count[3] = {0, 0, 0};
+		for (int i = 0; i < 7; ++i)
+		{
+			int peer = group.select("", 0, NULL);
+			count[peer]++;
+			sequence += static_cast<char>('a' + peer);
+		}
+		if (count[0] != 5 || count[1] != 1 || count[2] != 1)
+			throw std::runtime_error("Weights not respected: " + sequence);
+		if (sequence.find("aaa") != std::string::npos)
+			throw std::runtime_error("Heavy peer picked in a burst: " + sequence);
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_balancer_least_conn(TestRunner& runner)
+{
+	runner.startTest("UpstreamGroup least_conn follows in-flight counts");
+	try {
+		wsv::UpstreamGroup group(make_upstream("least_conn", 3));
+
+		int first = group.select("", 0, NULL);
+		group.acquire(first);
+		int second = group.select("", 0, NULL);
+		group.acquire(second);
+		int third = group.select("", 0, NULL);
+		group.acquire(third);
+		if (first == second || second == third || first == third)
+			throw std::runtime_error("Busy peer chosen while another was idle");
+
+		// Two more on peer 0: the next request goes elsewhere
+		group.acquire(0);
+		group.acquire(0);
+		group.release(third, false, 0);
+		if (group.select("", 0, NULL) != third) throw std::runtime_error("Least loaded peer not chosen");
+		if (group.getPeer(0).in_flight != 3 - (third == 0 ? 1 : 0))
+			throw std::runtime_error("In-flight count mismatch");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_balancer_hash(TestRunner& runner)
+{
+	runner.startTest("UpstreamGroup consistent hash is stable and spreads keys");
+	try {
+		wsv::UpstreamGroup group(make_upstream("hash", 4));
+		const int keys = 4000;
+		std::vector<int> before(keys);
+		int count[4] = {0, 0, 0, 0};
+
+		for (int i = 0; i < keys; ++i)
+		{
+			std::ostringstream key;
+			key << "/item/" << i;
+			before[i] = group.select(key.str(), 0, NULL);
+			if (group.select(key.str(), 0, NULL) != before[i]) throw std::runtime_error("Same key, different peer");
+			count[before[i]]++;
+		}
+		for (int p = 0; p < 4; ++p)
+		{
+			if (count[p] < keys / 8) throw std::runtime_error("Uneven spread over the ring");
+		}
+
+		// Peer 2 goes down (max_fails=1 by default): only its keys move
+		group.release(2, true, 100);
+		for (int i = 0; i < keys; ++i)
+		{
+			std::ostringstream key;
+			key << "/item/" << i;
+			int peer = group.select(key.str(), 100, NULL);
+			if (peer == 2) throw std::runtime_error("Key sent to a down peer");
+			if (before[i] != 2 && peer != before[i]) throw std::runtime_error("Key of a live peer moved");
+		}
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_balancer_failures(TestRunner& runner)
+{
+	runner.startTest("UpstreamGroup max_fails, fail_timeout and health probes");
+	try {
+		wsv::UpstreamConfig config = make_upstream("round_robin", 2);
+		config.peers[0].max_fails = 2;
+		config.peers[0].fail_timeout = 10;
+		config.health_fails = 2;
+		config.health_passes = 1;
+		wsv::UpstreamGroup group(config);
+
+		// One failure is tolerated, the second within the window takes the peer out
+		group.release(0, true, 100);
+		if (!group.isAvailable(0, 100)) throw std::runtime_error("Down after one failure");
+		group.release(0, true, 105);
+		if (group.isAvailable(0, 105)) throw std::runtime_error("Still up after max_fails");
+		for (int i = 0; i < 4; ++i)
+		{
+			if (group.select("", 110, NULL) != 1) throw std::runtime_error("Request sent to a down peer");
+		}
+		if (!group.isAvailable(0, 115)) throw std::runtime_error("Not back after fail_timeout");
+
+		// Failures in separate windows do not add up
+		group.release(0, true, 200);
+		group.release(0, true, 220);
+		if (!group.isAvailable(0, 220)) throw std::runtime_error("Failures of different windows added up");
+
+		// Active checks: down after 2 failed probes, up after 1 passed
+		if (group.reportProbe(1, false)) throw std::runtime_error("Down after a single failed probe");
+		if (!group.reportProbe(1, false) || group.isAvailable(1, 300)) throw std::runtime_error("Not down after fails");
+		if (!group.reportProbe(1, true) || !group.isAvailable(1, 300)) throw std::runtime_error("Not up after passes");
+
+		// Every peer down: no choice at all
+		group.reportProbe(0, false);
+		group.reportProbe(0, false);
+		group.reportProbe(1, false);
+		group.reportProbe(1, false);
+		if (group.select("", 300, NULL) != -1) throw std::runtime_error("A down peer was returned");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_balancer_retry_excludes_tried(TestRunner& runner)
+{
+	runner.startTest("UpstreamGroup retries skip the peers already tried");
+	try {
+		static const char* policies[] = { "round_robin", "least_conn", "hash" };
+		for (size_t p = 0; p < 3; ++p)
+		{
+			// max_fails 0: a failed peer stays available to other requests
+			wsv::UpstreamConfig config = make_upstream(policies[p], 3);
+			for (size_t i = 0; i < config.peers.size(); ++i)
+				config.peers[i].max_fails = 0;
+			wsv::UpstreamGroup group(config);
+
+			std::vector<bool> tried;
+			for (int n = 0; n < 3; ++n)
+			{
+				int peer = group.select("/same/key", 0, &tried);
+				if (peer == -1) throw std::runtime_error(std::string(policies[p]) + ": ran out of peers early");
+				if (peer < static_cast<int>(tried.size()) && tried[peer])
+					throw std::runtime_error(std::string(policies[p]) + ": tried peer chosen again");
+				tried.resize(group.size(), false);
+				tried[peer] = true;
+				group.release(peer, true, 0);
+			}
+			if (group.select("/same/key", 0, &tried) != -1)
+				throw std::runtime_error(std::string(policies[p]) + ": peer returned after all were tried");
+			if (group.select("/same/key", 0, NULL) == -1)
+				throw std::runtime_error(std::string(policies[p]) + ": other requests lost the peers");
+		}
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_resolver_cache(TestRunner& runner)
+{
+	runner.startTest("connectTcp resolves unknown names in the background");
+	try {
+		// Never resolved: no blocking lookup, the connect fails and a refresh starts
+		if (wsv::HttpProxy::connectTcp("localhost", 9) != -1)
+			throw std::runtime_error("Unresolved name connected at once");
+		int fd = -1;
+		for (int i = 0; i < 200 && fd == -1; ++i)
+		{
+			usleep(10000);
+			fd = wsv::HttpProxy::connectTcp("localhost", 9);
+		}
+		if (fd == -1) throw std::runtime_error("Background lookup never completed");
+		close(fd);
+
+		if (!wsv::HttpProxy::resolve("127.0.0.1", 9)) throw std::runtime_error("Numeric host not resolved");
+		fd = wsv::HttpProxy::connectTcp("127.0.0.1", 9);
+		if (fd == -1) throw std::runtime_error("Resolved address not used");
+		close(fd);
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+int main()
+{
+	std::cout << BOLD << "========================================" << RESET << std::endl;
+	std::cout << BOLD << "  HttpProxy / UpstreamGroup Test Suite" << RESET << std::endl;
+	std::cout << BOLD << "========================================" << RESET << std::endl << std::endl;
+
+	TestRunner runner;
+
+	// Upstream response decoding
+	test_parser_content_length(runner);
+	test_parser_chunked(runner);
+	test_parser_close_delimited(runner);
+	test_parser_no_body(runner);
+	test_parser_errors(runner);
+
+	// Request / head rewriting
+	test_encode_request(runner);
+	test_build_client_head(runner);
+	test_resolver_cache(runner);
+
+	// Upstream load balancing
+	test_balancer_round_robin(runner);
+	test_balancer_least_conn(runner);
+	test_balancer_hash(runner);
+	test_balancer_failures(runner);
+	test_balancer_retry_excludes_tried(runner);
+
+	runner.summary();
+
+	return runner.allPassed() ? 0 : 1;
+}
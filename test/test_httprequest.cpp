@@ -1,9 +1,15 @@
 #include "http/HttpRequest.hpp"
 #include "utils/StringUtils.hpp"
+#include "utils/ByteScan.hpp"
 #include "TestRunner.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
 
 void test_parse_simple_get(TestRunner& runner)
 {
@@ -239,6 +245,40 @@ void test_chunked_split_parsing(TestRunner& runner)
 	}
 }
 
+void test_chunked_bare_lf(TestRunner& runner)
+{
+	runner.startTest("HttpRequest: Bare LF line ends in a chunked body");
+	try {
+		// Every line, chunk-data terminator included, may end with a bare \n
+		std::string raw = "POST / HTTP/1.1\nHost: localhost\nTransfer-Encoding: chunked\n\n"
+						  "4\nWiki\n5\r\npedia\r\n0\n\n";
+		{
+			wsv::HttpRequest req;
+			req.parse(raw.c_str(), raw.length());
+			if (!req.isComplete() || req.getBody() != "Wikipedia")
+				throw std::runtime_error("Bare LF chunked body rejected: " + req.getBody());
+		}
+		{
+			wsv::HttpRequest req;
+			for (size_t i = 0; i < raw.length() && !req.isComplete() && !req.hasError(); ++i)
+				req.parse(raw.c_str() + i, 1);
+			if (!req.isComplete() || req.getBody() != "Wikipedia")
+				throw std::runtime_error("Bare LF chunked body rejected byte by byte");
+		}
+		// Anything else after the chunk data is still an error
+		{
+			wsv::HttpRequest req;
+			std::string bad = "POST / HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n"
+							  "4\r\nWiki\rX0\r\n\r\n";
+			req.parse(bad.c_str(), bad.length());
+			if (!req.hasError()) throw std::runtime_error("Bad chunk terminator accepted");
+		}
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
 void test_size_limits(TestRunner& runner)
 {
 	runner.startTest("HttpRequest: Size limits");
@@ -265,6 +305,302 @@ void test_size_limits(TestRunner& runner)
 	}
 }
 
+void test_byte_by_byte_parsing(TestRunner& runner)
+{
+	runner.startTest("HttpRequest: One byte per read");
+	try {
+		std::string raw = "POST /up?x=1 HTTP/1.1\r\n"
+						  "Host: localhost\r\n"
+						  "X-Dup: first\r\n"
+						  "Transfer-Encoding: chunked\r\n"
+						  "x-dup: second\r\n"
+						  "\r\n"
+						  "4;ext=1\r\nWiki\r\n"
+						  "a\r\n0123456789\r\n"
+						  "0\r\n\r\n";
+		wsv::HttpRequest req;
+		for (size_t i = 0; i < raw.size() && !req.isComplete(); ++i)
+			req.parse(raw.c_str() + i, 1);
+
+		if (!req.isComplete()) throw std::runtime_error("Request should be complete");
+		if (req.getMethod() != "POST") throw std::runtime_error("Method mismatch: " + req.getMethod());
+		if (req.getPath() != "/up" || req.getQuery() != "x=1") throw std::runtime_error("URL mismatch");
+		if (req.getHeader("X-DUP") != "second") throw std::runtime_error("Last header should win");
+		if (req.getHeaders()["x-dup"] != "second") throw std::runtime_error("Header map mismatch");
+		if (req.getBody() != "Wiki0123456789") throw std::runtime_error("Body mismatch: " + req.getBody());
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_head_survives_body(TestRunner& runner)
+{
+	runner.startTest("HttpRequest: Head fields survive a large body");
+	try {
+		std::string body(100000, 'b');
+		std::string head = "POST /files/a.bin HTTP/1.1\r\nHost: example\r\nContent-Length: 100000\r\n\r\n";
+		wsv::HttpRequest req;
+		// Head and the start of the body in one read, then body-sized reads
+		std::string first = head + body.substr(0, 1000);
+		req.parse(first.c_str(), first.size());
+		for (size_t off = 1000; off < body.size(); off += 16384)
+		{
+			size_t n = body.size() - off < 16384 ? body.size() - off : 16384;
+			req.parse(body.c_str() + off, n);
+		}
+		if (!req.isComplete()) throw std::runtime_error("Request should be complete");
+		if (req.getBody() != body) throw std::runtime_error("Body mismatch");
+		if (req.getPath() != "/files/a.bin") throw std::runtime_error("Path mismatch: " + req.getPath());
+		if (req.getHeader("Host") != "example") throw std::runtime_error("Host mismatch");
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_invalid_framing(TestRunner& runner)
+{
+	runner.startTest("HttpRequest: Invalid framing is rejected");
+	try {
+		const char* bad[] = {
+			"POST / HTTP/1.1\r\nContent-Length: 12abc\r\n\r\n",
+			"POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n",
+			"POST / HTTP/1.1\r\nContent-Length: 99999999999999999999\r\n\r\n",
+			"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+			"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n11111111111111111\r\n",
+			"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nabXY",
+			"GET / HTTP/1.1 extra\r\n\r\n",
+		};
+		for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i)
+		{
+			wsv::HttpRequest req;
+			req.parse(bad[i], std::strlen(bad[i]));
+			if (!req.hasError()) throw std::runtime_error(std::string("Should fail: ") + bad[i]);
+		}
+		// Chunk size line without an end
+		wsv::HttpRequest req;
+		std::string raw = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n" + std::string(300, '0');
+		req.parse(raw.c_str(), raw.size());
+		if (!req.hasError()) throw std::runtime_error("Should fail on a long chunk size line");
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+// Lines of data fed in pieces of `step` bytes, as "start-end-colon-next" records
+static std::string scanAll(const std::string& data, size_t step, size_t max_lines)
+{
+	std::string out;
+	ByteScan::LineScan scan;
+	ByteScan::Line lines[8];
+	for (size_t len = 0; len < data.size(); )
+	{
+		len = (len + step < data.size()) ? len + step : data.size();
+		size_t count;
+		while ((count = ByteScan::scanLines(data.data(), len, scan, lines, max_lines)) > 0)
+		{
+			for (size_t i = 0; i < count; ++i)
+				out += StringUtils::toString(lines[i].start) + "-" + StringUtils::toString(lines[i].end) + "-"
+					 + StringUtils::toString(static_cast<int>(lines[i].colon)) + "-"
+					 + StringUtils::toString(lines[i].next) + " ";
+			if (lines[count - 1].end == lines[count - 1].start)
+				out += "| ";
+		}
+	}
+	return out;
+}
+
+void test_byte_scan_kernels(TestRunner& runner)
+{
+	runner.startTest("ByteScan: kernels agree with the scalar scan");
+	try {
+		const char* kernels[] = { "scalar", "sse2", "avx2" };
+		const char alphabet[] = "ab:\r\n-";
+		std::string dispatched = ByteScan::kernelName();
+		std::srand(42);
+		for (int round = 0; round < 200; ++round)
+		{
+			std::string data;
+			size_t size = std::rand() % 300;
+			for (size_t i = 0; i < size; ++i)
+				data += alphabet[std::rand() % (sizeof(alphabet) - 1)];
+			size_t step = 1 + std::rand() % 70;
+			size_t max_lines = 1 + std::rand() % 8;
+			std::string needle = data.substr(std::rand() % (size + 1), 1 + std::rand() % 5);
+
+			ByteScan::useKernel("scalar");
+			std::string expected = scanAll(data, step, max_lines);
+			for (size_t k = 1; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+			{
+				if (!ByteScan::useKernel(kernels[k]))
+					continue;
+				if (scanAll(data, step, max_lines) != expected)
+					throw std::runtime_error(std::string("scanLines differs with ") + kernels[k]);
+				size_t from = std::rand() % (size + 1);
+				if (ByteScan::find(data.data(), data.size(), needle.data(), needle.size(), from)
+					!= data.find(needle, from))
+					throw std::runtime_error(std::string("find differs with ") + kernels[k]);
+			}
+		}
+		ByteScan::useKernel(dispatched);
+
+		// "\r\n" and bare "\n" both end a line; the colon is the first one
+		std::string head = "A: b:c\r\nno colon\nC:d\r\n\r\nbody:x\n";
+		if (scanAll(head, head.size(), 8) != "0-6-1-8 8-16--1-17 17-20-18-22 22-22--1-24 | 24-30-28-31 ")
+			throw std::runtime_error("Unexpected lines: " + scanAll(head, head.size(), 8));
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_typed_request_model(TestRunner& runner)
+{
+	runner.startTest("HttpRequest: Method/version enums and header slots");
+	try {
+		// Every well-known name has its own slot, in any case
+		for (int id = 0; id < wsv::HEADER_COUNT; ++id)
+		{
+			std::string name = wsv::HttpRequest::headerName(static_cast<wsv::HeaderId>(id));
+			std::string upper = name;
+			for (size_t i = 0; i < upper.size(); ++i)
+				upper[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(upper[i])));
+			if (wsv::HttpRequest::lookupHeader(name.data(), name.size()) != id ||
+				wsv::HttpRequest::lookupHeader(upper.data(), upper.size()) != id)
+				throw std::runtime_error("Header slot collision for " + name);
+		}
+		const char* others[] = { "hosts", "x", "content-lengt", "cookie2", "x-request-id" };
+		for (size_t i = 0; i < sizeof(others) / sizeof(others[0]); ++i)
+		{
+			if (wsv::HttpRequest::lookupHeader(others[i], std::strlen(others[i])) != wsv::HEADER_OTHER)
+				throw std::runtime_error(std::string("Not a well-known header: ") + others[i]);
+		}
+
+		wsv::HttpRequest req("HEAD /x HTTP/1.0\r\n"
+							 "Host: a\r\n"
+							 "X-Trace: 1\r\n"
+							 "Connection: Keep-Alive, Upgrade\r\n"
+							 "x-trace: 2\r\n"
+							 "HOST: b\r\n"
+							 "\r\n");
+		if (req.getMethodId() != wsv::METHOD_HEAD || req.getVersionId() != wsv::HTTP_1_0)
+			throw std::runtime_error("Method or version id mismatch");
+		if (req.getHeader(wsv::HEADER_HOST) != "b" || req.getHeader("host") != "b")
+			throw std::runtime_error("Last Host should win");
+		if (req.getHeader("X-TRACE") != "2" || !req.hasHeader("x-trace") || req.hasHeader("x-missing"))
+			throw std::runtime_error("Other header lookup failed");
+		if (!req.headerHasToken(wsv::HEADER_CONNECTION, "keep-alive") ||
+			!req.headerHasToken(wsv::HEADER_CONNECTION, "upgrade") ||
+			req.headerHasToken(wsv::HEADER_CONNECTION, "close"))
+			throw std::runtime_error("Connection token lookup failed");
+		if (!req.headerEquals(wsv::HEADER_HOST, "B") || req.hasHeader(wsv::HEADER_COOKIE)
+			|| req.hasHeader(wsv::HEADER_OTHER) || !req.getHeader(wsv::HEADER_OTHER).empty())
+			throw std::runtime_error("headerEquals/hasHeader by id failed");
+		if (req.getHeaderCount() != 5 || req.getHeaderName(4) != "host" || req.getHeaderName(3) != "x-trace" ||
+			req.getHeaderValue(1) != "1" || req.getHeaderId(2) != wsv::HEADER_CONNECTION)
+			throw std::runtime_error("Indexed header access failed");
+
+		wsv::HttpRequest del("DELETE /x HTTP/1.1\r\n\r\n");
+		if (del.getMethodId() != wsv::METHOD_DELETE || del.getVersionId() != wsv::HTTP_1_1)
+			throw std::runtime_error("DELETE HTTP/1.1 ids mismatch");
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_shared_body(TestRunner& runner)
+{
+	runner.startTest("HttpRequest: Body is shared, not copied");
+	try {
+		std::string body(1 << 20, 'b');
+		std::string raw = "POST /upload HTTP/1.1\r\nHost: a\r\nContent-Length: " +
+						  StringUtils::toString(static_cast<int>(body.size())) + "\r\n\r\n";
+		wsv::HttpRequest req;
+		req.parse(raw.data(), raw.size());
+		for (size_t off = 0; off < body.size(); off += 65536)
+			req.parse(body.data() + off, 65536);
+		if (!req.isComplete() || req.getBody() != body)
+			throw std::runtime_error("Body mismatch");
+
+		const char* bytes = req.getBody().data();
+		wsv::SharedBuffer stage = req.getBodyBuffer();
+		if (stage.data() != bytes || stage.useCount() != 2)
+			throw std::runtime_error("Handing the body on copied it");
+
+		// Next request on the connection: the stage keeps its bytes
+		req.reset();
+		if (!req.getBody().empty() || stage.data() != bytes || stage.size() != body.size() || stage.useCount() != 1)
+			throw std::runtime_error("Reset should only drop the request's reference");
+
+		// Writing to a shared buffer detaches it
+		wsv::SharedBuffer copy = stage;
+		copy.append("!", 1);
+		if (stage.size() != body.size() || copy.size() != body.size() + 1 || copy.data() == bytes)
+			throw std::runtime_error("Append on a shared buffer should copy first");
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_receive_in_place(TestRunner& runner)
+{
+	runner.startTest("HttpRequest: Reads in place, slab goes back to the pool");
+	int fds[2] = { -1, -1 };
+	try {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+			throw std::runtime_error("socketpair failed");
+		std::string body(40000, 'u');
+		std::string raw = "POST /upload HTTP/1.1\r\nHost: a\r\nContent-Length: " +
+						  StringUtils::toString(static_cast<int>(body.size())) + "\r\n\r\n";
+		wsv::HttpRequest req;
+		size_t in_use = wsv::BufferPool::slabsInUse();
+		size_t heap = 0;
+
+		for (int round = 0; round < 2; ++round)
+		{
+			// Head and body arrive together, more than the tail of a fresh slab
+			std::string wire = raw + body;
+			if (write(fds[1], wire.data(), wire.size()) != static_cast<ssize_t>(wire.size()))
+				throw std::runtime_error("write failed");
+			while (!req.isComplete() && !req.hasError())
+			{
+				if (req.input().readFrom(fds[0]) <= 0)
+					throw std::runtime_error("readFrom failed");
+				req.parseBuffered();
+			}
+			if (!req.isComplete() || req.getPath() != "/upload" || req.getBody() != body)
+				throw std::runtime_error("Request parsed from the receive buffer is wrong");
+			if (wsv::BufferPool::slabsInUse() != in_use + 1)
+				throw std::runtime_error("Request should hold one slab");
+			if (req.input().size() > raw.size())
+				throw std::runtime_error("Parsed body bytes stayed in the receive buffer");
+
+			// Idle connection: the slab goes back to the pool
+			req.reset();
+			if (wsv::BufferPool::slabsInUse() != in_use || req.input().capacity() != 0)
+				throw std::runtime_error("Reset should release the slab");
+			if (round == 0)
+				heap = wsv::BufferPool::heapAllocations();
+			else if (wsv::BufferPool::heapAllocations() != heap)
+				throw std::runtime_error("Second request should reuse pooled slabs");
+		}
+		close(fds[0]);
+		close(fds[1]);
+		runner.pass();
+	} catch (const std::exception& e) {
+		if (fds[0] >= 0)
+		{
+			close(fds[0]);
+			close(fds[1]);
+		}
+		runner.fail(e.what());
+	}
+}
+
 int main()
 {
 	std::cout << BOLD << "========================================" << RESET << std::endl;
@@ -284,7 +620,15 @@ int main()
 	test_header_parsing_edge_cases(runner);
 	test_body_parsing_limits(runner);
 	test_chunked_split_parsing(runner);
+	test_chunked_bare_lf(runner);
 	test_size_limits(runner);
+	test_byte_by_byte_parsing(runner);
+	test_head_survives_body(runner);
+	test_invalid_framing(runner);
+	test_byte_scan_kernels(runner);
+	test_typed_request_model(runner);
+	test_shared_body(runner);
+	test_receive_in_place(runner);
 
 	runner.summary();
 
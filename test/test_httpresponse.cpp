@@ -127,6 +127,112 @@ void test_response_body_append(TestRunner& runner)
 	}
 }
 
+void test_response_wire_format(TestRunner& runner)
+{
+	runner.startTest("HttpResponse serializes status table and header order");
+	try {
+		wsv::HttpResponse response;
+		response.setStatus(404);
+		response.setHeader("X-First", "1");
+		response.setHeader("A-Second", "2");
+		response.setHeader("x-first", "3");	// Same header, any case: replaced in place
+		response.setBody("gone");
+
+		std::string raw = response.serialize();
+		if (raw.compare(0, 24, "HTTP/1.1 404 Not Found\r\n") != 0) throw std::runtime_error("Status line mismatch");
+		size_t first = raw.find("X-First: 3\r\n");
+		size_t second = raw.find("A-Second: 2\r\n");
+		if (first == std::string::npos || second == std::string::npos || first > second)
+			throw std::runtime_error("Headers should keep the order they were set in");
+		if (raw.find("x-first") != std::string::npos) throw std::runtime_error("Header was duplicated");
+		if (raw.size() < 8 || raw.compare(raw.size() - 8, 8, "\r\n\r\ngone") != 0)
+			throw std::runtime_error("Body should follow the empty line");
+
+		// serializeTo appends, so a caller can reuse its output buffer
+		std::string out = "previous";
+		response.serializeTo(out);
+		if (out != "previous" + raw) throw std::runtime_error("serializeTo should append the same bytes");
+
+		response.setStatus(418);
+		if (response.serialize().compare(0, 22, "HTTP/1.1 418 Unknown\r\n") != 0)
+			throw std::runtime_error("Codes outside the table should still serialize");
+		size_t length = 0;
+		const char* line = wsv::HttpResponse::getStatusLine(503, length);
+		if (!line || std::string(line, length) != "HTTP/1.1 503 Service Unavailable\r\n")
+			throw std::runtime_error("Precomputed 503 line mismatch");
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_response_lazy_defaults(TestRunner& runner)
+{
+	runner.startTest("HttpResponse writes default headers at serialization");
+	try {
+		wsv::HttpResponse response;
+		wsv::HttpResponse::HeaderList headers;
+		response.collectHeaders(headers);
+		if (headers.size() != 3) throw std::runtime_error("A new response should only carry the three defaults");
+
+		wsv::HttpResponse::updateDate(0);
+		std::string raw = response.serialize();
+		if (raw.find("Server: Webserv/1.0\r\n") == std::string::npos) throw std::runtime_error("Server missing");
+		if (raw.find("Date: Thu, 01 Jan 1970 00:00:00 GMT\r\n") == std::string::npos)
+			throw std::runtime_error("Date should come from the shared cache");
+		if (raw.find("Connection: close\r\n") == std::string::npos) throw std::runtime_error("Connection missing");
+
+		// An explicit header replaces the default instead of adding a second one
+		response.setHeader("connection", "keep-alive");
+		raw = response.serialize();
+		if (raw.find("Connection: close") != std::string::npos || raw.find("connection: keep-alive\r\n") == std::string::npos)
+			throw std::runtime_error("Explicit Connection should replace the default");
+		if (response.getHeader("Connection") != "keep-alive") throw std::runtime_error("getHeader should see the explicit value");
+
+		wsv::HttpResponse::updateDate(60);
+		if (wsv::HttpResponse::getDate() != "Thu, 01 Jan 1970 00:01:00 GMT") throw std::runtime_error("Date not regenerated");
+		wsv::HttpResponse::updateDate(std::time(NULL));
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_response_freeze(TestRunner& runner)
+{
+	runner.startTest("HttpResponse freeze shares the rendered head");
+	try {
+		wsv::HttpResponse page = wsv::HttpResponse::createErrorResponse(404);
+		if (!page.isFrozen()) throw std::runtime_error("Standard error pages should be frozen");
+		if (wsv::HttpResponse::createErrorResponse(404).getBody() != page.getBody())
+			throw std::runtime_error("Frozen page should be reused");
+
+		// Connection and Date are written per send, other headers thaw the copy
+		wsv::HttpResponse copy = page;
+		copy.setHeader("Connection", "keep-alive");
+		std::string raw = copy.serialize();
+		if (raw.compare(0, 24, "HTTP/1.1 404 Not Found\r\n") != 0) throw std::runtime_error("Status line mismatch");
+		if (raw.find("Connection: keep-alive\r\n") == std::string::npos || raw.find("Connection: close") != std::string::npos)
+			throw std::runtime_error("Connection not patched in");
+		if (raw.find("Server: Webserv/1.0\r\n") == std::string::npos || raw.find("Date: ") == std::string::npos)
+			throw std::runtime_error("Defaults missing");
+		if (page.serialize().find("Connection: close\r\n") == std::string::npos)
+			throw std::runtime_error("The shared page should keep its own Connection");
+
+		copy.setHeader("Content-Type", "text/plain");
+		if (copy.isFrozen() || copy.getHeader("Content-Type") != "text/plain") throw std::runtime_error("Setting a head header should thaw");
+		if (copy.getBody() != page.getBody() || copy.getHeader("Connection") != "keep-alive")
+			throw std::runtime_error("Thawed copy lost its contents");
+		if (page.getHeader("Content-Type") != "text/html") throw std::runtime_error("Thawing changed the shared page");
+
+		wsv::HttpResponse custom = wsv::HttpResponse::createErrorResponse(404, "custom");
+		if (custom.isFrozen()) throw std::runtime_error("Pages with a message are built per call");
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
 int main()
 {
 	std::cout << BOLD << "========================================" << RESET << std::endl;
@@ -143,6 +249,9 @@ int main()
 	// Edge Cases
 	test_response_header_overwrite(runner);
 	test_response_body_append(runner);
+	test_response_wire_format(runner);
+	test_response_lazy_defaults(runner);
+	test_response_freeze(runner);
 
 	runner.summary();
 
@@ -1,4 +1,6 @@
 #include "router/RequestHandler.hpp"
+#include "router/ErrorHandler.hpp"
+#include "server/Client.hpp"
 #include "http/HttpRequest.hpp"
 #include "http/HttpResponse.hpp"
 #include "TestRunner.hpp"
@@ -6,6 +8,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <cstdlib>
+#include <cstring>
 
 using namespace wsv;
 
@@ -57,6 +60,7 @@ ServerConfig create_basic_config() {
 	loc_redirect.redirect_url = "http://example.com";
 	loc_redirect.client_max_body_size = config.client_max_body_size;
 	config.locations.push_back(loc_redirect);
+	config.compileLocations();
 
 	return config;
 }
@@ -274,6 +278,116 @@ void test_max_body_size(TestRunner& runner) {
 	}
 }
 
+void test_max_body_size_proxy(TestRunner& runner) {
+	runner.startTest("Oversized POST to a proxy_pass location returns 413");
+	try {
+		ServerConfig config = create_basic_config();
+		LocationConfig loc_api;
+		loc_api.path = "/api";
+		loc_api.allow_methods.push_back("POST");
+		loc_api.proxy_pass = "http://127.0.0.1:9/";
+		loc_api.client_max_body_size = 10;
+		config.locations.push_back(loc_api);
+		config.compileLocations();
+		RequestHandler handler(config);
+
+		std::string body = "This body is definitely longer than 10 bytes";
+		Client client;
+		client.config = &config;
+		std::string raw_req =
+			"POST /api/items HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Content-Length: " + StringUtils::toString(body.length()) + "\r\n"
+			"\r\n" + body;
+		client.request().parse(raw_req.data(), raw_req.size());
+		HttpResponse response = handler.handleRequest(client);
+		if (response.getStatus() != 413) throw std::runtime_error("Expected 413, got " + StringUtils::toString(response.getStatus()));
+		if (client.state == CLIENT_PROXYING) throw std::runtime_error("Oversized body was handed to the upstream");
+
+		// A return rule wins over proxy_pass too
+		config.locations.back().redirect_code = 301;
+		config.locations.back().redirect_url = "http://example.com/api";
+		client.compact();
+		client.request().parse(raw_req.data(), raw_req.size());
+		response = handler.handleRequest(client);
+		if (response.getStatus() != 301) throw std::runtime_error("Expected 301, got " + StringUtils::toString(response.getStatus()));
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_max_body_size_fastcgi(TestRunner& runner) {
+	runner.startTest("Oversized POST to a fastcgi_pass location returns 413");
+	try {
+		ServerConfig config = create_basic_config();
+		LocationConfig loc_app;
+		loc_app.path = "/app";
+		loc_app.root = "test/www_test";
+		loc_app.allow_methods.push_back("POST");
+		loc_app.fastcgi_pass = "/tmp/webserv_test_fcgi.sock";
+		loc_app.client_max_body_size = 10;
+		config.locations.push_back(loc_app);
+		config.compileLocations();
+		RequestHandler handler(config);
+
+		std::string body = "This body is definitely longer than 10 bytes";
+		Client client;
+		client.config = &config;
+		std::string raw_req =
+			"POST /app/run HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Content-Length: " + StringUtils::toString(body.length()) + "\r\n"
+			"\r\n" + body;
+		client.request().parse(raw_req.data(), raw_req.size());
+		HttpResponse response = handler.handleRequest(client);
+		if (response.getStatus() != 413) throw std::runtime_error("Expected 413, got " + StringUtils::toString(response.getStatus()));
+		if (client.cgi_handler) throw std::runtime_error("Oversized body was handed to the FastCGI worker");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_proxy_prefix(TestRunner& runner) {
+	runner.startTest("proxy_pass replaces the decoded location prefix");
+	try {
+		ServerConfig config = create_basic_config();
+		LocationConfig loc_api;
+		loc_api.path = "/api";
+		loc_api.allow_methods.push_back("GET");
+		loc_api.proxy_pass = "http://127.0.0.1:9/up/";
+		loc_api.proxy_uri = "/up/";
+		loc_api.client_max_body_size = config.client_max_body_size;
+		config.locations.push_back(loc_api);
+		config.compileLocations();
+		RequestHandler handler(config);
+
+		const char* targets[][2] = {
+			{ "/api/x", "GET /up/x?q=1 " },
+			{ "/%61pi/x", "GET /up/x?q=1 " },
+			{ "/api/a%20b%2Bc", "GET /up/a%20b%2Bc?q=1 " },
+		};
+		for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i)
+		{
+			Client client;
+			client.config = &config;
+			std::string raw_req = std::string("GET ") + targets[i][0] + "?q=1 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+			client.request().parse(raw_req.data(), raw_req.size());
+			handler.handleRequest(client);
+			if (client.state != CLIENT_PROXYING) throw std::runtime_error(std::string("Not proxied: ") + targets[i][0]);
+			if (client.proxy_request.compare(0, std::strlen(targets[i][1]), targets[i][1]) != 0)
+				throw std::runtime_error("Forwarded as " + client.proxy_request.substr(0, client.proxy_request.find('\r')));
+		}
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
 // ==================== Additional Edge Case Tests ====================
 
 void test_autoindex_directory(TestRunner& runner) {
@@ -313,6 +427,7 @@ void test_directory_no_autoindex(TestRunner& runner) {
 		loc_protected.autoindex = false;
 		loc_protected.client_max_body_size = config.client_max_body_size;
 		config.locations.push_back(loc_protected);
+		config.compileLocations();
 		
 		RequestHandler handler(config);
 		
@@ -412,6 +527,7 @@ void test_unknown_location(TestRunner& runner) {
 		loc_specific.root = "test/www_test";
 		loc_specific.allow_methods.push_back("GET");
 		config.locations.push_back(loc_specific);
+		config.compileLocations();
 		
 		RequestHandler handler(config);
 		
@@ -436,6 +552,7 @@ void test_redirect_302(TestRunner& runner) {
 		loc_temp_redirect.redirect_code = 302;
 		loc_temp_redirect.redirect_url = "http://example.com/new";
 		config.locations.push_back(loc_temp_redirect);
+		config.compileLocations();
 		
 		RequestHandler handler(config);
 		
@@ -465,6 +582,7 @@ void test_subdirectory_with_index(TestRunner& runner) {
 		loc_public.autoindex = false;
 		loc_public.client_max_body_size = config.client_max_body_size;
 		config.locations.push_back(loc_public);
+		config.compileLocations();
 		
 		RequestHandler handler(config);
 		
@@ -778,6 +896,134 @@ void test_upload_directory_not_exist(TestRunner& runner) {
 	}
 }
 
+void test_cgi_internal_redirect(TestRunner& runner) {
+	runner.startTest("X-Accel-Redirect URI is served through the locations");
+	try {
+		ServerConfig config = create_basic_config();
+		RequestHandler handler(config);
+
+		HttpResponse response = handler.serveInternalRedirect("/file.txt?token=abc");
+		if (response.getStatus() != 200) throw std::runtime_error("Expected 200, got " + StringUtils::toString(response.getStatus()));
+		if (response.getBody() != "Hello World Content") throw std::runtime_error("Body mismatch");
+
+		if (handler.serveInternalRedirect("/../etc/passwd").getStatus() != 403)
+			throw std::runtime_error("Traversal in internal URI not rejected");
+		if (handler.serveInternalRedirect("/missing.txt").getStatus() != 404)
+			throw std::runtime_error("Missing target should be 404");
+
+		// A script is never sent as its source
+		config.locations[0].cgi_extension = ".txt";
+		RequestHandler cgi_handler(config);
+		if (cgi_handler.serveInternalRedirect("/file.txt").getStatus() != 403)
+			throw std::runtime_error("CGI script served as a static file");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_cgi_sendfile_roots(TestRunner& runner) {
+	runner.startTest("X-Sendfile only serves files under configured roots");
+	try {
+		ServerConfig config = create_basic_config();
+		RequestHandler handler(config);
+
+		HttpResponse response = handler.serveSendfile("test/www_test/file.txt");
+		if (response.getStatus() != 200) throw std::runtime_error("Expected 200, got " + StringUtils::toString(response.getStatus()));
+		if (response.getBody() != "Hello World Content") throw std::runtime_error("Body mismatch");
+
+		if (handler.serveSendfile("/etc/passwd").getStatus() != 403)
+			throw std::runtime_error("Path outside roots not rejected");
+		if (handler.serveSendfile("test/www_test_other/file.txt").getStatus() != 403)
+			throw std::runtime_error("Sibling directory sharing the root prefix accepted");
+		if (handler.serveSendfile("test/www_test/../../etc/passwd").getStatus() != 403)
+			throw std::runtime_error("Traversal not rejected");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_prepared_error_pages(TestRunner& runner) {
+	runner.startTest("Prepared error pages and redirects are shared, not rebuilt");
+	try {
+		ServerConfig config = create_basic_config();
+		config.error_pages[404] = "/custom_404.html";
+		create_dummy_file("test/www_test/custom_404.html", "<h1>custom 404</h1>");
+		config.error_pages[403] = "/custom_403.html";   // Not there at startup
+		ErrorHandler::prepare(config);
+		// The page was read at startup: later edits on disk are not seen
+		create_dummy_file("test/www_test/custom_404.html", "changed");
+		// An unreadable page is not frozen as the standard one: it is found once it exists
+		if (config.canned_errors.count(403)) throw std::runtime_error("Unreadable page was prepared");
+		create_dummy_file("test/www_test/custom_403.html", "<h1>custom 403</h1>");
+		HttpResponse forbidden = ErrorHandler::get_error_page(403, config);
+		remove_test_file("test/www_test/custom_403.html");
+		if (forbidden.getBody() != "<h1>custom 403</h1>") throw std::runtime_error("Late custom page not served");
+
+		RequestHandler handler(config);
+		HttpRequest missing("GET /does_not_exist.txt HTTP/1.1\r\nHost: localhost\r\n\r\n");
+		HttpResponse response = handler.handleRequest(missing);
+		remove_test_file("test/www_test/custom_404.html");
+		if (response.getStatus() != 404) throw std::runtime_error("Expected 404");
+		if (!response.isFrozen()) throw std::runtime_error("404 should be the prepared response");
+		if (response.getBody() != "<h1>custom 404</h1>") throw std::runtime_error("Custom page not served: " + response.getBody());
+
+		// Connection is patched in at send time without copying the page
+		response.setHeader("Connection", "keep-alive");
+		if (!response.isFrozen()) throw std::runtime_error("Connection should not unfreeze the page");
+		std::string raw = response.serialize();
+		if (raw.find("Connection: keep-alive\r\n") == std::string::npos || raw.find("Date: ") == std::string::npos)
+			throw std::runtime_error("Date and Connection missing from the prepared page");
+
+		HttpRequest redirect("GET /redirect HTTP/1.1\r\nHost: localhost\r\n\r\n");
+		HttpResponse moved = handler.handleRequest(redirect);
+		if (moved.getStatus() != 301 || !moved.isFrozen()) throw std::runtime_error("Redirect should be prepared");
+		if (moved.getHeader("Location") != "http://example.com") throw std::runtime_error("Location mismatch");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_routed_context(TestRunner& runner) {
+	runner.startTest("Routing result and stat() are computed once per request");
+	try {
+		Arena arena;
+		RequestContext context(arena);
+		context.file_path = "test/www_test/file.txt";
+		if (!context.exists() || context.isDirectory()) throw std::runtime_error("file.txt should be a regular file");
+		// The first stat() is kept for the rest of the request
+		context.file_path = "test/www_test/missing.txt";
+		if (!context.exists() || context.fileStat().st_size != 19) throw std::runtime_error("stat() result was not cached");
+
+		ServerConfig config = create_basic_config();
+		config.locations[0].allow_methods.push_back("HEAD");
+		RequestHandler handler(config);
+
+		// HTTP/2 streams go through the same single routing stage
+		HttpRequest get("GET /file.txt HTTP/1.1\r\nHost: localhost\r\n\r\n");
+		HttpResponse response = handler.handleStreamRequest(get);
+		if (response.getStatus() != 200 || response.getBody() != "Hello World Content")
+			throw std::runtime_error("Stream GET failed: " + StringUtils::toString(response.getStatus()));
+		HttpRequest head("HEAD /file.txt HTTP/1.1\r\nHost: localhost\r\n\r\n");
+		response = handler.handleStreamRequest(head);
+		if (response.getStatus() != 200 || !response.getBody().empty())
+			throw std::runtime_error("Stream HEAD should have an empty body");
+		HttpRequest post("POST /file.txt HTTP/1.1\r\nHost: localhost\r\nContent-Length: 0\r\n\r\n");
+		if (handler.handleStreamRequest(post).getStatus() != 405) throw std::runtime_error("Expected 405 on stream");
+		HttpRequest traversal("GET /%2e%2e/etc/passwd HTTP/1.1\r\nHost: localhost\r\n\r\n");
+		if (handler.handleStreamRequest(traversal).getStatus() != 403) throw std::runtime_error("Expected 403 on stream");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
 int main() {
 	std::cout << BOLD << "========================================" << RESET << std::endl;
 	std::cout << BOLD << "  RequestHandler Unit Tests" << RESET << std::endl;
@@ -795,6 +1041,9 @@ int main() {
 	test_file_upload(runner);
 	test_delete_file(runner);
 	test_max_body_size(runner);
+	test_max_body_size_proxy(runner);
+	test_max_body_size_fastcgi(runner);
+	test_proxy_prefix(runner);
 
 	// Additional edge case tests
 	test_autoindex_directory(runner);
@@ -814,6 +1063,15 @@ int main() {
 	test_multipart_with_multiple_parts(runner);
 	test_upload_directory_not_exist(runner);
 
+	// CGI file delegation
+	test_cgi_internal_redirect(runner);
+	test_cgi_sendfile_roots(runner);
+
+	// Single routing stage
+	test_routed_context(runner);
+
+	test_prepared_error_pages(runner);
+
 	runner.summary();
 	return runner.allPassed() ? 0 : 1;
 }
@@ -2,6 +2,8 @@
 #include "server/Client.hpp"
 #include "http/HttpRequest.hpp"
 #include "config/ConfigParser.hpp"
+#include "utils/Arena.hpp"
+#include "utils/RecvBuffer.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
@@ -79,6 +81,7 @@ void test_location_matching_logic(TestRunner& runner)
 		wsv::LocationConfig loc_api_v1;
 		loc_api_v1.path = "/api/v1";
 		server.locations.push_back(loc_api_v1);
+		server.compileLocations();
 		
 		// Test cases
 		if (server.findLocation("/")->path != "/") throw std::runtime_error("Failed match /");
@@ -145,6 +148,78 @@ void test_server_not_found_response(TestRunner& runner)
 	}
 }
 
+// ==================== Request Arena Tests ====================
+
+void test_request_arena_reuse(TestRunner& runner)
+{
+	runner.startTest("Request arena is reused across requests after reset");
+	try {
+		wsv::Arena arena;
+		size_t blocks = 0;
+		for (int round = 0; round < 3; ++round)
+		{
+			{
+				wsv::ArenaString path = wsv::ArenaString(wsv::ArenaAllocator<char>(arena));
+				for (int i = 0; i < 200; ++i)
+					path.append("/segment");
+				if (path.size() != 1600) throw std::runtime_error("Arena string has wrong content");
+				if (arena.bytesUsed() < path.size()) throw std::runtime_error("String did not come from the arena");
+			}
+			if (round == 0)
+				blocks = arena.heapBlocks();
+			else if (arena.heapBlocks() != blocks)
+				throw std::runtime_error("Arena took new heap blocks after reset");
+			arena.reset();
+			if (arena.bytesUsed() != 0) throw std::runtime_error("Reset did not release the arena");
+		}
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_idle_client_compaction(TestRunner& runner)
+{
+	runner.startTest("Idle keep-alive client is compacted and rebuilt on demand");
+	try {
+		wsv::Client client;
+		size_t slabs = wsv::BufferPool::slabsInUse();
+		std::string raw = "GET /index.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+		client.request().parse(raw.data(), raw.size());
+		client.response_buffer.assign(100000, 'r');
+		if (client.isCompact() || wsv::BufferPool::slabsInUse() != slabs + 1)
+			throw std::runtime_error("Active client should hold its request state");
+
+		client.compact();
+		const wsv::Client& idle = client;
+		if (!client.isCompact() || wsv::BufferPool::slabsInUse() != slabs)
+			throw std::runtime_error("Compaction should release the request state");
+		if (client.response_buffer.capacity() >= 100000)
+			throw std::runtime_error("Compaction should release the response capacity");
+		if (!idle.request().getPath().empty() || !client.isCompact())
+			throw std::runtime_error("Reading an idle client should not rebuild its state");
+
+		// Next request: the state comes back empty
+		client.request().parse(raw.data(), raw.size());
+		if (client.isCompact() || !client.request().isComplete() || client.request().getPath() != "/index.html")
+			throw std::runtime_error("Request state should be rebuilt when data arrives");
+
+		// Copies never share the request state (each one frees its own)
+		{
+			wsv::Client copy(client);
+			wsv::Client assigned;
+			assigned = client;
+			if (!copy.isCompact() || !assigned.isCompact() || client.isCompact())
+				throw std::runtime_error("A copied client should start compact");
+		}
+		if (client.request().getPath() != "/index.html")
+			throw std::runtime_error("Destroying a copy released the original's state");
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
 // ==================== Main Test Runner ====================
 
 int main()
@@ -165,6 +240,8 @@ int main()
 	std::cout << BOLD << "--- Server Request Processing ---" << RESET << std::endl;
 	test_server_static_file_response(runner);
 	test_server_not_found_response(runner);
+	test_request_arena_reuse(runner);
+	test_idle_client_compaction(runner);
 	std::cout << std::endl;
 	
 	runner.summary();
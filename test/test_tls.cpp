@@ -0,0 +1,494 @@
+#include "server/Tls.hpp"
+#include "config/ConfigParser.hpp"
+#include "TestRunner.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+using wsv::TlsContext;
+using wsv::TlsConnection;
+
+static const char* CERT_PATH = "/tmp/webserv_test_tls.crt";
+static const char* KEY_PATH = "/tmp/webserv_test_tls.key";
+static const char* CONF_PATH = "/tmp/webserv_test_tls.conf";
+
+// ==================== Helper Functions ====================
+
+// Self-signed P-256 certificate for localhost, like `openssl req -x509`
+static bool write_self_signed(const char* cert_path, const char* key_path)
+{
+	EVP_PKEY* key = EVP_EC_gen("P-256");
+	X509* cert = X509_new();
+	if (!key || !cert)
+		return false;
+
+	ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+	X509_set_pubkey(cert, key);
+	X509_NAME* name = X509_get_subject_name(cert);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+							   reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+	X509_set_issuer_name(cert, name);
+	bool ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+	FILE* f = std::fopen(cert_path, "w");
+	ok = ok && f && PEM_write_X509(f, cert);
+	if (f)
+		std::fclose(f);
+	f = std::fopen(key_path, "w");
+	ok = ok && f && PEM_write_PrivateKey(f, key, NULL, NULL, 0, NULL, NULL);
+	if (f)
+		std::fclose(f);
+
+	X509_free(cert);
+	EVP_PKEY_free(key);
+	return ok;
+}
+
+static wsv::ServerConfig tls_config()
+{
+	wsv::ServerConfig config;
+	config.ssl = true;
+	config.ssl_certificate = CERT_PATH;
+	config.ssl_certificate_key = KEY_PATH;
+	return config;
+}
+
+// One client/server pair over a non-blocking socketpair
+struct Pair
+{
+	int				fds[2];
+	SSL*			client;
+	TlsConnection*	server;
+
+	Pair(SSL_CTX* client_ctx, const TlsContext& server_ctx)
+	{
+		if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) < 0)
+			throw std::runtime_error("socketpair failed");
+		client = SSL_new(client_ctx);
+		SSL_set_fd(client, fds[0]);
+		SSL_set_connect_state(client);
+		server = new TlsConnection(server_ctx, fds[1]);
+	}
+
+	~Pair()
+	{
+		delete server;
+		SSL_free(client);
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	// Alternate both sides until each has finished its handshake
+	bool handshake()
+	{
+		bool client_done = false;
+		bool server_done = false;
+		for (int i = 0; i < 50 && !(client_done && server_done); ++i)
+		{
+			if (!client_done)
+			{
+				int ret = SSL_do_handshake(client);
+				int error = SSL_get_error(client, ret);
+				if (ret == 1)
+					client_done = true;
+				else if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE)
+					return false;
+			}
+			if (!server_done)
+			{
+				TlsConnection::Result result = server->handshake();
+				if (result == TlsConnection::TLS_DONE)
+					server_done = true;
+				else if (result == TlsConnection::TLS_FAILED)
+					return false;
+			}
+		}
+		return client_done && server_done;
+	}
+
+	// Server -> client message; the client also takes in the session tickets
+	std::string serverToClient(const std::string& data)
+	{
+		if (server->write(data.c_str(), data.size()) != static_cast<ssize_t>(data.size()))
+			throw std::runtime_error("Server write failed");
+		char buffer[256];
+		int n = SSL_read(client, buffer, sizeof(buffer));
+		return n > 0 ? std::string(buffer, n) : "";
+	}
+
+private:
+	Pair(const Pair&);
+	Pair& operator=(const Pair&);
+};
+
+static SSL_CTX* client_context(int max_version)
+{
+	SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+	SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+	if (max_version)
+		SSL_CTX_set_max_proto_version(ctx, max_version);
+	return ctx;
+}
+
+// Full handshake, then a second connection offering the first one's session
+static bool resumes(const TlsContext& server_ctx, int max_version)
+{
+	SSL_CTX* client_ctx = client_context(max_version);
+	SSL_SESSION* session = NULL;
+	bool resumed = false;
+	{
+		Pair first(client_ctx, server_ctx);
+		if (!first.handshake())
+			throw std::runtime_error("First handshake failed");
+		if (first.server->isResumed())
+			throw std::runtime_error("First handshake reported as resumed");
+		first.serverToClient("hello");
+		session = SSL_get1_session(first.client);
+		// Like Server::_close_client: a session survives only a clean shutdown
+		first.server->shutdown();
+		SSL_shutdown(first.client);
+	}
+	{
+		Pair second(client_ctx, server_ctx);
+		SSL_set_session(second.client, session);
+		if (!second.handshake())
+			throw std::runtime_error("Second handshake failed");
+		resumed = second.server->isResumed();
+	}
+	SSL_SESSION_free(session);
+	SSL_CTX_free(client_ctx);
+	return resumed;
+}
+
+// ==================== Tests ====================
+
+void test_tls_config(TestRunner& runner)
+{
+	runner.startTest("ConfigParser reads listen ... ssl and the ssl_* directives");
+	try {
+		std::ofstream out(CONF_PATH);
+		out << "server {\n"
+			<< "    listen 127.0.0.1:8443 ssl http2;\n"
+			<< "    ssl_certificate certs/server.crt;\n"
+			<< "    ssl_certificate_key certs/server.key;\n"
+			<< "    ssl_session_cache off;\n"
+			<< "    ssl_session_timeout 10m;\n"
+			<< "    ssl_session_tickets off;\n"
+			<< "    ssl_ktls off;\n"
+			<< "}\n";
+		out.close();
+
+		wsv::ConfigParser parser(CONF_PATH);
+		parser.parse();
+		const wsv::ServerConfig& server = parser.getServers()[0];
+		if (!server.ssl || !server.http2 || server.listen_port != 8443 || server.host != "127.0.0.1")
+			throw std::runtime_error("listen ... ssl not parsed");
+		if (server.ssl_certificate != "certs/server.crt" || server.ssl_certificate_key != "certs/server.key")
+			throw std::runtime_error("Certificate paths not parsed");
+		if (server.ssl_session_cache != 0 || server.ssl_session_timeout != 600)
+			throw std::runtime_error("Session cache settings not parsed");
+		if (server.ssl_session_tickets || server.ssl_ktls)
+			throw std::runtime_error("on/off switches not parsed");
+
+		const char* bad[] = {
+			"server {\n    listen 8443 ssl;\n}\n",     // No certificate
+			"server {\n    listen 8443 tls;\n}\n",     // Unknown parameter
+			"server {\n    listen 8443 quic;\n}\n",    // No QUIC stack
+			"server {\n    listen 8443 ssl;\n    ssl_certificate a;\n    ssl_certificate_key b;\n"
+			"    ssl_session_cache off;\n    ssl_early_data on;\n}\n"  // 0-RTT without anti-replay
+		};
+		for (size_t i = 0; i < 4; ++i)
+		{
+			std::ofstream bad_out(CONF_PATH);
+			bad_out << bad[i];
+			bad_out.close();
+			wsv::ConfigParser bad_parser(CONF_PATH);
+			bool thrown = false;
+			try { bad_parser.parse(); } catch (const std::exception&) { thrown = true; }
+			if (!thrown)
+				throw std::runtime_error("Invalid config accepted: " + std::string(bad[i]));
+		}
+		std::remove(CONF_PATH);
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		std::remove(CONF_PATH);
+		runner.fail(e.what());
+	}
+}
+
+void test_tls_bad_certificate(TestRunner& runner)
+{
+	runner.startTest("TlsContext refuses a missing certificate or a mismatched key");
+	try {
+		wsv::ServerConfig config = tls_config();
+		config.ssl_certificate = "/nonexistent/server.crt";
+		bool thrown = false;
+		try { TlsContext context(config); } catch (const std::runtime_error&) { thrown = true; }
+		if (!thrown)
+			throw std::runtime_error("Missing certificate accepted");
+
+		// Key of another certificate
+		const char* other_cert = "/tmp/webserv_test_tls_other.crt";
+		const char* other_key = "/tmp/webserv_test_tls_other.key";
+		if (!write_self_signed(other_cert, other_key))
+			throw std::runtime_error("Cannot create the second certificate");
+		config = tls_config();
+		config.ssl_certificate_key = other_key;
+		thrown = false;
+		try { TlsContext context(config); } catch (const std::runtime_error&) { thrown = true; }
+		std::remove(other_cert);
+		std::remove(other_key);
+		if (!thrown)
+			throw std::runtime_error("Mismatched key accepted");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_tls_handshake_and_data(TestRunner& runner)
+{
+	runner.startTest("Non-blocking handshake, data both ways, EAGAIN and close_notify");
+	try {
+		TlsContext server_ctx(tls_config());
+		SSL_CTX* client_ctx = client_context(0);
+		{
+			Pair pair(client_ctx, server_ctx);
+
+			// Nothing from the client yet: the server waits
+			if (pair.server->handshake() != TlsConnection::TLS_WANT_READ)
+				throw std::runtime_error("Handshake did not wait for the ClientHello");
+			if (!pair.handshake())
+				throw std::runtime_error("Handshake failed");
+			if (!pair.server->isEstablished() || pair.server->version() != "TLSv1.3")
+				throw std::runtime_error("Unexpected version " + pair.server->version());
+
+			char buffer[64];
+			errno = 0;
+			if (pair.server->read(buffer, sizeof(buffer)) != -1 || errno != EAGAIN)
+				throw std::runtime_error("Empty socket not reported as EAGAIN");
+
+			const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+			SSL_write(pair.client, request.c_str(), request.size());
+			ssize_t n = pair.server->read(buffer, sizeof(buffer));
+			if (n != static_cast<ssize_t>(request.size()) || std::string(buffer, n) != request)
+				throw std::runtime_error("Request not decrypted");
+
+			if (pair.serverToClient("HTTP/1.1 200 OK\r\n\r\n") != "HTTP/1.1 200 OK\r\n\r\n")
+				throw std::runtime_error("Response not decrypted");
+
+			// Sockets without a kernel TLS ULP keep encrypting in OpenSSL
+			if (pair.server->kernelSend())
+				throw std::runtime_error("kTLS reported on a UNIX socket");
+
+			SSL_shutdown(pair.client);
+			if (pair.server->read(buffer, sizeof(buffer)) != 0)
+				throw std::runtime_error("close_notify not reported as end of stream");
+		}
+		SSL_CTX_free(client_ctx);
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_tls_resumption(TestRunner& runner)
+{
+	runner.startTest("Session resumption with tickets, with the session cache, and neither");
+	try {
+		wsv::ServerConfig config = tls_config();
+
+		// TLS 1.3 stateless tickets
+		TlsContext tickets(config);
+		if (!resumes(tickets, 0))
+			throw std::runtime_error("TLS 1.3 ticket not resumed");
+
+		// Tickets off: TLS 1.2 session IDs and TLS 1.3 stateful tickets from the cache
+		config.ssl_session_tickets = false;
+		TlsContext cache(config);
+		if (!resumes(cache, TLS1_2_VERSION))
+			throw std::runtime_error("TLS 1.2 session ID not resumed");
+		if (!resumes(cache, 0))
+			throw std::runtime_error("TLS 1.3 cached session not resumed");
+
+		config.ssl_session_cache = 0;
+		TlsContext none(config);
+		if (resumes(none, TLS1_2_VERSION))
+			throw std::runtime_error("Resumed without cache and tickets");
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_tls_early_data(TestRunner& runner)
+{
+	runner.startTest("0-RTT request on resumption, 0.5-RTT response, then a normal connection");
+	try {
+		wsv::ServerConfig config = tls_config();
+		config.ssl_early_data = true;
+		TlsContext server_ctx(config);
+		SSL_CTX* client_ctx = client_context(0);
+
+		SSL_SESSION* session = NULL;
+		{
+			Pair first(client_ctx, server_ctx);
+			if (!first.handshake())
+				throw std::runtime_error("First handshake failed");
+			if (first.server->isEarly())
+				throw std::runtime_error("Full handshake reported as 0-RTT");
+			first.serverToClient("hello");
+			session = SSL_get1_session(first.client);
+			first.server->shutdown();
+			SSL_shutdown(first.client);
+		}
+		if (SSL_SESSION_get_max_early_data(session) != TlsContext::MAX_EARLY_DATA)
+			throw std::runtime_error("Ticket does not allow early data");
+
+		{
+			Pair second(client_ctx, server_ctx);
+			SSL_set_session(second.client, session);
+
+			// ClientHello and the request leave together
+			const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+			size_t written = 0;
+			if (SSL_write_early_data(second.client, request.c_str(), request.size(), &written) != 1)
+				throw std::runtime_error("Client could not send early data");
+
+			if (second.server->handshake() != TlsConnection::TLS_DONE)
+				throw std::runtime_error("Early data did not make the connection usable");
+			if (!second.server->isEarly() || !second.server->hasPendingData())
+				throw std::runtime_error("Early data not reported");
+			char buffer[128];
+			ssize_t n = second.server->read(buffer, sizeof(buffer));
+			if (n != static_cast<ssize_t>(request.size()) || std::string(buffer, n) != request)
+				throw std::runtime_error("0-RTT request not read");
+
+			// Answered before the client's Finished arrives
+			const std::string response = "HTTP/1.1 200 OK\r\n\r\n";
+			if (second.server->write(response.c_str(), response.size()) != static_cast<ssize_t>(response.size()))
+				throw std::runtime_error("0.5-RTT write failed");
+			int ret;
+			while ((ret = SSL_do_handshake(second.client)) != 1)
+				if (SSL_get_error(second.client, ret) != SSL_ERROR_WANT_READ)
+					throw std::runtime_error("Client handshake failed");
+			if (SSL_get_early_data_status(second.client) != SSL_EARLY_DATA_ACCEPTED)
+				throw std::runtime_error("Client sees early data rejected");
+			n = SSL_read(second.client, buffer, sizeof(buffer));
+			if (n <= 0 || std::string(buffer, n) != response)
+				throw std::runtime_error("0.5-RTT response not received");
+
+			// EndOfEarlyData + Finished: the handshake completes inside read()
+			errno = 0;
+			if (second.server->read(buffer, sizeof(buffer)) != -1 || errno != EAGAIN)
+				throw std::runtime_error("Handshake completion returned data");
+			if (second.server->isEarly())
+				throw std::runtime_error("Still in early data after Finished");
+			SSL_write(second.client, "next", 4);
+			if (second.server->read(buffer, sizeof(buffer)) != 4)
+				throw std::runtime_error("Data after the handshake not read");
+		}
+
+		// The ticket was used for early data once: a replay is refused
+		{
+			Pair replay(client_ctx, server_ctx);
+			SSL_set_session(replay.client, session);
+			size_t written = 0;
+			SSL_write_early_data(replay.client, "GET", 3, &written);
+			replay.server->handshake();
+			if (replay.server->isEarly())
+				throw std::runtime_error("Replayed early data accepted");
+		}
+		SSL_SESSION_free(session);
+		SSL_CTX_free(client_ctx);
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+void test_tls_alpn(TestRunner& runner)
+{
+	runner.startTest("ALPN selects h2 on http2 listeners, http/1.1 otherwise");
+	try {
+		wsv::ServerConfig config = tls_config();
+		config.http2 = true;
+		TlsContext server_ctx(config);
+		TlsContext http1_ctx(tls_config());
+		SSL_CTX* client_ctx = client_context(0);
+
+		const std::string offers[] = {
+			std::string("\x08http/1.1\x02h2", 12),
+			std::string("\x08http/1.1", 9),
+			std::string("\x06spdy/3", 7),
+			""
+		};
+		const char* expected[] = { "h2", "http/1.1", "", "" };
+		for (size_t i = 0; i < 4; ++i)
+		{
+			Pair pair(client_ctx, server_ctx);
+			if (!offers[i].empty())
+				SSL_set_alpn_protos(pair.client, reinterpret_cast<const unsigned char*>(offers[i].data()),
+									offers[i].size());
+			if (!pair.handshake())
+				throw std::runtime_error("Handshake failed");
+			if (pair.server->alpn() != expected[i])
+				throw std::runtime_error("Selected '" + pair.server->alpn() + "', expected '"
+										 + expected[i] + "'");
+		}
+
+		Pair http1(client_ctx, http1_ctx);
+		SSL_set_alpn_protos(http1.client, reinterpret_cast<const unsigned char*>(offers[0].data()),
+							offers[0].size());
+		if (!http1.handshake() || http1.server->alpn() != "http/1.1")
+			throw std::runtime_error("h2 selected without the http2 flag");
+		SSL_CTX_free(client_ctx);
+
+		runner.pass();
+	} catch (const std::exception& e) {
+		runner.fail(e.what());
+	}
+}
+
+int main()
+{
+	std::cout << BOLD << "========================================" << RESET << std::endl;
+	std::cout << BOLD << "  TLS Test Suite" << RESET << std::endl;
+	std::cout << BOLD << "========================================" << RESET << std::endl << std::endl;
+
+	TestRunner runner;
+
+	test_tls_config(runner);
+
+	if (!write_self_signed(CERT_PATH, KEY_PATH))
+	{
+		std::cerr << "Cannot create the test certificate" << std::endl;
+		return 1;
+	}
+	test_tls_bad_certificate(runner);
+	test_tls_handshake_and_data(runner);
+	test_tls_resumption(runner);
+	test_tls_early_data(runner);
+	test_tls_alpn(runner);
+	std::remove(CERT_PATH);
+	std::remove(KEY_PATH);
+
+	runner.summary();
+
+	return runner.allPassed() ? 0 : 1;
+}
@@ -1,16 +1,28 @@
 TEST_PARSER		:= test_parser
 TEST_PARSER_SRC	:= test/test_configparser.cpp \
 				   src/config/ConfigParser.cpp \
+				   src/config/LocationTrie.cpp \
+				   src/http/HttpResponse.cpp \
 				   src/utils/StringUtils.cpp
 
 TEST_SERVER		:= test_server
 TEST_SERVER_SRC	:= test/test_server.cpp \
 				   src/config/ConfigParser.cpp \
+				   src/config/LocationTrie.cpp \
 				   src/server/Server.cpp \
 				   src/server/Server_helper.cpp \
+				   src/server/Server_proxy.cpp \
+				   src/server/Server_http2.cpp \
+				   src/server/Server_tls.cpp \
+				   src/server/Tls.cpp \
 				   src/server/Client.cpp \
+				   src/server/UpstreamPool.cpp \
+				   src/server/UpstreamGroup.cpp \
 				   src/http/HttpRequest.cpp \
 				   src/http/HttpResponse.cpp \
+				   src/http/HttpProxy.cpp \
+				   src/http/Hpack.cpp \
+				   src/http/Http2.cpp \
 				   src/router/RequestHandler.cpp \
 				   src/router/FileHandler.cpp \
 				   src/router/CgiRequestHandler.cpp \
@@ -18,23 +30,71 @@ TEST_SERVER_SRC	:= test/test_server.cpp \
 				   src/router/ErrorHandler.cpp \
 				   src/utils/Logger.cpp \
 				   src/utils/StringUtils.cpp \
-				   src/cgi/CgiHandler.cpp
+				   src/utils/ByteScan.cpp \
+				   src/utils/SharedBuffer.cpp \
+				   src/utils/RecvBuffer.cpp \
+				   src/utils/Arena.cpp \
+				   src/cgi/CgiHandler.cpp \
+				   src/cgi/FastCgi.cpp \
+				   src/cgi/CgiCache.cpp \
+				   src/cgi/CgiLimiter.cpp
 
 TEST_HTTP_REQUEST		:= test_httprequest
 TEST_HTTP_REQUEST_SRC	:= test/test_httprequest.cpp \
 						   src/http/HttpRequest.cpp \
-						   src/utils/StringUtils.cpp
+						   src/utils/StringUtils.cpp \
+						   src/utils/ByteScan.cpp \
+						   src/utils/SharedBuffer.cpp \
+						   src/utils/RecvBuffer.cpp
 
 TEST_HTTP_RESPONSE		:= test_httpresponse
 TEST_HTTP_RESPONSE_SRC	:= test/test_httpresponse.cpp \
 						   src/http/HttpResponse.cpp \
 						   src/utils/StringUtils.cpp
 
+TEST_HTTP_PROXY		:= test_httpproxy
+TEST_HTTP_PROXY_SRC	:= test/test_httpproxy.cpp \
+					   src/http/HttpProxy.cpp \
+					   src/server/UpstreamGroup.cpp \
+					   src/config/ConfigParser.cpp \
+					   src/config/LocationTrie.cpp \
+					   src/http/HttpRequest.cpp \
+					   src/http/HttpResponse.cpp \
+					   src/utils/StringUtils.cpp \
+					   src/utils/ByteScan.cpp \
+					   src/utils/SharedBuffer.cpp \
+					   src/utils/RecvBuffer.cpp
+
+TEST_HTTP2		:= test_http2
+TEST_HTTP2_SRC	:= test/test_http2.cpp \
+				   src/http/Hpack.cpp \
+				   src/http/Http2.cpp \
+				   src/http/HttpRequest.cpp \
+				   src/http/HttpResponse.cpp \
+				   src/utils/StringUtils.cpp \
+				   src/utils/ByteScan.cpp \
+				   src/utils/SharedBuffer.cpp \
+				   src/utils/RecvBuffer.cpp
+
+TEST_TLS		:= test_tls
+TEST_TLS_SRC	:= test/test_tls.cpp \
+				   src/server/Tls.cpp \
+				   src/config/ConfigParser.cpp \
+				   src/config/LocationTrie.cpp \
+				   src/http/HttpResponse.cpp \
+				   src/utils/StringUtils.cpp
+
 TEST_REQUEST_HANDLER    := test_requesthandler
 TEST_REQUEST_HANDLER_SRC := test/test_requesthandler.cpp \
                            src/config/ConfigParser.cpp \
+                           src/config/LocationTrie.cpp \
+                           src/server/Client.cpp \
+                           src/server/Tls.cpp \
                            src/http/HttpRequest.cpp \
                            src/http/HttpResponse.cpp \
+                           src/http/HttpProxy.cpp \
+                           src/http/Hpack.cpp \
+                           src/http/Http2.cpp \
                            src/router/RequestHandler.cpp \
                            src/router/FileHandler.cpp \
                            src/router/CgiRequestHandler.cpp \
@@ -42,15 +102,78 @@ TEST_REQUEST_HANDLER_SRC := test/test_requesthandler.cpp \
                            src/router/ErrorHandler.cpp \
                            src/utils/Logger.cpp \
                            src/utils/StringUtils.cpp \
-                           src/cgi/CgiHandler.cpp
+                           src/utils/ByteScan.cpp \
+                           src/utils/SharedBuffer.cpp \
+                           src/utils/RecvBuffer.cpp \
+                           src/utils/Arena.cpp \
+                           src/cgi/CgiHandler.cpp \
+                           src/cgi/FastCgi.cpp \
+                           src/cgi/CgiCache.cpp \
+                           src/cgi/CgiLimiter.cpp
 
 TEST_CGI := test_cgi
 TEST_CGI_SRC := test/test_cgi.cpp \
                 src/cgi/CgiHandler.cpp \
+                src/cgi/FastCgi.cpp \
+                src/cgi/CgiCache.cpp \
+                src/cgi/CgiLimiter.cpp \
+                src/config/ConfigParser.cpp \
+                src/config/LocationTrie.cpp \
+                src/http/HttpRequest.cpp \
+                src/http/HttpResponse.cpp \
                 src/utils/StringUtils.cpp \
+                src/utils/ByteScan.cpp \
+                src/utils/SharedBuffer.cpp \
+                src/utils/RecvBuffer.cpp \
                 src/utils/Logger.cpp
 
-TEST_EXECUTABLES := $(TEST_PARSER) $(TEST_SERVER) $(TEST_HTTP_REQUEST) $(TEST_HTTP_RESPONSE) $(TEST_REQUEST_HANDLER) $(TEST_CGI)
+BENCH_SCAN		:= bench_scan
+BENCH_SCAN_SRC	:= test/bench_scan.cpp \
+				   src/utils/ByteScan.cpp \
+				   src/utils/SharedBuffer.cpp \
+				   src/utils/RecvBuffer.cpp \
+				   src/http/HttpRequest.cpp \
+				   src/utils/StringUtils.cpp
+
+BENCH_ALLOC		:= bench_alloc
+BENCH_ALLOC_SRC	:= test/bench_alloc.cpp \
+				   src/config/ConfigParser.cpp \
+				   src/config/LocationTrie.cpp \
+				   src/server/Client.cpp \
+				   src/server/Tls.cpp \
+				   src/http/HttpRequest.cpp \
+				   src/http/HttpResponse.cpp \
+				   src/http/HttpProxy.cpp \
+				   src/http/Hpack.cpp \
+				   src/http/Http2.cpp \
+				   src/router/RequestHandler.cpp \
+				   src/router/FileHandler.cpp \
+				   src/router/CgiRequestHandler.cpp \
+				   src/router/UploadHandler.cpp \
+				   src/router/ErrorHandler.cpp \
+				   src/utils/Logger.cpp \
+				   src/utils/StringUtils.cpp \
+				   src/utils/ByteScan.cpp \
+				   src/utils/SharedBuffer.cpp \
+				   src/utils/RecvBuffer.cpp \
+				   src/utils/Arena.cpp \
+				   src/cgi/CgiHandler.cpp \
+				   src/cgi/FastCgi.cpp \
+				   src/cgi/CgiCache.cpp \
+				   src/cgi/CgiLimiter.cpp
+
+BENCH_RESPONSE		:= bench_response
+BENCH_RESPONSE_SRC	:= test/bench_response.cpp \
+					   src/http/HttpResponse.cpp
+
+BENCH_ROUTES		:= bench_routes
+BENCH_ROUTES_SRC	:= test/bench_routes.cpp \
+				   src/config/ConfigParser.cpp \
+				   src/config/LocationTrie.cpp \
+				   src/http/HttpResponse.cpp \
+				   src/utils/StringUtils.cpp
+
+TEST_EXECUTABLES := $(TEST_PARSER) $(TEST_SERVER) $(TEST_HTTP_REQUEST) $(TEST_HTTP_RESPONSE) $(TEST_HTTP_PROXY) $(TEST_HTTP2) $(TEST_TLS) $(TEST_REQUEST_HANDLER) $(TEST_CGI)
 
 # ----- Test Rules -----
 check: $(TEST_EXECUTABLES)
@@ -62,16 +185,41 @@ check: $(TEST_EXECUTABLES)
 	./$(TEST_HTTP_REQUEST)
 	@echo "\n----- Running HttpResponse tests... -----"
 	./$(TEST_HTTP_RESPONSE)
+	@echo "\n----- Running HttpProxy tests... -----"
+	./$(TEST_HTTP_PROXY)
+	@echo "\n----- Running HTTP/2 tests... -----"
+	./$(TEST_HTTP2)
+	@echo "\n----- Running TLS tests... -----"
+	./$(TEST_TLS)
 	@echo "\n----- Running RequestHandler tests... -----"
 	./$(TEST_REQUEST_HANDLER)
 	@echo "\n----- Running CGI tests... -----"
 	./$(TEST_CGI)
 
+# Microbenchmarks, optimized like a release build would be
+bench: $(BENCH_SCAN) $(BENCH_ALLOC) $(BENCH_RESPONSE) $(BENCH_ROUTES)
+	./$(BENCH_SCAN)
+	./$(BENCH_ALLOC)
+	./$(BENCH_RESPONSE)
+	./$(BENCH_ROUTES)
+
+$(BENCH_SCAN): $(BENCH_SCAN_SRC)
+	$(CC) $(FLAG) -O2 $(INCLUDE) $(BENCH_SCAN_SRC) -o $(BENCH_SCAN)
+
+$(BENCH_ALLOC): $(BENCH_ALLOC_SRC)
+	$(CC) $(FLAG) -O2 $(INCLUDE) $(BENCH_ALLOC_SRC) -o $(BENCH_ALLOC) $(LIBS)
+
+$(BENCH_RESPONSE): $(BENCH_RESPONSE_SRC)
+	$(CC) $(FLAG) -O2 $(INCLUDE) $(BENCH_RESPONSE_SRC) -o $(BENCH_RESPONSE)
+
+$(BENCH_ROUTES): $(BENCH_ROUTES_SRC)
+	$(CC) $(FLAG) -O2 $(INCLUDE) $(BENCH_ROUTES_SRC) -o $(BENCH_ROUTES)
+
 $(TEST_PARSER): $(TEST_PARSER_SRC)
 	$(CC) $(FLAG) $(INCLUDE) $(TEST_PARSER_SRC) -o $(TEST_PARSER)
 
 $(TEST_SERVER): $(TEST_SERVER_SRC)
-	$(CC) $(FLAG) $(INCLUDE) $(TEST_SERVER_SRC) -o $(TEST_SERVER)
+	$(CC) $(FLAG) $(INCLUDE) $(TEST_SERVER_SRC) -o $(TEST_SERVER) $(LIBS)
 
 $(TEST_HTTP_REQUEST): $(TEST_HTTP_REQUEST_SRC)
 	$(CC) $(FLAG) $(INCLUDE) $(TEST_HTTP_REQUEST_SRC) -o $(TEST_HTTP_REQUEST)
@@ -79,8 +227,17 @@ $(TEST_HTTP_REQUEST): $(TEST_HTTP_REQUEST_SRC)
 $(TEST_HTTP_RESPONSE): $(TEST_HTTP_RESPONSE_SRC)
 	$(CC) $(FLAG) $(INCLUDE) $(TEST_HTTP_RESPONSE_SRC) -o $(TEST_HTTP_RESPONSE)
 
+$(TEST_HTTP_PROXY): $(TEST_HTTP_PROXY_SRC)
+	$(CC) $(FLAG) $(INCLUDE) $(TEST_HTTP_PROXY_SRC) -o $(TEST_HTTP_PROXY)
+
+$(TEST_HTTP2): $(TEST_HTTP2_SRC)
+	$(CC) $(FLAG) $(INCLUDE) $(TEST_HTTP2_SRC) -o $(TEST_HTTP2)
+
+$(TEST_TLS): $(TEST_TLS_SRC)
+	$(CC) $(FLAG) $(INCLUDE) $(TEST_TLS_SRC) -o $(TEST_TLS) $(LIBS)
+
 $(TEST_REQUEST_HANDLER): $(TEST_REQUEST_HANDLER_SRC)
-	$(CC) $(FLAG) $(INCLUDE) $(TEST_REQUEST_HANDLER_SRC) -o $(TEST_REQUEST_HANDLER)
+	$(CC) $(FLAG) $(INCLUDE) $(TEST_REQUEST_HANDLER_SRC) -o $(TEST_REQUEST_HANDLER) $(LIBS)
 
 $(TEST_CGI): $(TEST_CGI_SRC)
 	$(CC) $(FLAG) $(INCLUDE) $(TEST_CGI_SRC) -o $(TEST_CGI)
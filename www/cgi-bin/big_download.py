@@ -0,0 +1,18 @@
+#!/usr/bin/env python3
+# Large body with Content-Length: relayed to the client with splice()
+# Size in MiB from the query string, e.g. /cgi-bin/big_download.py?mb=64
+import os
+import sys
+
+mb = 16
+for part in os.environ.get("QUERY_STRING", "").split("&"):
+    if part.startswith("mb=") and part[3:].isdigit():
+        mb = int(part[3:])
+
+chunk = b"B" * (1024 * 1024)
+out = sys.stdout.buffer
+out.write(b"Content-Type: application/octet-stream\r\n")
+out.write(b"Content-Length: %d\r\n\r\n" % (mb * len(chunk)))
+for _ in range(mb):
+    out.write(chunk)
+out.flush()
@@ -0,0 +1,10 @@
+#!/usr/bin/env python3
+import os
+import sys
+import time
+
+# Finish the response, close stdout, then keep running for a while
+sys.stdout.write("Content-Type: text/plain\r\n\r\nstdout closed early\n")
+sys.stdout.flush()
+os.close(1)
+time.sleep(3)
@@ -0,0 +1,10 @@
+#!/usr/bin/env python3
+import os
+
+# Authorize, then let the server send the file itself
+if "token=secret" not in os.environ.get("QUERY_STRING", ""):
+    print("Status: 403 Forbidden\r\nContent-Type: text/plain\r\n\r\n", end="")
+    print("Forbidden")
+else:
+    print("X-Accel-Redirect: /index.html\r\n"
+          "Content-Disposition: attachment; filename=\"index.html\"\r\n\r\n", end="")